@@ -0,0 +1,1280 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ *
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+/* Headless benchmark for the burn pipeline. Each scenario builds a session
+ * the way the application would, runs it through BraseroBurn and reports
+ * wall time, CPU time and throughput for every stage (action) along with
+ * the per job telemetry. Nothing here needs a display or a real drive:
+ * outputs are images and disc sources are images exposed through the
+ * file backed drives (libbrasero-media/scsi-fake.c) linked into this
+ * program. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <gio/gio.h>
+
+#include "brasero-media.h"
+#include "brasero-drive.h"
+#include "brasero-drive-priv.h"
+
+#include "brasero-burn-lib.h"
+#include "brasero-burn.h"
+#include "brasero-session.h"
+#include "brasero-status.h"
+#include "brasero-track-data-cfg.h"
+#include "brasero-track-stream-cfg.h"
+#include "brasero-track-image.h"
+#include "brasero-track-disc.h"
+#include "brasero-xfer.h"
+#include "burn-image-format.h"
+
+typedef struct _BraseroBenchStage BraseroBenchStage;
+struct _BraseroBenchStage {
+	BraseroBurnAction action;
+
+	gint64 wall;
+	gint64 cpu;
+};
+
+typedef struct _BraseroBench BraseroBench;
+struct _BraseroBench {
+	const gchar *name;
+
+	/* set while a stage is running */
+	BraseroBurnAction action;
+	gint64 stage_wall;
+	gint64 stage_cpu;
+
+	GSList *stages;
+
+	goffset bytes;
+	gint64 wall;
+	gint64 cpu;
+
+	/* Used as a baseline when the scenario has one */
+	gint64 raw_wall;
+};
+
+static gchar *scenario = NULL;
+static gchar *data_source = NULL;
+static gchar *image_source = NULL;
+static gchar **audio_sources = NULL;
+static gchar *output_dir = NULL;
+static gint iterations = 1;
+static gint jobs = 4;
+static gint entries = 1000000;
+
+static const GOptionEntry options [] = {
+	{ "scenario", 's', 0, G_OPTION_ARG_STRING, &scenario,
+	  "Scenario to run: data, checksum, audio, copy, stage, sheet, graft or all (default)",
+	  "SCENARIO" },
+	{ "data", 'd', 0, G_OPTION_ARG_FILENAME, &data_source,
+	  "File or directory to put into the data image",
+	  "PATH" },
+	{ "image", 'i', 0, G_OPTION_ARG_FILENAME, &image_source,
+	  "ISO image to checksum and to expose as a file backed disc",
+	  "PATH" },
+	{ "audio", 'a', 0, G_OPTION_ARG_FILENAME_ARRAY, &audio_sources,
+	  "Audio file to decode (can be given several times)",
+	  "PATH" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+	  "Directory where images are written (default: temporary directory)",
+	  "PATH" },
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of times each scenario is run",
+	  "N" },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+	  "Number of concurrent copies for the stage scenario (default: 4)",
+	  "N" },
+	{ "entries", 'e', 0, G_OPTION_ARG_INT, &entries,
+	  "Number of synthetic files for the graft scenario (default: 1000000)",
+	  "N" },
+	{ NULL }
+};
+
+static gint64
+brasero_bench_cpu_time (void)
+{
+	struct rusage self, children;
+
+	/* Most of the work is done by helper processes (genisoimage, wodim,
+	 * ...) so account for them as well. Note that children are only
+	 * accounted for once they have been waited for. */
+	getrusage (RUSAGE_SELF, &self);
+	getrusage (RUSAGE_CHILDREN, &children);
+
+	return (gint64) (self.ru_utime.tv_sec + self.ru_stime.tv_sec +
+			 children.ru_utime.tv_sec + children.ru_stime.tv_sec) * G_USEC_PER_SEC +
+	       (self.ru_utime.tv_usec + self.ru_stime.tv_usec +
+		children.ru_utime.tv_usec + children.ru_stime.tv_usec);
+}
+
+static glong
+brasero_bench_peak_rss (void)
+{
+	struct rusage usage;
+
+	/* In kilobytes and a high-water mark for the whole process */
+	getrusage (RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static gdouble
+brasero_bench_rate (goffset bytes,
+		    gint64 usec)
+{
+	if (usec <= 0)
+		return 0.0;
+
+	return (gdouble) bytes / (1024.0 * 1024.0) / ((gdouble) usec / G_USEC_PER_SEC);
+}
+
+static void
+brasero_bench_stage_close (BraseroBench *bench)
+{
+	BraseroBenchStage *stage;
+
+	if (bench->action == BRASERO_BURN_ACTION_NONE)
+		return;
+
+	stage = g_new0 (BraseroBenchStage, 1);
+	stage->action = bench->action;
+	stage->wall = g_get_monotonic_time () - bench->stage_wall;
+	stage->cpu = brasero_bench_cpu_time () - bench->stage_cpu;
+	bench->stages = g_slist_append (bench->stages, stage);
+
+	bench->action = BRASERO_BURN_ACTION_NONE;
+}
+
+static void
+brasero_bench_action_changed_cb (BraseroBurn *burn,
+				 BraseroBurnAction action,
+				 BraseroBench *bench)
+{
+	if (action == bench->action)
+		return;
+
+	brasero_bench_stage_close (bench);
+
+	if (action == BRASERO_BURN_ACTION_NONE
+	||  action == BRASERO_BURN_ACTION_FINISHED)
+		return;
+
+	bench->action = action;
+	bench->stage_wall = g_get_monotonic_time ();
+	bench->stage_cpu = brasero_bench_cpu_time ();
+}
+
+static BraseroBurnResult
+brasero_bench_continue_cb (BraseroBurn *burn,
+			   gpointer user_data)
+{
+	/* All warnings are accepted: nothing here touches a real disc */
+	return BRASERO_BURN_OK;
+}
+
+static BraseroBurnResult
+brasero_bench_insert_media_cb (BraseroBurn *burn,
+			       BraseroDrive *drive,
+			       BraseroBurnError error,
+			       BraseroMedia media,
+			       gpointer user_data)
+{
+	/* There is nobody to insert a disc */
+	return BRASERO_BURN_CANCEL;
+}
+
+static BraseroBurnResult
+brasero_bench_location_request_cb (BraseroBurn *burn,
+				   GError *error,
+				   gboolean is_temporary,
+				   gpointer user_data)
+{
+	return BRASERO_BURN_CANCEL;
+}
+
+static BraseroBurnResult
+brasero_bench_install_missing_cb (BraseroBurn *burn,
+				  BraseroPluginErrorType type,
+				  const gchar *detail,
+				  gpointer user_data)
+{
+	return BRASERO_BURN_CANCEL;
+}
+
+static BraseroBurnResult
+brasero_bench_blank_failure_cb (BraseroBurn *burn,
+				gpointer user_data)
+{
+	return BRASERO_BURN_CANCEL;
+}
+
+static BraseroBurnResult
+brasero_bench_wait_session (BraseroBurnSession *session)
+{
+	BraseroBurnResult result;
+	BraseroStatus *status;
+
+	/* Tracks load their contents (or get their size) asynchronously */
+	status = brasero_status_new ();
+	while (1) {
+		brasero_burn_session_get_status (session, status);
+		result = brasero_status_get_result (status);
+		if (result != BRASERO_BURN_NOT_READY
+		&&  result != BRASERO_BURN_RUNNING)
+			break;
+
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_object_unref (status);
+
+	return result;
+}
+
+static void
+brasero_bench_print_telemetry (BraseroBurn *burn)
+{
+	GVariant *telemetry;
+	GVariantIter channels;
+	const gchar *name;
+	GVariantIter *samples;
+
+	telemetry = brasero_burn_get_telemetry (burn);
+	if (!telemetry)
+		return;
+
+	g_variant_iter_init (&channels, telemetry);
+	while (g_variant_iter_loop (&channels, "(&sa(xttxxi))", &name, &samples)) {
+		gint64 time = 0, stall_in = 0, stall_out = 0;
+		guint64 bytes_in = 0, bytes_out = 0;
+		gint fill, fill_min = -1, fill_max = -1;
+		gint64 fill_sum = 0;
+		guint fill_num = 0;
+		guint num = 0;
+
+		while (g_variant_iter_next (samples,
+					    "(xttxxi)",
+					    &time,
+					    &bytes_in,
+					    &bytes_out,
+					    &stall_in,
+					    &stall_out,
+					    &fill)) {
+			num ++;
+			if (fill < 0)
+				continue;
+
+			if (fill_min < 0 || fill < fill_min)
+				fill_min = fill;
+			if (fill > fill_max)
+				fill_max = fill;
+
+			fill_sum += fill;
+			fill_num ++;
+		}
+
+		/* Counters are cumulative so the last sample has totals */
+		printf ("    job %-32s samples %4u in %8.2f MiB/s out %8.2f MiB/s stall in %6.2fs out %6.2fs",
+			name,
+			num,
+			brasero_bench_rate (bytes_in, time),
+			brasero_bench_rate (bytes_out, time),
+			(gdouble) stall_in / G_USEC_PER_SEC,
+			(gdouble) stall_out / G_USEC_PER_SEC);
+
+		if (fill_num)
+			printf (" buffer %d/%d/%d%%",
+				fill_min,
+				(gint) (fill_sum / fill_num),
+				fill_max);
+
+		printf ("\n");
+	}
+
+	g_variant_unref (telemetry);
+}
+
+static void
+brasero_bench_print (BraseroBench *bench,
+		     BraseroBurn *burn)
+{
+	GSList *iter;
+
+	printf ("%s: %" G_GOFFSET_FORMAT " bytes in %.3fs (%.2f MiB/s), cpu %.3fs, peak rss %li KiB\n",
+		bench->name,
+		bench->bytes,
+		(gdouble) bench->wall / G_USEC_PER_SEC,
+		brasero_bench_rate (bench->bytes, bench->wall),
+		(gdouble) bench->cpu / G_USEC_PER_SEC,
+		brasero_bench_peak_rss ());
+
+	if (bench->raw_wall > 0)
+		printf ("    raw read baseline %.3fs (%.2f MiB/s)\n",
+			(gdouble) bench->raw_wall / G_USEC_PER_SEC,
+			brasero_bench_rate (bench->bytes, bench->raw_wall));
+
+	for (iter = bench->stages; iter; iter = iter->next) {
+		BraseroBenchStage *stage = iter->data;
+		gchar *string = NULL;
+
+		brasero_burn_get_action_string (burn, stage->action, &string);
+		printf ("    stage %-32s %8.3fs cpu %8.3fs %8.2f MiB/s\n",
+			string,
+			(gdouble) stage->wall / G_USEC_PER_SEC,
+			(gdouble) stage->cpu / G_USEC_PER_SEC,
+			brasero_bench_rate (bench->bytes, stage->wall));
+		g_free (string);
+	}
+
+	brasero_bench_print_telemetry (burn);
+}
+
+static BraseroBurnResult
+brasero_bench_run (BraseroBench *bench,
+		   BraseroBurnSession *session,
+		   gboolean check)
+{
+	BraseroBurnResult result;
+	GError *error = NULL;
+	BraseroBurn *burn;
+	gint64 cpu;
+	gint64 start;
+
+	result = brasero_bench_wait_session (session);
+	if (result != BRASERO_BURN_OK) {
+		printf ("%s: skipped (session could not be prepared)\n", bench->name);
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	if (!check && brasero_burn_session_can_burn (session, FALSE) != BRASERO_BURN_OK) {
+		printf ("%s: skipped (no plugin can handle this session)\n", bench->name);
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	if (!bench->bytes)
+		brasero_burn_session_get_size (session, NULL, &bench->bytes);
+
+	burn = brasero_burn_new ();
+	g_signal_connect (burn,
+			  "action-changed",
+			  G_CALLBACK (brasero_bench_action_changed_cb),
+			  bench);
+	g_signal_connect (burn,
+			  "disable-joliet",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "warn-data-loss",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "warn-previous-session-loss",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "warn-audio-to-appendable",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "warn-rewritable",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "dummy-success",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "eject-failure",
+			  G_CALLBACK (brasero_bench_continue_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "insert-media",
+			  G_CALLBACK (brasero_bench_insert_media_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "location-request",
+			  G_CALLBACK (brasero_bench_location_request_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "install-missing",
+			  G_CALLBACK (brasero_bench_install_missing_cb),
+			  NULL);
+	g_signal_connect (burn,
+			  "blank-failure",
+			  G_CALLBACK (brasero_bench_blank_failure_cb),
+			  NULL);
+
+	start = g_get_monotonic_time ();
+	cpu = brasero_bench_cpu_time ();
+
+	if (check)
+		result = brasero_burn_check (burn, session, &error);
+	else
+		result = brasero_burn_record (burn, session, &error);
+
+	brasero_bench_stage_close (bench);
+	bench->wall = g_get_monotonic_time () - start;
+	bench->cpu = brasero_bench_cpu_time () - cpu;
+
+	if (result == BRASERO_BURN_OK)
+		brasero_bench_print (bench, burn);
+	else
+		printf ("%s: failed (%s)\n",
+			bench->name,
+			error ? error->message : "unknown error");
+
+	if (error)
+		g_error_free (error);
+
+	g_object_unref (burn);
+	return result;
+}
+
+static void
+brasero_bench_clear (BraseroBench *bench)
+{
+	g_slist_foreach (bench->stages, (GFunc) g_free, NULL);
+	g_slist_free (bench->stages);
+	memset (bench, 0, sizeof (BraseroBench));
+}
+
+static gchar *
+brasero_bench_output (const gchar *name)
+{
+	return g_build_filename (output_dir, name, NULL);
+}
+
+static void
+brasero_bench_remove_output (BraseroBurnSession *session)
+{
+	gchar *image = NULL;
+	gchar *toc = NULL;
+
+	/* Don't let the outputs of an iteration pile up */
+	brasero_burn_session_get_output (session, &image, &toc);
+	if (image) {
+		g_remove (image);
+		g_free (image);
+	}
+
+	if (toc) {
+		g_remove (toc);
+		g_free (toc);
+	}
+}
+
+static BraseroBurnResult
+brasero_bench_data (void)
+{
+	BraseroBurnSession *session;
+	BraseroTrackDataCfg *track;
+	BraseroBench bench = { 0, };
+	BraseroBurnResult result;
+	gchar *output;
+	GFile *file;
+	gchar *uri;
+
+	if (!data_source) {
+		printf ("data: skipped (no --data source)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	bench.name = "data";
+
+	session = brasero_burn_session_new ();
+	track = brasero_track_data_cfg_new ();
+
+	file = g_file_new_for_commandline_arg (data_source);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	brasero_track_data_cfg_add (track, uri, NULL);
+	g_free (uri);
+
+	brasero_burn_session_add_track (session, BRASERO_TRACK (track), NULL);
+	g_object_unref (track);
+
+	output = brasero_bench_output ("data.iso");
+	brasero_burn_session_set_image_output_full (session,
+						    BRASERO_IMAGE_FORMAT_BIN,
+						    output,
+						    NULL);
+	g_free (output);
+
+	brasero_burn_session_set_tmpdir (session, output_dir);
+	result = brasero_bench_run (&bench, session, FALSE);
+
+	brasero_bench_remove_output (session);
+	brasero_bench_clear (&bench);
+	g_object_unref (session);
+	return result;
+}
+
+static gchar *
+brasero_bench_md5 (const gchar *path,
+		   gint64 *wall)
+{
+	GChecksum *checksum;
+	gchar *string;
+	guchar *buffer;
+	gint64 start;
+	gsize bytes;
+	FILE *file;
+
+	file = fopen (path, "r");
+	if (!file)
+		return NULL;
+
+	start = g_get_monotonic_time ();
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+	buffer = g_new (guchar, 1024 * 1024);
+	while ((bytes = fread (buffer, 1, 1024 * 1024, file)) > 0)
+		g_checksum_update (checksum, buffer, bytes);
+
+	*wall = g_get_monotonic_time () - start;
+
+	g_free (buffer);
+	fclose (file);
+
+	string = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+	return string;
+}
+
+static BraseroBurnResult
+brasero_bench_checksum (void)
+{
+	BraseroBurnSession *session;
+	BraseroBench bench = { 0, };
+	BraseroTrackImage *track;
+	BraseroBurnResult result;
+	gchar *checksum;
+	GStatBuf buf;
+
+	if (!image_source) {
+		printf ("checksum: skipped (no --image source)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	if (g_stat (image_source, &buf)) {
+		printf ("checksum: skipped (%s)\n", g_strerror (errno));
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	bench.name = "checksum";
+	bench.bytes = buf.st_size;
+
+	/* The reference sum is computed here so the time it takes is the
+	 * lowest we can hope for: a straight read + MD5 of the image. */
+	checksum = brasero_bench_md5 (image_source, &bench.raw_wall);
+	if (!checksum) {
+		printf ("checksum: skipped (image could not be read)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	session = brasero_burn_session_new ();
+	track = brasero_track_image_new ();
+	brasero_track_image_set_source (track,
+					image_source,
+					NULL,
+					BRASERO_IMAGE_FORMAT_BIN);
+	brasero_track_set_checksum (BRASERO_TRACK (track),
+				    BRASERO_CHECKSUM_MD5,
+				    checksum);
+	g_free (checksum);
+
+	brasero_burn_session_add_track (session, BRASERO_TRACK (track), NULL);
+	g_object_unref (track);
+
+	result = brasero_bench_run (&bench, session, TRUE);
+
+	brasero_bench_clear (&bench);
+	g_object_unref (session);
+	return result;
+}
+
+static BraseroBurnResult
+brasero_bench_audio (void)
+{
+	BraseroBurnSession *session;
+	BraseroBench bench = { 0, };
+	BraseroBurnResult result;
+	gchar *output;
+	gchar *toc;
+	gint i;
+
+	if (!audio_sources || !audio_sources [0]) {
+		printf ("audio: skipped (no --audio source)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	bench.name = "audio";
+
+	session = brasero_burn_session_new ();
+	for (i = 0; audio_sources [i]; i ++) {
+		BraseroTrackStreamCfg *track;
+		GFile *file;
+		gchar *uri;
+
+		file = g_file_new_for_commandline_arg (audio_sources [i]);
+		uri = g_file_get_uri (file);
+		g_object_unref (file);
+
+		/* The track gets its length and format on its own */
+		track = brasero_track_stream_cfg_new ();
+		brasero_track_stream_set_source (BRASERO_TRACK_STREAM (track), uri);
+		g_free (uri);
+
+		brasero_burn_session_add_track (session, BRASERO_TRACK (track), NULL);
+		g_object_unref (track);
+	}
+
+	output = brasero_bench_output ("audio.bin");
+	toc = brasero_bench_output ("audio.cue");
+	brasero_burn_session_set_image_output_full (session,
+						    BRASERO_IMAGE_FORMAT_CUE,
+						    output,
+						    toc);
+	g_free (output);
+	g_free (toc);
+
+	brasero_burn_session_set_tmpdir (session, output_dir);
+	result = brasero_bench_run (&bench, session, FALSE);
+
+	brasero_bench_remove_output (session);
+	brasero_bench_clear (&bench);
+	g_object_unref (session);
+	return result;
+}
+
+static BraseroBurnResult
+brasero_bench_copy (void)
+{
+	BraseroBurnSession *session;
+	BraseroBench bench = { 0, };
+	BraseroBurnResult result;
+	BraseroTrackDisc *track;
+	BraseroDrive *drive;
+	gchar *output;
+
+	if (!image_source) {
+		printf ("copy: skipped (no --image source)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	bench.name = "copy";
+
+	/* With the file backed SCSI backend the image is seen as a pressed
+	 * DVD-ROM. Otherwise probing fails and the drive has no medium. */
+	drive = g_object_new (BRASERO_TYPE_DRIVE,
+			      "device", image_source,
+			      NULL);
+	while (brasero_drive_probing (drive))
+		g_main_context_iteration (NULL, TRUE);
+
+	if (!brasero_drive_get_medium (drive)
+	||  brasero_medium_get_status (brasero_drive_get_medium (drive)) == BRASERO_MEDIUM_NONE) {
+		printf ("copy: skipped (image is not seen as a disc; are the file backed drives in use?)\n");
+		g_object_unref (drive);
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	session = brasero_burn_session_new ();
+	track = brasero_track_disc_new ();
+	brasero_track_disc_set_drive (track, drive);
+	g_object_unref (drive);
+
+	brasero_burn_session_add_track (session, BRASERO_TRACK (track), NULL);
+	g_object_unref (track);
+
+	output = brasero_bench_output ("copy.iso");
+	brasero_burn_session_set_image_output_full (session,
+						    BRASERO_IMAGE_FORMAT_BIN,
+						    output,
+						    NULL);
+	g_free (output);
+
+	brasero_burn_session_set_tmpdir (session, output_dir);
+	result = brasero_bench_run (&bench, session, FALSE);
+
+	brasero_bench_remove_output (session);
+	brasero_bench_clear (&bench);
+	g_object_unref (session);
+	return result;
+}
+
+static void
+brasero_bench_remove_tree (GFile *file)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+
+	enumerator = g_file_enumerate_children (file,
+						G_FILE_ATTRIBUTE_STANDARD_NAME,
+						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						NULL,
+						NULL);
+	if (enumerator) {
+		while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL))) {
+			GFile *child;
+
+			child = g_file_get_child (file, g_file_info_get_name (info));
+			brasero_bench_remove_tree (child);
+			g_object_unref (child);
+			g_object_unref (info);
+		}
+		g_object_unref (enumerator);
+	}
+
+	g_file_delete (file, NULL, NULL);
+}
+
+static BraseroBurnResult
+brasero_bench_stage_run (GFile *src,
+			 guint max_jobs)
+{
+	BraseroXferCtx *ctx;
+	GError *error = NULL;
+	goffset bytes = 0;
+	gboolean result;
+	gint64 start;
+	gchar *path;
+	GFile *dest;
+
+	path = brasero_bench_output ("stage");
+	dest = g_file_new_for_path (path);
+	g_free (path);
+
+	ctx = brasero_xfer_new ();
+	brasero_xfer_set_max_jobs (ctx, max_jobs);
+
+	start = g_get_monotonic_time ();
+	brasero_xfer_add (ctx, src, dest);
+	result = brasero_xfer_run (ctx, NULL, &error);
+	start = g_get_monotonic_time () - start;
+
+	brasero_xfer_get_progress (ctx, &bytes, NULL);
+	brasero_xfer_free (ctx);
+
+	if (result)
+		printf ("stage: %u job(s) %" G_GOFFSET_FORMAT " bytes in %.3fs (%.2f MiB/s)\n",
+			max_jobs,
+			bytes,
+			(gdouble) start / G_USEC_PER_SEC,
+			brasero_bench_rate (bytes, start));
+	else
+		printf ("stage: %u job(s) failed (%s)\n",
+			max_jobs,
+			error ? error->message : "unknown error");
+
+	if (error)
+		g_error_free (error);
+
+	brasero_bench_remove_tree (dest);
+	g_object_unref (dest);
+
+	return result ? BRASERO_BURN_OK : BRASERO_BURN_ERR;
+}
+
+static BraseroBurnResult
+brasero_bench_stage (void)
+{
+	BraseroBurnResult result;
+	GFile *src;
+	gchar *uri;
+
+	if (!data_source) {
+		printf ("stage: skipped (no --data source)\n");
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	/* Staging goes through GIO so any URI works; a local file:// source
+	 * stands in for a remote location and gives the engine overhead. */
+	if (strstr (data_source, "://"))
+		src = g_file_new_for_uri (data_source);
+	else
+		src = g_file_new_for_commandline_arg (data_source);
+
+	uri = g_file_get_uri (src);
+	printf ("stage: %s\n", uri);
+	g_free (uri);
+
+	/* Serial copy first as a baseline */
+	result = brasero_bench_stage_run (src, 1);
+	if (result == BRASERO_BURN_OK && jobs > 1)
+		result = brasero_bench_stage_run (src, jobs);
+
+	g_object_unref (src);
+	return result;
+}
+
+#define BRASERO_BENCH_SHEET_TRACKS	2000
+#define BRASERO_BENCH_SHEET_QUERIES	100
+#define BRASERO_BENCH_SHEET_FUZZ	500
+
+static gchar *
+brasero_bench_sheet_write (const gchar *name,
+			   BraseroImageFormat format)
+{
+	GString *sheet;
+	gchar *path;
+	gint i;
+
+	sheet = g_string_new (NULL);
+	if (format == BRASERO_IMAGE_FORMAT_CDRDAO)
+		g_string_append (sheet, "CD_DA\n\n");
+
+	for (i = 1; i <= BRASERO_BENCH_SHEET_TRACKS; i ++) {
+		if (format == BRASERO_IMAGE_FORMAT_CUE)
+			g_string_append_printf (sheet,
+						"FILE \"sheet.bin\" BINARY\n"
+						"  TRACK %02i AUDIO\n"
+						"    PREGAP 00:02:00\n"
+						"    INDEX 01 00:00:00\n",
+						i);
+		else
+			g_string_append_printf (sheet,
+						"TRACK AUDIO\n"
+						"PREGAP 00:02:00\n"
+						"FILE \"sheet.bin\" 0 00:00:10 // track %i\n\n",
+						i);
+	}
+
+	path = brasero_bench_output (name);
+	if (!g_file_set_contents (path, sheet->str, sheet->len, NULL)) {
+		g_free (path);
+		path = NULL;
+	}
+
+	g_string_free (sheet, TRUE);
+	return path;
+}
+
+static BraseroBurnResult
+brasero_bench_sheet_time (const gchar *path,
+			  BraseroImageFormat format)
+{
+	BraseroImageSheet *sheet;
+	GError *error = NULL;
+	guint64 blocks = 0;
+	gint64 parse;
+	gint64 cached;
+	gchar *uri;
+	GFile *file;
+	gint i;
+
+	file = g_file_new_for_path (path);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	parse = g_get_monotonic_time ();
+	sheet = brasero_image_sheet_get (uri, NULL, &error);
+	if (sheet && format == BRASERO_IMAGE_FORMAT_CUE)
+		brasero_image_sheet_get_cue_size (sheet, &blocks, NULL, NULL, &error);
+	else if (sheet)
+		brasero_image_sheet_get_cdrdao_size (sheet, &blocks, NULL, NULL, &error);
+	parse = g_get_monotonic_time () - parse;
+
+	if (!sheet || error) {
+		printf ("sheet: %s failed (%s)\n",
+			path,
+			error ? error->message : "unknown error");
+		if (error)
+			g_error_free (error);
+		if (sheet)
+			brasero_image_sheet_unref (sheet);
+		g_free (uri);
+		return BRASERO_BURN_ERR;
+	}
+
+	/* While a reference is held every query after the first one should be
+	 * answered from the cache (only the sheet itself is stat'ed). */
+	cached = g_get_monotonic_time ();
+	for (i = 0; i < BRASERO_BENCH_SHEET_QUERIES; i ++) {
+		if (format == BRASERO_IMAGE_FORMAT_CUE) {
+			brasero_image_format_identify_cuesheet (uri, NULL, NULL);
+			brasero_image_format_get_cue_size (uri, NULL, NULL, NULL, NULL);
+			brasero_image_format_cue_bin_byte_swap (uri, NULL, NULL);
+		}
+		else {
+			brasero_image_format_identify_cuesheet (uri, NULL, NULL);
+			brasero_image_format_get_cdrdao_size (uri, NULL, NULL, NULL, NULL);
+		}
+	}
+	cached = g_get_monotonic_time () - cached;
+
+	printf ("sheet: %s %i tracks, %" G_GUINT64_FORMAT " blocks, parse %.3fms, cached query %.3fms\n",
+		format == BRASERO_IMAGE_FORMAT_CUE ? "cue" : "toc",
+		g_slist_length (sheet->tracks),
+		blocks,
+		(gdouble) parse / 1000.0,
+		(gdouble) cached / 1000.0 / BRASERO_BENCH_SHEET_QUERIES);
+
+	brasero_image_sheet_unref (sheet);
+	g_free (uri);
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_bench_sheet_fuzz (const gchar *path)
+{
+	gchar *contents = NULL;
+	gsize length = 0;
+	gchar *fuzzed;
+	gchar *uri;
+	GFile *file;
+	gint i;
+
+	if (!g_file_get_contents (path, &contents, &length, NULL))
+		return;
+
+	fuzzed = brasero_bench_output ("fuzz.cue");
+	file = g_file_new_for_path (fuzzed);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	/* Truncated and mangled sheets must be rejected or parsed, never
+	 * crash. The fixed seed makes failures reproducible. */
+	g_random_set_seed (0x42);
+	for (i = 0; i < BRASERO_BENCH_SHEET_FUZZ; i ++) {
+		BraseroImageSheet *sheet;
+		gchar *complement;
+		gsize size;
+		gint j;
+
+		size = g_random_int_range (0, MIN (length, 4096));
+		for (j = 0; j < 8 && size; j ++) {
+			static const gchar garbage [] = " \t\n\"#:/0123456789AFILETRACKINDEX";
+			contents [g_random_int_range (0, size)] = garbage [g_random_int_range (0, sizeof (garbage) - 1)];
+		}
+
+		if (!g_file_set_contents (fuzzed, contents, size, NULL))
+			break;
+
+		sheet = brasero_image_sheet_get (uri, NULL, NULL);
+		if (sheet) {
+			brasero_image_sheet_get_format (sheet);
+			brasero_image_sheet_get_cue_size (sheet, NULL, NULL, NULL, NULL);
+			brasero_image_sheet_get_cdrdao_size (sheet, NULL, NULL, NULL, NULL);
+			brasero_image_sheet_need_byte_swap (sheet);
+			complement = brasero_image_sheet_get_complement (sheet);
+			g_free (complement);
+			brasero_image_sheet_unref (sheet);
+		}
+	}
+
+	printf ("sheet: %i mangled sheets parsed\n", i);
+
+	g_remove (fuzzed);
+	g_free (fuzzed);
+	g_free (contents);
+	g_free (uri);
+}
+
+static BraseroBurnResult
+brasero_bench_sheet (void)
+{
+	BraseroBurnResult result = BRASERO_BURN_ERR;
+	gchar *cue = NULL;
+	gchar *toc = NULL;
+	gchar *bin;
+
+	/* Every track points to the same small data file */
+	bin = brasero_bench_output ("sheet.bin");
+	if (!g_file_set_contents (bin, "", 0, NULL)
+	||  truncate (bin, 2352 * 10)) {
+		printf ("sheet: could not create %s\n", bin);
+		goto end;
+	}
+
+	cue = brasero_bench_sheet_write ("sheet.cue", BRASERO_IMAGE_FORMAT_CUE);
+	toc = brasero_bench_sheet_write ("sheet.toc", BRASERO_IMAGE_FORMAT_CDRDAO);
+	if (!cue || !toc) {
+		printf ("sheet: could not write sheets\n");
+		goto end;
+	}
+
+	result = brasero_bench_sheet_time (cue, BRASERO_IMAGE_FORMAT_CUE);
+	if (result == BRASERO_BURN_OK)
+		result = brasero_bench_sheet_time (toc, BRASERO_IMAGE_FORMAT_CDRDAO);
+
+	if (result == BRASERO_BURN_OK) {
+		brasero_bench_sheet_fuzz (cue);
+		brasero_bench_sheet_fuzz (toc);
+	}
+
+end:
+	if (cue) {
+		g_remove (cue);
+		g_free (cue);
+	}
+
+	if (toc) {
+		g_remove (toc);
+		g_free (toc);
+	}
+
+	g_remove (bin);
+	g_free (bin);
+	return result;
+}
+
+/* Adding files one at a time costs a sorted insertion each, so the baseline
+ * is only run on the first entries */
+#define BRASERO_BENCH_GRAFT_ONE_BY_ONE	20000
+
+static void
+brasero_bench_graft_entries (gint num,
+			     gchar ***uris_ret,
+			     GFileInfo ***infos_ret)
+{
+	GFileInfo **infos;
+	gchar **uris;
+	gint i;
+
+	/* The files don't need to exist since their information is given */
+	uris = g_new0 (gchar *, num + 1);
+	infos = g_new0 (GFileInfo *, num);
+	for (i = 0; i < num; i ++) {
+		gchar *name;
+		gchar *path;
+
+		name = g_strdup_printf ("entry-%08i", i);
+		path = g_build_filename (output_dir, name, NULL);
+		uris [i] = g_filename_to_uri (path, NULL, NULL);
+		g_free (path);
+
+		infos [i] = g_file_info_new ();
+		g_file_info_set_name (infos [i], name);
+		g_file_info_set_file_type (infos [i], G_FILE_TYPE_REGULAR);
+		g_file_info_set_size (infos [i], 2048 * (i % 64 + 1));
+		g_file_info_set_content_type (infos [i], "application/octet-stream");
+		g_free (name);
+	}
+
+	/* Shuffle them (always the same way) so they need sorting */
+	g_random_set_seed (0x42);
+	for (i = num - 1; i > 0; i --) {
+		GFileInfo *info;
+		gchar *uri;
+		gint j;
+
+		j = g_random_int_range (0, i + 1);
+
+		uri = uris [i];
+		uris [i] = uris [j];
+		uris [j] = uri;
+
+		info = infos [i];
+		infos [i] = infos [j];
+		infos [j] = info;
+	}
+
+	*uris_ret = uris;
+	*infos_ret = infos;
+}
+
+static BraseroBurnResult
+brasero_bench_graft (void)
+{
+	BraseroBurnResult result = BRASERO_BURN_OK;
+	BraseroTrackDataCfg *track;
+	GFileInfo **infos;
+	gint64 wall, cpu;
+	gchar **uris;
+	guint added;
+	gint num;
+	gint i;
+
+	num = MAX (entries, 1);
+	brasero_bench_graft_entries (num, &uris, &infos);
+
+	/* One call with all the files */
+	track = brasero_track_data_cfg_new ();
+
+	wall = g_get_monotonic_time ();
+	cpu = brasero_bench_cpu_time ();
+	added = brasero_track_data_cfg_add_many (track,
+						 (const gchar * const *) uris,
+						 infos,
+						 NULL);
+	wall = g_get_monotonic_time () - wall;
+	cpu = brasero_bench_cpu_time () - cpu;
+
+	printf ("graft: bulk %u/%i files, wall %.3fs, cpu %.3fs, %.0f files/s, peak RSS %li KiB\n",
+		added,
+		num,
+		(gdouble) wall / G_USEC_PER_SEC,
+		(gdouble) cpu / G_USEC_PER_SEC,
+		wall > 0 ? (gdouble) added * G_USEC_PER_SEC / wall : 0.0,
+		brasero_bench_peak_rss ());
+
+	if (added != (guint) num
+	||  gtk_tree_model_iter_n_children (GTK_TREE_MODEL (track), NULL) != num)
+		result = BRASERO_BURN_ERR;
+
+	wall = g_get_monotonic_time ();
+	g_object_unref (track);
+	wall = g_get_monotonic_time () - wall;
+	printf ("graft: bulk teardown %.3fs\n", (gdouble) wall / G_USEC_PER_SEC);
+
+	/* Then the same files one by one as the application used to do */
+	num = MIN (num, BRASERO_BENCH_GRAFT_ONE_BY_ONE);
+	track = brasero_track_data_cfg_new ();
+
+	added = 0;
+	wall = g_get_monotonic_time ();
+	cpu = brasero_bench_cpu_time ();
+	for (i = 0; i < num; i ++) {
+		const gchar *one [2] = { uris [i], NULL };
+
+		added += brasero_track_data_cfg_add_many (track,
+							  one,
+							  infos + i,
+							  NULL);
+	}
+	wall = g_get_monotonic_time () - wall;
+	cpu = brasero_bench_cpu_time () - cpu;
+
+	printf ("graft: one by one %u/%i files, wall %.3fs, cpu %.3fs, %.0f files/s\n",
+		added,
+		num,
+		(gdouble) wall / G_USEC_PER_SEC,
+		(gdouble) cpu / G_USEC_PER_SEC,
+		wall > 0 ? (gdouble) added * G_USEC_PER_SEC / wall : 0.0);
+
+	if (added != (guint) num)
+		result = BRASERO_BURN_ERR;
+
+	g_object_unref (track);
+
+	num = MAX (entries, 1);
+	for (i = 0; i < num; i ++)
+		g_object_unref (infos [i]);
+	g_free (infos);
+	g_strfreev (uris);
+
+	return result;
+}
+
+typedef BraseroBurnResult (*BraseroBenchFunc) (void);
+
+static const struct {
+	const gchar *name;
+	BraseroBenchFunc func;
+} scenarios [] = {
+	{ "data",	brasero_bench_data },
+	{ "checksum",	brasero_bench_checksum },
+	{ "audio",	brasero_bench_audio },
+	{ "copy",	brasero_bench_copy },
+	{ "stage",	brasero_bench_stage },
+	{ "sheet",	brasero_bench_sheet },
+	{ "graft",	brasero_bench_graft },
+	{ NULL }
+};
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gboolean tmp_output = FALSE;
+	gboolean found = FALSE;
+	gint failures = 0;
+	gint i, n;
+
+	g_thread_init (NULL);
+	g_type_init ();
+
+	context = g_option_context_new ("- benchmark the burn pipeline");
+	g_option_context_add_main_entries (context, options, NULL);
+	g_option_context_add_group (context, brasero_burn_library_get_option_group ());
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (!brasero_burn_library_start (&argc, &argv)) {
+		g_printerr ("The burn library could not be initialized\n");
+		return 1;
+	}
+
+	if (!output_dir) {
+		output_dir = g_build_filename (g_get_tmp_dir (), "brasero-bench-XXXXXX", NULL);
+		if (!g_mkdtemp (output_dir)) {
+			g_printerr ("%s\n", g_strerror (errno));
+			return 1;
+		}
+		tmp_output = TRUE;
+	}
+
+	for (n = 0; n < MAX (iterations, 1); n ++) {
+		for (i = 0; scenarios [i].name; i ++) {
+			BraseroBurnResult result;
+
+			if (scenario
+			&&  strcmp (scenario, "all")
+			&&  strcmp (scenario, scenarios [i].name))
+				continue;
+
+			found = TRUE;
+			result = scenarios [i].func ();
+
+			/* Skipped scenarios are not failures */
+			if (result != BRASERO_BURN_OK
+			&&  result != BRASERO_BURN_NOT_SUPPORTED)
+				failures ++;
+		}
+	}
+
+	if (!found)
+		g_printerr ("Unknown scenario \"%s\"\n", scenario);
+
+	if (tmp_output)
+		g_rmdir (output_dir);
+
+	brasero_burn_library_stop ();
+	return (failures || !found) ? 1 : 0;
+}
@@ -35,6 +35,8 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -51,6 +53,8 @@
 #include "burn-basics.h"
 #include "burn-debug.h"
 #include "burn-dbus.h"
+#include "burn-fanout.h"
+#include "burn-telemetry.h"
 #include "burn-task-ctx.h"
 #include "burn-task.h"
 #include "brasero-caps-burn.h"
@@ -59,6 +63,7 @@
 
 #include "brasero-volume.h"
 #include "brasero-drive.h"
+#include "brasero-units.h"
 
 #include "brasero-tags.h"
 #include "brasero-track.h"
@@ -86,10 +91,27 @@ struct _BraseroBurnPrivate {
 
 	gint appcookie;
 
+	/* per job throughput samples of the last operation */
+	BraseroTelemetry *telemetry;
+	guint telemetry_id;
+
 	guint64 session_start;
 	guint64 session_end;
 
+	/* pipe the recorder reads instead of the image (fan-out) */
+	int input_fd;
+
+	/* set when the recorder runs without a loop of its own (fan-out) */
+	BraseroTaskDoneFunc recorder_done;
+	gpointer recorder_data;
+
+	/* the per drive recordings of a fan-out */
+	GSList *fanout_drives;
+	GMainLoop *fanout_loop;
+	guint fanout_running;
+
 	guint mounted_by_us:1;
+	guint fanout_cancel:1;
 };
 
 #define BRASERO_BURN_NOT_SUPPORTED_LOG(burn)					\
@@ -124,6 +146,20 @@ struct _BraseroBurnPrivate {
 		g_free (format);						\
 	}
 
+#define BRASERO_BURN_DEBUG_ERROR(burn, message, ...)				\
+	{									\
+		gchar *format;							\
+		BRASERO_BURN_LOG_ERROR (message, ##__VA_ARGS__);		\
+		format = g_strdup_printf ("%s (%s %s)",				\
+					  message,				\
+					  G_STRFUNC,				\
+					  G_STRLOC);				\
+		brasero_burn_log (burn,						\
+				  format,					\
+				  ##__VA_ARGS__);				\
+		g_free (format);						\
+	}
+
 typedef enum {
 	ASK_DISABLE_JOLIET_SIGNAL,
 	WARN_DATA_LOSS_SIGNAL,
@@ -138,6 +174,9 @@ typedef enum {
 	EJECT_FAILURE_SIGNAL,
 	BLANK_FAILURE_SIGNAL,
 	INSTALL_MISSING_SIGNAL,
+	DRIVE_PROGRESS_CHANGED_SIGNAL,
+	DRIVE_ACTION_CHANGED_SIGNAL,
+	DRIVE_FINISHED_SIGNAL,
 	LAST_SIGNAL
 } BraseroBurnSignalType;
 
@@ -164,6 +203,60 @@ brasero_burn_powermanagement (BraseroBurn *self,
 		brasero_uninhibit_suspend (priv->appcookie); 
 }
 
+static GVariant *
+brasero_burn_telemetry_cb (gpointer user_data)
+{
+	return brasero_burn_get_telemetry (BRASERO_BURN (user_data));
+}
+
+static void
+brasero_burn_telemetry_start (BraseroBurn *self)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (self);
+
+	/* Keep the samples of the previous operation until a new one starts
+	 * so that they can still be retrieved once it is over. */
+	if (priv->telemetry)
+		brasero_telemetry_unref (priv->telemetry);
+
+	priv->telemetry = brasero_telemetry_new ();
+	if (!priv->telemetry_id)
+		priv->telemetry_id = brasero_dbus_export_telemetry (brasero_burn_telemetry_cb, self);
+}
+
+static void
+brasero_burn_telemetry_stop (BraseroBurn *self)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (self);
+
+	brasero_dbus_unexport_telemetry (priv->telemetry_id);
+	priv->telemetry_id = 0;
+}
+
+static void
+brasero_burn_set_task_telemetry (BraseroBurn *self)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (self);
+
+	if (priv->task && priv->telemetry)
+		brasero_task_ctx_set_telemetry (BRASERO_TASK_CTX (priv->task),
+						priv->telemetry);
+}
+
+static void
+brasero_burn_set_task_input (BraseroBurn *self)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (self);
+
+	/* Only given once: if the recorder has to be restarted it reads the
+	 * image itself. */
+	if (priv->task && priv->input_fd >= 0) {
+		brasero_task_ctx_set_input_fd (BRASERO_TASK_CTX (priv->task),
+					       priv->input_fd);
+		priv->input_fd = -1;
+	}
+}
+
 /**
  * brasero_burn_new:
  *
@@ -1128,6 +1221,38 @@ brasero_burn_get_action_string (BraseroBurn *burn,
 							    string);
 }
 
+/**
+ * brasero_burn_get_telemetry:
+ * @burn: a #BraseroBurn
+ *
+ * Returns the throughput and latency samples gathered during the current
+ * operation (or the last one if none is running). There is one entry per
+ * job with its name and its samples taken every half second, from the
+ * oldest to the newest: time since the start of the operation (in
+ * microseconds), bytes read, bytes written, time spent waiting for input
+ * and for output (in microseconds) and the fill ratio of the drive buffer
+ * (in percent, -1 if unknown).
+ *
+ * The same data is available over D-Bus through the GetTelemetry () method
+ * of the org.gnome.Brasero.Burn.Telemetry interface while @burn is busy.
+ *
+ * Return value: (transfer floating): a #GVariant of type a(sa(xttxxi)).
+ **/
+
+GVariant *
+brasero_burn_get_telemetry (BraseroBurn *burn)
+{
+	BraseroBurnPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_BURN (burn), NULL);
+
+	priv = BRASERO_BURN_PRIVATE (burn);
+	if (!priv->telemetry)
+		return g_variant_new_array (G_VARIANT_TYPE ("(sa(xttxxi))"), NULL, 0);
+
+	return brasero_telemetry_to_variant (priv->telemetry);
+}
+
 /**
  * brasero_burn_status:
  * @burn: a #BraseroBurn
@@ -1659,6 +1784,42 @@ start:
 	return BRASERO_BURN_ERR;
 }
 
+/* When priv->recorder_done is set, brasero_burn_run_tasks () only gets the
+ * recorder ready (everything that may wait for the drive is done here) and
+ * returns BRASERO_BURN_RUNNING. The caller then starts it with
+ * brasero_burn_start_recorder () which returns while it runs and gives its
+ * result to priv->recorder_done. There is no recovery from errors since what
+ * was read from the input can't be read again. */
+
+static BraseroBurnResult
+brasero_burn_prepare_recorder (BraseroBurn *burn, GError **error)
+{
+	BraseroDrive *burner;
+	BraseroBurnResult result;
+	BraseroMedium *burnt_medium;
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (burn);
+
+	burner = brasero_burn_session_get_burner (priv->session);
+	burnt_medium = brasero_drive_get_medium (burner);
+
+	result = brasero_burn_unmount (burn, burnt_medium, error);
+	if (result != BRASERO_BURN_OK)
+		return result;
+
+	return brasero_burn_can_use_drive_exclusively (burn, burner);
+}
+
+static BraseroBurnResult
+brasero_burn_start_recorder (BraseroBurn *burn, GError **error)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (burn);
+
+	return brasero_task_run_async (priv->task,
+				       priv->recorder_done,
+				       priv->recorder_data,
+				       error);
+}
+
 static BraseroBurnResult
 brasero_burn_install_missing (BraseroPluginErrorType error,
 			      const gchar *details,
@@ -2090,6 +2251,7 @@ brasero_burn_run_tasks (BraseroBurn *burn,
 		next = iter->next;
 		priv->task = iter->data;
 		tasks = g_slist_remove (tasks, priv->task);
+		brasero_burn_set_task_telemetry (burn);
 
 		g_signal_connect (priv->task,
 				  "progress-changed",
@@ -2233,7 +2395,14 @@ brasero_burn_run_tasks (BraseroBurn *burn,
 		if (!next) {
 			if (!brasero_burn_session_is_dest_file (priv->session)) {
 				*dummy_session = (brasero_burn_session_get_flags (priv->session) & BRASERO_BURN_FLAG_DUMMY);
-				result = brasero_burn_run_recorder (burn, error);
+				brasero_burn_set_task_input (burn);
+				if (priv->recorder_done) {
+					result = brasero_burn_prepare_recorder (burn, error);
+					if (result == BRASERO_BURN_OK)
+						result = BRASERO_BURN_RUNNING;
+				}
+				else
+					result = brasero_burn_run_recorder (burn, error);
 			}
 			else
 				result = brasero_burn_run_imager (burn, FALSE, error);
@@ -2254,6 +2423,14 @@ brasero_burn_run_tasks (BraseroBurn *burn,
 		priv->tasks_done ++;
 	}
 
+	/* The recorder is ready or still running: the settings are restored
+	 * and the task is released once it stops */
+	if (result == BRASERO_BURN_RUNNING) {
+		g_slist_foreach (tasks, (GFunc) g_object_unref, NULL);
+		g_slist_free (tasks);
+		return result;
+	}
+
 	/* restore the session settings. Keep the used flags
 	 * nevertheless to make sure we actually use the flags that were
 	 * set after checking for session consistency. */
@@ -2289,6 +2466,7 @@ brasero_burn_check_real (BraseroBurn *self,
 	if (priv->task) {
 		priv->task_nb = 1;
 		priv->tasks_done = 0;
+		brasero_burn_set_task_telemetry (self);
 		g_signal_connect (priv->task,
 				  "progress-changed",
 				  G_CALLBACK (brasero_burn_progress_changed),
@@ -2367,6 +2545,7 @@ brasero_burn_record_session (BraseroBurn *burn,
 			     GError **error)
 {
 	gboolean dummy_session = FALSE;
+	const gchar *files_checksum;
 	const gchar *checksum = NULL;
 	BraseroTrack *track = NULL;
 	BraseroChecksumType type;
@@ -2468,11 +2647,20 @@ brasero_burn_record_session (BraseroBurn *burn,
 	 * during the session recording */
 	brasero_burn_session_push_tracks (priv->session);
 
+	files_checksum = brasero_track_tag_lookup_string (track, BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG);
+
 	track = BRASERO_TRACK (brasero_track_disc_new ());
 	brasero_track_set_checksum (BRASERO_TRACK (track),
 	                            type,
 	                            checksum);
 
+	/* That allows to tell which files are corrupted if the image
+	 * checksum is wrong */
+	if (files_checksum)
+		brasero_track_tag_add_string (track,
+					      BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG,
+					      files_checksum);
+
 	brasero_track_disc_set_drive (BRASERO_TRACK_DISC (track), brasero_burn_session_get_burner (priv->session));
 	brasero_burn_session_add_track (priv->session, track, NULL);
 
@@ -2580,7 +2768,7 @@ brasero_burn_check (BraseroBurn *self,
 	track = tracks->data;
 
 	/* if the input is a DISC, ask/check there is one and lock it (as dest) */
-	if (BRASERO_IS_TRACK_IMAGE (track)) {
+	if (BRASERO_IS_TRACK_DISC (track)) {
 		/* make sure there is a disc. If not, ask one and lock it */
 		result = brasero_burn_lock_checksum_media (self, error);
 		if (result != BRASERO_BURN_OK)
@@ -2588,10 +2776,12 @@ brasero_burn_check (BraseroBurn *self,
 	}
 
 	brasero_burn_powermanagement (self, TRUE);
+	brasero_burn_telemetry_start (self);
 
 	result = brasero_burn_check_real (self, track, error);
 
 	brasero_burn_powermanagement (self, FALSE);
+	brasero_burn_telemetry_stop (self);
 
 	if (result == BRASERO_BURN_OK)
 		result = brasero_burn_unlock_medias (self, error);
@@ -2737,41 +2927,22 @@ again:
 	return BRASERO_BURN_OK;
 }
 
-/**
- * brasero_burn_record:
- * @burn: a #BraseroBurn
- * @session: a #BraseroBurnSession
- * @error: a #GError
- *
- * Burns or creates a disc image according to the parameters
- * set in @session.
- *
- * Return value: a #BraseroBurnResult. The result of the operation. 
- * BRASERO_BURN_OK if it was successful.
- **/
-
-BraseroBurnResult 
-brasero_burn_record (BraseroBurn *burn,
-		     BraseroBurnSession *session,
-		     GError **error)
+static BraseroBurnResult
+brasero_burn_record_begin (BraseroBurn *burn,
+			   BraseroBurnSession *session,
+			   GError **error)
 {
 	BraseroTrackType *type = NULL;
 	BraseroBurnResult result;
 	BraseroBurnPrivate *priv;
 
-	g_return_val_if_fail (BRASERO_IS_BURN (burn), BRASERO_BURN_ERR);
-	g_return_val_if_fail (BRASERO_IS_BURN_SESSION (session), BRASERO_BURN_ERR);
-
 	priv = BRASERO_BURN_PRIVATE (burn);
 
-	/* make sure we're ready */
-	if (brasero_burn_session_get_status (session, NULL) != BRASERO_BURN_OK)
-		return BRASERO_BURN_ERR;
-
 	g_object_ref (session);
 	priv->session = session;
 
 	brasero_burn_powermanagement (burn, TRUE);
+	brasero_burn_telemetry_start (burn);
 
 	/* say to the whole world we started */
 	brasero_burn_action_changed_real (burn, BRASERO_BURN_ACTION_PREPARING);
@@ -2780,11 +2951,11 @@ brasero_burn_record (BraseroBurn *burn,
 		/* This is a special case */
 		result = brasero_burn_same_src_dest_image (burn, error);
 		if (result != BRASERO_BURN_OK)
-			goto end;
+			return result;
 
 		result = brasero_burn_same_src_dest_reload_medium (burn, error);
 		if (result != BRASERO_BURN_OK)
-			goto end;
+			return result;
 	}
 	else if (!brasero_burn_session_is_dest_file (session)) {
 		BraseroBurnError berror = BRASERO_BURN_ERROR_NONE;
@@ -2805,29 +2976,34 @@ brasero_burn_record (BraseroBurn *burn,
 								  required_media,
 								  error);
 			if (result != BRASERO_BURN_OK)
-				goto end;
+				return result;
 
 			result = brasero_burn_lock_dest_media (burn, &berror, error);
 		}
 
 		if (result != BRASERO_BURN_OK)
-			goto end;
+			return result;
 	}
 
 	type = brasero_track_type_new ();
 	brasero_burn_session_get_input_type (session, type);
-	if (brasero_track_type_get_has_medium (type)) {
+	if (brasero_track_type_get_has_medium (type))
 		result = brasero_burn_lock_src_media (burn, error);
-		if (result != BRASERO_BURN_OK)
-			goto end;
-	}
+	else
+		result = BRASERO_BURN_OK;
 
-	/* burn the session except if dummy session */
-	result = brasero_burn_record_session (burn, TRUE, NULL, error);
+	brasero_track_type_free (type);
+	return result;
+}
 
-end:
+static BraseroBurnResult
+brasero_burn_record_end (BraseroBurn *burn,
+			 BraseroBurnResult result,
+			 GError **error)
+{
+	BraseroBurnPrivate *priv;
 
-	brasero_track_type_free (type);
+	priv = BRASERO_BURN_PRIVATE (burn);
 
 	if (result == BRASERO_BURN_OK)
 		result = brasero_burn_unlock_medias (burn, error);
@@ -2839,7 +3015,7 @@ end:
 	||  result == BRASERO_BURN_NOT_SUPPORTED
 	||  result == BRASERO_BURN_RUNNING
 	||  result == BRASERO_BURN_NOT_RUNNING)) {
-		BRASERO_BURN_LOG ("Internal error with result %i", result);
+		BRASERO_BURN_LOG_ERROR ("Internal error with result %i", result);
 		g_set_error (error,
 			     BRASERO_BURN_ERROR,
 			     BRASERO_BURN_ERROR_GENERAL,
@@ -2851,12 +3027,12 @@ end:
 	}
 	else if (result != BRASERO_BURN_OK) {
 		if (error && (*error)) {
-			BRASERO_BURN_DEBUG (burn,
-					    "Session error : %s",
-					    (*error)->message);
+			BRASERO_BURN_DEBUG_ERROR (burn,
+						  "Session error : %s",
+						  (*error)->message);
 		}
 		else
-			BRASERO_BURN_DEBUG (burn, "Session error : unknown");
+			BRASERO_BURN_DEBUG_ERROR (burn, "Session error : unknown");
 	}
 	else {
 		BRASERO_BURN_DEBUG (burn, "Session successfully finished");
@@ -2865,6 +3041,7 @@ end:
 	}
 
 	brasero_burn_powermanagement (burn, FALSE);
+	brasero_burn_telemetry_stop (burn);
 
 	/* release session */
 	g_object_unref (priv->session);
@@ -2873,6 +3050,670 @@ end:
 	return result;
 }
 
+/**
+ * brasero_burn_record:
+ * @burn: a #BraseroBurn
+ * @session: a #BraseroBurnSession
+ * @error: a #GError
+ *
+ * Burns or creates a disc image according to the parameters
+ * set in @session.
+ *
+ * Return value: a #BraseroBurnResult. The result of the operation. 
+ * BRASERO_BURN_OK if it was successful.
+ **/
+
+BraseroBurnResult 
+brasero_burn_record (BraseroBurn *burn,
+		     BraseroBurnSession *session,
+		     GError **error)
+{
+	BraseroBurnResult result;
+
+	g_return_val_if_fail (BRASERO_IS_BURN (burn), BRASERO_BURN_ERR);
+	g_return_val_if_fail (BRASERO_IS_BURN_SESSION (session), BRASERO_BURN_ERR);
+
+	/* make sure we're ready */
+	if (brasero_burn_session_get_status (session, NULL) != BRASERO_BURN_OK)
+		return BRASERO_BURN_ERR;
+
+	result = brasero_burn_record_begin (burn, session, error);
+
+	/* burn the session except if dummy session */
+	if (result == BRASERO_BURN_OK)
+		result = brasero_burn_record_session (burn, TRUE, NULL, error);
+
+	return brasero_burn_record_end (burn, result, error);
+}
+
+typedef struct _BraseroBurnFanoutDrive BraseroBurnFanoutDrive;
+struct _BraseroBurnFanoutDrive {
+	BraseroBurn *parent;
+
+	BraseroBurn *burn;
+	BraseroBurnSession *session;
+	BraseroDrive *drive;
+
+	gdouble progress;
+	glong remaining;
+
+	BraseroBurnResult result;
+	GError *error;
+
+	guint ready:1;
+};
+
+static void
+brasero_burn_fanout_drive_free (BraseroBurnFanoutDrive *node)
+{
+	if (node->burn)
+		g_object_unref (node->burn);
+
+	if (node->session)
+		g_object_unref (node->session);
+
+	if (node->drive)
+		g_object_unref (node->drive);
+
+	if (node->error)
+		g_error_free (node->error);
+
+	g_free (node);
+}
+
+/* The per drive objects ask their questions through the main object so that
+ * the caller only needs to handle one of them */
+
+static BraseroBurnResult
+brasero_burn_fanout_insert_media_cb (BraseroBurn *burn,
+				     BraseroDrive *drive,
+				     BraseroBurnError error,
+				     BraseroMedia required_media,
+				     BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_ask_for_media (node->parent,
+					   drive,
+					   error,
+					   required_media,
+					   NULL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_eject_failure_cb (BraseroBurn *burn,
+				      BraseroDrive *drive,
+				      BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_eject_failure_signal (node->parent, drive);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_location_request_cb (BraseroBurn *burn,
+					 GError *error,
+					 gboolean is_temporary,
+					 BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_ask_for_location (node->parent,
+					      error,
+					      is_temporary,
+					      NULL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_install_missing_cb (BraseroBurn *burn,
+					BraseroPluginErrorType type,
+					const gchar *detail,
+					BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_install_missing (type, detail, node->parent);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_data_loss_cb (BraseroBurn *burn,
+				  BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 WARN_DATA_LOSS_SIGNAL,
+					 BRASERO_BURN_CANCEL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_previous_session_loss_cb (BraseroBurn *burn,
+					      BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 WARN_PREVIOUS_SESSION_LOSS_SIGNAL,
+					 BRASERO_BURN_CANCEL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_audio_to_appendable_cb (BraseroBurn *burn,
+					    BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 WARN_AUDIO_TO_APPENDABLE_SIGNAL,
+					 BRASERO_BURN_CANCEL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_rewritable_cb (BraseroBurn *burn,
+				   BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 WARN_REWRITABLE_SIGNAL,
+					 BRASERO_BURN_CANCEL);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_dummy_success_cb (BraseroBurn *burn,
+				      BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 DUMMY_SUCCESS_SIGNAL,
+					 BRASERO_BURN_OK);
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_blank_failure_cb (BraseroBurn *burn,
+				      BraseroBurnFanoutDrive *node)
+{
+	return brasero_burn_emit_signal (node->parent,
+					 BLANK_FAILURE_SIGNAL,
+					 BRASERO_BURN_ERR);
+}
+
+static void
+brasero_burn_fanout_progress_changed_cb (BraseroBurn *burn,
+					 gdouble overall_progress,
+					 gdouble action_progress,
+					 glong time_remaining,
+					 BraseroBurnFanoutDrive *node)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (node->parent);
+	gdouble progress = 0.0;
+	glong remaining = -1;
+	GSList *iter;
+
+	g_signal_emit (node->parent,
+		       brasero_burn_signals [DRIVE_PROGRESS_CHANGED_SIGNAL],
+		       0,
+		       node->drive,
+		       overall_progress,
+		       action_progress,
+		       time_remaining);
+
+	if (overall_progress >= 0.0)
+		node->progress = overall_progress;
+
+	node->remaining = time_remaining;
+
+	/* The whole operation is as far as the average drive and will last
+	 * as long as the slowest one */
+	for (iter = priv->fanout_drives; iter; iter = iter->next) {
+		BraseroBurnFanoutDrive *other = iter->data;
+
+		progress += other->progress;
+		remaining = MAX (remaining, other->remaining);
+	}
+	progress /= (gdouble) g_slist_length (priv->fanout_drives);
+
+	g_signal_emit (node->parent,
+		       brasero_burn_signals [PROGRESS_CHANGED_SIGNAL],
+		       0,
+		       progress,
+		       progress,
+		       remaining);
+}
+
+static void
+brasero_burn_fanout_action_changed_cb (BraseroBurn *burn,
+				       BraseroBurnAction action,
+				       BraseroBurnFanoutDrive *node)
+{
+	g_signal_emit (node->parent,
+		       brasero_burn_signals [DRIVE_ACTION_CHANGED_SIGNAL],
+		       0,
+		       node->drive,
+		       action);
+}
+
+static void
+brasero_burn_fanout_drive_finished (BraseroBurnFanoutDrive *node,
+				    BraseroBurnResult result)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (node->parent);
+	BraseroBurnPrivate *node_priv;
+
+	node->result = result;
+
+	/* If the recorder never got to read its pipe, close it so that this
+	 * drive doesn't hold back the others. */
+	node_priv = BRASERO_BURN_PRIVATE (node->burn);
+	if (node_priv->input_fd >= 0) {
+		close (node_priv->input_fd);
+		node_priv->input_fd = -1;
+	}
+
+	BRASERO_BURN_LOG ("Recording on %s finished (%i)",
+			  brasero_drive_get_device (node->drive),
+			  node->result);
+
+	g_signal_emit (node->parent,
+		       brasero_burn_signals [DRIVE_FINISHED_SIGNAL],
+		       0,
+		       node->drive,
+		       node->result,
+		       node->error);
+
+	priv->fanout_running --;
+	if (!priv->fanout_running && priv->fanout_loop)
+		g_main_loop_quit (priv->fanout_loop);
+}
+
+static void
+brasero_burn_fanout_recorder_done (BraseroTask *task,
+				   BraseroBurnResult result,
+				   GError *error,
+				   gpointer data)
+{
+	BraseroBurnFanoutDrive *node = data;
+	BraseroBurnPrivate *priv;
+
+	priv = BRASERO_BURN_PRIVATE (node->burn);
+
+	/* What brasero_burn_run_tasks () does once the recorder returns */
+	if (result == BRASERO_BURN_OK) {
+		priv->tasks_done ++;
+		g_signal_emit (node->burn,
+			       brasero_burn_signals [PROGRESS_CHANGED_SIGNAL],
+			       0,
+			       1.0,
+			       1.0,
+			       -1L);
+	}
+
+	brasero_burn_session_pop_settings (priv->session);
+	g_object_unref (priv->task);
+	priv->task = NULL;
+
+	node->error = error;
+
+	/* This unlocks and ejects the medium right away */
+	result = brasero_burn_record_end (node->burn, result, &node->error);
+	brasero_burn_fanout_drive_finished (node, result);
+}
+
+/* Everything that may wait (for a medium to be inserted, for the drive, for
+ * the medium to be blanked, ...) is done for each drive in turn before the
+ * image is read. Otherwise these waits would run loops nested in the one
+ * of brasero_burn_record_fanout () while the other drives are recording. */
+
+static void
+brasero_burn_fanout_drive_prepare (BraseroBurnFanoutDrive *node)
+{
+	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (node->parent);
+	BraseroBurnPrivate *node_priv;
+	BraseroBurnResult result;
+
+	if (priv->fanout_cancel) {
+		brasero_burn_fanout_drive_finished (node, BRASERO_BURN_CANCEL);
+		return;
+	}
+
+	/* The recorder doesn't run a loop of its own. Otherwise the recordings
+	 * would be nested and a drive could only be finished (unlocked and
+	 * ejected) once all those started after it were. It is finished from
+	 * brasero_burn_fanout_recorder_done () as soon as its recording stops
+	 * and the only loop is the one in brasero_burn_record_fanout (). */
+	node_priv = BRASERO_BURN_PRIVATE (node->burn);
+	node_priv->recorder_done = brasero_burn_fanout_recorder_done;
+	node_priv->recorder_data = node;
+
+	result = brasero_burn_record_begin (node->burn, node->session, &node->error);
+	if (result == BRASERO_BURN_OK)
+		result = brasero_burn_record_session (node->burn, TRUE, NULL, &node->error);
+
+	/* The recorder is ready */
+	if (result == BRASERO_BURN_RUNNING) {
+		node->ready = TRUE;
+		return;
+	}
+
+	result = brasero_burn_record_end (node->burn, result, &node->error);
+	brasero_burn_fanout_drive_finished (node, result);
+}
+
+static void
+brasero_burn_fanout_drive_start (BraseroBurnFanoutDrive *node,
+				 BraseroBurnResult result)
+{
+	GError *error = NULL;
+
+	if (result == BRASERO_BURN_OK)
+		result = brasero_burn_start_recorder (node->burn, &error);
+
+	if (result != BRASERO_BURN_RUNNING)
+		brasero_burn_fanout_recorder_done (NULL, result, error, node);
+}
+
+static BraseroBurnFanoutDrive *
+brasero_burn_fanout_drive_new (BraseroBurn *self,
+			       BraseroBurnSession *session,
+			       BraseroDrive *drive,
+			       const gchar *image,
+			       goffset blocks)
+{
+	BraseroBurnFanoutDrive *node;
+	BraseroTrackImage *track;
+
+	node = g_new0 (BraseroBurnFanoutDrive, 1);
+	node->parent = self;
+	node->drive = g_object_ref (drive);
+	node->remaining = -1;
+	node->result = BRASERO_BURN_NOT_RUNNING;
+
+	/* Each drive gets its own session with the same settings */
+	node->session = brasero_burn_session_new ();
+	brasero_burn_session_set_burner (node->session, drive);
+	brasero_burn_session_set_flags (node->session, brasero_burn_session_get_flags (session));
+	brasero_burn_session_set_rate (node->session, brasero_burn_session_get_rate (session));
+	brasero_burn_session_set_tmpdir (node->session, brasero_burn_session_get_tmpdir (session));
+
+	track = brasero_track_image_new ();
+	brasero_track_image_set_source (track,
+					image,
+					NULL,
+					BRASERO_IMAGE_FORMAT_BIN);
+	brasero_track_image_set_block_num (track, blocks);
+	brasero_burn_session_add_track (node->session, BRASERO_TRACK (track), NULL);
+	g_object_unref (track);
+
+	node->burn = brasero_burn_new ();
+	g_signal_connect (node->burn,
+			  "insert_media",
+			  G_CALLBACK (brasero_burn_fanout_insert_media_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "eject_failure",
+			  G_CALLBACK (brasero_burn_fanout_eject_failure_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "location-request",
+			  G_CALLBACK (brasero_burn_fanout_location_request_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "install_missing",
+			  G_CALLBACK (brasero_burn_fanout_install_missing_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "warn_data_loss",
+			  G_CALLBACK (brasero_burn_fanout_data_loss_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "warn_previous_session_loss",
+			  G_CALLBACK (brasero_burn_fanout_previous_session_loss_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "warn_audio_to_appendable",
+			  G_CALLBACK (brasero_burn_fanout_audio_to_appendable_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "warn_rewritable",
+			  G_CALLBACK (brasero_burn_fanout_rewritable_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "dummy_success",
+			  G_CALLBACK (brasero_burn_fanout_dummy_success_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "blank_failure",
+			  G_CALLBACK (brasero_burn_fanout_blank_failure_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "progress_changed",
+			  G_CALLBACK (brasero_burn_fanout_progress_changed_cb),
+			  node);
+	g_signal_connect (node->burn,
+			  "action_changed",
+			  G_CALLBACK (brasero_burn_fanout_action_changed_cb),
+			  node);
+
+	return node;
+}
+
+static BraseroBurnResult
+brasero_burn_fanout_get_image (BraseroBurn *self,
+			       BraseroBurnSession *session,
+			       gchar **image,
+			       GError **error)
+{
+	BraseroBurnSession *imaging;
+	BraseroBurnResult result;
+	GSList *tracks;
+
+	/* An ISO image can be streamed as is */
+	tracks = brasero_burn_session_get_tracks (session);
+	if (g_slist_length (tracks) == 1
+	&&  BRASERO_IS_TRACK_IMAGE (tracks->data)
+	&&  brasero_track_image_get_format (tracks->data) == BRASERO_IMAGE_FORMAT_BIN) {
+		*image = brasero_track_image_get_source (tracks->data, FALSE);
+		return BRASERO_BURN_OK;
+	}
+
+	/* Otherwise create it once for all the drives. It is a temporary file
+	 * of @session and goes away with it. */
+	result = brasero_burn_session_get_tmp_image (session,
+						     BRASERO_IMAGE_FORMAT_BIN,
+						     image,
+						     NULL,
+						     error);
+	if (result != BRASERO_BURN_OK)
+		return result;
+
+	imaging = brasero_burn_session_new ();
+	for (; tracks; tracks = tracks->next)
+		brasero_burn_session_add_track (imaging, tracks->data, NULL);
+
+	brasero_burn_session_set_tmpdir (imaging, brasero_burn_session_get_tmpdir (session));
+	brasero_burn_session_set_label (imaging, brasero_burn_session_get_label (session));
+	brasero_burn_session_set_image_output_full (imaging,
+						    BRASERO_IMAGE_FORMAT_BIN,
+						    *image,
+						    NULL);
+	brasero_burn_session_set_output_tmp (imaging, TRUE);
+
+	result = brasero_burn_record (self, imaging, error);
+	g_object_unref (imaging);
+
+	if (result != BRASERO_BURN_OK) {
+		g_free (*image);
+		*image = NULL;
+	}
+
+	return result;
+}
+
+/**
+ * brasero_burn_record_fanout:
+ * @burn: a #BraseroBurn
+ * @session: a #BraseroBurnSession
+ * @drives: (element-type BraseroBurn.Drive): a #GSList of #BraseroDrive
+ * @error: a #GError
+ *
+ * Burns the contents of @session on all the drives in @drives at the same
+ * time. The burner set in @session is ignored; its other settings are used
+ * for every drive.
+ *
+ * Unless @session already holds an ISO image, an image is created first.
+ * Each drive is then prepared in turn (its medium is locked and blanked if
+ * need be). The image is read once and fed to all the recorders. A drive that
+ * is slower than the others holds them back only once they are more than
+ * a few megabytes ahead of it. A drive that fails or is cancelled stops
+ * holding them back. Each medium is unlocked (and ejected if need be) as
+ * soon as its recording stops. Since the image is only read once, a failed
+ * recording is not retried and a simulation is not followed by the actual
+ * recording.
+ *
+ * Each drive reports its progress and its actions with the
+ * #BraseroBurn::drive-progress-changed and #BraseroBurn::drive-action-changed
+ * signals and its result with #BraseroBurn::drive-finished. The usual
+ * #BraseroBurn::progress-changed signal reports the average progress.
+ * Requests for a medium or warnings of any drive are emitted by @burn.
+ *
+ * Return value: a #BraseroBurnResult. BRASERO_BURN_OK if all drives
+ * succeeded. Otherwise @error is set from the first drive that failed.
+ **/
+
+BraseroBurnResult
+brasero_burn_record_fanout (BraseroBurn *burn,
+			    BraseroBurnSession *session,
+			    GSList *drives,
+			    GError **error)
+{
+	BraseroBurnResult result;
+	BraseroBurnPrivate *priv;
+	BraseroFanout *fanout;
+	GError *ret_error = NULL;
+	gchar *image = NULL;
+	goffset blocks;
+	GStatBuf buf;
+	GSList *iter;
+
+	g_return_val_if_fail (BRASERO_IS_BURN (burn), BRASERO_BURN_ERR);
+	g_return_val_if_fail (BRASERO_IS_BURN_SESSION (session), BRASERO_BURN_ERR);
+	g_return_val_if_fail (drives != NULL, BRASERO_BURN_ERR);
+
+	priv = BRASERO_BURN_PRIVATE (burn);
+
+	/* make sure we're ready */
+	if (brasero_burn_session_get_status (session, NULL) != BRASERO_BURN_OK)
+		return BRASERO_BURN_ERR;
+
+	result = brasero_burn_fanout_get_image (burn, session, &image, error);
+	if (result != BRASERO_BURN_OK)
+		return result;
+
+	if (g_stat (image, &buf)) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("File \"%s\" could not be opened (%s)"),
+			     image,
+			     g_strerror (errsv));
+		g_free (image);
+		return BRASERO_BURN_ERR;
+	}
+	blocks = BRASERO_BYTES_TO_SECTORS (buf.st_size, 2048);
+
+	fanout = brasero_fanout_new (image, error);
+	if (!fanout) {
+		g_free (image);
+		return BRASERO_BURN_ERR;
+	}
+
+	priv->fanout_cancel = FALSE;
+	priv->fanout_running = g_slist_length (drives);
+	for (iter = drives; iter; iter = iter->next) {
+		BraseroBurnFanoutDrive *node;
+		BraseroBurnPrivate *node_priv;
+
+		node = brasero_burn_fanout_drive_new (burn,
+						      session,
+						      iter->data,
+						      image,
+						      blocks);
+		priv->fanout_drives = g_slist_append (priv->fanout_drives, node);
+
+		/* The recorder reads this pipe instead of the image */
+		node_priv = BRASERO_BURN_PRIVATE (node->burn);
+		node_priv->input_fd = brasero_fanout_add_output (fanout, error);
+		if (node_priv->input_fd < 0) {
+			result = BRASERO_BURN_ERR;
+			goto end;
+		}
+	}
+
+	for (iter = priv->fanout_drives; iter; iter = iter->next)
+		brasero_burn_fanout_drive_prepare (iter->data);
+
+	/* Nothing is read if all drives already failed or were cancelled */
+	if (priv->fanout_running) {
+		result = BRASERO_BURN_OK;
+		if (priv->fanout_cancel)
+			result = BRASERO_BURN_CANCEL;
+		else if (!brasero_fanout_start (fanout, &ret_error))
+			result = BRASERO_BURN_ERR;
+
+		if (result == BRASERO_BURN_OK)
+			brasero_burn_action_changed_real (burn, BRASERO_BURN_ACTION_RECORDING);
+
+		/* Start all recordings (or finish the drives if the image
+		 * can't be read) and wait for them */
+		for (iter = priv->fanout_drives; iter; iter = iter->next) {
+			BraseroBurnFanoutDrive *node = iter->data;
+
+			if (node->ready)
+				brasero_burn_fanout_drive_start (node, result);
+		}
+
+		if (ret_error) {
+			g_propagate_error (error, ret_error);
+			ret_error = NULL;
+			goto end;
+		}
+
+		if (priv->fanout_running) {
+			priv->fanout_loop = g_main_loop_new (NULL, FALSE);
+			g_main_loop_run (priv->fanout_loop);
+			g_main_loop_unref (priv->fanout_loop);
+			priv->fanout_loop = NULL;
+		}
+	}
+
+	/* A read error is the most likely reason for the failures */
+	if (brasero_fanout_get_error (fanout, &ret_error)) {
+		result = BRASERO_BURN_ERR;
+		g_propagate_error (error, ret_error);
+		goto end;
+	}
+
+	/* Failures prevail over cancellations */
+	result = BRASERO_BURN_OK;
+	for (iter = priv->fanout_drives; iter; iter = iter->next) {
+		BraseroBurnFanoutDrive *node = iter->data;
+
+		if (node->result == BRASERO_BURN_OK
+		||  result == BRASERO_BURN_ERR)
+			continue;
+
+		if (node->result == BRASERO_BURN_CANCEL) {
+			result = BRASERO_BURN_CANCEL;
+			continue;
+		}
+
+		/* Report the first failure */
+		result = BRASERO_BURN_ERR;
+		if (node->error)
+			g_propagate_error (error, g_error_copy (node->error));
+	}
+
+	if (result == BRASERO_BURN_OK)
+		brasero_burn_action_changed_real (burn, BRASERO_BURN_ACTION_FINISHED);
+
+end:
+
+	brasero_fanout_cancel (fanout);
+	brasero_fanout_unref (fanout);
+
+	g_slist_foreach (priv->fanout_drives, (GFunc) brasero_burn_fanout_drive_free, NULL);
+	g_slist_free (priv->fanout_drives);
+	priv->fanout_drives = NULL;
+
+	g_free (image);
+	return result;
+}
+
 static BraseroBurnResult
 brasero_burn_blank_real (BraseroBurn *burn, GError **error)
 {
@@ -2887,6 +3728,8 @@ brasero_burn_blank_real (BraseroBurn *burn, GError **error)
 	if (!priv->task)
 		return BRASERO_BURN_NOT_SUPPORTED;
 
+	brasero_burn_set_task_telemetry (burn);
+
 	g_signal_connect (priv->task,
 			  "progress-changed",
 			  G_CALLBACK (brasero_burn_progress_changed),
@@ -2935,6 +3778,7 @@ brasero_burn_blank (BraseroBurn *burn,
 	priv->session = session;
 
 	brasero_burn_powermanagement (burn, TRUE);
+	brasero_burn_telemetry_start (burn);
 
 	/* we wait for the insertion of a media and lock it */
 	result = brasero_burn_lock_rewritable_media (burn, error);
@@ -2976,6 +3820,7 @@ end:
 		brasero_burn_action_changed_real (burn, BRASERO_BURN_ACTION_FINISHED);
 
 	brasero_burn_powermanagement (burn, FALSE);
+	brasero_burn_telemetry_stop (burn);
 
 	/* release session */
 	g_object_unref (priv->session);
@@ -3017,6 +3862,20 @@ brasero_burn_cancel (BraseroBurn *burn, gboolean protect)
 		priv->sleep_loop = NULL;
 	}
 
+	if (priv->fanout_drives) {
+		GSList *iter;
+
+		priv->fanout_cancel = TRUE;
+		for (iter = priv->fanout_drives; iter; iter = iter->next) {
+			BraseroBurnFanoutDrive *node = iter->data;
+			BraseroBurnResult node_result;
+
+			node_result = brasero_burn_cancel (node->burn, protect);
+			if (node_result != BRASERO_BURN_OK)
+				result = node_result;
+		}
+	}
+
 	if (priv->dest)
 		brasero_drive_cancel_current_operation (priv->dest);
 
@@ -3057,6 +3916,21 @@ brasero_burn_finalize (GObject *object)
 	if (priv->caps)
 		g_object_unref (priv->caps);
 
+	if (priv->telemetry_id) {
+		brasero_dbus_unexport_telemetry (priv->telemetry_id);
+		priv->telemetry_id = 0;
+	}
+
+	if (priv->telemetry) {
+		brasero_telemetry_unref (priv->telemetry);
+		priv->telemetry = NULL;
+	}
+
+	if (priv->input_fd >= 0) {
+		close (priv->input_fd);
+		priv->input_fd = -1;
+	}
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -3204,6 +4078,45 @@ brasero_burn_class_init (BraseroBurnClass *klass)
 			      G_TYPE_INT, 2,
 		              G_TYPE_INT,
 			      G_TYPE_STRING);
+	brasero_burn_signals [DRIVE_PROGRESS_CHANGED_SIGNAL] =
+		g_signal_new ("drive_progress_changed",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (BraseroBurnClass,
+					       drive_progress_changed),
+			      NULL, NULL,
+			      brasero_marshal_VOID__OBJECT_DOUBLE_DOUBLE_LONG,
+			      G_TYPE_NONE,
+			      4,
+			      BRASERO_TYPE_DRIVE,
+			      G_TYPE_DOUBLE,
+			      G_TYPE_DOUBLE,
+			      G_TYPE_LONG);
+	brasero_burn_signals [DRIVE_ACTION_CHANGED_SIGNAL] =
+		g_signal_new ("drive_action_changed",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (BraseroBurnClass,
+					       drive_action_changed),
+			      NULL, NULL,
+			      brasero_marshal_VOID__OBJECT_INT,
+			      G_TYPE_NONE,
+			      2,
+			      BRASERO_TYPE_DRIVE,
+			      G_TYPE_INT);
+	brasero_burn_signals [DRIVE_FINISHED_SIGNAL] =
+		g_signal_new ("drive_finished",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (BraseroBurnClass,
+					       drive_finished),
+			      NULL, NULL,
+			      brasero_marshal_VOID__OBJECT_INT_POINTER,
+			      G_TYPE_NONE,
+			      3,
+			      BRASERO_TYPE_DRIVE,
+			      G_TYPE_INT,
+			      G_TYPE_POINTER);
 }
 
 static void
@@ -3212,4 +4125,5 @@ brasero_burn_init (BraseroBurn *obj)
 	BraseroBurnPrivate *priv = BRASERO_BURN_PRIVATE (obj);
 
 	priv->caps = brasero_burn_caps_get_default ();
+	priv->input_fd = -1;
 }
@@ -90,6 +90,20 @@ typedef struct {
 	BraseroBurnResult		(*install_missing)		(BraseroBurn *obj,
 									 BraseroPluginErrorType error,
 									 const gchar *detail);
+
+	/* only emitted by brasero_burn_record_fanout () */
+	void				(*drive_progress_changed)	(BraseroBurn *obj,
+									 BraseroDrive *drive,
+									 gdouble overall_progress,
+									 gdouble action_progress,
+									 glong time_remaining);
+	void				(*drive_action_changed)		(BraseroBurn *obj,
+									 BraseroDrive *drive,
+									 BraseroBurnAction action);
+	void				(*drive_finished)		(BraseroBurn *obj,
+									 BraseroDrive *drive,
+									 BraseroBurnResult result,
+									 const GError *error);
 } BraseroBurnClass;
 
 GType brasero_burn_get_type (void);
@@ -100,6 +114,12 @@ brasero_burn_record (BraseroBurn *burn,
 		     BraseroBurnSession *session,
 		     GError **error);
 
+BraseroBurnResult
+brasero_burn_record_fanout (BraseroBurn *burn,
+			    BraseroBurnSession *session,
+			    GSList *drives,
+			    GError **error);
+
 BraseroBurnResult
 brasero_burn_check (BraseroBurn *burn,
 		    BraseroBurnSession *session,
@@ -126,6 +146,9 @@ brasero_burn_get_action_string (BraseroBurn *burn,
 				BraseroBurnAction action,
 				gchar **string);
 
+GVariant *
+brasero_burn_get_telemetry (BraseroBurn *burn);
+
 G_END_DECLS
 
 #endif /* BURN_H */
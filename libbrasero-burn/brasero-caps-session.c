@@ -560,7 +560,148 @@ brasero_caps_find_link_set_ctx (BraseroBurnSession *session,
 
 static BraseroBurnResult
 brasero_caps_find_link (BraseroCaps *caps,
-                        BraseroFindLinkCtx *ctx)
+                        BraseroFindLinkCtx *ctx);
+
+/**
+ * Results of brasero_caps_find_link () only depend on the caps, the context
+ * and the state of plugins. The UI asks the same questions many times so they
+ * are remembered for each node of the graph until the state of a plugin
+ * changes (see brasero_plugin_get_state_serial ()). Medium changes need no
+ * special handling since the media is part of the key.
+ */
+
+struct _BraseroFindLinkKey {
+	BraseroCaps *caps;
+	BraseroTrackDataType input_type;
+	BraseroMedia input_subtype;
+	BraseroMedia media;
+	BraseroPluginIOFlag io_flags;
+	BraseroBurnFlag session_flags;
+	guint ignore_plugin_errors:1;
+	guint check_session_flags:1;
+};
+typedef struct _BraseroFindLinkKey BraseroFindLinkKey;
+
+G_LOCK_DEFINE_STATIC (links_cache);
+static GHashTable *links_cache = NULL;
+static guint links_cache_serial = 0;
+static guint links_cache_queries = 0;
+static guint links_cache_hits = 0;
+
+static guint
+brasero_caps_find_link_key_hash (gconstpointer data)
+{
+	const BraseroFindLinkKey *key = data;
+	guint hash;
+
+	hash = g_direct_hash (key->caps);
+	hash = hash * 31 + key->input_type;
+	hash = hash * 31 + key->input_subtype;
+	hash = hash * 31 + key->media;
+	hash = hash * 31 + key->io_flags;
+	hash = hash * 31 + key->session_flags;
+	hash = hash * 31 + (key->ignore_plugin_errors << 1 | key->check_session_flags);
+	return hash;
+}
+
+static gboolean
+brasero_caps_find_link_key_equal (gconstpointer a,
+                                  gconstpointer b)
+{
+	const BraseroFindLinkKey *key_a = a;
+	const BraseroFindLinkKey *key_b = b;
+
+	return key_a->caps == key_b->caps
+	    && key_a->input_type == key_b->input_type
+	    && key_a->input_subtype == key_b->input_subtype
+	    && key_a->media == key_b->media
+	    && key_a->io_flags == key_b->io_flags
+	    && key_a->session_flags == key_b->session_flags
+	    && key_a->ignore_plugin_errors == key_b->ignore_plugin_errors
+	    && key_a->check_session_flags == key_b->check_session_flags;
+}
+
+static void
+brasero_caps_find_link_key_set (BraseroFindLinkKey *key,
+                                BraseroCaps *caps,
+                                BraseroFindLinkCtx *ctx)
+{
+	memset (key, 0, sizeof (BraseroFindLinkKey));
+	key->caps = caps;
+	key->input_type = ctx->input->type;
+
+	/* All members of the union have the same size */
+	key->input_subtype = ctx->input->subtype.media;
+	key->media = ctx->media;
+	key->io_flags = ctx->io_flags;
+	key->session_flags = ctx->session_flags;
+	key->ignore_plugin_errors = ctx->ignore_plugin_errors;
+	key->check_session_flags = ctx->check_session_flags;
+}
+
+static gboolean
+brasero_caps_find_link_cached (BraseroFindLinkKey *key,
+                               BraseroBurnResult *result)
+{
+	gpointer value;
+	guint serial;
+
+	serial = brasero_plugin_get_state_serial ();
+
+	G_LOCK (links_cache);
+
+	if (!links_cache || links_cache_serial != serial) {
+		if (links_cache) {
+			BRASERO_BURN_LOG ("Plugin state changed; dropping caps cache (%u queries, %u hits, %.1f%%)",
+					  links_cache_queries,
+					  links_cache_hits,
+					  links_cache_queries ? links_cache_hits * 100.0 / links_cache_queries : 0.0);
+			g_hash_table_destroy (links_cache);
+		}
+
+		links_cache = g_hash_table_new_full (brasero_caps_find_link_key_hash,
+						     brasero_caps_find_link_key_equal,
+						     g_free,
+						     NULL);
+		links_cache_serial = serial;
+		links_cache_queries = 0;
+		links_cache_hits = 0;
+	}
+
+	links_cache_queries ++;
+	value = g_hash_table_lookup (links_cache, key);
+	if (value)
+		links_cache_hits ++;
+
+	G_UNLOCK (links_cache);
+
+	if (!value)
+		return FALSE;
+
+	/* Results are stored shifted by one so that BRASERO_BURN_OK is not NULL */
+	*result = GPOINTER_TO_INT (value) - 1;
+	return TRUE;
+}
+
+static void
+brasero_caps_find_link_cache (BraseroFindLinkKey *key,
+                              guint serial,
+                              BraseroBurnResult result)
+{
+	G_LOCK (links_cache);
+
+	/* Don't store anything computed with a stale plugin state */
+	if (links_cache && links_cache_serial == serial)
+		g_hash_table_insert (links_cache,
+				     g_memdup (key, sizeof (BraseroFindLinkKey)),
+				     GINT_TO_POINTER (result + 1));
+
+	G_UNLOCK (links_cache);
+}
+
+static BraseroBurnResult
+brasero_caps_find_link_real (BraseroCaps *caps,
+                             BraseroFindLinkCtx *ctx)
 {
 	GSList *iter;
 
@@ -657,6 +798,28 @@ brasero_caps_find_link (BraseroCaps *caps,
 	return BRASERO_BURN_NOT_SUPPORTED;
 }
 
+static BraseroBurnResult
+brasero_caps_find_link (BraseroCaps *caps,
+                        BraseroFindLinkCtx *ctx)
+{
+	BraseroFindLinkKey key;
+	BraseroBurnResult result;
+	guint serial;
+
+	/* Reporting plugin errors through the callback can't be cached */
+	if (ctx->callback)
+		return brasero_caps_find_link_real (caps, ctx);
+
+	brasero_caps_find_link_key_set (&key, caps, ctx);
+	if (brasero_caps_find_link_cached (&key, &result))
+		return result;
+
+	serial = brasero_plugin_get_state_serial ();
+	result = brasero_caps_find_link_real (caps, ctx);
+	brasero_caps_find_link_cache (&key, serial, result);
+	return result;
+}
+
 static BraseroBurnResult
 brasero_caps_try_output (BraseroBurnCaps *self,
                          BraseroFindLinkCtx *ctx,
@@ -45,6 +45,7 @@
 #include "brasero-units.h"
 
 #include "brasero-data-project.h"
+#include "brasero-image-layout.h"
 #include "libbrasero-marshal.h"
 
 #include "brasero-misc.h"
@@ -85,6 +86,9 @@ struct _BraseroDataProjectPrivate
 	/* This is a counter for the number of files to be loaded */
 	guint loading;
 
+	/* Directories created for the grafts added so far while loading */
+	GSList *loading_folders;
+
 	guint is_loading_contents:1;
 };
 
@@ -2168,6 +2172,31 @@ brasero_data_project_node_reloaded (BraseroDataProject *self,
 			       0);
 }
 
+void
+brasero_data_project_node_mime (BraseroDataProject *self,
+				BraseroFileNode *node,
+				const gchar *mime)
+{
+	gchar *registered;
+
+	/* Only the content type of a file changes here: neither its size nor
+	 * its name; that's why there's no need to use a GFileInfo. */
+	if (!node->is_file || node->is_imported)
+		return;
+
+	registered = brasero_utils_register_string (mime);
+	if (BRASERO_FILE_NODE_MIME (node) == registered) {
+		brasero_utils_unregister_string (registered);
+		return;
+	}
+
+	if (BRASERO_FILE_NODE_MIME (node))
+		brasero_utils_unregister_string (BRASERO_FILE_NODE_MIME (node));
+
+	node->union2.mime = registered;
+	brasero_data_project_node_changed (self, node);
+}
+
 static BraseroFileNode *
 brasero_data_project_add_loading_node_real (BraseroDataProject *self,
 					    const gchar *uri,
@@ -2251,6 +2280,206 @@ brasero_data_project_add_hidden_node (BraseroDataProject *self,
 	return brasero_data_project_add_loading_node_real (self, uri, name, TRUE, parent);
 }
 
+/**
+ * The following functions add many nodes under the same parent at once
+ */
+
+struct _BraseroDataProjectEntry {
+	BraseroFileNode *node;
+	const gchar *uri;
+	GFileInfo *info;
+};
+typedef struct _BraseroDataProjectEntry BraseroDataProjectEntry;
+
+static gint
+brasero_data_project_sort_entries_cb (gconstpointer a,
+				      gconstpointer b,
+				      gpointer user_data)
+{
+	const BraseroDataProjectEntry *entry_a = a;
+	const BraseroDataProjectEntry *entry_b = b;
+	GCompareFunc sort_func = user_data;
+
+	return sort_func (entry_a->node, entry_b->node);
+}
+
+static gboolean
+brasero_data_project_info_usable (GFileInfo *info)
+{
+	GFileType type;
+
+	if (!info)
+		return FALSE;
+
+	/* Only plain readable files and directories are used as they are. The
+	 * others need the checks (and maybe the signals) done when a node is
+	 * loaded. */
+	type = g_file_info_get_file_type (info);
+	if (type != G_FILE_TYPE_REGULAR && type != G_FILE_TYPE_DIRECTORY)
+		return FALSE;
+
+	if (g_file_info_get_is_symlink (info))
+		return FALSE;
+
+	if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ)
+	&& !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
+		return FALSE;
+
+	if (type == G_FILE_TYPE_REGULAR
+	&&  BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2048) > BRASERO_FILE_2G_LIMIT)
+		return FALSE;
+
+	return TRUE;
+}
+
+/**
+ * Adds all @uris (NULL terminated) under @parent. If @infos is not NULL it
+ * has the information for each URI (or NULL) and these nodes don't need to
+ * be loaded. All nodes are created and sorted before being merged with the
+ * children of @parent in one pass; size-changed is emitted only once.
+ * URIs whose name is already taken are added one by one afterwards so that
+ * the collision is signalled as usual.
+ * Returns the number of nodes added.
+ */
+
+guint
+brasero_data_project_add_nodes (BraseroDataProject *self,
+				const gchar * const *uris,
+				GFileInfo **infos,
+				BraseroFileNode *parent)
+{
+	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
+	gboolean size_changed = FALSE;
+	GSList *one_by_one = NULL;
+	BraseroFileNode *head;
+	GHashTable *names;
+	GArray *entries;
+	gboolean use_info;
+	guint added = 0;
+	GSList *iter;
+	guint i;
+
+	g_return_val_if_fail (BRASERO_IS_DATA_PROJECT (self), 0);
+	g_return_val_if_fail (uris != NULL, 0);
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	if (!parent)
+		parent = priv->root;
+
+	/* Deep files must be signalled when they are loaded */
+	use_info = (infos && brasero_file_node_get_depth (parent) < 5);
+	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+
+	/* Build all the nodes outside the tree */
+	names = g_hash_table_new (g_str_hash, g_str_equal);
+	for (head = BRASERO_FILE_NODE_CHILDREN (parent); head; head = head->next)
+		g_hash_table_insert (names, (gchar *) BRASERO_FILE_NODE_NAME (head), head);
+
+	entries = g_array_new (FALSE, FALSE, sizeof (BraseroDataProjectEntry));
+	for (i = 0; uris [i]; i ++) {
+		BraseroDataProjectEntry entry;
+		gchar *name;
+
+		name = brasero_utils_get_uri_name (uris [i]);
+		if (!name || name [0] == '\0' || g_hash_table_lookup (names, name)) {
+			one_by_one = g_slist_prepend (one_by_one, (gchar *) uris [i]);
+			g_free (name);
+			continue;
+		}
+
+		entry.uri = uris [i];
+		if (use_info && brasero_data_project_info_usable (infos [i])) {
+			entry.info = infos [i];
+			entry.node = brasero_file_node_new (name);
+			brasero_file_node_set_from_info (entry.node, stats, entry.info);
+		}
+		else {
+			entry.info = NULL;
+			entry.node = brasero_file_node_new_loading (name);
+		}
+		g_free (name);
+
+		g_hash_table_insert (names, (gchar *) BRASERO_FILE_NODE_NAME (entry.node), entry.node);
+		g_array_append_val (entries, entry);
+	}
+	g_hash_table_destroy (names);
+
+	/* Sort them and merge them with the existing children */
+	if (priv->sort_func)
+		g_array_sort_with_data (entries,
+					brasero_data_project_sort_entries_cb,
+					priv->sort_func);
+
+	head = NULL;
+	for (i = entries->len; i > 0; i --) {
+		BraseroDataProjectEntry *entry;
+
+		entry = &g_array_index (entries, BraseroDataProjectEntry, i - 1);
+		entry->node->next = head;
+		head = entry->node;
+	}
+
+	if (head)
+		brasero_file_node_add_sorted (parent, head, priv->sort_func);
+
+	/* Now graft them and tell everyone */
+	for (i = 0; i < entries->len; i ++) {
+		BraseroDataProjectEntry *entry;
+		BraseroURINode *graft;
+		BraseroFileNode *node;
+
+		entry = &g_array_index (entries, BraseroDataProjectEntry, i);
+		node = entry->node;
+
+		graft = g_hash_table_lookup (priv->grafts, entry->uri);
+		if (!brasero_data_project_add_node_real (self, node, graft, entry->uri))
+			continue;
+
+		added ++;
+		if (!entry->info)
+			continue;
+
+		if (node->is_file)
+			size_changed = TRUE;
+
+		if (!node->is_monitored) {
+
+#ifdef BUILD_INOTIFY
+
+			if (node->is_grafted)
+				brasero_file_monitor_single_file (BRASERO_FILE_MONITOR (self),
+								  entry->uri,
+								  node);
+
+			if (!node->is_file)
+				brasero_file_monitor_directory_contents (BRASERO_FILE_MONITOR (self),
+									 entry->uri,
+									 node);
+			node->is_monitored = TRUE;
+
+#endif
+
+		}
+	}
+	g_array_free (entries, TRUE);
+
+	one_by_one = g_slist_reverse (one_by_one);
+	for (iter = one_by_one; iter; iter = iter->next) {
+		if (brasero_data_project_add_loading_node_real (self, iter->data, NULL, FALSE, parent))
+			added ++;
+	}
+	g_slist_free (one_by_one);
+
+	if (size_changed)
+		g_signal_emit (self,
+			       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
+			       0);
+
+	return added;
+}
+
 void
 brasero_data_project_directory_node_loaded (BraseroDataProject *self,
 					    BraseroFileNode *parent)
@@ -3569,18 +3798,24 @@ brasero_data_project_load_contents_notify (BraseroDataProject *self)
 	return num;
 }
 
-guint
-brasero_data_project_load_contents (BraseroDataProject *self,
-				    GSList *grafts,
-				    GSList *excluded)
+/**
+ * Adds @grafts to the tree without loading them yet. This can be called
+ * several times before brasero_data_project_load_contents () which loads
+ * them all along with its own grafts.
+ */
+
+void
+brasero_data_project_load_contents_add (BraseroDataProject *self,
+					GSList *grafts)
 {
 	GSList *iter;
-	GSList *folders = NULL;
+	GSList *folders;
 	BraseroDataProjectPrivate *priv;
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
 	priv->is_loading_contents = 1;
 
+	folders = priv->loading_folders;
 	for (iter = grafts; iter; iter = iter->next) {
 		BraseroGraftPt *graft;
 		GFile *file;
@@ -3618,6 +3853,23 @@ brasero_data_project_load_contents (BraseroDataProject *self,
 		g_free (path);
 		g_free (uri);
 	}
+	priv->loading_folders = folders;
+}
+
+guint
+brasero_data_project_load_contents (BraseroDataProject *self,
+				    GSList *grafts,
+				    GSList *excluded)
+{
+	GSList *iter;
+	GSList *folders;
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	brasero_data_project_load_contents_add (self, grafts);
+	folders = priv->loading_folders;
+	priv->loading_folders = NULL;
 
 	for (iter = excluded; iter; iter = iter->next) {
 		gchar *uri;
@@ -3711,6 +3963,33 @@ brasero_data_project_get_sectors (BraseroDataProject *self)
 	return retval;
 }
 
+goffset
+brasero_data_project_get_image_sectors (BraseroDataProject *self,
+					BraseroImageFS fs_type)
+{
+	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
+	goffset sectors;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	sectors = brasero_data_project_get_sectors (self);
+	if (!sectors)
+		return 0;
+
+	/* The UDF structures of video projects are not modelled; in this case
+	 * fall back to the rough estimation. */
+	stats = BRASERO_FILE_NODE_STATS (priv->root);
+	if (fs_type & BRASERO_IMAGE_FS_UDF)
+		return brasero_data_project_improve_image_size_accuracy (sectors,
+									 stats->num_dir,
+									 fs_type);
+
+	return sectors + brasero_image_layout_get_sectors (stats->layout,
+							   priv->root,
+							   fs_type);
+}
+
 struct _BraseroFileSize {
 	goffset sum;
 	BraseroFileNode *node;
@@ -3928,6 +4207,13 @@ brasero_data_project_finalize (GObject *object)
 	BraseroDataProjectPrivate *priv;
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (object);
+
+	/* A load that was never completed */
+	if (priv->loading_folders) {
+		g_slist_free (priv->loading_folders);
+		priv->loading_folders = NULL;
+	}
+
 	brasero_data_project_clear (BRASERO_DATA_PROJECT (object));
 
 	if (priv->grafts) {
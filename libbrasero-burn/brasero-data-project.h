@@ -125,6 +125,10 @@ brasero_data_project_reset (BraseroDataProject *project);
 goffset
 brasero_data_project_get_sectors (BraseroDataProject *project);
 
+goffset
+brasero_data_project_get_image_sectors (BraseroDataProject *project,
+					BraseroImageFS fs_type);
+
 goffset
 brasero_data_project_improve_image_size_accuracy (goffset blocks,
 						  guint64 dir_num,
@@ -153,6 +157,10 @@ brasero_data_project_is_video_project (BraseroDataProject *project);
 gboolean
 brasero_data_project_is_joliet_compliant (BraseroDataProject *project);
 
+void
+brasero_data_project_load_contents_add (BraseroDataProject *project,
+					GSList *grafts);
+
 guint
 brasero_data_project_load_contents (BraseroDataProject *project,
 				    GSList *grafts,
@@ -164,6 +172,12 @@ brasero_data_project_add_hidden_node (BraseroDataProject *project,
 				      const gchar *name,
 				      BraseroFileNode *parent);
 
+guint
+brasero_data_project_add_nodes (BraseroDataProject *project,
+				const gchar * const *uris,
+				GFileInfo **infos,
+				BraseroFileNode *parent);
+
 BraseroFileNode *
 brasero_data_project_add_loading_node (BraseroDataProject *project,
 				       const gchar *uri,
@@ -200,6 +214,10 @@ brasero_data_project_node_reloaded (BraseroDataProject *project,
 				    const gchar *uri,
 				    GFileInfo *info);
 void
+brasero_data_project_node_mime (BraseroDataProject *project,
+				BraseroFileNode *node,
+				const gchar *mime);
+void
 brasero_data_project_directory_node_loaded (BraseroDataProject *project,
 					    BraseroFileNode *parent);
 
@@ -53,11 +53,17 @@
 
 #include "libbrasero-marshal.h"
 
+#include "burn-debug.h"
+
 typedef struct _BraseroDataSessionPrivate BraseroDataSessionPrivate;
 struct _BraseroDataSessionPrivate
 {
 	BraseroIOJobBase *load_dir;
 
+	/* Directories waiting to be read in one go */
+	GSList *load_batch;
+	guint load_batch_id;
+
 	/* Multisession drives that are inserted */
 	GSList *media;
 
@@ -85,24 +91,69 @@ static gulong brasero_data_session_signals [LAST_SIGNAL] = { 0 };
  */
 struct _BraseroIOImageContentsData {
 	BraseroIOJob job;
-	gchar *dev_image;
 
 	gint64 session_block;
 	gint64 block;
+
+	/* Other directories of the same session read by the same job; they are
+	 * jobs as well so that each of them has its own callback data */
+	GSList *batch;
 };
 typedef struct _BraseroIOImageContentsData BraseroIOImageContentsData;
 
+/* Maximum number of directories read by a single job. That way a big batch
+ * is split and spread over the IO threads and results keep coming. */
+#define BRASERO_DATA_SESSION_BATCH_SIZE		64
+
 static void
 brasero_io_image_directory_contents_destroy (BraseroAsyncTaskManager *manager,
 					     gboolean cancelled,
 					     gpointer callback_data)
 {
 	BraseroIOImageContentsData *data = callback_data;
+	GSList *iter;
+
+	for (iter = data->batch; iter; iter = iter->next)
+		brasero_io_job_free (cancelled, iter->data);
 
-	g_free (data->dev_image);
+	g_slist_free (data->batch);
 	brasero_io_job_free (cancelled, BRASERO_IO_JOB (data));
 }
 
+static void
+brasero_io_image_directory_contents_return (BraseroIOImageContentsData *data,
+					    GList *children)
+{
+	GList *iter;
+
+	for (iter = children; iter; iter = iter->next) {
+		BraseroVolFile *file;
+		GFileInfo *info;
+
+		file = iter->data;
+
+		info = g_file_info_new ();
+		g_file_info_set_file_type (info, file->isdir? G_FILE_TYPE_DIRECTORY:G_FILE_TYPE_REGULAR);
+		g_file_info_set_name (info, BRASERO_VOLUME_FILE_NAME (file));
+
+		if (file->isdir)
+			g_file_info_set_attribute_int64 (info,
+							 BRASERO_IO_DIR_CONTENTS_ADDR,
+							 file->specific.dir.address);
+		else
+			g_file_info_set_size (info, BRASERO_VOLUME_FILE_SIZE (file));
+
+		brasero_io_return_result (data->job.base,
+					  data->job.uri,
+					  info,
+					  NULL,
+					  data->job.callback_data);
+	}
+
+	g_list_foreach (children, (GFunc) brasero_volume_file_free, NULL);
+	g_list_free (children);
+}
+
 static BraseroAsyncTaskResult
 brasero_io_image_directory_contents_thread (BraseroAsyncTaskManager *manager,
 					    GCancellable *cancel,
@@ -110,9 +161,13 @@ brasero_io_image_directory_contents_thread (BraseroAsyncTaskManager *manager,
 {
 	BraseroIOImageContentsData *data = callback_data;
 	BraseroDeviceHandle *handle;
-	GList *children, *iter;
 	GError *error = NULL;
 	BraseroVolSrc *vol;
+	GList **contents;
+	gint64 *blocks;
+	GSList *iter;
+	guint num;
+	guint i;
 
 	handle = brasero_device_handle_open (data->job.uri, FALSE, NULL);
 	if (!handle) {
@@ -141,39 +196,41 @@ brasero_io_image_directory_contents_thread (BraseroAsyncTaskManager *manager,
 		return BRASERO_ASYNC_TASK_FINISHED;
 	}
 
-	children = brasero_volume_load_directory_contents (vol,
-							   data->session_block,
-							   data->block,
-							   &error);
-	brasero_volume_source_close (vol);
-	brasero_device_handle_close (handle);
+	/* The device and the volume descriptor are only opened and read
+	 * once for all the directories of the batch (which are sorted) */
+	num = g_slist_length (data->batch) + 1;
+	blocks = g_new (gint64, num);
+	contents = g_new0 (GList *, num);
 
-	for (iter = children; iter; iter = iter->next) {
-		BraseroVolFile *file;
-		GFileInfo *info;
+	blocks [0] = data->block;
+	for (i = 1, iter = data->batch; iter; iter = iter->next, i ++) {
+		BraseroIOImageContentsData *directory;
 
-		file = iter->data;
+		directory = iter->data;
+		blocks [i] = directory->block;
+	}
 
-		info = g_file_info_new ();
-		g_file_info_set_file_type (info, file->isdir? G_FILE_TYPE_DIRECTORY:G_FILE_TYPE_REGULAR);
-		g_file_info_set_name (info, BRASERO_VOLUME_FILE_NAME (file));
+	if (!brasero_volume_load_directories_contents (vol,
+						       data->session_block,
+						       blocks,
+						       num,
+						       contents,
+						       &error)) {
+		BRASERO_BURN_LOG ("Error loading session directories %s",
+				  error? error->message:"unknown");
+		if (error)
+			g_error_free (error);
+	}
 
-		if (file->isdir)
-			g_file_info_set_attribute_int64 (info,
-							 BRASERO_IO_DIR_CONTENTS_ADDR,
-							 file->specific.dir.address);
-		else
-			g_file_info_set_size (info, BRASERO_VOLUME_FILE_SIZE (file));
+	brasero_volume_source_close (vol);
+	brasero_device_handle_close (handle);
 
-		brasero_io_return_result (data->job.base,
-					  data->job.uri,
-					  info,
-					  NULL,
-					  data->job.callback_data);
-	}
+	brasero_io_image_directory_contents_return (data, contents [0]);
+	for (i = 1, iter = data->batch; iter; iter = iter->next, i ++)
+		brasero_io_image_directory_contents_return (iter->data, contents [i]);
 
-	g_list_foreach (children, (GFunc) brasero_volume_file_free, NULL);
-	g_list_free (children);
+	g_free (contents);
+	g_free (blocks);
 
 	return BRASERO_ASYNC_TASK_FINISHED;
 }
@@ -183,13 +240,13 @@ static const BraseroAsyncTaskType image_contents_type = {
 	brasero_io_image_directory_contents_destroy
 };
 
-static void
-brasero_io_load_image_directory (const gchar *dev_image,
-				 gint64 session_block,
-				 gint64 block,
-				 const BraseroIOJobBase *base,
-				 BraseroIOFlags options,
-				 gpointer user_data)
+static BraseroIOImageContentsData *
+brasero_io_image_directory_new (const gchar *dev_image,
+				gint64 session_block,
+				gint64 block,
+				const BraseroIOJobBase *base,
+				BraseroIOFlags options,
+				gpointer user_data)
 {
 	BraseroIOImageContentsData *data;
 	BraseroIOResultCallbackData *callback_data = NULL;
@@ -209,9 +266,51 @@ brasero_io_load_image_directory (const gchar *dev_image,
 			    options,
 			    callback_data);
 
-	brasero_io_push_job (BRASERO_IO_JOB (data),
-			     &image_contents_type);
+	return data;
+}
 
+static gint
+brasero_io_image_directory_sort_cb (gconstpointer a,
+				    gconstpointer b)
+{
+	const BraseroIOImageContentsData *data_a = a;
+	const BraseroIOImageContentsData *data_b = b;
+
+	/* Root (-1) comes first */
+	if (data_a->block < data_b->block)
+		return -1;
+
+	if (data_a->block > data_b->block)
+		return 1;
+
+	return 0;
+}
+
+static void
+brasero_io_load_image_directories (GSList *directories)
+{
+	/* Sort the directories by address so that the drive reads forward
+	 * and push them in chunks; each chunk is led by its first directory */
+	directories = g_slist_sort (directories, brasero_io_image_directory_sort_cb);
+	while (directories) {
+		BraseroIOImageContentsData *data;
+		GSList *head;
+		GSList *last;
+
+		head = directories;
+		data = head->data;
+
+		last = g_slist_nth (head, BRASERO_DATA_SESSION_BATCH_SIZE - 1);
+		directories = last? last->next:NULL;
+		if (last)
+			last->next = NULL;
+
+		data->batch = head->next;
+		g_slist_free_1 (head);
+
+		brasero_io_push_job (BRASERO_IO_JOB (data),
+				     &image_contents_type);
+	}
 }
 
 void
@@ -331,6 +430,20 @@ brasero_data_session_load_dir_result (GObject *owner,
 	}
 }
 
+static gboolean
+brasero_data_session_load_batch_cb (gpointer data)
+{
+	BraseroDataSessionPrivate *priv;
+
+	priv = BRASERO_DATA_SESSION_PRIVATE (data);
+
+	priv->load_batch_id = 0;
+	brasero_io_load_image_directories (priv->load_batch);
+	priv->load_batch = NULL;
+
+	return FALSE;
+}
+
 static gboolean
 brasero_data_session_load_directory_contents_real (BraseroDataSession *self,
 						   BraseroFileNode *node,
@@ -362,12 +475,17 @@ brasero_data_session_load_directory_contents_real (BraseroDataSession *self,
 		node->is_exploring = TRUE;
 	}
 
-	brasero_io_load_image_directory (device,
-					 session_block,
-					 BRASERO_FILE_NODE_IMPORTED_ADDRESS (node),
-					 priv->load_dir,
-					 BRASERO_IO_INFO_URGENT,
-					 GINT_TO_POINTER (reference));
+	/* Directories usually get shown (and therefore loaded) several at a
+	 * time, so wait for the others to read them all in one pass */
+	priv->load_batch = g_slist_prepend (priv->load_batch,
+					    brasero_io_image_directory_new (device,
+									    session_block,
+									    BRASERO_FILE_NODE_IMPORTED_ADDRESS (node),
+									    priv->load_dir,
+									    BRASERO_IO_INFO_URGENT,
+									    GINT_TO_POINTER (reference)));
+	if (!priv->load_batch_id)
+		priv->load_batch_id = g_idle_add (brasero_data_session_load_batch_cb, self);
 
 	if (node)
 		node->is_fake = FALSE;
@@ -556,6 +674,23 @@ brasero_data_session_stop_io (BraseroDataSession *self)
 
 	priv = BRASERO_DATA_SESSION_PRIVATE (self);
 
+	if (priv->load_batch_id) {
+		g_source_remove (priv->load_batch_id);
+		priv->load_batch_id = 0;
+	}
+
+	if (priv->load_batch) {
+		GSList *iter;
+
+		/* These were never pushed so they are destroyed as if
+		 * they had been cancelled */
+		for (iter = priv->load_batch; iter; iter = iter->next)
+			brasero_io_job_free (TRUE, iter->data);
+
+		g_slist_free (priv->load_batch);
+		priv->load_batch = NULL;
+	}
+
 	if (priv->load_dir) {
 		brasero_io_cancel_by_base (priv->load_dir);
 		brasero_io_job_base_free (priv->load_dir);
@@ -64,8 +64,24 @@ struct _BraseroDataVFSPrivate
 	BraseroIOJobBase *load_uri;
 	BraseroIOJobBase *load_contents;
 
+	/* Files whose name wasn't enough to get their content type. They are
+	 * grouped per parent directory (parent uri => uris) before being sent
+	 * to be sniffed; sniffing has the nodes waiting for each uri. */
+	GHashTable *sniff_batches;
+	GHashTable *sniffing;
+	BraseroIOJobBase *sniff;
+	guint sniff_id;
+
 	GSettings *settings;
 
+	/* State of the explored directories: those given when a project is
+	 * opened and those recorded while exploring (uri => snapshot) */
+	GHashTable *snapshots;
+	GHashTable *recording;
+
+	guint snapshot_unchanged;
+	guint snapshot_changed;
+
 	guint replace_sym:1;
 	guint filter_hidden:1;
 	guint filter_broken_sym:1;
@@ -249,6 +265,297 @@ brasero_data_vfs_remove_from_hash (BraseroDataVFS *self,
 	g_hash_table_remove (h_table, uri);
 }
 
+/**
+ * Snapshots of directories
+ */
+
+static void
+brasero_data_vfs_snapshot_start (BraseroDataVFS *self,
+				 const gchar *uri,
+				 GFileInfo *info)
+{
+	BraseroIOSnapshot *snapshot = NULL;
+	BraseroDataVFSPrivate *priv;
+	guint64 mtime;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (g_file_info_has_attribute (info, BRASERO_IO_SNAPSHOT_UNCHANGED)) {
+		if (g_file_info_get_attribute_boolean (info, BRASERO_IO_SNAPSHOT_UNCHANGED))
+			priv->snapshot_unchanged ++;
+		else {
+			BRASERO_BURN_LOG ("Directory %s changed since it was recorded", uri);
+			priv->snapshot_changed ++;
+		}
+	}
+
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+	/* A change made within the same clock tick as the last one would not
+	 * change the modification time: don't record directories modified
+	 * that recently. */
+	if (g_get_real_time () - mtime > 2 * G_USEC_PER_SEC) {
+		snapshot = g_new0 (BraseroIOSnapshot, 1);
+		snapshot->mtime = mtime;
+		snapshot->inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+	}
+
+	g_hash_table_replace (priv->recording, g_strdup (uri), snapshot);
+}
+
+static void
+brasero_data_vfs_snapshot_record (BraseroDataVFS *self,
+				  const gchar *parent_uri,
+				  GError *error,
+				  GFileInfo *info)
+{
+	BraseroIOSnapshotEntry *entry;
+	BraseroIOSnapshot *snapshot;
+	GFileType type = G_FILE_TYPE_UNKNOWN;
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	snapshot = g_hash_table_lookup (priv->recording, parent_uri);
+	if (!snapshot)
+		return;
+
+	/* Only plain readable files and directories can be restored from a
+	 * snapshot; otherwise the directory will always be explored. */
+	if (!error)
+		type = g_file_info_get_file_type (info);
+
+	if (error
+	||  g_file_info_get_is_symlink (info)
+	|| (type != G_FILE_TYPE_REGULAR && type != G_FILE_TYPE_DIRECTORY)
+	|| (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ)
+	&& !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
+	||  !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+	||  !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE)) {
+		g_hash_table_replace (priv->recording, g_strdup (parent_uri), NULL);
+		return;
+	}
+
+	entry = g_new0 (BraseroIOSnapshotEntry, 1);
+	entry->name = g_strdup (g_file_info_get_name (info));
+	entry->size = g_file_info_get_size (info);
+	entry->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		       g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	entry->inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+	entry->is_directory = (type == G_FILE_TYPE_DIRECTORY);
+
+	snapshot->entries = g_slist_prepend (snapshot->entries, entry);
+}
+
+static void
+brasero_data_vfs_snapshot_end (BraseroDataVFS *self,
+			       const gchar *uri,
+			       gboolean cancelled)
+{
+	BraseroIOSnapshot *snapshot = NULL;
+	BraseroDataVFSPrivate *priv;
+	gpointer key;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (!g_hash_table_lookup_extended (priv->recording, uri, &key, (gpointer *) &snapshot))
+		return;
+
+	g_hash_table_steal (priv->recording, uri);
+	g_free (key);
+
+	if (!snapshot)
+		return;
+
+	if (cancelled) {
+		brasero_io_snapshot_free (snapshot);
+		return;
+	}
+
+	g_hash_table_replace (priv->snapshots, g_strdup (uri), snapshot);
+}
+
+static gchar *
+brasero_data_vfs_snapshot_to_string (const gchar *uri,
+				     BraseroIOSnapshot *snapshot)
+{
+	GString *string;
+	GSList *iter;
+
+	/* One line for the directory then one per child. Names are escaped
+	 * so they can't have spaces or line breaks. */
+	string = g_string_new (NULL);
+	g_string_append_printf (string,
+				"%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %s",
+				snapshot->mtime,
+				snapshot->inode,
+				uri);
+
+	for (iter = snapshot->entries; iter; iter = iter->next) {
+		BraseroIOSnapshotEntry *entry;
+		gchar *escaped;
+
+		entry = iter->data;
+		escaped = g_uri_escape_string (entry->name, NULL, FALSE);
+		g_string_append_printf (string,
+					"\n%c %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %s",
+					entry->is_directory? 'd':'f',
+					entry->size,
+					entry->mtime,
+					entry->inode,
+					escaped);
+		g_free (escaped);
+	}
+
+	return g_string_free (string, FALSE);
+}
+
+static gboolean
+brasero_data_vfs_snapshot_parse_numbers (gchar **ptr,
+					 guint64 *values,
+					 guint num)
+{
+	guint i;
+
+	for (i = 0; i < num; i ++) {
+		gchar *end = NULL;
+
+		values [i] = g_ascii_strtoull (*ptr, &end, 10);
+		if (end == *ptr || *end != ' ')
+			return FALSE;
+
+		*ptr = end + 1;
+	}
+
+	return TRUE;
+}
+
+gboolean
+brasero_data_vfs_add_snapshot (BraseroDataVFS *self,
+			       const gchar *string)
+{
+	BraseroIOSnapshot *snapshot;
+	BraseroDataVFSPrivate *priv;
+	guint64 values [3];
+	const gchar *uri;
+	gchar **lines;
+	gchar *ptr;
+	guint i;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	lines = g_strsplit (string, "\n", -1);
+	if (!lines [0])
+		goto error;
+
+	ptr = g_strstrip (lines [0]);
+	if (!brasero_data_vfs_snapshot_parse_numbers (&ptr, values, 2) || !ptr [0])
+		goto error;
+
+	uri = ptr;
+
+	snapshot = g_new0 (BraseroIOSnapshot, 1);
+	snapshot->mtime = values [0];
+	snapshot->inode = values [1];
+
+	for (i = 1; lines [i]; i ++) {
+		BraseroIOSnapshotEntry *entry;
+		gchar *line;
+		gchar *name;
+
+		line = g_strstrip (lines [i]);
+		if (!line [0])
+			continue;
+
+		if ((line [0] != 'd' && line [0] != 'f') || line [1] != ' ')
+			goto snapshot_error;
+
+		ptr = line + 2;
+		if (!brasero_data_vfs_snapshot_parse_numbers (&ptr, values, 3))
+			goto snapshot_error;
+
+		name = g_uri_unescape_string (ptr, NULL);
+		if (!name || !name [0] || strchr (name, G_DIR_SEPARATOR)) {
+			g_free (name);
+			goto snapshot_error;
+		}
+
+		entry = g_new0 (BraseroIOSnapshotEntry, 1);
+		entry->name = name;
+		entry->size = values [0];
+		entry->mtime = values [1];
+		entry->inode = values [2];
+		entry->is_directory = (line [0] == 'd');
+		snapshot->entries = g_slist_prepend (snapshot->entries, entry);
+	}
+
+	g_hash_table_replace (priv->snapshots, g_strdup (uri), snapshot);
+	g_strfreev (lines);
+	return TRUE;
+
+snapshot_error:
+
+	brasero_io_snapshot_free (snapshot);
+
+error:
+
+	BRASERO_BURN_LOG ("Invalid directory snapshot");
+	g_strfreev (lines);
+	return FALSE;
+}
+
+static void
+brasero_data_vfs_get_snapshot_directory (BraseroDataVFS *self,
+					 BraseroFileNode *node,
+					 GHashTable *done,
+					 GSList **list)
+{
+	BraseroDataVFSPrivate *priv;
+	BraseroFileNode *child;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	for (child = BRASERO_FILE_NODE_CHILDREN (node); child; child = child->next) {
+		if (child->is_file || child->is_imported)
+			continue;
+
+		if (!child->is_fake && !child->is_loading) {
+			BraseroIOSnapshot *snapshot;
+			gchar *uri;
+
+			/* The same directory can be grafted several times */
+			uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), child);
+			snapshot = uri? g_hash_table_lookup (priv->snapshots, uri):NULL;
+			if (snapshot && !g_hash_table_lookup (done, uri)) {
+				*list = g_slist_prepend (*list, brasero_data_vfs_snapshot_to_string (uri, snapshot));
+				g_hash_table_insert (done, uri, GINT_TO_POINTER (1));
+			}
+			else
+				g_free (uri);
+		}
+
+		brasero_data_vfs_get_snapshot_directory (self, child, done, list);
+	}
+}
+
+GSList *
+brasero_data_vfs_get_snapshot (BraseroDataVFS *self)
+{
+	BraseroFileNode *root;
+	GSList *list = NULL;
+	GHashTable *done;
+
+	/* Only directories still in the tree are returned. That also gets rid
+	 * of those that were removed from the project. */
+	done = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	root = brasero_data_project_get_root (BRASERO_DATA_PROJECT (self));
+	brasero_data_vfs_get_snapshot_directory (self, root, done, &list);
+	g_hash_table_destroy (done);
+
+	return g_slist_reverse (list);
+}
+
 /**
  * Explore and add the contents of a directory already loaded
  */
@@ -277,12 +584,23 @@ brasero_data_vfs_directory_load_end (GObject *object,
 		brasero_data_project_directory_node_loaded (BRASERO_DATA_PROJECT (self), parent);
 	}
 
+	brasero_data_vfs_snapshot_end (self, uri, cancelled);
+
 	brasero_data_vfs_remove_from_hash (self, priv->directories, uri);
 	brasero_utils_unregister_string (uri);
 
 	if (cancelled)
 		return;
 
+	if (!g_hash_table_size (priv->directories)
+	&& (priv->snapshot_unchanged || priv->snapshot_changed)) {
+		BRASERO_BURN_LOG ("Snapshots: %u directories unchanged, %u changed and explored again",
+				  priv->snapshot_unchanged,
+				  priv->snapshot_changed);
+		priv->snapshot_unchanged = 0;
+		priv->snapshot_changed = 0;
+	}
+
 	/* Only emit a signal if state changed. Some widgets need to know if 
 	 * either directories loading or uri loading state has changed to signal
 	 * it even if there were some uri loading. */
@@ -398,6 +716,15 @@ brasero_data_vfs_directory_load_result (GObject *owner,
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
 
+	/* The state of the directory comes before its contents */
+	if (!error && g_file_info_get_attribute_boolean (info, BRASERO_IO_SNAPSHOT_DIRECTORY)) {
+		brasero_data_vfs_snapshot_start (self, parent_uri, info);
+		return;
+	}
+
+	/* Record what is on disc before any filtering */
+	brasero_data_vfs_snapshot_record (self, parent_uri, error, info);
+
 	/* check the status of the operation.
 	 * NOTE: no need to remove the nodes. */
 	if (!brasero_data_vfs_check_uri_result (self, uri, error, info))
@@ -485,9 +812,11 @@ brasero_data_vfs_load_directory (BraseroDataVFS *self,
 				 BraseroFileNode *node,
 				 const gchar *uri)
 {
+	BraseroIOSnapshot *snapshot = NULL;
 	BraseroDataVFSPrivate *priv;
 	gchar *registered;
 	guint reference;
+	gpointer key;
 	GSList *nodes;
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
@@ -514,12 +843,21 @@ brasero_data_vfs_load_directory (BraseroDataVFS *self,
 							   brasero_data_vfs_directory_load_end,
 							   NULL);
 
+	/* If it was recorded (when the project was saved) the job takes
+	 * the snapshot and only checks the directory didn't change */
+	if (g_hash_table_lookup_extended (priv->snapshots, uri, &key, (gpointer *) &snapshot)) {
+		g_hash_table_steal (priv->snapshots, uri);
+		g_free (key);
+	}
+
 	/* no need to require mime types here as these rows won't be visible */
-	brasero_io_load_directory (uri,
-				   priv->load_contents,
-				   BRASERO_IO_INFO_PERM|
-				  (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
-				   registered);
+	brasero_io_load_directory_snapshot (uri,
+					    priv->load_contents,
+					    BRASERO_IO_INFO_PERM|
+					    BRASERO_IO_INFO_SNAPSHOT|
+					   (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
+					    snapshot,
+					    registered);
 
 	/* Only emit a signal if state changed. Some widgets need to know if 
 	 * either directories loading or uri loading state has changed to signal
@@ -837,14 +1175,140 @@ brasero_data_vfs_require_node_load (BraseroDataVFS *self,
 							 priv->load_uri);
 }
 
+static void
+brasero_data_vfs_sniff_result (GObject *owner,
+			       GError *error,
+			       const gchar *uri,
+			       GFileInfo *info,
+			       gpointer callback_data)
+{
+	BraseroDataVFSPrivate *priv;
+	gpointer registered;
+	GSList *nodes;
+	GSList *iter;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (owner);
+
+	if (!g_hash_table_lookup_extended (priv->sniffing, uri, &registered, (gpointer *) &nodes))
+		return;
+
+	g_hash_table_remove (priv->sniffing, registered);
+
+	for (iter = nodes; iter; iter = iter->next) {
+		BraseroFileNode *node;
+		guint reference;
+
+		reference = GPOINTER_TO_INT (iter->data);
+		node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (owner), reference);
+		brasero_data_project_reference_free (BRASERO_DATA_PROJECT (owner), reference);
+
+		/* If it is (re)loading, the content type will come with the
+		 * rest of the information */
+		if (!node || node->is_loading || node->is_reloading)
+			continue;
+
+		if (error || !info)
+			continue;
+
+		brasero_data_project_node_mime (BRASERO_DATA_PROJECT (owner),
+						node,
+						g_file_info_get_content_type (info));
+	}
+
+	g_slist_free (nodes);
+	brasero_utils_unregister_string (registered);
+}
+
+static void
+brasero_data_vfs_sniff_end (GObject *object,
+			    gboolean cancelled,
+			    gpointer data)
+{
+	gchar *parent = data;
+
+	brasero_utils_unregister_string (parent);
+}
+
+static gboolean
+brasero_data_vfs_sniff_batch_visible (BraseroDataVFS *self,
+				      GSList *uris)
+{
+	BraseroDataVFSPrivate *priv;
+	GSList *iter;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	for (; uris; uris = uris->next) {
+		GSList *nodes;
+
+		nodes = g_hash_table_lookup (priv->sniffing, uris->data);
+		for (iter = nodes; iter; iter = iter->next) {
+			BraseroFileNode *node;
+			guint reference;
+
+			reference = GPOINTER_TO_INT (iter->data);
+			node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), reference);
+			if (node && node->is_visible > 0)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+brasero_data_vfs_sniff_flush_cb (gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (data);
+	BraseroDataVFSPrivate *priv;
+	GHashTableIter iter;
+	gpointer parent;
+	GSList *uris;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+	priv->sniff_id = 0;
+
+	if (!priv->sniff)
+		priv->sniff = brasero_io_register (G_OBJECT (self),
+						   brasero_data_vfs_sniff_result,
+						   brasero_data_vfs_sniff_end,
+						   NULL);
+
+	/* Send one job per directory. The rows that are still visible come
+	 * first; the others are only sniffed when there is nothing else to
+	 * do. brasero_data_vfs_load_mime () raises the priority of a batch
+	 * again if one of its rows is shown in the mean time. */
+	g_hash_table_iter_init (&iter, priv->sniff_batches);
+	while (g_hash_table_iter_next (&iter, &parent, (gpointer *) &uris)) {
+		gboolean visible;
+
+		uris = g_slist_reverse (uris);
+		visible = brasero_data_vfs_sniff_batch_visible (self, uris);
+
+		/* NOTE: the job owns the parent string from now on */
+		brasero_io_sniff_content_types (parent,
+						uris,
+						priv->sniff,
+						visible ? BRASERO_IO_INFO_URGENT:BRASERO_IO_INFO_IDLE,
+						parent);
+		g_slist_free (uris);
+	}
+	g_hash_table_remove_all (priv->sniff_batches);
+
+	return FALSE;
+}
+
 gboolean
 brasero_data_vfs_load_mime (BraseroDataVFS *self,
 			    BraseroFileNode *node)
 {
 	BraseroDataVFSPrivate *priv;
+	gboolean uncertain = FALSE;
+	gchar *registered;
 	guint reference;
-	gboolean result;
 	GSList *nodes;
+	gchar *parent;
+	gchar *mime;
 	gchar *uri;
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
@@ -854,57 +1318,77 @@ brasero_data_vfs_load_mime (BraseroDataVFS *self,
 		return TRUE;
 	}
 
+	/* Most of the time the name of the file is enough and that doesn't
+	 * need any I/O at all. */
+	mime = g_content_type_guess (BRASERO_FILE_NODE_NAME (node),
+				     NULL,
+				     0,
+				     &uncertain);
+	if (!uncertain) {
+		brasero_data_project_node_mime (BRASERO_DATA_PROJECT (self), node, mime);
+		g_free (mime);
+		return TRUE;
+	}
+	g_free (mime);
+
+	/* Otherwise its contents need to be read */
 	uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), node);
-	node->is_reloading = TRUE;
+	if (!uri)
+		return FALSE;
 
-	/* make sure the node is not already in the loading table */
-	nodes = g_hash_table_lookup (priv->loading, uri);
+	parent = g_path_get_dirname (uri);
+	registered = brasero_utils_register_string (parent);
+	g_free (parent);
+	parent = registered;
+
+	nodes = g_hash_table_lookup (priv->sniffing, uri);
 	if (nodes) {
-		gchar *registered;
 		GSList *iter;
 
-		registered = brasero_utils_register_string (uri);
-		g_free (uri);
-
 		for (iter = nodes; iter; iter = iter->next) {
-			guint reference;
-			BraseroFileNode *ref_node;
-
 			reference = GPOINTER_TO_INT (iter->data);
-			ref_node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), reference);
-			if (ref_node == node) {
-				/* Ask for a higher priority */
-				brasero_io_find_urgent (priv->load_uri,
-							brasero_data_vfs_increase_priority_cb,
-							registered);
-				brasero_utils_unregister_string (registered);
-				return TRUE;
-			}
+			if (brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), reference) == node)
+				break;
 		}
 
-		/* It's loading, wait for the results */
-		reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), node);
-		nodes = g_slist_prepend (nodes, GINT_TO_POINTER (reference));
-		g_hash_table_insert (priv->loading, registered, nodes);
+		if (!iter) {
+			reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), node);
+			nodes = g_slist_prepend (nodes, GINT_TO_POINTER (reference));
+			g_hash_table_insert (priv->sniffing, (gchar *) uri, nodes);
+		}
+
+		/* The row was shown again: its batch is needed now */
+		if (priv->sniff)
+			brasero_io_find_urgent (priv->sniff,
+						brasero_data_vfs_increase_priority_cb,
+						parent);
 
-		/* Yet, ask for a higher priority */
-		brasero_io_find_urgent (priv->load_uri,
-					brasero_data_vfs_increase_priority_cb,
-					registered);
-		brasero_utils_unregister_string (registered);
+		brasero_utils_unregister_string (parent);
+		g_free (uri);
 		return TRUE;
 	}
 
-	reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), node);
-	result = brasero_data_vfs_load_node (self,
-					     BRASERO_IO_INFO_MIME|
-					     BRASERO_IO_INFO_URGENT|
-					     (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
-					     reference,
-					     uri);
+	registered = brasero_utils_register_string (uri);
 	g_free (uri);
 
-	return result;
+	reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), node);
+	g_hash_table_insert (priv->sniffing,
+			     registered,
+			     g_slist_prepend (NULL, GINT_TO_POINTER (reference)));
+
+	/* Wait for the other visible rows of the directory to send them all
+	 * at once. The batch holds the reference on the parent string. */
+	nodes = g_hash_table_lookup (priv->sniff_batches, parent);
+	if (nodes)
+		brasero_utils_unregister_string (parent);
+
+	nodes = g_slist_prepend (nodes, registered);
+	g_hash_table_insert (priv->sniff_batches, parent, nodes);
+
+	if (!priv->sniff_id)
+		priv->sniff_id = g_idle_add (brasero_data_vfs_sniff_flush_cb, self);
+
+	return TRUE;
 }
 
 /**
@@ -968,6 +1452,17 @@ brasero_data_vfs_empty_loading_cb (gpointer key,
 	return TRUE;
 }
 
+static gboolean
+brasero_data_vfs_empty_batch_cb (gpointer key,
+				 gpointer data,
+				 gpointer callback_data)
+{
+	/* the uris are unregistered with the sniffing hash */
+	brasero_utils_unregister_string (key);
+	g_slist_free (data);
+	return TRUE;
+}
+
 static void
 brasero_data_vfs_clear (BraseroDataVFS *self)
 {
@@ -988,6 +1483,17 @@ brasero_data_vfs_clear (BraseroDataVFS *self)
 		priv->load_contents = NULL;
 	}
 
+	if (priv->sniff_id) {
+		g_source_remove (priv->sniff_id);
+		priv->sniff_id = 0;
+	}
+
+	if (priv->sniff) {
+		brasero_io_cancel_by_base (priv->sniff);
+		brasero_io_job_base_free (priv->sniff);
+		priv->sniff = NULL;
+	}
+
 	/* Empty the hash tables */
 	g_hash_table_foreach_remove (priv->loading,
 				     brasero_data_vfs_empty_loading_cb,
@@ -995,8 +1501,19 @@ brasero_data_vfs_clear (BraseroDataVFS *self)
 	g_hash_table_foreach_remove (priv->directories,
 				     brasero_data_vfs_empty_loading_cb,
 				     self);
+	g_hash_table_foreach_remove (priv->sniffing,
+				     brasero_data_vfs_empty_loading_cb,
+				     self);
+	g_hash_table_foreach_remove (priv->sniff_batches,
+				     brasero_data_vfs_empty_batch_cb,
+				     NULL);
 
 	brasero_filtered_uri_clear (priv->filtered);
+
+	g_hash_table_remove_all (priv->snapshots);
+	g_hash_table_remove_all (priv->recording);
+	priv->snapshot_unchanged = 0;
+	priv->snapshot_changed = 0;
 }
 
 static void
@@ -1063,6 +1580,17 @@ brasero_data_vfs_init (BraseroDataVFS *object)
 	/* create the hash tables */
 	priv->loading = g_hash_table_new (g_str_hash, g_str_equal);
 	priv->directories = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->sniffing = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->sniff_batches = g_hash_table_new (g_str_hash, g_str_equal);
+
+	priv->snapshots = g_hash_table_new_full (g_str_hash,
+						 g_str_equal,
+						 g_free,
+						 (GDestroyNotify) brasero_io_snapshot_free);
+	priv->recording = g_hash_table_new_full (g_str_hash,
+						 g_str_equal,
+						 g_free,
+						 (GDestroyNotify) brasero_io_snapshot_free);
 }
 
 static void
@@ -1084,6 +1612,26 @@ brasero_data_vfs_finalize (GObject *object)
 		priv->directories = NULL;
 	}
 
+	if (priv->sniffing) {
+		g_hash_table_destroy (priv->sniffing);
+		priv->sniffing = NULL;
+	}
+
+	if (priv->sniff_batches) {
+		g_hash_table_destroy (priv->sniff_batches);
+		priv->sniff_batches = NULL;
+	}
+
+	if (priv->snapshots) {
+		g_hash_table_destroy (priv->snapshots);
+		priv->snapshots = NULL;
+	}
+
+	if (priv->recording) {
+		g_hash_table_destroy (priv->recording);
+		priv->recording = NULL;
+	}
+
 	if (priv->filtered) {
 		g_object_unref (priv->filtered);
 		priv->filtered = NULL;
@@ -90,6 +90,13 @@ brasero_data_vfs_require_directory_contents (BraseroDataVFS *vfs,
 BraseroFilteredUri *
 brasero_data_vfs_get_filtered_model (BraseroDataVFS *vfs);
 
+gboolean
+brasero_data_vfs_add_snapshot (BraseroDataVFS *vfs,
+			       const gchar *snapshot);
+
+GSList *
+brasero_data_vfs_get_snapshot (BraseroDataVFS *vfs);
+
 G_END_DECLS
 
 #endif /* _BRASERO_DATA_VFS_H_ */
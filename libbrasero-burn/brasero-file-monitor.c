@@ -32,19 +32,46 @@
 #  include <config.h>
 #endif
 
+/* Needed for name_to_handle_at () */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
 #include <sys/inotify.h>
 
+#ifdef HAVE_SYS_FANOTIFY_H
+#include <sys/fanotify.h>
+#include <sys/vfs.h>
+
+/* Events must report the directory and the name of the child (linux 5.9) */
+#if defined (FAN_REPORT_DFID_NAME) && defined (MAX_HANDLE_SZ)
+#define BRASERO_FILE_MONITOR_FANOTIFY	1
+#endif
+
+#endif
+
 #include "brasero-file-monitor.h"
 #include "burn-debug.h"
 
 #include "brasero-file-node.h"
 
+/* Events are read from the kernel by chunks of that size */
+#define BRASERO_FILE_MONITOR_BUFFER		65536
+
+/* Events are held that long (ms) so that repeated ones can be merged */
+#define BRASERO_FILE_MONITOR_DELAY		150
+
+/* Past that number of held events they are applied without waiting */
+#define BRASERO_FILE_MONITOR_MAX_EVENTS		4096
+
 typedef struct _BraseroFileMonitorPrivate BraseroFileMonitorPrivate;
 struct _BraseroFileMonitorPrivate
 {
@@ -59,6 +86,27 @@ struct _BraseroFileMonitorPrivate
 
 	/* This is used in the case of a MOVE_FROM event */
 	GSList *moved_list;
+
+	/* Events read but not applied yet. Those that can still absorb
+	 * the following events for the same path are indexed in pending. */
+	GQueue *events;
+	GHashTable *pending;
+	guint flush_id;
+
+	gchar *buffer;
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+
+	/* Used for directories once there are no more inotify watches */
+	int fanotify_id;
+	GIOChannel *fanotify;
+	GHashTable *handles;
+
+	guint fanotify_failed:1;
+
+#endif
+
+	guint exhausted:1;
 };
 
 #define BRASERO_FILE_MONITOR_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_FILE_MONITOR, BraseroFileMonitorPrivate))
@@ -96,6 +144,31 @@ struct _BraseroFileMonitorSearchResult {
 };
 typedef struct _BraseroFileMonitorSearchResult BraseroFileMonitorSearchResult;
 
+struct _BraseroFileMonitorEvent {
+	gint wd;
+	guint32 mask;
+	guint32 cookie;
+	gchar *name;
+
+	/* path (watch + name) used to merge events */
+	gchar *key;
+
+	/* set instead of wd for fanotify events */
+	gpointer handle;
+};
+typedef struct _BraseroFileMonitorEvent BraseroFileMonitorEvent;
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+
+/* fsid + handle type + handle of a directory */
+struct _BraseroFileMonitorHandle {
+	guint size;
+	guchar data [1];
+};
+typedef struct _BraseroFileMonitorHandle BraseroFileMonitorHandle;
+
+#endif
+
 static void
 brasero_inotify_file_data_free (BraseroInotifyFileData *data)
 {
@@ -103,6 +176,15 @@ brasero_inotify_file_data_free (BraseroInotifyFileData *data)
 	g_free (data);
 }
 
+static void
+brasero_file_monitor_event_free (BraseroFileMonitorEvent *event)
+{
+	g_free (event->name);
+	g_free (event->key);
+	g_free (event->handle);
+	g_free (event);
+}
+
 static void
 brasero_file_monitor_moved_to_event (BraseroFileMonitor *self,
 				     gpointer callback_data,
@@ -252,7 +334,7 @@ brasero_file_monitor_directory_event (BraseroFileMonitor *self,
 				      BraseroFileMonitorType type,
 				      gpointer callback_data,
 				      const gchar *name,
-				      struct inotify_event *event)
+				      BraseroFileMonitorEvent *event)
 {
 	BraseroFileMonitorClass *klass;
 
@@ -300,7 +382,7 @@ static void
 brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 					 GSList *list,
 					 const gchar *name,
-					 struct inotify_event *event)
+					 BraseroFileMonitorEvent *event)
 {
 	BraseroInotifyFileData *data = NULL;
 	BraseroFileMonitorPrivate *priv;
@@ -471,121 +553,489 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 					      event);
 }
 
+static void
+brasero_file_monitor_dispatch_event (BraseroFileMonitor *self,
+				     BraseroFileMonitorEvent *event)
+{
+	BraseroFileMonitorPrivate *priv;
+	gpointer callback_data;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	if (event->handle) {
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+		/* The directory may have been removed from the project since */
+		callback_data = g_hash_table_lookup (priv->handles, event->handle);
+		if (callback_data && event->name)
+			brasero_file_monitor_directory_event (self,
+							      BRASERO_FILE_MONITOR_FOLDER,
+							      callback_data,
+							      event->name,
+							      event);
+#endif
+		return;
+	}
+
+	/* look for ignored signal usually following deletion */
+	if (event->mask & IN_IGNORED) {
+		GSList *list;
+
+		list = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event->wd));
+		if (list) {
+			g_slist_foreach (list, (GFunc) g_free, NULL);
+			g_slist_free (list);
+			g_hash_table_remove (priv->files, GINT_TO_POINTER (event->wd));
+		}
+
+		g_hash_table_remove (priv->directories, GINT_TO_POINTER (event->wd));
+		return;
+	}
+
+	callback_data = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event->wd));
+	if (!callback_data) {
+		/* Retry with children */
+		callback_data = g_hash_table_lookup (priv->directories, GINT_TO_POINTER (event->wd));
+		if (event->name && callback_data) {
+			/* For directories we don't take heed of the SELF events.
+			 * All events are treated through the parent directory
+			 * events. */
+			brasero_file_monitor_directory_event (self,
+							      BRASERO_FILE_MONITOR_FOLDER,
+							      callback_data,
+							      event->name,
+							      event);
+		}
+		else
+			inotify_rm_watch (g_io_channel_unix_get_fd (priv->notify), event->wd);
+	}
+	else {
+		GSList *list;
+
+		/* This is an event happening on the top directory there */
+		list = callback_data;
+		brasero_file_monitor_inotify_file_event (self,
+							 list,
+							 event->name,
+							 event);
+	}
+}
+
+static void
+brasero_file_monitor_flush (BraseroFileMonitor *self)
+{
+	BraseroFileMonitorPrivate *priv;
+	BraseroFileMonitorEvent *event;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	if (priv->flush_id) {
+		g_source_remove (priv->flush_id);
+		priv->flush_id = 0;
+	}
+
+	if (g_queue_is_empty (priv->events))
+		return;
+
+	BRASERO_BURN_LOG ("File Monitoring (applying %i events)", g_queue_get_length (priv->events));
+
+	g_hash_table_remove_all (priv->pending);
+
+	/* NOTE: pop them one by one as a callback can reset the queue */
+	while ((event = g_queue_pop_head (priv->events))) {
+		brasero_file_monitor_dispatch_event (self, event);
+		brasero_file_monitor_event_free (event);
+	}
+}
+
+static gboolean
+brasero_file_monitor_flush_cb (gpointer data)
+{
+	BraseroFileMonitor *self = BRASERO_FILE_MONITOR (data);
+	BraseroFileMonitorPrivate *priv;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+	priv->flush_id = 0;
+
+	brasero_file_monitor_flush (self);
+	return FALSE;
+}
+
+static void
+brasero_file_monitor_queue_event (BraseroFileMonitor *self,
+				  gint wd,
+				  guint32 mask,
+				  guint32 cookie,
+				  const gchar *name,
+				  gpointer handle)
+{
+	BraseroFileMonitorEvent *previous;
+	BraseroFileMonitorPrivate *priv;
+	BraseroFileMonitorEvent *event;
+	gchar *key;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+	if (handle) {
+		BraseroFileMonitorHandle *fid = handle;
+		GString *string;
+		guint i;
+
+		string = g_string_new (NULL);
+		for (i = 0; i < fid->size; i ++)
+			g_string_append_printf (string, "%02x", fid->data [i]);
+
+		g_string_append_printf (string, "/%s", name ? name : "");
+		key = g_string_free (string, FALSE);
+	}
+	else
+#endif
+		key = g_strdup_printf ("%i/%s", wd, name ? name : "");
+
+	/* A file being written sends a stream of IN_MODIFY: one is enough.
+	 * After an IN_CREATE they are not needed at all since the new file
+	 * is going to be explored anyway. */
+	previous = g_hash_table_lookup (priv->pending, key);
+	if (previous && !(mask & ~(IN_MODIFY|IN_ATTRIB|IN_ISDIR))) {
+		if (!(previous->mask & IN_CREATE))
+			previous->mask |= mask;
+
+		g_free (handle);
+		g_free (key);
+		return;
+	}
+
+	event = g_new0 (BraseroFileMonitorEvent, 1);
+	event->wd = wd;
+	event->mask = mask;
+	event->cookie = cookie;
+	event->name = g_strdup (name);
+	event->handle = handle;
+	event->key = key;
+	g_queue_push_tail (priv->events, event);
+
+	/* Any other event (removal, move) must keep its place in the queue
+	 * so the events that follow for that path are not merged before it */
+	if (!(mask & ~(IN_MODIFY|IN_ATTRIB|IN_CREATE|IN_ISDIR)))
+		g_hash_table_replace (priv->pending, event->key, event);
+	else
+		g_hash_table_remove (priv->pending, event->key);
+
+	if (!priv->flush_id)
+		priv->flush_id = g_timeout_add (BRASERO_FILE_MONITOR_DELAY,
+						brasero_file_monitor_flush_cb,
+						self);
+}
+
 static gboolean
 brasero_file_monitor_inotify_monitor_cb (GIOChannel *channel,
 					 GIOCondition condition,
 					 BraseroFileMonitor *self)
 {
 	BraseroFileMonitorPrivate *priv;
-	struct inotify_event event;
-	gpointer callback_data;
-	GError *err = NULL;
-	GIOStatus status;
-	gchar *name;
-	gsize size;
+	int dev_fd;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
-	while (condition & G_IO_IN) {
-		callback_data = NULL;
-
-		status = g_io_channel_read_chars (channel,
-						  (char *) &event,
-						  sizeof (struct inotify_event),
-						  &size, &err);
-		if (status == G_IO_STATUS_EOF)
-			return TRUE;
-
-		if (event.len) {
-			name = g_new (char, event.len + 1);
-
-			name [event.len] = '\0';
-
-			status = g_io_channel_read_chars (channel,
-							  name,
-							  event.len,
-							  &size,
-							  &err);
-			if (status != G_IO_STATUS_NORMAL) {
-				g_warning ("Error reading inotify: %s\n",
-					   err ? "Unknown error" : err->message);
-				g_error_free (err);
-				return TRUE;
-			}
+	dev_fd = g_io_channel_unix_get_fd (channel);
+
+	/* Drain the descriptor: events are packed so one read () returns
+	 * as many as fit in the buffer */
+	while (1) {
+		struct inotify_event *event;
+		gssize len;
+		gchar *ptr;
+
+		len = read (dev_fd, priv->buffer, BRASERO_FILE_MONITOR_BUFFER);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno != EAGAIN)
+				g_warning ("Error reading inotify: %s\n", g_strerror (errno));
+
+			break;
 		}
-		else
-			name = NULL;
 
-		/* look for ignored signal usually following deletion */
-		if (event.mask & IN_IGNORED) {
-			GSList *list;
+		if (!len)
+			break;
+
+		for (ptr = priv->buffer; ptr < priv->buffer + len; ptr += sizeof (struct inotify_event) + event->len) {
+			event = (struct inotify_event *) ptr;
 
-			list = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event.wd));
-			if (list) {
-				g_slist_foreach (list, (GFunc) g_free, NULL);
-				g_slist_free (list);
-				g_hash_table_remove (priv->files, GINT_TO_POINTER (event.wd));
+			if (event->mask & IN_Q_OVERFLOW) {
+				BRASERO_BURN_LOG ("File Monitoring (event queue overflowed, changes were lost)");
+				continue;
 			}
 
-			g_hash_table_remove (priv->directories, GINT_TO_POINTER (event.wd));
+			brasero_file_monitor_queue_event (self,
+							  event->wd,
+							  event->mask,
+							  event->cookie,
+							  event->len ? event->name : NULL,
+							  NULL);
+		}
+	}
 
-			if (name) {
-				g_free (name);
-				name = NULL;
-			}
+	if (g_queue_get_length (priv->events) >= BRASERO_FILE_MONITOR_MAX_EVENTS)
+		brasero_file_monitor_flush (self);
 
-			condition = g_io_channel_get_buffer_condition (channel);
+	return TRUE;
+}
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+
+static guint
+brasero_file_monitor_handle_hash (gconstpointer key)
+{
+	const BraseroFileMonitorHandle *handle = key;
+	guint hash = 5381;
+	guint i;
+
+	for (i = 0; i < handle->size; i ++)
+		hash = (hash << 5) + hash + handle->data [i];
+
+	return hash;
+}
+
+static gboolean
+brasero_file_monitor_handle_equal (gconstpointer a,
+				   gconstpointer b)
+{
+	const BraseroFileMonitorHandle *handle_a = a;
+	const BraseroFileMonitorHandle *handle_b = b;
+
+	if (handle_a->size != handle_b->size)
+		return FALSE;
+
+	return !memcmp (handle_a->data, handle_b->data, handle_a->size);
+}
+
+static BraseroFileMonitorHandle *
+brasero_file_monitor_handle_new (gconstpointer fsid,
+				 struct file_handle *file_handle)
+{
+	BraseroFileMonitorHandle *handle;
+	guint size;
+
+	size = sizeof (fsid_t) + sizeof (file_handle->handle_type) + file_handle->handle_bytes;
+	handle = g_malloc (G_STRUCT_OFFSET (BraseroFileMonitorHandle, data) + size);
+	handle->size = size;
+
+	memcpy (handle->data, fsid, sizeof (fsid_t));
+	memcpy (handle->data + sizeof (fsid_t),
+		&file_handle->handle_type,
+		sizeof (file_handle->handle_type));
+	memcpy (handle->data + sizeof (fsid_t) + sizeof (file_handle->handle_type),
+		file_handle->f_handle,
+		file_handle->handle_bytes);
+
+	return handle;
+}
+
+static void
+brasero_file_monitor_queue_fanotify_event (BraseroFileMonitor *self,
+					   guint64 mask,
+					   BraseroFileMonitorHandle *handle,
+					   const gchar *name)
+{
+	/* The kernel merges events so split them again. Since there is no
+	 * cookie, moves are seen as a removal and an addition.
+	 * The merged mask doesn't tell in which order things happened so
+	 * removals always come first: if the file was replaced it is added
+	 * back and if it was created then removed, the addition fails when
+	 * the new node is loaded and it is dropped. The other way round a
+	 * replaced file would just disappear from the project. */
+	static const struct {
+		guint64 fan_mask;
+		guint32 in_mask;
+	} masks [] = {
+		{ FAN_MOVED_FROM,	IN_MOVED_FROM },
+		{ FAN_DELETE,		IN_DELETE },
+		{ FAN_CREATE,		IN_CREATE },
+		{ FAN_MOVED_TO,		IN_MOVED_TO },
+		{ FAN_MODIFY,		IN_MODIFY },
+		{ FAN_ATTRIB,		IN_ATTRIB }
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (masks); i ++) {
+		if (!(mask & masks [i].fan_mask))
 			continue;
+
+		brasero_file_monitor_queue_event (self,
+						  -1,
+						  masks [i].in_mask,
+						  0,
+						  name,
+						  g_memdup (handle, G_STRUCT_OFFSET (BraseroFileMonitorHandle, data) + handle->size));
+	}
+}
+
+static gboolean
+brasero_file_monitor_fanotify_cb (GIOChannel *channel,
+				  GIOCondition condition,
+				  BraseroFileMonitor *self)
+{
+	BraseroFileMonitorPrivate *priv;
+	int dev_fd;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+	dev_fd = g_io_channel_unix_get_fd (channel);
+
+	while (1) {
+		struct fanotify_event_metadata *metadata;
+		gssize len;
+
+		len = read (dev_fd, priv->buffer, BRASERO_FILE_MONITOR_BUFFER);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno != EAGAIN)
+				g_warning ("Error reading fanotify: %s\n", g_strerror (errno));
+
+			break;
 		}
 
-		callback_data = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event.wd));
-		if (!callback_data) {
-			/* Retry with children */
-			callback_data = g_hash_table_lookup (priv->directories, GINT_TO_POINTER (event.wd));
-			if (name && callback_data) {
-				/* For directories we don't take heed of the SELF events.
-				 * All events are treated through the parent directory
-				 * events. */
-				brasero_file_monitor_directory_event (self,
-								      BRASERO_FILE_MONITOR_FOLDER,
-								      callback_data,
-								      name,
-								      &event);
-			}
-			else {
-				int dev_fd;
+		if (!len)
+			break;
 
-				dev_fd = g_io_channel_unix_get_fd (channel);
-				inotify_rm_watch (dev_fd, event.wd);
+		metadata = (struct fanotify_event_metadata *) priv->buffer;
+		for (; FAN_EVENT_OK (metadata, len); metadata = FAN_EVENT_NEXT (metadata, len)) {
+			struct fanotify_event_info_fid *info;
+			BraseroFileMonitorHandle *handle;
+			struct file_handle *file_handle;
+			const gchar *name;
+
+			if (metadata->vers != FANOTIFY_METADATA_VERSION)
+				break;
+
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				BRASERO_BURN_LOG ("File Monitoring (fanotify queue overflowed, changes were lost)");
+				continue;
 			}
+
+			info = (struct fanotify_event_info_fid *) (metadata + 1);
+			if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+				continue;
+
+			file_handle = (struct file_handle *) info->handle;
+			name = (const gchar *) file_handle->f_handle + file_handle->handle_bytes;
+			if (!strcmp (name, "."))
+				continue;
+
+			/* A filesystem mark reports a lot more than we need */
+			handle = brasero_file_monitor_handle_new (&info->fsid, file_handle);
+			if (g_hash_table_lookup (priv->handles, handle))
+				brasero_file_monitor_queue_fanotify_event (self,
+									   metadata->mask,
+									   handle,
+									   name);
+			g_free (handle);
 		}
-		else {
-			GSList *list;
-
-			/* This is an event happening on the top directory there */
-			list = callback_data;
-			brasero_file_monitor_inotify_file_event (self,
-								 list,
-								 name,
-								 &event);
-		}
+	}
+
+	if (g_queue_get_length (priv->events) >= BRASERO_FILE_MONITOR_MAX_EVENTS)
+		brasero_file_monitor_flush (self);
+
+	return TRUE;
+}
+
+static gboolean
+brasero_file_monitor_fanotify_directory (BraseroFileMonitor *self,
+					 const gchar *path,
+					 gpointer callback_data)
+{
+	BraseroFileMonitorPrivate *priv;
+	struct file_handle *file_handle;
+	struct statfs stats;
+	guint64 mask;
+	int mount_id;
+	int dev_fd;
 
-		if (name) {
-			g_free (name);
-			name = NULL;
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	if (priv->fanotify_failed)
+		return FALSE;
+
+	if (!priv->fanotify) {
+		dev_fd = fanotify_init (FAN_CLASS_NOTIF|FAN_REPORT_DFID_NAME|FAN_CLOEXEC|FAN_NONBLOCK,
+					O_RDONLY|O_LARGEFILE);
+		if (dev_fd == -1) {
+			BRASERO_BURN_LOG ("fanotify is not available : %s", g_strerror (errno));
+			priv->fanotify_failed = TRUE;
+			return FALSE;
 		}
 
-		condition = g_io_channel_get_buffer_condition (channel);
+		priv->fanotify = g_io_channel_unix_new (dev_fd);
+		g_io_channel_set_encoding (priv->fanotify, NULL, NULL);
+		g_io_channel_set_close_on_unref (priv->fanotify, TRUE);
+		priv->fanotify_id = g_io_add_watch (priv->fanotify,
+						    G_IO_IN | G_IO_HUP | G_IO_PRI,
+						    (GIOFunc) brasero_file_monitor_fanotify_cb,
+						    self);
+		g_io_channel_unref (priv->fanotify);
+	}
+
+	dev_fd = g_io_channel_unix_get_fd (priv->fanotify);
+	mask = FAN_CREATE |
+	       FAN_DELETE |
+	       FAN_MOVED_FROM |
+	       FAN_MOVED_TO |
+	       FAN_MODIFY |
+	       FAN_ATTRIB |
+	       FAN_ONDIR |
+	       FAN_EVENT_ON_CHILD;
+
+	/* Marking the whole filesystem once covers all the directories that
+	 * are on it but it needs CAP_SYS_ADMIN. Otherwise recent kernels
+	 * still allow to mark the directory itself. */
+	if (fanotify_mark (dev_fd, FAN_MARK_ADD|FAN_MARK_FILESYSTEM, mask & ~FAN_EVENT_ON_CHILD, AT_FDCWD, path) == -1
+	&&  fanotify_mark (dev_fd, FAN_MARK_ADD|FAN_MARK_ONLYDIR, mask, AT_FDCWD, path) == -1) {
+		BRASERO_BURN_LOG ("ERROR creating fanotify mark for local file %s : %s",
+				  path,
+				  g_strerror (errno));
+		return FALSE;
+	}
+
+	file_handle = g_malloc (sizeof (struct file_handle) + MAX_HANDLE_SZ);
+	file_handle->handle_bytes = MAX_HANDLE_SZ;
+	if (statfs (path, &stats) == -1
+	||  name_to_handle_at (AT_FDCWD, path, file_handle, &mount_id, 0) == -1) {
+		BRASERO_BURN_LOG ("ERROR getting handle for local file %s : %s",
+				  path,
+				  g_strerror (errno));
+		g_free (file_handle);
+		return FALSE;
 	}
 
+	g_hash_table_replace (priv->handles,
+			      brasero_file_monitor_handle_new (&stats.f_fsid, file_handle),
+			      callback_data);
+	g_free (file_handle);
 	return TRUE;
 }
 
+#endif
+
+static gchar *
+brasero_file_monitor_uri_to_path (const gchar *uri)
+{
+	gchar *unescaped_uri;
+	gchar *path;
+
+	unescaped_uri = g_uri_unescape_string (uri, NULL);
+	path = g_filename_from_uri (unescaped_uri, NULL, NULL);
+	g_free (unescaped_uri);
+
+	return path;
+}
+
 static guint32
 brasero_file_monitor_start_monitoring_real (BraseroFileMonitor *self,
 					    const gchar *uri)
 {
 	BraseroFileMonitorPrivate *priv;
-	gchar *unescaped_uri;
 	gchar *path;
 	gint dev_fd;
 	uint32_t mask;
@@ -593,9 +1043,7 @@ brasero_file_monitor_start_monitoring_real (BraseroFileMonitor *self,
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 
-	unescaped_uri = g_uri_unescape_string (uri, NULL);
-	path = g_filename_from_uri (unescaped_uri, NULL, NULL);
-	g_free (unescaped_uri);
+	path = brasero_file_monitor_uri_to_path (uri);
 
 	dev_fd = g_io_channel_unix_get_fd (priv->notify);
 	mask = IN_MODIFY |
@@ -610,6 +1058,12 @@ brasero_file_monitor_start_monitoring_real (BraseroFileMonitor *self,
 	/* NOTE: always return the same wd when we ask for the same file */
 	wd = inotify_add_watch (dev_fd, path, mask);
 	if (wd == -1) {
+		/* Projects with more directories than max_user_watches */
+		if (errno == ENOSPC && !priv->exhausted) {
+			g_warning ("No more inotify watches (see /proc/sys/fs/inotify/max_user_watches)\n");
+			priv->exhausted = TRUE;
+		}
+
 		BRASERO_BURN_LOG ("ERROR creating watch for local file %s : %s\n",
 				  path,
 				  g_strerror (errno));
@@ -685,13 +1139,35 @@ brasero_file_monitor_directory_contents (BraseroFileMonitor *self,
 	if (!priv->notify || strncmp (uri, "file://", 7))
 		return FALSE;
 
+	/* Once inotify has run out of watches, don't try again for every new
+	 * directory and use fanotify where it is permitted */
+	if (priv->exhausted) {
+		gboolean result = FALSE;
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+		gchar *path;
+
+		path = brasero_file_monitor_uri_to_path (uri);
+		result = brasero_file_monitor_fanotify_directory (self, path, callback_data);
+		g_free (path);
+#endif
+		if (!result)
+			BRASERO_BURN_LOG ("File Monitoring (%s is not monitored)", uri);
+
+		return result;
+	}
+
 	/* we only monitor directories. Files are watched through their
 	 * parent directory. We give them the same handle as their parent
 	 * directory to find it more easily and mark it as being watched */
 	wd = brasero_file_monitor_start_monitoring_real (self, uri);
 
-	if (!wd)
+	if (!wd) {
+		/* Retry now that it is known there are no watches left */
+		if (priv->exhausted)
+			return brasero_file_monitor_directory_contents (self, uri, callback_data);
+
 		return FALSE;
+	}
 
 	g_hash_table_insert (priv->directories,
 			     GINT_TO_POINTER (wd),
@@ -744,6 +1220,22 @@ brasero_file_monitor_foreach_cancel_directory_cb (gpointer key,
 	return TRUE;
 }
 
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+
+static gboolean
+brasero_file_monitor_foreach_cancel_handle_cb (gpointer key,
+					       gpointer hash_data,
+					       gpointer callback_data)
+{
+	BraseroFileMonitorCancelForeach *data = callback_data;
+
+	/* NOTE: marks are only removed when fanotify is closed; events for
+	 * this directory are simply ignored from now on. */
+	return data->func (hash_data, data->callback_data);
+}
+
+#endif
+
 void
 brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 				     BraseroMonitorFindFunc func,
@@ -790,6 +1282,12 @@ brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 				     brasero_file_monitor_foreach_cancel_directory_cb,
 				     &data);
 
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+	g_hash_table_foreach_remove (priv->handles,
+				     brasero_file_monitor_foreach_cancel_handle_cb,
+				     &data);
+#endif
+
 	/* Finally get rid of moved that data in moved list */
 	for (iter = priv->moved_list; iter; iter = next) {
 		BraseroInotifyMovedData *data;
@@ -846,6 +1344,29 @@ brasero_file_monitor_reset (BraseroFileMonitor *self)
 	g_hash_table_foreach_remove (priv->directories,
 				     brasero_file_monitor_foreach_directory_reset_cb,
 				     GINT_TO_POINTER (g_io_channel_unix_get_fd (priv->notify)));
+
+	/* Events not applied yet were for the previous contents */
+	if (priv->flush_id) {
+		g_source_remove (priv->flush_id);
+		priv->flush_id = 0;
+	}
+
+	g_hash_table_remove_all (priv->pending);
+	g_queue_foreach (priv->events, (GFunc) brasero_file_monitor_event_free, NULL);
+	g_queue_clear (priv->events);
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+	/* Closing it removes all the marks */
+	if (priv->fanotify_id) {
+		g_source_remove (priv->fanotify_id);
+		priv->fanotify_id = 0;
+		priv->fanotify = NULL;
+	}
+
+	g_hash_table_remove_all (priv->handles);
+#endif
+
+	priv->exhausted = FALSE;
 }
 
 static void
@@ -859,9 +1380,23 @@ brasero_file_monitor_init (BraseroFileMonitor *object)
 	priv->files = g_hash_table_new (g_direct_hash, g_direct_equal);
 	priv->directories = g_hash_table_new (g_direct_hash, g_direct_equal);
 
+	priv->events = g_queue_new ();
+	priv->pending = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->buffer = g_malloc (BRASERO_FILE_MONITOR_BUFFER);
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+	priv->handles = g_hash_table_new_full (brasero_file_monitor_handle_hash,
+					       brasero_file_monitor_handle_equal,
+					       g_free,
+					       NULL);
+#endif
+
 	/* start inotify monitoring backend */
 	fd = inotify_init ();
 	if (fd != -1) {
+		/* the descriptor is drained until there is nothing left */
+		fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
 		priv->notify = g_io_channel_unix_new (fd);
 		g_io_channel_set_encoding (priv->notify, NULL, NULL);
 		g_io_channel_set_close_on_unref (priv->notify, TRUE);
@@ -890,6 +1425,14 @@ brasero_file_monitor_finalize (GObject *object)
 	g_hash_table_destroy (priv->files);
 	g_hash_table_destroy (priv->directories);
 
+	g_hash_table_destroy (priv->pending);
+	g_queue_free (priv->events);
+	g_free (priv->buffer);
+
+#ifdef BRASERO_FILE_MONITOR_FANOTIFY
+	g_hash_table_destroy (priv->handles);
+#endif
+
 	G_OBJECT_CLASS (brasero_file_monitor_parent_class)->finalize (object);
 }
 
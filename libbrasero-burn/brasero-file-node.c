@@ -41,6 +41,7 @@
 #include "burn-basics.h"
 
 #include "brasero-file-node.h"
+#include "brasero-image-layout.h"
 #include "brasero-io.h"
 
 
@@ -54,6 +55,8 @@ brasero_file_node_root_new (void)
 	root->is_imported = TRUE;
 
 	root->union3.stats = g_new0 (BraseroFileTreeStats, 1);
+	root->union3.stats->layout = brasero_image_layout_new ();
+	brasero_image_layout_node_changed (root->union3.stats->layout, root);
 	return root;
 }
 
@@ -752,26 +755,30 @@ brasero_file_node_rename (BraseroFileNode *node,
 		node->union1.graft->name = g_strdup (name);
 	else
 		node->union1.name = g_strdup (name);
+
+	if (node->parent) {
+		BraseroFileTreeStats *stats;
+
+		stats = brasero_file_node_get_tree_stats (node->parent, NULL);
+		if (stats && stats->layout)
+			brasero_image_layout_node_changed (stats->layout, node);
+	}
 }
 
-void
-brasero_file_node_add (BraseroFileNode *parent,
-		       BraseroFileNode *node,
-		       GCompareFunc sort_func)
+static void
+brasero_file_node_added (BraseroFileNode *node)
 {
 	BraseroFileTreeStats *stats;
+	BraseroFileNode *parent;
 	guint depth = 0;
 
-	parent->union2.children = brasero_file_node_insert (BRASERO_FILE_NODE_CHILDREN (parent),
-							    node,
-							    sort_func,
-							    NULL);
-	node->parent = parent;
-
 	if (BRASERO_FILE_NODE_VIRTUAL (node))
 		return;
 
 	stats = brasero_file_node_get_tree_stats (node->parent, &depth);
+	if (stats && stats->layout)
+		brasero_image_layout_node_added (stats->layout, node);
+
 	if (!node->is_imported) {
 		/* book keeping */
 		if (!node->is_file)
@@ -782,7 +789,7 @@ brasero_file_node_add (BraseroFileNode *parent,
 		/* NOTE: parent will be changed afterwards !!! */
 		if (!node->is_grafted) {
 			/* propagate the size change*/
-			for (; parent && !parent->is_root; parent = parent->parent) {
+			for (parent = node->parent; parent && !parent->is_root; parent = parent->parent) {
 				parent->union3.sectors += BRASERO_FILE_NODE_SECTORS (node);
 				if (parent->is_grafted)
 					break;
@@ -803,11 +810,78 @@ brasero_file_node_add (BraseroFileNode *parent,
 	node->is_deep = TRUE;
 }
 
+void
+brasero_file_node_add (BraseroFileNode *parent,
+		       BraseroFileNode *node,
+		       GCompareFunc sort_func)
+{
+	parent->union2.children = brasero_file_node_insert (BRASERO_FILE_NODE_CHILDREN (parent),
+							    node,
+							    sort_func,
+							    NULL);
+	node->parent = parent;
+	brasero_file_node_added (node);
+}
+
+/**
+ * Same as brasero_file_node_add () for a whole list of nodes (linked through
+ * their next member) already sorted with @sort_func. The list is merged with
+ * the children of @parent in one pass. None of the nodes may be hidden.
+ */
+
+void
+brasero_file_node_add_sorted (BraseroFileNode *parent,
+			      BraseroFileNode *nodes,
+			      GCompareFunc sort_func)
+{
+	BraseroFileNode *children;
+	BraseroFileNode *head = NULL;
+	BraseroFileNode **tail = &head;
+
+	children = BRASERO_FILE_NODE_CHILDREN (parent);
+
+	/* Hidden children are always last so stop before them */
+	while (children && !children->is_hidden && nodes) {
+		if (sort_func && sort_func (children, nodes) > 0) {
+			*tail = nodes;
+			nodes = nodes->next;
+
+			(*tail)->parent = parent;
+			brasero_file_node_added (*tail);
+		}
+		else {
+			*tail = children;
+			children = children->next;
+		}
+		tail = &(*tail)->next;
+	}
+
+	while (children && !children->is_hidden) {
+		*tail = children;
+		children = children->next;
+		tail = &(*tail)->next;
+	}
+
+	while (nodes) {
+		*tail = nodes;
+		nodes = nodes->next;
+
+		(*tail)->parent = parent;
+		brasero_file_node_added (*tail);
+		tail = &(*tail)->next;
+	}
+
+	*tail = children;
+	parent->union2.children = head;
+}
+
 void
 brasero_file_node_set_from_info (BraseroFileNode *node,
 				 BraseroFileTreeStats *stats,
 				 GFileInfo *info)
 {
+	gboolean was_file;
+
 	/* NOTE: the name will never be replaced here since that means
 	 * we could replace a previously set name (that triggered the
 	 * creation of a graft). If someone wants to set a new name,
@@ -838,7 +912,11 @@ brasero_file_node_set_from_info (BraseroFileNode *node,
 	 * - the mime type
 	 * - the size (and possibly the one of his parent)
 	 * - the type */
+	was_file = node->is_file;
 	node->is_file = (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY);
+	if (node->parent && stats && stats->layout && was_file != node->is_file)
+		brasero_image_layout_node_changed (stats->layout, node);
+
 	node->is_fake = FALSE;
 	node->is_loading = FALSE;
 	node->is_imported = FALSE;
@@ -972,6 +1050,14 @@ brasero_file_node_unlink (BraseroFileNode *node)
 
 	iter = BRASERO_FILE_NODE_CHILDREN (node->parent);
 
+	if (!BRASERO_FILE_NODE_VIRTUAL (node)) {
+		BraseroFileTreeStats *stats;
+
+		stats = brasero_file_node_get_tree_stats (node->parent, NULL);
+		if (stats && stats->layout)
+			brasero_image_layout_node_removed (stats->layout, node);
+	}
+
 	/* handle the size change for previous parent */
 	if (!node->is_grafted
 	&&  !node->is_imported
@@ -1077,6 +1163,9 @@ brasero_file_node_move_to (BraseroFileNode *node,
 	/* NOTE: here stats about the tree can change if the parent has a depth
 	 * > 6 and if previous didn't. Other stats remains unmodified. */
 	stats = brasero_file_node_get_tree_stats (node->parent, &depth);
+	if (stats && stats->layout)
+		brasero_image_layout_node_added (stats->layout, node);
+
 	if (node->is_file) {
 		if (depth < 6)
 			return;
@@ -1158,8 +1247,15 @@ brasero_file_node_destroy_with_children (BraseroFileNode *node,
 	if (node->is_file && !node->is_imported && BRASERO_FILE_NODE_MIME (node))
 		brasero_utils_unregister_string (BRASERO_FILE_NODE_MIME (node));
 
-	if (node->is_root)
-		g_free (BRASERO_FILE_NODE_STATS (node));
+	if (node->is_root) {
+		BraseroFileTreeStats *root_stats;
+
+		root_stats = BRASERO_FILE_NODE_STATS (node);
+		if (root_stats->layout)
+			brasero_image_layout_free (root_stats->layout);
+
+		g_free (root_stats);
+	}
 
 	g_free (node);
 }
@@ -68,6 +68,8 @@ typedef struct _BraseroImport BraseroImport;
  * - number of children (files+directories)
  * - number of deep directories
  * - number of files over 2 GiB
+ * - the size of the directory structures in the image (see
+ *   brasero-image-layout.c)
  */
 
 struct _BraseroFileTreeStats {
@@ -76,6 +78,8 @@ struct _BraseroFileTreeStats {
 	guint num_deep;
 	guint num_2GiB;
 	guint num_sym;
+
+	struct _BraseroImageLayout *layout;
 };
 typedef struct _BraseroFileTreeStats BraseroFileTreeStats;
 
@@ -158,6 +162,10 @@ struct _BraseroFileNode {
 	 * upped and therefore wrong. */
 	guint is_inserting:1;
 
+	/* Used by the model: the node was added while notifications were
+	 * batched and the views haven't been told about it yet */
+	guint is_pending:1;
+
 	guint is_expanded:1; /* Used to choose the icon for folders */
 
 	/* this is a ref count a max of 255 should be enough */
@@ -247,6 +255,11 @@ brasero_file_node_add (BraseroFileNode *parent,
 		       BraseroFileNode *child,
 		       GCompareFunc sort_func);
 
+void
+brasero_file_node_add_sorted (BraseroFileNode *parent,
+			      BraseroFileNode *nodes,
+			      GCompareFunc sort_func);
+
 BraseroFileNode *
 brasero_file_node_new (const gchar *name);
 
@@ -0,0 +1,471 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+ 
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "brasero-units.h"
+
+#include "brasero-image-layout.h"
+
+/**
+ * The layout modelled here is the one genisoimage/mkisofs produce with the
+ * options the plugins pass (-r, optionally -J and -iso-level 3):
+ * - 16 sectors of system area
+ * - primary volume descriptor, (joliet supplementary volume descriptor),
+ *   terminator and the version descriptor mkisofs appends
+ * - type L and type M path tables for each hierarchy
+ * - directory extents where records never cross a sector boundary
+ * - Rock Ridge continuation areas
+ * - 150 sectors of padding at the end
+ * File data itself is not accounted for here.
+ */
+
+#define BRASERO_LAYOUT_SECTOR_SIZE	2048
+#define BRASERO_LAYOUT_RECORD_MAX	254
+
+/* Size of the SUSP entries written with -r */
+#define RR_ENTRY_RR			5
+#define RR_ENTRY_PX			36
+#define RR_ENTRY_TF			26
+#define RR_ENTRY_NM			5
+#define RR_ENTRY_SP			7
+#define RR_ENTRY_CE			28
+#define RR_ENTRY_ER			237
+
+#define RR_ENTRIES_BASE			(RR_ENTRY_RR + RR_ENTRY_PX + RR_ENTRY_TF)
+
+struct _BraseroImageLayoutDir {
+	guint iso_sectors;
+	guint joliet_sectors;
+	guint ce_sectors;
+
+	/* the size of the entry of the directory in path tables */
+	guint iso_path;
+	guint joliet_path;
+};
+typedef struct _BraseroImageLayoutDir BraseroImageLayoutDir;
+
+struct _BraseroImageLayout {
+	/* key = directory node, data = BraseroImageLayoutDir */
+	GHashTable *dirs;
+
+	/* directories whose entry needs to be (re)computed */
+	GHashTable *dirty;
+
+	/* sums of all the entries in dirs */
+	guint64 iso_sectors;
+	guint64 joliet_sectors;
+	guint64 ce_sectors;
+	guint64 iso_path;
+	guint64 joliet_path;
+
+	guint level_3:1;
+};
+
+static guint
+brasero_image_layout_iso_name_len (const gchar *name,
+				   gboolean is_file,
+				   gboolean level_3)
+{
+	const gchar *dot;
+	glong base;
+	glong ext;
+	glong len;
+
+	/* Characters that are not allowed are replaced by '_' so names are
+	 * mangled but the number of characters is kept (up to the limit) */
+	len = g_utf8_strlen (name, -1);
+	if (!is_file)
+		return MIN (len, level_3? 31:8);
+
+	/* A leading dot doesn't start an extension */
+	dot = strrchr (name, '.');
+	if (dot && dot != name) {
+		base = g_utf8_pointer_to_offset (name, dot);
+		ext = len - base - 1;
+	}
+	else {
+		base = len;
+		ext = 0;
+	}
+
+	/* There is always a dot for files */
+	if (level_3)
+		len = MIN (base + 1 + ext, 31);
+	else
+		len = MIN (base, 8) + 1 + MIN (ext, 3);
+
+	/* Add ";1" */
+	return len + 2;
+}
+
+static guint
+brasero_image_layout_joliet_name_len (const gchar *name,
+				      gboolean is_file)
+{
+	glong len;
+
+	/* UCS-2 names limited to 64 characters; files also get ";1" */
+	len = MIN (g_utf8_strlen (name, -1), 64);
+	if (is_file)
+		len += 2;
+
+	return len * 2;
+}
+
+static guint
+brasero_image_layout_record_len (guint name_len,
+				 guint susp_len)
+{
+	guint len;
+
+	/* 33 bytes of fixed fields, the name, a padding byte if needed so
+	 * that the system use area starts on an even offset. The whole record
+	 * is then padded to an even length as well. */
+	len = 33 + name_len;
+	len += len & 1;
+	len += susp_len;
+	len += len & 1;
+	return len;
+}
+
+static void
+brasero_image_layout_pack (guint64 *offset,
+			   guint len)
+{
+	guint used;
+
+	/* Records can't span over two sectors */
+	used = *offset % BRASERO_LAYOUT_SECTOR_SIZE;
+	if (used + len > BRASERO_LAYOUT_SECTOR_SIZE)
+		*offset += BRASERO_LAYOUT_SECTOR_SIZE - used;
+
+	*offset += len;
+}
+
+static gint
+brasero_image_layout_sort_name_cb (gconstpointer a,
+				   gconstpointer b)
+{
+	BraseroFileNode *node_a = *(BraseroFileNode **) a;
+	BraseroFileNode *node_b = *(BraseroFileNode **) b;
+
+	return strcmp (BRASERO_FILE_NODE_NAME (node_a), BRASERO_FILE_NODE_NAME (node_b));
+}
+
+static void
+brasero_image_layout_dir_compute (BraseroImageLayout *layout,
+				  BraseroFileNode *dir,
+				  BraseroImageLayoutDir *entry)
+{
+	guint64 joliet_offset;
+	guint64 iso_offset;
+	GPtrArray *records;
+	BraseroFileNode *iter;
+	guint64 ce_bytes = 0;
+	guint i;
+
+	/* Virtual nodes are only placeholders and won't appear in the image */
+	if (BRASERO_FILE_NODE_VIRTUAL (dir))
+		return;
+
+	/* "." and ".." records. For the root "." also holds the SP entry and a
+	 * CE entry pointing to the ER entry in a continuation area. */
+	iso_offset = brasero_image_layout_record_len (1, RR_ENTRIES_BASE) * 2;
+	if (dir->is_root) {
+		iso_offset += RR_ENTRY_SP + RR_ENTRY_CE;
+		ce_bytes += RR_ENTRY_ER;
+	}
+	joliet_offset = brasero_image_layout_record_len (1, 0) * 2;
+
+	/* Records are sorted by name in the image which matters a bit as to
+	 * how they are packed into sectors. */
+	records = g_ptr_array_new ();
+	for (iter = BRASERO_FILE_NODE_CHILDREN (dir); iter; iter = iter->next) {
+		if (!BRASERO_FILE_NODE_VIRTUAL (iter))
+			g_ptr_array_add (records, iter);
+	}
+	g_ptr_array_sort (records, brasero_image_layout_sort_name_cb);
+
+	for (i = 0; i < records->len; i ++) {
+		const gchar *name;
+		guint name_len;
+		guint len;
+
+		iter = g_ptr_array_index (records, i);
+		name = BRASERO_FILE_NODE_NAME (iter);
+
+		name_len = brasero_image_layout_iso_name_len (name, iter->is_file, layout->level_3);
+		len = brasero_image_layout_record_len (name_len, RR_ENTRIES_BASE + RR_ENTRY_NM + strlen (name));
+		if (len > BRASERO_LAYOUT_RECORD_MAX) {
+			/* What doesn't fit goes to a continuation area */
+			ce_bytes += len - BRASERO_LAYOUT_RECORD_MAX + RR_ENTRY_CE;
+			len = BRASERO_LAYOUT_RECORD_MAX;
+		}
+		brasero_image_layout_pack (&iso_offset, len);
+
+		name_len = brasero_image_layout_joliet_name_len (name, iter->is_file);
+		len = brasero_image_layout_record_len (name_len, 0);
+		brasero_image_layout_pack (&joliet_offset, len);
+	}
+	g_ptr_array_free (records, TRUE);
+
+	entry->iso_sectors = BRASERO_BYTES_TO_SECTORS (iso_offset, BRASERO_LAYOUT_SECTOR_SIZE);
+	entry->joliet_sectors = BRASERO_BYTES_TO_SECTORS (joliet_offset, BRASERO_LAYOUT_SECTOR_SIZE);
+	entry->ce_sectors = BRASERO_BYTES_TO_SECTORS (ce_bytes, BRASERO_LAYOUT_SECTOR_SIZE);
+
+	/* Path table entries: 8 bytes plus the name (padded to even length).
+	 * The root name is a single 0 byte. */
+	if (dir->is_root) {
+		entry->iso_path = 10;
+		entry->joliet_path = 10;
+	}
+	else {
+		guint name_len;
+
+		name_len = brasero_image_layout_iso_name_len (BRASERO_FILE_NODE_NAME (dir), FALSE, layout->level_3);
+		entry->iso_path = 8 + name_len + (name_len & 1);
+
+		name_len = brasero_image_layout_joliet_name_len (BRASERO_FILE_NODE_NAME (dir), FALSE);
+		entry->joliet_path = 8 + name_len;
+	}
+}
+
+static void
+brasero_image_layout_account (BraseroImageLayout *layout,
+			      BraseroImageLayoutDir *entry)
+{
+	layout->iso_sectors += entry->iso_sectors;
+	layout->joliet_sectors += entry->joliet_sectors;
+	layout->ce_sectors += entry->ce_sectors;
+	layout->iso_path += entry->iso_path;
+	layout->joliet_path += entry->joliet_path;
+}
+
+static void
+brasero_image_layout_discount (BraseroImageLayout *layout,
+			       BraseroImageLayoutDir *entry)
+{
+	layout->iso_sectors -= entry->iso_sectors;
+	layout->joliet_sectors -= entry->joliet_sectors;
+	layout->ce_sectors -= entry->ce_sectors;
+	layout->iso_path -= entry->iso_path;
+	layout->joliet_path -= entry->joliet_path;
+}
+
+static void
+brasero_image_layout_drop (BraseroImageLayout *layout,
+			   BraseroFileNode *dir)
+{
+	BraseroImageLayoutDir *entry;
+
+	entry = g_hash_table_lookup (layout->dirs, dir);
+	if (entry) {
+		brasero_image_layout_discount (layout, entry);
+		g_hash_table_remove (layout->dirs, dir);
+	}
+
+	g_hash_table_remove (layout->dirty, dir);
+}
+
+static void
+brasero_image_layout_mark_dirty (BraseroImageLayout *layout,
+				 BraseroFileNode *dir)
+{
+	BraseroImageLayoutDir *entry;
+
+	if (!dir || dir->is_file)
+		return;
+
+	/* Virtual nodes don't appear in the image. They must not be kept
+	 * either since they are destroyed without the layout being told
+	 * (see brasero_file_node_unlink ()). */
+	if (BRASERO_FILE_NODE_VIRTUAL (dir))
+		return;
+
+	entry = g_hash_table_lookup (layout->dirs, dir);
+	if (entry) {
+		brasero_image_layout_discount (layout, entry);
+		g_hash_table_remove (layout->dirs, dir);
+	}
+
+	g_hash_table_insert (layout->dirty, dir, dir);
+}
+
+static void
+brasero_image_layout_drop_subtree (BraseroImageLayout *layout,
+				   BraseroFileNode *node)
+{
+	BraseroFileNode *iter;
+
+	if (node->is_file)
+		return;
+
+	brasero_image_layout_drop (layout, node);
+	for (iter = BRASERO_FILE_NODE_CHILDREN (node); iter; iter = iter->next)
+		brasero_image_layout_drop_subtree (layout, iter);
+}
+
+static void
+brasero_image_layout_mark_subtree_dirty (BraseroImageLayout *layout,
+					 BraseroFileNode *node)
+{
+	BraseroFileNode *iter;
+
+	if (node->is_file || BRASERO_FILE_NODE_VIRTUAL (node))
+		return;
+
+	brasero_image_layout_mark_dirty (layout, node);
+	for (iter = BRASERO_FILE_NODE_CHILDREN (node); iter; iter = iter->next)
+		brasero_image_layout_mark_subtree_dirty (layout, iter);
+}
+
+/**
+ * To be called once node was inserted in the tree
+ */
+
+void
+brasero_image_layout_node_added (BraseroImageLayout *layout,
+				 BraseroFileNode *node)
+{
+	brasero_image_layout_mark_dirty (layout, node->parent);
+	brasero_image_layout_mark_subtree_dirty (layout, node);
+}
+
+/**
+ * To be called before node is unlinked from its parent
+ */
+
+void
+brasero_image_layout_node_removed (BraseroImageLayout *layout,
+				   BraseroFileNode *node)
+{
+	brasero_image_layout_mark_dirty (layout, node->parent);
+	brasero_image_layout_drop_subtree (layout, node);
+}
+
+/**
+ * To be called when the name or the type of node changed
+ */
+
+void
+brasero_image_layout_node_changed (BraseroImageLayout *layout,
+				   BraseroFileNode *node)
+{
+	brasero_image_layout_mark_dirty (layout, node->parent);
+	if (node->is_file)
+		brasero_image_layout_drop (layout, node);
+	else
+		brasero_image_layout_mark_dirty (layout, node);
+}
+
+goffset
+brasero_image_layout_get_sectors (BraseroImageLayout *layout,
+				  BraseroFileNode *root,
+				  BraseroImageFS fs_type)
+{
+	GHashTableIter iter;
+	gpointer key;
+	goffset sectors;
+	gboolean level_3;
+
+	/* All ISO names depend on the level so everything must be redone */
+	level_3 = (fs_type & BRASERO_IMAGE_ISO_FS_LEVEL_3) != 0;
+	if (level_3 != layout->level_3) {
+		g_hash_table_remove_all (layout->dirs);
+		layout->iso_sectors = 0;
+		layout->joliet_sectors = 0;
+		layout->ce_sectors = 0;
+		layout->iso_path = 0;
+		layout->joliet_path = 0;
+
+		layout->level_3 = level_3;
+		brasero_image_layout_mark_subtree_dirty (layout, root);
+	}
+
+	/* Only the directories that changed since last time are computed */
+	g_hash_table_iter_init (&iter, layout->dirty);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		BraseroImageLayoutDir *entry;
+
+		entry = g_new0 (BraseroImageLayoutDir, 1);
+		brasero_image_layout_dir_compute (layout, key, entry);
+		brasero_image_layout_account (layout, entry);
+		g_hash_table_insert (layout->dirs, key, entry);
+	}
+	g_hash_table_remove_all (layout->dirty);
+
+	/* system area, PVD, terminator and version descriptor */
+	sectors = 16 + 3;
+	sectors += BRASERO_BYTES_TO_SECTORS (layout->iso_path, BRASERO_LAYOUT_SECTOR_SIZE) * 2;
+	sectors += layout->iso_sectors;
+	sectors += layout->ce_sectors;
+
+	if (fs_type & BRASERO_IMAGE_FS_JOLIET) {
+		/* supplementary volume descriptor */
+		sectors += 1;
+		sectors += BRASERO_BYTES_TO_SECTORS (layout->joliet_path, BRASERO_LAYOUT_SECTOR_SIZE) * 2;
+		sectors += layout->joliet_sectors;
+	}
+
+	/* padding */
+	sectors += 150;
+
+	return sectors;
+}
+
+BraseroImageLayout *
+brasero_image_layout_new (void)
+{
+	BraseroImageLayout *layout;
+
+	layout = g_new0 (BraseroImageLayout, 1);
+	layout->dirs = g_hash_table_new_full (g_direct_hash,
+					      g_direct_equal,
+					      NULL,
+					      g_free);
+	layout->dirty = g_hash_table_new (g_direct_hash, g_direct_equal);
+	return layout;
+}
+
+void
+brasero_image_layout_free (BraseroImageLayout *layout)
+{
+	g_hash_table_destroy (layout->dirs);
+	g_hash_table_destroy (layout->dirty);
+	g_free (layout);
+}
@@ -88,6 +88,15 @@ brasero_plugin_check_media_restrictions (BraseroPlugin *plugin,
 void
 brasero_plugin_check_plugin_ready (BraseroPlugin *plugin);
 
+gboolean
+brasero_plugin_get_check_thread_safe (BraseroPlugin *plugin);
+
+guint
+brasero_plugin_get_state_serial (void);
+
+void
+brasero_plugin_save_app_cache (void);
+
 G_END_DECLS
 
 #endif
@@ -76,6 +76,16 @@ void
 brasero_plugin_set_compulsory (BraseroPlugin *self,
 			       gboolean compulsory);
 
+/**
+ * Plugins whose brasero_plugin_check_config () is safe to run in a thread
+ * at the same time as others (it doesn't touch the environment, the current
+ * directory, the locale or any other process wide state) should say so to
+ * be checked concurrently. The others are checked one by one beforehand.
+ */
+void
+brasero_plugin_set_check_thread_safe (BraseroPlugin *self,
+				      gboolean thread_safe);
+
 void
 brasero_plugin_register_group (BraseroPlugin *plugin,
 			       const gchar *name);
@@ -102,6 +102,13 @@ brasero_burn_session_get_tmp_dir (BraseroBurnSession *session,
 				  gchar **path,
 				  GError **error);
 
+void
+brasero_burn_session_set_output_tmp (BraseroBurnSession *session,
+				     gboolean tmp);
+
+gboolean
+brasero_burn_session_is_output_tmp (BraseroBurnSession *session);
+
 BraseroBurnResult
 brasero_burn_session_get_tmp_image_type_same_src_dest (BraseroBurnSession *session,
                                                        BraseroTrackType *image_type);
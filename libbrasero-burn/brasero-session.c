@@ -114,6 +114,7 @@ struct _BraseroBurnSessionPrivate {
 	GSList *pile_tracks;
 
 	guint strict_checks:1;
+	guint tmp_output:1;
 };
 typedef struct _BraseroBurnSessionPrivate BraseroBurnSessionPrivate;
 
@@ -1230,6 +1231,45 @@ brasero_burn_session_get_tmpdir (BraseroBurnSession *self)
 	return priv->tmpdir? priv->tmpdir:g_get_tmp_dir ();
 }
 
+/**
+ * brasero_burn_session_set_output_tmp:
+ * @session: a #BraseroBurnSession
+ * @tmp: a #gboolean
+ *
+ * Tells whether the image output of the session is a temporary file (that
+ * another session owns) rather than a path the user chose.
+ **/
+
+void
+brasero_burn_session_set_output_tmp (BraseroBurnSession *self,
+				     gboolean tmp)
+{
+	BraseroBurnSessionPrivate *priv;
+
+	g_return_if_fail (BRASERO_IS_BURN_SESSION (self));
+
+	priv = BRASERO_BURN_SESSION_PRIVATE (self);
+	priv->tmp_output = (tmp != FALSE);
+}
+
+/**
+ * brasero_burn_session_is_output_tmp:
+ * @session: a #BraseroBurnSession
+ *
+ * Return value: a #gboolean. TRUE if the image output is a temporary file.
+ **/
+
+gboolean
+brasero_burn_session_is_output_tmp (BraseroBurnSession *self)
+{
+	BraseroBurnSessionPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_BURN_SESSION (self), FALSE);
+
+	priv = BRASERO_BURN_SESSION_PRIVATE (self);
+	return priv->tmp_output;
+}
+
 /**
  * brasero_burn_session_get_tmp_dir:
  * @session: a #BraseroBurnSession
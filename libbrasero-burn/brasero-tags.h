@@ -48,6 +48,13 @@ G_BEGIN_DECLS
 
 #define BRASERO_TRACK_MEDIUM_WRONG_CHECKSUM_TAG		"track::medium::error::checksum::list"
 
+/**
+ * Path of a file with the checksums of the files of an image as it was
+ * recorded, one "checksum  path" line per file (G_TYPE_STRING)
+ */
+
+#define BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG		"track::image::checksum::files"
+
 /**
  * Strings
  */
@@ -79,10 +79,19 @@ struct _BraseroTrackDataCfgPrivate
 
 	GSList *shown;
 
+	/* Nodes added but not yet signalled to the views (node -> reference) */
+	GHashTable *pending;
+	guint pending_id;
+	guint batch;
+
+	/* Paths of the rows shown in the views (node -> GtkTreePath) */
+	GHashTable *paths;
+
 	gint sort_column;
 	GtkSortType sort_type;
 
 	guint joliet_rename:1;
+	guint adding_grafts:1;
 
 	guint deep_directory:1;
 	guint G2_files:1;
@@ -90,6 +99,14 @@ struct _BraseroTrackDataCfgPrivate
 
 #define BRASERO_TRACK_DATA_CFG_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_TRACK_DATA_CFG, BraseroTrackDataCfgPrivate))
 
+/* Nodes that are not exposed through the GtkTreeModel interface */
+#define BRASERO_TRACK_DATA_CFG_NODE_SKIP(MACRO_node)				\
+	((MACRO_node)->is_hidden || (MACRO_node)->is_pending)
+
+/* How long rows added to a directory being explored are kept before being
+ * signalled all at once to the views */
+#define BRASERO_TRACK_DATA_CFG_PENDING_DELAY	200
+
 
 static void
 brasero_track_data_cfg_drag_source_iface_init (gpointer g_iface, gpointer data);
@@ -99,6 +116,12 @@ static void
 brasero_track_data_cfg_sortable_iface_init (gpointer g_iface, gpointer data);
 static void
 brasero_track_data_cfg_iface_init (gpointer g_iface, gpointer data);
+static void
+brasero_track_data_cfg_flush_pending (BraseroTrackDataCfg *self);
+static void
+brasero_track_data_cfg_batch_begin (BraseroTrackDataCfg *self);
+static void
+brasero_track_data_cfg_batch_end (BraseroTrackDataCfg *self);
 
 G_DEFINE_TYPE_WITH_CODE (BraseroTrackDataCfg,
 			 brasero_track_data_cfg,
@@ -156,8 +179,8 @@ brasero_track_data_cfg_get_pos_as_child (BraseroFileNode *node)
 		if (peers == node)
 			break;
 
-		/* Don't increment when is_hidden */
-		if (peers->is_hidden)
+		/* Don't increment when is_hidden or not signalled yet */
+		if (BRASERO_TRACK_DATA_CFG_NODE_SKIP (peers))
 			continue;
 
 		pos ++;
@@ -166,12 +189,70 @@ brasero_track_data_cfg_get_pos_as_child (BraseroFileNode *node)
 	return pos;
 }
 
+/* The views ask for the path of the rows they show again and again (when
+ * drawing them, for the selection, ...) and each time all the siblings of the
+ * node and of its ancestors are walked. So these paths are kept until the
+ * rows change. Adding, removing, renaming or reordering a row (or signalling
+ * it to the views) only moves the rows of the same directory and the rows
+ * below them: only the paths of the rows below that directory are dropped.
+ * All of them are dropped when the tree is resorted or reset. */
+
+static void
+brasero_track_data_cfg_paths_clear (BraseroTrackDataCfg *self)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+	if (priv->paths && g_hash_table_size (priv->paths))
+		g_hash_table_remove_all (priv->paths);
+}
+
+static gboolean
+brasero_track_data_cfg_paths_below_cb (gpointer key,
+				       gpointer value,
+				       gpointer data)
+{
+	return brasero_file_node_is_ancestor (data, key);
+}
+
+static void
+brasero_track_data_cfg_paths_invalidate (BraseroTrackDataCfg *self,
+					 BraseroFileNode *node)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+	if (!priv->paths || !g_hash_table_size (priv->paths))
+		return;
+
+	if (!node || node->is_root) {
+		g_hash_table_remove_all (priv->paths);
+		return;
+	}
+
+	/* node and all the rows below it */
+	g_hash_table_foreach_remove (priv->paths,
+				     brasero_track_data_cfg_paths_below_cb,
+				     node);
+}
+
 static GtkTreePath *
 brasero_track_data_cfg_node_to_path (BraseroTrackDataCfg *self,
 				     BraseroFileNode *node)
 {
+	BraseroTrackDataCfgPrivate *priv;
+	BraseroFileNode *visible;
 	GtkTreePath *path;
 
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	visible = node->is_visible ? node : NULL;
+	if (visible) {
+		path = g_hash_table_lookup (priv->paths, visible);
+		if (path)
+			return gtk_tree_path_copy (path);
+	}
+
 	path = gtk_tree_path_new ();
 	for (; node->parent && !node->is_root; node = node->parent) {
 		guint nth;
@@ -180,6 +261,9 @@ brasero_track_data_cfg_node_to_path (BraseroTrackDataCfg *self,
 		gtk_tree_path_prepend_index (path, nth);
 	}
 
+	if (visible)
+		g_hash_table_insert (priv->paths, visible, gtk_tree_path_copy (path));
+
 	return path;
 }
 
@@ -229,14 +313,14 @@ brasero_track_data_cfg_nth_child (BraseroFileNode *parent,
 		return NULL;
 
 	peers = BRASERO_FILE_NODE_CHILDREN (parent);
-	while (peers && peers->is_hidden)
+	while (peers && BRASERO_TRACK_DATA_CFG_NODE_SKIP (peers))
 		peers = peers->next;
 		
 	for (pos = 0; pos < nth && peers; pos ++) {
 		peers = peers->next;
 
 		/* Skip hidden */
-		while (peers && peers->is_hidden)
+		while (peers && BRASERO_TRACK_DATA_CFG_NODE_SKIP (peers))
 			peers = peers->next;
 	}
 
@@ -289,7 +373,7 @@ brasero_track_data_cfg_get_n_children (const BraseroFileNode *node)
 		return 0;
 
 	for (children = BRASERO_FILE_NODE_CHILDREN (node); children; children = children->next) {
-		if (children->is_hidden)
+		if (BRASERO_TRACK_DATA_CFG_NODE_SKIP (children))
 			continue;
 
 		num ++;
@@ -391,10 +475,10 @@ brasero_track_data_cfg_iter_children (GtkTreeModel *model,
 			return FALSE;
 
 		node = BRASERO_FILE_NODE_CHILDREN (root);
-		while (node && node->is_hidden)
+		while (node && BRASERO_TRACK_DATA_CFG_NODE_SKIP (node))
 			node = node->next;
 
-		if (!node || node->is_hidden)
+		if (!node)
 			return FALSE;
 
 		iter->user_data = node;
@@ -428,7 +512,11 @@ brasero_track_data_cfg_iter_children (GtkTreeModel *model,
 		return TRUE;
 	}
 
-	iter->user_data = BRASERO_FILE_NODE_CHILDREN (node);
+	node = BRASERO_FILE_NODE_CHILDREN (node);
+	while (node && BRASERO_TRACK_DATA_CFG_NODE_SKIP (node))
+		node = node->next;
+
+	iter->user_data = node;
 	iter->user_data2 = GINT_TO_POINTER (BRASERO_ROW_REGULAR);
 	return TRUE;
 }
@@ -458,10 +546,10 @@ brasero_track_data_cfg_iter_next (GtkTreeModel *model,
 	node = node->next;
 
 	/* skip all hidden files */
-	while (node && node->is_hidden)
+	while (node && BRASERO_TRACK_DATA_CFG_NODE_SKIP (node))
 		node = node->next;
 
-	if (!node || node->is_hidden)
+	if (!node)
 		return FALSE;
 
 	iter->user_data = node;
@@ -1168,7 +1256,6 @@ brasero_track_data_cfg_drag_data_received (GtkTreeDragDest *drag_dest,
 		}
 	}
 	else if (target == gdk_atom_intern ("text/uri-list", TRUE)) {
-		gint i;
 		gchar **uris;
 
 		/* NOTE: there can be many URIs at the same time. One
@@ -1184,12 +1271,13 @@ brasero_track_data_cfg_drag_data_received (GtkTreeDragDest *drag_dest,
 		if (!uris)
 			return TRUE;
 
-		for (i = 0; uris [i]; i ++) {
-			/* Add the URIs to the project */
-			brasero_data_project_add_loading_node (BRASERO_DATA_PROJECT (priv->tree),
-			                                       uris [i],
-			                                       parent);
-		}
+		/* Add the URIs to the project */
+		brasero_track_data_cfg_batch_begin (BRASERO_TRACK_DATA_CFG (drag_dest));
+		brasero_data_project_add_nodes (BRASERO_DATA_PROJECT (priv->tree),
+						(const gchar * const *) uris,
+						NULL,
+						parent);
+		brasero_track_data_cfg_batch_end (BRASERO_TRACK_DATA_CFG (drag_dest));
 		g_strfreev (uris);
 	}
 	else
@@ -1323,6 +1411,9 @@ brasero_track_data_cfg_set_sort_column_id (GtkTreeSortable *sortable,
 	priv->sort_column = column;
 	priv->sort_type = type;
 
+	/* The whole tree is going to be reordered */
+	brasero_track_data_cfg_flush_pending (BRASERO_TRACK_DATA_CFG (sortable));
+
 	switch (column) {
 	case BRASERO_DATA_TREE_MODEL_NAME:
 		brasero_data_project_set_sort_function (BRASERO_DATA_PROJECT (priv->tree),
@@ -1346,6 +1437,7 @@ brasero_track_data_cfg_set_sort_column_id (GtkTreeSortable *sortable,
 		break;
 	}
 
+	brasero_track_data_cfg_paths_clear (BRASERO_TRACK_DATA_CFG (sortable));
 	gtk_tree_sortable_sort_column_changed (sortable);
 }
 
@@ -1427,6 +1519,258 @@ brasero_track_data_cfg_clean_cache (BraseroTrackDataCfg *track)
 	}
 }
 
+/**
+ * Batching of row insertions.
+ * When a whole project is loaded or when a visible directory is explored
+ * there can be thousands of nodes added in a row. Rather than emitting one
+ * signal per node (each of which requires building a path by walking all
+ * the previous siblings) the nodes are hidden from the model until they
+ * are signalled all at once, parent by parent, in a single pass over the
+ * children of each parent.
+ */
+
+/* Whether the views know about the row: neither it nor any of its ancestors
+ * is waiting to be signalled */
+
+static gboolean
+brasero_track_data_cfg_node_is_signalled (BraseroFileNode *node)
+{
+	for (; node && !node->is_root; node = node->parent) {
+		if (node->is_pending)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+brasero_track_data_cfg_flush_children (BraseroTrackDataCfg *self,
+				       BraseroFileNode *parent)
+{
+	BraseroTrackDataCfgPrivate *priv;
+	BraseroFileNode *child;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	guint inserted = 0;
+	guint num;
+	guint pos;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	/* number of rows the views know about */
+	num = brasero_track_data_cfg_get_n_children (parent);
+
+	iter.stamp = priv->stamp;
+	iter.user_data2 = GINT_TO_POINTER (BRASERO_ROW_REGULAR);
+
+	/* The path of the parent is computed once and the position of each
+	 * child is counted while walking the list. Rows are signalled in
+	 * their order so that each path is right when it is emitted. */
+	path = brasero_track_data_cfg_node_to_path (self, parent);
+	for (pos = 0, child = BRASERO_FILE_NODE_CHILDREN (parent); child; child = child->next) {
+		if (child->is_hidden)
+			continue;
+
+		if (child->is_pending) {
+			child->is_pending = FALSE;
+			brasero_track_data_cfg_paths_invalidate (self, parent);
+
+			iter.user_data = child;
+			gtk_tree_path_append_index (path, pos);
+
+			/* See brasero_track_data_cfg_node_added () */
+			child->is_inserting = 1;
+			gtk_tree_model_row_inserted (GTK_TREE_MODEL (self),
+						     path,
+						     &iter);
+			child->is_inserting = 0;
+
+			if (!child->is_file && !child->is_loading)
+				gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (self),
+								      path,
+								      &iter);
+			gtk_tree_path_up (path);
+			inserted ++;
+		}
+
+		pos ++;
+	}
+
+	if (inserted && !parent->is_root) {
+		iter.user_data = parent;
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, &iter);
+
+		/* Remove the BOGUS row if the directory was empty */
+		if (!num) {
+			gtk_tree_path_append_index (path, inserted);
+			gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), path);
+		}
+	}
+
+	gtk_tree_path_free (path);
+}
+
+static void
+brasero_track_data_cfg_flush_pending (BraseroTrackDataCfg *self)
+{
+	BraseroTrackDataCfgPrivate *priv;
+	GHashTableIter iter;
+	GHashTable *parents;
+	GHashTable *pending;
+	GSList *silent = NULL;
+	gpointer reference;
+	GList *parent_list;
+	GSList *list;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	if (priv->pending_id) {
+		g_source_remove (priv->pending_id);
+		priv->pending_id = 0;
+	}
+
+	if (!g_hash_table_size (priv->pending))
+		return;
+
+	/* Signal handlers could add nodes while we are flushing */
+	pending = priv->pending;
+	priv->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	parents = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_hash_table_iter_init (&iter, pending);
+	while (g_hash_table_iter_next (&iter, NULL, &reference)) {
+		BraseroFileNode *ancestor;
+		BraseroFileNode *node;
+
+		/* The node may have been destroyed in the meantime */
+		node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (priv->tree),
+							   GPOINTER_TO_INT (reference));
+		brasero_data_project_reference_free (BRASERO_DATA_PROJECT (priv->tree),
+						     GPOINTER_TO_INT (reference));
+		if (!node || !node->is_pending)
+			continue;
+
+		/* Rows below a pending row are signalled along with it */
+		for (ancestor = node->parent; ancestor; ancestor = ancestor->parent) {
+			if (ancestor->is_pending)
+				break;
+		}
+
+		if (ancestor)
+			silent = g_slist_prepend (silent, node);
+		else
+			g_hash_table_insert (parents, node->parent, node->parent);
+	}
+	g_hash_table_destroy (pending);
+
+	for (list = silent; list; list = list->next) {
+		BraseroFileNode *node;
+
+		node = list->data;
+		node->is_pending = FALSE;
+	}
+	g_slist_free (silent);
+
+	parent_list = g_hash_table_get_keys (parents);
+	g_hash_table_destroy (parents);
+
+	for (; parent_list; parent_list = g_list_delete_link (parent_list, parent_list))
+		brasero_track_data_cfg_flush_children (self, parent_list->data);
+}
+
+static gboolean
+brasero_track_data_cfg_flush_pending_cb (gpointer data)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (data);
+	priv->pending_id = 0;
+
+	brasero_track_data_cfg_flush_pending (BRASERO_TRACK_DATA_CFG (data));
+	return FALSE;
+}
+
+static void
+brasero_track_data_cfg_add_pending (BraseroTrackDataCfg *self,
+				    BraseroFileNode *node)
+{
+	BraseroTrackDataCfgPrivate *priv;
+	guint reference;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	/* A reference is used since the node could be destroyed (along with
+	 * its parent for example) without us being told */
+	reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (priv->tree), node);
+	g_hash_table_insert (priv->pending, node, GINT_TO_POINTER (reference));
+	node->is_pending = TRUE;
+
+	if (!priv->batch && !priv->pending_id)
+		priv->pending_id = g_timeout_add (BRASERO_TRACK_DATA_CFG_PENDING_DELAY,
+						  brasero_track_data_cfg_flush_pending_cb,
+						  self);
+}
+
+static void
+brasero_track_data_cfg_remove_pending (BraseroTrackDataCfg *self,
+				       BraseroFileNode *node)
+{
+	BraseroTrackDataCfgPrivate *priv;
+	gpointer reference;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	node->is_pending = FALSE;
+
+	reference = g_hash_table_lookup (priv->pending, node);
+	if (!reference)
+		return;
+
+	brasero_data_project_reference_free (BRASERO_DATA_PROJECT (priv->tree),
+					     GPOINTER_TO_INT (reference));
+	g_hash_table_remove (priv->pending, node);
+}
+
+static void
+brasero_track_data_cfg_clear_pending (BraseroTrackDataCfg *self)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	if (priv->pending_id) {
+		g_source_remove (priv->pending_id);
+		priv->pending_id = 0;
+	}
+
+	/* NOTE: references are all invalidated when the project is reset */
+	g_hash_table_remove_all (priv->pending);
+}
+
+static void
+brasero_track_data_cfg_batch_begin (BraseroTrackDataCfg *self)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+	priv->batch ++;
+}
+
+static void
+brasero_track_data_cfg_batch_end (BraseroTrackDataCfg *self)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+	if (!priv->batch)
+		return;
+
+	priv->batch --;
+	if (!priv->batch)
+		brasero_track_data_cfg_flush_pending (self);
+}
+
 static void
 brasero_track_data_cfg_node_added (BraseroDataProject *project,
 				   BraseroFileNode *node,
@@ -1438,6 +1782,7 @@ brasero_track_data_cfg_node_added (BraseroDataProject *project,
 	GtkTreeIter iter;
 
 	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+	brasero_track_data_cfg_paths_invalidate (self, node->parent);
 
 	if (priv->icon == node) {
 		/* Our icon node has showed up, signal that */
@@ -1470,6 +1815,18 @@ brasero_track_data_cfg_node_added (BraseroDataProject *project,
 		}
 	}
 
+	/* The views will be told about it when it is flushed */
+	if (node->is_pending)
+		return;
+
+	/* Batch the rows when a project is loaded or when a directory is
+	 * explored. */
+	if (!node->is_reloading
+	&& (priv->batch || (node->parent->is_exploring && !node->parent->is_root))) {
+		brasero_track_data_cfg_add_pending (self, node);
+		return;
+	}
+
 	iter.stamp = priv->stamp;
 	iter.user_data = node;
 	iter.user_data2 = GINT_TO_POINTER (BRASERO_ROW_REGULAR);
@@ -1495,26 +1852,30 @@ brasero_track_data_cfg_node_added (BraseroDataProject *project,
 				     path,
 				     &iter);
 	node->is_inserting = 0;
-	gtk_tree_path_free (path);
 
+	/* The paths of the parent and of the node itself are derived from
+	 * the one we already have rather than walking the tree again. */
 	parent = node->parent;
 	if (!parent->is_root) {
+		GtkTreePath *parent_path;
+
 		/* Tell the tree that the parent changed (since the number of children
 		 * changed as well). */
 		iter.user_data = parent;
-		path = brasero_track_data_cfg_node_to_path (self, parent);
+		parent_path = gtk_tree_path_copy (path);
+		gtk_tree_path_up (parent_path);
 
-		gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, &iter);
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (self), parent_path, &iter);
 
 		/* Check if the parent of this node is empty if so remove the BOGUS row.
 		 * Do it afterwards to prevent the parent row to be collapsed if it was
 		 * previously expanded. */
 		if (parent && brasero_track_data_cfg_get_n_children (parent) == 1) {
-			gtk_tree_path_append_index (path, 1);
-			gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), path);
+			gtk_tree_path_append_index (parent_path, 1);
+			gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), parent_path);
 		}
 
-		gtk_tree_path_free (path);
+		gtk_tree_path_free (parent_path);
 	}
 
 	/* Now see if this is a directory which is empty and needs a BOGUS */
@@ -1522,10 +1883,10 @@ brasero_track_data_cfg_node_added (BraseroDataProject *project,
 		/* emit child-toggled. Thanks to bogus rows we only need to emit
 		 * this signal once since a directory will always have a child
 		 * in the tree */
-		path = brasero_track_data_cfg_node_to_path (self, node);
+		iter.user_data = node;
 		gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (self), path, &iter);
-		gtk_tree_path_free (path);
 	}
+	gtk_tree_path_free (path);
 
 	/* we also have to set the is_visible property as all nodes added to 
 	 * root are always visible but ref_node is not necessarily called on
@@ -1547,7 +1908,7 @@ brasero_track_data_cfg_convert_former_position (BraseroFileNode *former_parent,
 	child = BRASERO_FILE_NODE_CHILDREN (former_parent);
 
 	for (current_pos = 0; child && current_pos != former_position; current_pos ++) {
-		if (child->is_hidden)
+		if (BRASERO_TRACK_DATA_CFG_NODE_SKIP (child))
 			hidden_num ++;
 
 		child = child->next;
@@ -1568,6 +1929,11 @@ brasero_track_data_cfg_node_removed (BraseroDataProject *project,
 	GtkTreePath *path;
 
 	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
+
+	/* The rows below the node are gone as well */
+	brasero_track_data_cfg_paths_invalidate (self, former_parent);
+	brasero_track_data_cfg_paths_invalidate (self, node);
+
 	/* NOTE: there is no special case of autorun.inf here when we created
 	 * it as a temprary file since it's hidden and BraseroDataTreeModel
 	 * won't emit a signal for removed file in this case.
@@ -1603,6 +1969,12 @@ brasero_track_data_cfg_node_removed (BraseroDataProject *project,
 			priv->shown = g_slist_remove (priv->shown, tmp);
 	}
 
+	/* The views never heard about this node */
+	if (node->is_pending) {
+		brasero_track_data_cfg_remove_pending (self, node);
+		return;
+	}
+
 	/* See if the parent of this node still has children. If not we need to
 	 * add a bogus row. If it hasn't got children then it only remains our
 	 * node in the list.
@@ -1641,6 +2013,13 @@ brasero_track_data_cfg_node_changed (BraseroDataProject *project,
 
 	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
 
+	/* The node may have been renamed and moved among its siblings */
+	brasero_track_data_cfg_paths_invalidate (self, node->parent);
+
+	/* The views will get the row as it is when it is flushed */
+	if (!brasero_track_data_cfg_node_is_signalled (node))
+		return;
+
 	/* Get the iter for the node */
 	iter.stamp = priv->stamp;
 	iter.user_data = node;
@@ -1685,6 +2064,68 @@ brasero_track_data_cfg_node_changed (BraseroDataProject *project,
 	gtk_tree_path_free (path);
 }
 
+/* new_order covers all the rows that are not hidden, including those not
+ * signalled yet. Returns the order of the rows known to the views (NULL if
+ * that's all of them). Since pending rows are signalled where they are when
+ * they are flushed, there is no need to flush them first. */
+
+static gint *
+brasero_track_data_cfg_known_order (BraseroFileNode *parent,
+				    gint *new_order)
+{
+	BraseroFileNode *child;
+	gboolean *pending;
+	gint *known_order;
+	gint *old_known;
+	guint num = 0;
+	guint known;
+	guint i;
+
+	for (child = BRASERO_FILE_NODE_CHILDREN (parent); child; child = child->next) {
+		if (!child->is_hidden)
+			num ++;
+	}
+
+	/* Which old positions were those of pending rows */
+	pending = g_new0 (gboolean, num);
+	for (i = 0, child = BRASERO_FILE_NODE_CHILDREN (parent); child; child = child->next) {
+		if (child->is_hidden)
+			continue;
+
+		if (child->is_pending)
+			pending [new_order [i]] = TRUE;
+		i ++;
+	}
+
+	/* Old position of each row among the known rows */
+	old_known = g_new0 (gint, num);
+	for (i = 0, known = 0; i < num; i ++) {
+		old_known [i] = known;
+		if (!pending [i])
+			known ++;
+	}
+
+	if (known == num) {
+		g_free (old_known);
+		g_free (pending);
+		return NULL;
+	}
+
+	known_order = g_new0 (gint, known);
+	for (i = 0, known = 0, child = BRASERO_FILE_NODE_CHILDREN (parent); child; child = child->next) {
+		if (child->is_hidden)
+			continue;
+
+		if (!child->is_pending)
+			known_order [known ++] = old_known [new_order [i]];
+		i ++;
+	}
+
+	g_free (old_known);
+	g_free (pending);
+	return known_order;
+}
+
 static void
 brasero_track_data_cfg_node_reordered (BraseroDataProject *project,
 				       BraseroFileNode *parent,
@@ -1693,9 +2134,22 @@ brasero_track_data_cfg_node_reordered (BraseroDataProject *project,
 {
 	GtkTreePath *treepath;
 	BraseroTrackDataCfgPrivate *priv;
+	gint *known_order;
 
 	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (self);
 
+	brasero_track_data_cfg_paths_invalidate (self, parent);
+
+	/* The views will get the rows in their new order when the directory
+	 * is flushed */
+	if (!brasero_track_data_cfg_node_is_signalled (parent)
+	||  !brasero_track_data_cfg_get_n_children (parent))
+		return;
+
+	known_order = brasero_track_data_cfg_known_order (parent, new_order);
+	if (known_order)
+		new_order = known_order;
+
 	treepath = brasero_track_data_cfg_node_to_path (self, parent);
 	if (parent != brasero_data_project_get_root (project)) {
 		GtkTreeIter iter;
@@ -1716,6 +2170,7 @@ brasero_track_data_cfg_node_reordered (BraseroDataProject *project,
 					       new_order);
 
 	gtk_tree_path_free (treepath);
+	g_free (known_order);
 }
 
 static void
@@ -1833,6 +2288,24 @@ brasero_track_data_cfg_sortable_iface_init (gpointer g_iface, gpointer data)
  * Track part
  */
 
+static void
+brasero_track_data_cfg_load_imported (BraseroTrackDataCfg *track,
+				      BraseroFileNode *parent)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	/* The contents of a directory from an imported session are only
+	 * loaded once it is shown. Get them now so that the names of the
+	 * files already on disc are checked against the new ones. */
+	if (!parent || !parent->is_imported || !parent->is_fake || parent->is_file)
+		return;
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+	brasero_data_session_load_directory_contents (BRASERO_DATA_SESSION (priv->tree),
+						      parent,
+						      NULL);
+}
+
 /**
  * brasero_track_data_cfg_add:
  * @track: a #BraseroTrackDataCfg
@@ -1869,9 +2342,82 @@ brasero_track_data_cfg_add (BraseroTrackDataCfg *track,
 	else
 		parent_node = brasero_data_project_get_root (BRASERO_DATA_PROJECT (priv->tree));
 
+	brasero_track_data_cfg_load_imported (track, parent_node);
 	return (brasero_data_project_add_loading_node (BRASERO_DATA_PROJECT (BRASERO_DATA_PROJECT (priv->tree)), uri, parent_node) != NULL);
 }
 
+/**
+ * brasero_track_data_cfg_add_many:
+ * @track: a #BraseroTrackDataCfg
+ * @uris: a NULL terminated array of URIs or paths
+ * @infos: an array of #GFileInfo (one for each of @uris, any can be NULL) or NULL
+ * @parent: a #GtkTreePath or NULL
+ *
+ * Add all the files in @uris under a directory (@parent) at once.
+ * If @parent is NULL, the files are added to the root.
+ * This is much faster than calling brasero_track_data_cfg_add () for each
+ * file: the new rows are sorted and merged with the existing ones in one
+ * go and the size is only updated once.
+ * When a #GFileInfo is given for a plain file or directory, it is used as
+ * is and the file is not queried again.
+ *
+ * Return value: a #guint. The number of files that were added.
+ **/
+
+guint
+brasero_track_data_cfg_add_many (BraseroTrackDataCfg *track,
+				 const gchar * const *uris,
+				 GFileInfo **infos,
+				 GtkTreePath *parent)
+{
+	BraseroTrackDataCfgPrivate *priv;
+	BraseroFileNode *parent_node;
+	gchar **converted;
+	guint added;
+	guint num;
+	guint i;
+
+	g_return_val_if_fail (BRASERO_TRACK_DATA_CFG (track), 0);
+	g_return_val_if_fail (uris != NULL, 0);
+
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	if (priv->loading)
+		return 0;
+
+	if (parent) {
+		parent_node = brasero_track_data_cfg_path_to_node (track, parent);
+		if (parent_node && (parent_node->is_file || parent_node->is_loading))
+			parent_node = parent_node->parent;
+	}
+	else
+		parent_node = brasero_data_project_get_root (BRASERO_DATA_PROJECT (priv->tree));
+
+	brasero_track_data_cfg_load_imported (track, parent_node);
+
+	/* Paths are turned into URIs and URIs are made canonical */
+	num = g_strv_length ((gchar **) uris);
+	converted = g_new0 (gchar *, num + 1);
+	for (i = 0; i < num; i ++) {
+		GFile *file;
+
+		file = g_file_new_for_commandline_arg (uris [i]);
+		converted [i] = g_file_get_uri (file);
+		g_object_unref (file);
+	}
+
+	/* Signal all the rows at once when they are all in the tree */
+	brasero_track_data_cfg_batch_begin (track);
+	added = brasero_data_project_add_nodes (BRASERO_DATA_PROJECT (priv->tree),
+						(const gchar * const *) converted,
+						infos,
+						parent_node);
+	brasero_track_data_cfg_batch_end (track);
+
+	g_strfreev (converted);
+	return added;
+}
+
 /**
  * brasero_track_data_cfg_add_empty_directory:
  * @track: a #BraseroTrackDataCfg
@@ -1931,6 +2477,10 @@ brasero_track_data_cfg_add_empty_directory (BraseroTrackDataCfg *track,
 	if (!node)
 		return NULL;
 
+	/* The caller expects a valid path for the new row */
+	if (node->is_pending)
+		brasero_track_data_cfg_flush_pending (track);
+
 	path = brasero_track_data_cfg_node_to_path (track, node);
 	if (path)
 		brasero_track_changed (BRASERO_TRACK (track));
@@ -2026,6 +2576,8 @@ brasero_track_data_cfg_reset (BraseroTrackDataCfg *track)
 	num = brasero_track_data_cfg_get_n_children (root);
 
 	brasero_data_project_reset (BRASERO_DATA_PROJECT (priv->tree));
+	brasero_track_data_cfg_clear_pending (track);
+	brasero_track_data_cfg_paths_clear (track);
 
 	treepath = gtk_tree_path_new_first ();
 	for (i = 0; i < num; i++)
@@ -2145,6 +2697,83 @@ brasero_track_data_cfg_get_restored_list (BraseroTrackDataCfg *track)
 	return brasero_filtered_uri_get_restored_list (filtered);
 }
 
+/**
+ * brasero_track_data_cfg_add_grafts:
+ * @track: a #BraseroTrackDataCfg
+ * @grafts: (element-type BraseroBurn.GraftPt) (in) (transfer full): a #GSList of #BraseroGraftPt.
+ *
+ * Adds @grafts to @track while they are read so they don't all need to be
+ * held in memory. They are only loaded once the last ones and the excluded
+ * URIs are given with brasero_track_data_set_source () which must follow.
+ **/
+
+void
+brasero_track_data_cfg_add_grafts (BraseroTrackDataCfg *track,
+				   GSList *grafts)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	g_return_if_fail (BRASERO_TRACK_DATA_CFG (track));
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	if (!priv->adding_grafts) {
+		priv->adding_grafts = TRUE;
+		brasero_track_data_cfg_batch_begin (track);
+	}
+
+	brasero_data_project_load_contents_add (BRASERO_DATA_PROJECT (priv->tree), grafts);
+
+	g_slist_foreach (grafts, (GFunc) brasero_graft_point_free, NULL);
+	g_slist_free (grafts);
+}
+
+/**
+ * brasero_track_data_cfg_add_snapshot:
+ * @track: a #BraseroTrackDataCfg
+ * @snapshot: a #gchar
+ *
+ * Gives the state of a directory as it was returned by
+ * brasero_track_data_cfg_get_snapshot (). If this directory did not change
+ * since then, its contents are taken from @snapshot instead of exploring it
+ * again. This must be called before brasero_track_data_set_source ().
+ *
+ * Return value: a #gboolean. FALSE if @snapshot is not valid.
+ **/
+
+gboolean
+brasero_track_data_cfg_add_snapshot (BraseroTrackDataCfg *track,
+				     const gchar *snapshot)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_TRACK_DATA_CFG (track), FALSE);
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	return brasero_data_vfs_add_snapshot (BRASERO_DATA_VFS (priv->tree), snapshot);
+}
+
+/**
+ * brasero_track_data_cfg_get_snapshot:
+ * @track: a #BraseroTrackDataCfg
+ *
+ * Gets the state (modification time, inode and contents) of the directories
+ * explored so far, one #gchar * per directory. They can be given back with
+ * brasero_track_data_cfg_add_snapshot () when the project is opened again.
+ *
+ * Return value: a #GSList; free the list and its contents when not needed anymore.
+ **/
+
+GSList *
+brasero_track_data_cfg_get_snapshot (BraseroTrackDataCfg *track)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_TRACK_DATA_CFG (track), NULL);
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	return brasero_data_vfs_get_snapshot (BRASERO_DATA_VFS (priv->tree));
+}
+
 /**
  * brasero_track_data_cfg_load_medium:
  * @track: a #BraseroTrackDataCfg
@@ -2238,12 +2867,19 @@ brasero_track_data_cfg_set_source (BraseroTrackData *track,
 	BraseroTrackDataCfgPrivate *priv;
 
 	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
-	if (!grafts)
+	if (!grafts && !priv->adding_grafts)
 		return BRASERO_BURN_ERR;
 
+	/* Signal all the rows at once when they are all in the tree. If some
+	 * grafts were added beforehand, that was started then. */
+	if (!priv->adding_grafts)
+		brasero_track_data_cfg_batch_begin (BRASERO_TRACK_DATA_CFG (track));
+
+	priv->adding_grafts = FALSE;
 	priv->loading = brasero_data_project_load_contents (BRASERO_DATA_PROJECT (priv->tree),
 							    grafts,
 							    excluded);
+	brasero_track_data_cfg_batch_end (BRASERO_TRACK_DATA_CFG (track));
 
 	/* Remember that we own the list grafts and excluded
 	 * so we have to free them ourselves. */
@@ -2448,20 +3084,14 @@ brasero_track_data_cfg_get_size (BraseroTrack *track,
 
 	sectors = brasero_data_project_get_sectors (BRASERO_DATA_PROJECT (priv->tree));
 	if (blocks) {
-		BraseroFileNode *root;
 		BraseroImageFS fs_type;
-		BraseroFileTreeStats *stats;
 
 		if (!sectors)
 			return sectors;
 
 		fs_type = brasero_track_data_cfg_get_fs (BRASERO_TRACK_DATA (track));
-		root = brasero_data_project_get_root (BRASERO_DATA_PROJECT (priv->tree));
-		stats = BRASERO_FILE_NODE_STATS (root);
-		sectors = brasero_data_project_improve_image_size_accuracy (sectors,
-									    stats->num_dir,
-									    fs_type);
-		*blocks = sectors;
+		*blocks = brasero_data_project_get_image_sectors (BRASERO_DATA_PROJECT (priv->tree),
+								  fs_type);
 	}
 
 	if (block_size)
@@ -3299,6 +3929,11 @@ brasero_track_data_cfg_init (BraseroTrackDataCfg *object)
 
 	priv->theme = gtk_icon_theme_get_default ();
 	priv->tree = brasero_data_tree_model_new ();
+	priv->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+	priv->paths = g_hash_table_new_full (g_direct_hash,
+					     g_direct_equal,
+					     NULL,
+					     (GDestroyNotify) gtk_tree_path_free);
 
 	g_signal_connect (priv->tree,
 			  "row-added",
@@ -3392,6 +4027,21 @@ brasero_track_data_cfg_finalize (GObject *object)
 		priv->shown = NULL;
 	}
 
+	if (priv->pending_id) {
+		g_source_remove (priv->pending_id);
+		priv->pending_id = 0;
+	}
+
+	if (priv->pending) {
+		g_hash_table_destroy (priv->pending);
+		priv->pending = NULL;
+	}
+
+	if (priv->paths) {
+		g_hash_table_destroy (priv->paths);
+		priv->paths = NULL;
+	}
+
 	if (priv->tree) {
 		/* This object could outlive us just for some time
 		 * so we better remove all signals.
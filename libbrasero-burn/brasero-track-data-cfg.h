@@ -92,6 +92,11 @@ gboolean
 brasero_track_data_cfg_add (BraseroTrackDataCfg *track,
 			    const gchar *uri,
 			    GtkTreePath *parent);
+guint
+brasero_track_data_cfg_add_many (BraseroTrackDataCfg *track,
+				 const gchar * const *uris,
+				 GFileInfo **infos,
+				 GtkTreePath *parent);
 GtkTreePath *
 brasero_track_data_cfg_add_empty_directory (BraseroTrackDataCfg *track,
 					    const gchar *name,
@@ -132,6 +137,21 @@ brasero_track_data_cfg_dont_filter_uri (BraseroTrackDataCfg *track,
 GSList *
 brasero_track_data_cfg_get_restored_list (BraseroTrackDataCfg *track);
 
+void
+brasero_track_data_cfg_add_grafts (BraseroTrackDataCfg *track,
+				   GSList *grafts);
+
+/**
+ * To avoid exploring unchanged directories again when a project is reopened
+ */
+
+gboolean
+brasero_track_data_cfg_add_snapshot (BraseroTrackDataCfg *track,
+				     const gchar *snapshot);
+
+GSList *
+brasero_track_data_cfg_get_snapshot (BraseroTrackDataCfg *track);
+
 enum  {
 	BRASERO_FILTERED_STOCK_ID_COL,
 	BRASERO_FILTERED_URI_COL,
@@ -51,6 +51,7 @@ struct _BraseroTrackImageInfo {
 	guint64 blocks;
 	GCancellable *cancel;
 	BraseroImageFormat format;
+	BraseroImageSheet *sheet;
 };
 
 typedef struct _BraseroTrackImageCfgPrivate BraseroTrackImageCfgPrivate;
@@ -60,6 +61,9 @@ struct _BraseroTrackImageCfgPrivate
 	GError *error;
 
 	BraseroImageFormat format;
+
+	/* Keeps the parsed cue/toc sheet in cache while the track uses it */
+	BraseroImageSheet *sheet;
 };
 
 #define BRASERO_TRACK_IMAGE_CFG_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_TRACK_IMAGE_CFG, BraseroTrackImageCfgPrivate))
@@ -130,6 +134,12 @@ brasero_track_image_cfg_get_info_cb (GObject *object,
 	                                 info->uri,
 	                                 priv->format != BRASERO_IMAGE_FORMAT_NONE? priv->format:info->format);
 
+	if (priv->sheet)
+		brasero_image_sheet_unref (priv->sheet);
+
+	priv->sheet = info->sheet;
+	info->sheet = NULL;
+
 	BRASERO_TRACK_IMAGE_CLASS (brasero_track_image_cfg_parent_class)->set_block_num (BRASERO_TRACK_IMAGE (object), info->blocks);
 	brasero_track_changed (BRASERO_TRACK (object));
 }
@@ -172,17 +182,21 @@ brasero_track_image_cfg_get_info_thread (GSimpleAsyncResult *result,
 		&& (!strcmp (mime, "application/x-toc")
 		||  !strcmp (mime, "application/x-cdrdao-toc")
 		||  !strcmp (mime, "application/x-cue"))) {
-			info->format = brasero_image_format_identify_cuesheet (info->uri, cancel, &error);
+			info->sheet = brasero_image_sheet_get (info->uri, cancel, &error);
 
-			if (error) {
+			if (!info->sheet) {
 				if (!g_cancellable_is_cancelled (cancel))
 					g_simple_async_result_set_from_error (result, error);
 
-				g_error_free (error);
+				if (error)
+					g_error_free (error);
+
 				g_object_unref (file_info);
 				return;
 			}
 
+			info->format = brasero_image_sheet_get_format (info->sheet);
+
 			if (info->format == BRASERO_IMAGE_FORMAT_NONE
 			&&  g_str_has_suffix (info->uri, ".toc"))
 				info->format = BRASERO_IMAGE_FORMAT_CLONE;
@@ -215,10 +229,18 @@ brasero_track_image_cfg_get_info_thread (GSimpleAsyncResult *result,
 		complement = brasero_image_format_get_complement (BRASERO_IMAGE_FORMAT_CLONE, info->uri);
 		brasero_image_format_get_clone_size (complement, &info->blocks, NULL, cancel, &error);
 	}
-	else if (info->format == BRASERO_IMAGE_FORMAT_CDRDAO)
-		brasero_image_format_get_cdrdao_size (info->uri, &info->blocks, NULL, cancel, &error);
-	else if (info->format == BRASERO_IMAGE_FORMAT_CUE)
-		brasero_image_format_get_cue_size (info->uri, &info->blocks, NULL, cancel, &error);
+	else if (info->format == BRASERO_IMAGE_FORMAT_CDRDAO
+	     ||  info->format == BRASERO_IMAGE_FORMAT_CUE) {
+		/* The sheet is only parsed once; the same copy is used for the
+		 * size and later by the burning session */
+		if (!info->sheet)
+			info->sheet = brasero_image_sheet_get (info->uri, cancel, &error);
+
+		if (info->sheet && info->format == BRASERO_IMAGE_FORMAT_CDRDAO)
+			brasero_image_sheet_get_cdrdao_size (info->sheet, &info->blocks, NULL, cancel, &error);
+		else if (info->sheet)
+			brasero_image_sheet_get_cue_size (info->sheet, &info->blocks, NULL, cancel, &error);
+	}
 
 	if (error && !g_cancellable_is_cancelled (cancel))
 		g_simple_async_result_set_from_error (result, error);
@@ -232,6 +254,9 @@ brasero_track_image_info_free (gpointer data)
 {
 	BraseroTrackImageInfo *info = data;
 
+	if (info->sheet)
+		brasero_image_sheet_unref (info->sheet);
+
 	g_object_unref (info->cancel);
 	g_free (info->uri);
 	g_free (info);
@@ -502,6 +527,11 @@ brasero_track_image_cfg_finalize (GObject *object)
 		priv->error = NULL;
 	}
 
+	if (priv->sheet) {
+		brasero_image_sheet_unref (priv->sheet);
+		priv->sheet = NULL;
+	}
+
 	G_OBJECT_CLASS (brasero_track_image_cfg_parent_class)->finalize (object);
 }
 
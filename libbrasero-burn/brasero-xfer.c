@@ -45,60 +45,172 @@
 #include "burn-debug.h"
 
 /* FIXME! one way to improve this would be to add auto mounting */
+
+/**
+ * Transfers are split into items (one per file or directory) that are put in
+ * a queue. Up to max_jobs threads pick items from the queue. When a directory
+ * is processed its children are added to the queue as they are enumerated so
+ * that discovering the size of what has to be copied goes along with copying.
+ */
+
+typedef struct _BraseroXferItem BraseroXferItem;
+struct _BraseroXferItem {
+	BraseroXferCtx *ctx;
+
+	GFile *src;
+	GFile *dest;
+
+	/* G_FILE_TYPE_UNKNOWN until it was queried */
+	GFileType type;
+	goffset size;
+
+	/* what was copied so far */
+	goffset current;
+
+	/* Set for what was added with brasero_xfer_add (). Their destination
+	 * is a temporary file that must be replaced. */
+	guint is_top:1;
+};
+
 struct _BraseroXferCtx {
+	GMutex *lock;
+	GCond *cond;
+
+	GQueue *pending;
+	guint busy;
+	guint max_jobs;
+
+	GCancellable *cancel;
+	GError *error;
+
 	goffset total_size;
 
 	goffset bytes_copied;
 	goffset current_bytes_copied;
 };
 
+static BraseroXferItem *
+brasero_xfer_item_new (BraseroXferCtx *ctx,
+		       GFile *src,
+		       GFile *dest)
+{
+	BraseroXferItem *item;
+
+	item = g_new0 (BraseroXferItem, 1);
+	item->ctx = ctx;
+	item->src = g_object_ref (src);
+	item->dest = g_object_ref (dest);
+	item->type = G_FILE_TYPE_UNKNOWN;
+	return item;
+}
+
+static void
+brasero_xfer_item_free (BraseroXferItem *item)
+{
+	g_object_unref (item->src);
+	g_object_unref (item->dest);
+	g_free (item);
+}
+
+static void
+brasero_xfer_push (BraseroXferCtx *ctx,
+		   BraseroXferItem *item)
+{
+	g_mutex_lock (ctx->lock);
+
+	if (item->type != G_FILE_TYPE_DIRECTORY)
+		ctx->total_size += item->size;
+
+	g_queue_push_tail (ctx->pending, item);
+	g_cond_signal (ctx->cond);
+	g_mutex_unlock (ctx->lock);
+}
+
 static void
 brasero_xfer_progress_cb (goffset current_num_bytes,
 			  goffset total_num_bytes,
 			  gpointer callback_data)
 {
-	BraseroXferCtx *ctx = callback_data;
-	ctx->current_bytes_copied = current_num_bytes;
+	BraseroXferItem *item = callback_data;
+	BraseroXferCtx *ctx = item->ctx;
+
+	g_mutex_lock (ctx->lock);
+	ctx->current_bytes_copied += current_num_bytes - item->current;
+	item->current = current_num_bytes;
+	g_mutex_unlock (ctx->lock);
 }
 
 static gboolean
-brasero_xfer_file_transfer (BraseroXferCtx *ctx,
-			    GFile *src,
-			    GFile *dest,
+brasero_xfer_file_transfer (BraseroXferItem *item,
 			    GCancellable *cancel,
 			    GError **error)
 {
+	BraseroXferCtx *ctx = item->ctx;
 	gboolean result;
 	gchar *name;
 
-	name = g_file_get_basename (src);
+	name = g_file_get_basename (item->src);
 	BRASERO_BURN_LOG ("Downloading %s", name);
 	g_free (name);
 
-	result = g_file_copy (src,
-			      dest,
+	if (item->is_top)
+		g_file_delete (item->dest, cancel, NULL);
+
+	result = g_file_copy (item->src,
+			      item->dest,
 			      G_FILE_COPY_ALL_METADATA,
 			      cancel,
 			      brasero_xfer_progress_cb,
-			      ctx,
+			      item,
 			      error);
 
+	g_mutex_lock (ctx->lock);
+	ctx->current_bytes_copied -= item->current;
+	ctx->bytes_copied += item->size;
+	item->current = 0;
+	g_mutex_unlock (ctx->lock);
+
 	return result;
 }
 
 static gboolean
-brasero_xfer_recursive_transfer (BraseroXferCtx *ctx,
-				 GFile *src,
-				 GFile *dest,
+brasero_xfer_directory_transfer (BraseroXferItem *item,
 				 GCancellable *cancel,
 				 GError **error)
 {
 	GFileInfo *info;
+	gchar *dest_path;
 	gboolean result = TRUE;
 	GFileEnumerator *enumerator;
 
+	dest_path = g_file_get_path (item->dest);
+
+	/* create a directory with the same name and explore it. For the ones
+	 * that were added remove the temporary file that was created. */
+	if (item->is_top) {
+		g_remove (dest_path);
+		result = (g_mkdir_with_parents (dest_path, S_IRWXU) == 0);
+	}
+	else
+		result = (g_mkdir (dest_path, S_IRWXU) == 0);
+
+	if (!result) {
+                int errsv = errno;
+
+		g_free (dest_path);
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("Directory could not be created (%s)"),
+			     g_strerror (errsv));
+		return FALSE;
+	}
+
+	BRASERO_BURN_LOG ("Created directory %s", dest_path);
+	g_free (dest_path);
+
 	BRASERO_BURN_LOG ("Downloading directory contents");
-	enumerator = g_file_enumerate_children (src,
+	enumerator = g_file_enumerate_children (item->src,
 						G_FILE_ATTRIBUTE_STANDARD_TYPE ","
 						G_FILE_ATTRIBUTE_STANDARD_NAME ","
 						G_FILE_ATTRIBUTE_STANDARD_SIZE,
@@ -109,58 +221,33 @@ brasero_xfer_recursive_transfer (BraseroXferCtx *ctx,
 		return FALSE;
 
 	while ((info = g_file_enumerator_next_file (enumerator, cancel, error))) {
+		BraseroXferItem *child;
 		GFile *dest_child;
 		GFile *src_child;
 
-		src_child = g_file_get_child (src, g_file_info_get_name (info));
-		dest_child = g_file_get_child (dest, g_file_info_get_name (info));
-
-		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
-			gchar *path;
-
-			path = g_file_get_path (dest_child);
-			BRASERO_BURN_LOG ("Creating directory %s", path);
-
-			/* create a directory with the same name and explore it */
-			if (g_mkdir (path, S_IRWXU)) {
-                                int errsv = errno;
-				g_set_error (error,
-					     BRASERO_BURN_ERROR,
-					     BRASERO_BURN_ERROR_GENERAL,
-					     _("Directory could not be created (%s)"),
-					     g_strerror (errsv));
-				result = FALSE;
-			}
-			else {
-				result = brasero_xfer_recursive_transfer (ctx,
-									  src_child,
-									  dest_child,
-									  cancel,
-									  error);
-			}
-
-			g_free (path);
-		}
-		else {
-			result = brasero_xfer_file_transfer (ctx,
-							     src_child,
-							     dest_child,
-							     cancel,
-							     error);
-			ctx->bytes_copied += g_file_info_get_size (info);
-		}
+		src_child = g_file_get_child (item->src, g_file_info_get_name (info));
+		dest_child = g_file_get_child (item->dest, g_file_info_get_name (info));
+
+		/* Queue it straight away: another thread may start copying it
+		 * while we are still enumerating. */
+		child = brasero_xfer_item_new (item->ctx, src_child, dest_child);
+		child->type = g_file_info_get_file_type (info);
+		if (child->type != G_FILE_TYPE_DIRECTORY)
+			child->size = g_file_info_get_size (info);
+
+		brasero_xfer_push (item->ctx, child);
 
 		g_object_unref (info);
 		g_object_unref (src_child);
 		g_object_unref (dest_child);
 
-		if (!result)
-			break;
-
 		if (g_cancellable_is_cancelled (cancel))
 			break;
 	}
 
+	if (error && *error)
+		result = FALSE;
+
 	g_file_enumerator_close (enumerator, cancel, NULL);
 	g_object_unref (enumerator);
 
@@ -168,120 +255,189 @@ brasero_xfer_recursive_transfer (BraseroXferCtx *ctx,
 }
 
 static gboolean
-brasero_xfer_get_download_size (BraseroXferCtx *ctx,
-				GFile *src,
-				GCancellable *cancel,
-				GError **error)
+brasero_xfer_item_transfer (BraseroXferItem *item,
+			    GCancellable *cancel,
+			    GError **error)
 {
-	GFileEnumerator *enumerator;
-	GFileInfo *info;
+	if (item->type == G_FILE_TYPE_UNKNOWN) {
+		GFileInfo *info;
+
+		info = g_file_query_info (item->src,
+					  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NONE, /* follow symlinks */
+					  cancel,
+					  error);
+		if (!info)
+			return FALSE;
 
-	enumerator = g_file_enumerate_children (src,
-						G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-						G_FILE_ATTRIBUTE_STANDARD_NAME ","
-						G_FILE_ATTRIBUTE_STANDARD_SIZE,
-						G_FILE_QUERY_INFO_NONE,	/* follow symlinks */
-						cancel,
-						error);
-	if (!enumerator)
-		return FALSE;
+		item->type = g_file_info_get_file_type (info);
+		if (item->type != G_FILE_TYPE_DIRECTORY) {
+			item->size = g_file_info_get_size (info);
+			BRASERO_BURN_LOG ("Downloading file (size = %lli)", item->size);
 
-	while ((info = g_file_enumerator_next_file (enumerator, cancel, error))) {
-		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
-			GFile *child;
-	
-			child = g_file_get_child (src, g_file_info_get_name (info));
-			brasero_xfer_get_download_size (ctx, child, cancel, error);
-			g_object_unref (child);
+			g_mutex_lock (item->ctx->lock);
+			item->ctx->total_size += item->size;
+			g_mutex_unlock (item->ctx->lock);
 		}
 		else
-			ctx->total_size += g_file_info_get_size (info);
+			BRASERO_BURN_LOG ("Downloading directory");
 
 		g_object_unref (info);
-
-		if (g_cancellable_is_cancelled (cancel))
-			break;
 	}
 
-	g_file_enumerator_close (enumerator, cancel, NULL);
-	g_object_unref (enumerator);
+	if (item->type == G_FILE_TYPE_DIRECTORY)
+		return brasero_xfer_directory_transfer (item, cancel, error);
 
-	return TRUE;
+	return brasero_xfer_file_transfer (item, cancel, error);
 }
 
-gboolean
-brasero_xfer_start (BraseroXferCtx *ctx,
-		    GFile *src,
-		    GFile *dest,
-		    GCancellable *cancel,
-		    GError **error)
+static gpointer
+brasero_xfer_worker (gpointer data)
 {
-	gboolean result;
-	GFileInfo *info;
+	BraseroXferCtx *ctx = data;
+
+	g_mutex_lock (ctx->lock);
+	while (!ctx->error && !g_cancellable_is_cancelled (ctx->cancel)) {
+		BraseroXferItem *item;
+		GError *error = NULL;
+		gboolean result;
+
+		item = g_queue_pop_head (ctx->pending);
+		if (!item) {
+			/* When nobody is busy nobody can queue more items */
+			if (!ctx->busy)
+				break;
+
+			g_cond_wait (ctx->cond, ctx->lock);
+			continue;
+		}
 
-	bzero (ctx, sizeof (BraseroXferCtx));
+		ctx->busy ++;
+		g_mutex_unlock (ctx->lock);
 
-	/* First step: get all the total size of what we have to move */
-	info = g_file_query_info (src,
-				  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
-				  G_FILE_QUERY_INFO_NONE, /* follow symlinks */
-				  cancel,
-				  error);
-	if (!info)
-		return FALSE;
+		result = brasero_xfer_item_transfer (item, ctx->cancel, &error);
+		brasero_xfer_item_free (item);
 
-	if (g_cancellable_is_cancelled (cancel))
-		return FALSE;
+		g_mutex_lock (ctx->lock);
+		ctx->busy --;
 
-	/* Retrieve the size of all the data. */
-	if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY) {
-		BRASERO_BURN_LOG ("Downloading file (size = %lli)", g_file_info_get_size (info));
-		ctx->total_size = g_file_info_get_size (info);
-	}
-	else {
-		brasero_xfer_get_download_size (ctx, src, cancel, error);
-		BRASERO_BURN_LOG ("Downloading directory (size = %lli)", ctx->total_size);
+		/* Only keep the first error */
+		if (!result && !ctx->error) {
+			if (!error)
+				error = g_error_new (BRASERO_BURN_ERROR,
+						     BRASERO_BURN_ERROR_GENERAL,
+						     "%s",
+						     _("An internal error occurred"));
+			ctx->error = error;
+		}
+		else if (error)
+			g_error_free (error);
+
+		g_cond_broadcast (ctx->cond);
 	}
 
-	ctx->bytes_copied = 0;
+	/* Wake up the others so they can leave as well */
+	g_cond_broadcast (ctx->cond);
+	g_mutex_unlock (ctx->lock);
 
-	/* Step 2: start downloading */
-	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
-		gchar *dest_path;
+	return NULL;
+}
 
-		dest_path = g_file_get_path (dest);
+/**
+ * Sets how many files are copied at the same time.
+ */
 
-		/* remove the temporary file that was created */
-		g_remove (dest_path);
-		if (g_mkdir_with_parents (dest_path, S_IRWXU)) {
-                        int errsv = errno;
+void
+brasero_xfer_set_max_jobs (BraseroXferCtx *ctx,
+			   guint max_jobs)
+{
+	ctx->max_jobs = MAX (max_jobs, 1);
+}
 
-			g_free (dest_path);
-			g_object_unref (info);
+/**
+ * Queues src to be copied to dest. The copy happens with brasero_xfer_run ().
+ */
 
-			g_set_error (error,
-				     BRASERO_BURN_ERROR,
-				     BRASERO_BURN_ERROR_GENERAL,
-				     _("Directory could not be created (%s)"),
-				     g_strerror (errsv));
-			return FALSE;
-		}
+void
+brasero_xfer_add (BraseroXferCtx *ctx,
+		  GFile *src,
+		  GFile *dest)
+{
+	BraseroXferItem *item;
 
-		BRASERO_BURN_LOG ("Created directory %s", dest_path);
-		g_free (dest_path);
+	item = brasero_xfer_item_new (ctx, src, dest);
+	item->is_top = TRUE;
+	brasero_xfer_push (ctx, item);
+}
+
+/**
+ * Copies everything that was queued and blocks until it's done.
+ */
+
+gboolean
+brasero_xfer_run (BraseroXferCtx *ctx,
+		  GCancellable *cancel,
+		  GError **error)
+{
+	BraseroXferItem *item;
+	GSList *threads = NULL;
+	GSList *iter;
+	guint i;
+
+	ctx->cancel = cancel;
+
+	/* The calling thread does its share of the work */
+	for (i = 1; i < ctx->max_jobs; i ++) {
+		GThread *thread;
+
+		thread = g_thread_create (brasero_xfer_worker,
+					  ctx,
+					  TRUE,
+					  NULL);
+		if (!thread)
+			break;
 
-		result = brasero_xfer_recursive_transfer (ctx, src, dest, cancel, error);
+		threads = g_slist_prepend (threads, thread);
 	}
-	else {
-		g_file_delete (dest, cancel, NULL);
-		result = brasero_xfer_file_transfer (ctx, src, dest, cancel, error);
-		ctx->bytes_copied += g_file_info_get_size (info);
+
+	BRASERO_BURN_LOG ("Downloading with %i thread(s)", g_slist_length (threads) + 1);
+	brasero_xfer_worker (ctx);
+
+	for (iter = threads; iter; iter = iter->next)
+		g_thread_join (iter->data);
+	g_slist_free (threads);
+
+	ctx->cancel = NULL;
+
+	/* Remove what was left after an error or a cancellation */
+	while ((item = g_queue_pop_head (ctx->pending)))
+		brasero_xfer_item_free (item);
+
+	if (ctx->error) {
+		g_propagate_error (error, ctx->error);
+		ctx->error = NULL;
+		return FALSE;
 	}
 
-	g_object_unref (info);
+	return !g_cancellable_is_cancelled (cancel);
+}
 
-	return result;
+gboolean
+brasero_xfer_start (BraseroXferCtx *ctx,
+		    GFile *src,
+		    GFile *dest,
+		    GCancellable *cancel,
+		    GError **error)
+{
+	g_mutex_lock (ctx->lock);
+	ctx->total_size = 0;
+	ctx->bytes_copied = 0;
+	ctx->current_bytes_copied = 0;
+	g_mutex_unlock (ctx->lock);
+
+	brasero_xfer_add (ctx, src, dest);
+	return brasero_xfer_run (ctx, cancel, error);
 }
 
 typedef struct _BraseroXferThreadData BraseroXferThreadData;
@@ -343,8 +499,6 @@ brasero_xfer_wait (BraseroXferCtx *ctx,
 	gulong cancel_sig;
 	GThread *thread;
 
-	bzero (ctx, sizeof (BraseroXferCtx));
-
 	cancel_sig = g_signal_connect (cancel,
 				       "cancelled",
 				       G_CALLBACK (brasero_xfer_wait_cancelled_cb),
@@ -418,6 +572,10 @@ brasero_xfer_new (void)
 	BraseroXferCtx *ctx;
 
 	ctx = g_new0 (BraseroXferCtx, 1);
+	ctx->lock = g_mutex_new ();
+	ctx->cond = g_cond_new ();
+	ctx->pending = g_queue_new ();
+	ctx->max_jobs = 1;
 
 	return ctx;
 }
@@ -425,6 +583,14 @@ brasero_xfer_new (void)
 void
 brasero_xfer_free (BraseroXferCtx *ctx)
 {
+	BraseroXferItem *item;
+
+	while ((item = g_queue_pop_head (ctx->pending)))
+		brasero_xfer_item_free (item);
+
+	g_queue_free (ctx->pending);
+	g_mutex_free (ctx->lock);
+	g_cond_free (ctx->cond);
 	g_free (ctx);
 }
 
@@ -433,11 +599,14 @@ brasero_xfer_get_progress (BraseroXferCtx *ctx,
 			   goffset *written,
 			   goffset *total)
 {
+	g_mutex_lock (ctx->lock);
+
 	if (written)
 		*written = ctx->current_bytes_copied + ctx->bytes_copied;
 
 	if (total)
 		*total = ctx->total_size;
 
+	g_mutex_unlock (ctx->lock);
 	return TRUE;
 }
@@ -44,6 +44,20 @@ brasero_xfer_new (void);
 void
 brasero_xfer_free (BraseroXferCtx *ctx);
 
+void
+brasero_xfer_set_max_jobs (BraseroXferCtx *ctx,
+			   guint max_jobs);
+
+void
+brasero_xfer_add (BraseroXferCtx *ctx,
+		  GFile *src,
+		  GFile *dest);
+
+gboolean
+brasero_xfer_run (BraseroXferCtx *ctx,
+		  GCancellable *cancel,
+		  GError **error);
+
 gboolean
 brasero_xfer_start (BraseroXferCtx *ctx,
 		    GFile *src,
@@ -322,6 +322,9 @@ brasero_burn_library_stop (void)
 
 	/* Cleanup the io thing */
 	brasero_io_shutdown ();
+
+	/* Write the last debug statements */
+	brasero_burn_debug_shutdown ();
 }
 
 /**
@@ -33,6 +33,8 @@
 #  include <config.h>
 #endif
 
+#include <unistd.h>
+
 #include <glib.h>
 #include <gtk/gtk.h>
 #include "burn-dbus.h"
@@ -41,8 +43,38 @@
 #define	GS_DBUS_INHIBIT_PATH		"/org/gnome/SessionManager"
 #define	GS_DBUS_INHIBIT_INTERFACE	"org.gnome.SessionManager"
 
+#define BRASERO_DBUS_TELEMETRY_PATH		"/org/gnome/Brasero/Burn"
+#define BRASERO_DBUS_TELEMETRY_INTERFACE	"org.gnome.Brasero.Burn.Telemetry"
+
+static const gchar telemetry_xml [] =
+	"<node>"
+	"  <interface name='" BRASERO_DBUS_TELEMETRY_INTERFACE "'>"
+	"    <method name='GetTelemetry'>"
+	"      <arg type='a(sa(xttxxi))' name='channels' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+typedef struct _BraseroDBusTelemetry BraseroDBusTelemetry;
+struct _BraseroDBusTelemetry {
+	BraseroDBusTelemetryFunc func;
+	gpointer user_data;
+};
+
 static GDBusConnection *conn;
 
+/* The session bus connection is shared; keep the reference for the lifetime
+ * of the process instead of getting a new one for every call. */
+
+static GDBusConnection *
+brasero_dbus_get_connection (GError **error)
+{
+	if (!conn)
+		conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
+
+	return conn;
+}
+
 void
 brasero_uninhibit_suspend (guint cookie)
 {
@@ -54,9 +86,7 @@ brasero_uninhibit_suspend (guint cookie)
 		return;
 	}
 
-	conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
-
-	if (conn == NULL) {
+	if (brasero_dbus_get_connection (&error) == NULL) {
 		g_warning ("Couldn't get a DBUS connection: %s",
 			    error->message);
 		g_error_free (error);
@@ -95,9 +125,7 @@ brasero_inhibit_suspend (const char *reason)
 
 	g_return_val_if_fail (reason != NULL, -1);
 
-	conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
-
-	if (conn == NULL) {
+	if (brasero_dbus_get_connection (&error) == NULL) {
 		g_warning ("Couldn't get a DBUS connection: %s",
 			    error->message);
 		g_error_free (error);
@@ -133,3 +161,111 @@ brasero_inhibit_suspend (const char *reason)
 
 	return cookie;
 }
+
+static void
+brasero_dbus_telemetry_method_call (GDBusConnection *connection,
+				    const gchar *sender,
+				    const gchar *object_path,
+				    const gchar *interface_name,
+				    const gchar *method_name,
+				    GVariant *parameters,
+				    GDBusMethodInvocation *invocation,
+				    gpointer user_data)
+{
+	BraseroDBusTelemetry *telemetry = user_data;
+	GVariant *channels;
+
+	if (g_strcmp0 (method_name, "GetTelemetry")) {
+		g_dbus_method_invocation_return_error (invocation,
+						       G_DBUS_ERROR,
+						       G_DBUS_ERROR_UNKNOWN_METHOD,
+						       "Unknown method %s",
+						       method_name);
+		return;
+	}
+
+	channels = telemetry->func (telemetry->user_data);
+	g_dbus_method_invocation_return_value (invocation,
+					       g_variant_new_tuple (&channels, 1));
+}
+
+static const GDBusInterfaceVTable telemetry_vtable = {
+	brasero_dbus_telemetry_method_call,
+	NULL,
+	NULL
+};
+
+/**
+ * Exports the samples returned by @func on the session bus as
+ * /org/gnome/Brasero/Burn/<pid>_<n>. @func must return a floating
+ * GVariant of type a(sa(xttxxi)). Returns 0 on error.
+ */
+
+guint
+brasero_dbus_export_telemetry (BraseroDBusTelemetryFunc func,
+			       gpointer user_data)
+{
+	static GDBusNodeInfo *info = NULL;
+	static gboolean warned = FALSE;
+	static guint counter = 0;
+	BraseroDBusTelemetry *telemetry;
+	GError *error = NULL;
+	gchar *path;
+	guint id;
+
+	g_return_val_if_fail (func != NULL, 0);
+
+	/* This is called for every burn so only warn once when there is no
+	 * session bus */
+	if (brasero_dbus_get_connection (&error) == NULL) {
+		if (!warned)
+			g_warning ("Couldn't get a DBUS connection: %s",
+				    error->message);
+		warned = TRUE;
+		g_error_free (error);
+		return 0;
+	}
+
+	if (!info) {
+		info = g_dbus_node_info_new_for_xml (telemetry_xml, &error);
+		if (!info) {
+			g_warning ("Invalid telemetry interface: %s",
+				   error->message);
+			g_error_free (error);
+			return 0;
+		}
+	}
+
+	telemetry = g_new0 (BraseroDBusTelemetry, 1);
+	telemetry->func = func;
+	telemetry->user_data = user_data;
+
+	path = g_strdup_printf (BRASERO_DBUS_TELEMETRY_PATH "/%i_%u",
+				getpid (),
+				++ counter);
+	id = g_dbus_connection_register_object (conn,
+						path,
+						info->interfaces [0],
+						&telemetry_vtable,
+						telemetry,
+						g_free,
+						&error);
+	g_free (path);
+
+	if (!id) {
+		g_warning ("Failed to export telemetry: %s",
+			   error->message);
+		g_error_free (error);
+	}
+
+	return id;
+}
+
+void
+brasero_dbus_unexport_telemetry (guint id)
+{
+	if (!id || !conn)
+		return;
+
+	g_dbus_connection_unregister_object (conn, id);
+}
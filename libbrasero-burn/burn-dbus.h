@@ -41,3 +41,12 @@ brasero_uninhibit_suspend (guint cookie);
 gint
 brasero_inhibit_suspend (const char *reason);
 
+typedef GVariant *(*BraseroDBusTelemetryFunc) (gpointer user_data);
+
+guint
+brasero_dbus_export_telemetry (BraseroDBusTelemetryFunc func,
+			       gpointer user_data);
+
+void
+brasero_dbus_unexport_telemetry (guint id);
+
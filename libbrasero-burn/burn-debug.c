@@ -34,6 +34,8 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -48,20 +50,492 @@
 #include "brasero-burn-lib.h"
 
 static gboolean debug = FALSE;
+static gchar *trace_path = NULL;
 
 static const GOptionEntry options [] = {
 	{ "brasero-burn-debug", 'g', 0, G_OPTION_ARG_NONE, &debug,
 	  N_("Display debug statements on stdout for Brasero burn library"),
 	  NULL },
+	{ "brasero-burn-trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_path,
+	  N_("Write a binary trace of Brasero burn library events to FILE"),
+	  N_("FILE") },
 	{ NULL }
 };
 
+/**
+ * Debug statements are not written by the thread emitting them. Each thread
+ * has its own ring of records which it fills without taking any lock and a
+ * background thread empties all the rings at regular intervals, merging the
+ * records according to their timestamps before writing them to stdout and
+ * to the binary trace file if any.
+ * There is a single producer and a single consumer per ring so only the
+ * head (moved by the producer) and the tail (moved by the flusher) need to
+ * be accessed atomically.
+ * Errors are not left waiting for the flusher: the thread emitting one
+ * empties the rings itself. So are the rings when the process exits so
+ * that the last statements are not lost. Nothing is done on fatal signals
+ * since writing the records is not async-signal-safe; statements leading
+ * to a failure are normally errors and are out already.
+ */
+
+#define BRASERO_BURN_DEBUG_RING_LEN		256	/* must be a power of 2 */
+#define BRASERO_BURN_DEBUG_RECORD_LEN		240
+#define BRASERO_BURN_DEBUG_FLUSH_INTERVAL	50000	/* microseconds */
+#define BRASERO_BURN_DEBUG_FULL_RETRIES		40
+
+#define BRASERO_BURN_TRACE_MAGIC		"BRSTRACE"
+#define BRASERO_BURN_TRACE_VERSION		1
+
+typedef struct _BraseroBurnDebugRecord BraseroBurnDebugRecord;
+struct _BraseroBurnDebugRecord {
+	gint64 time;
+	const gchar *location;
+
+	/* Used when the message doesn't fit in text */
+	gchar *long_text;
+
+	BraseroBurnTraceType type;
+	gchar text [BRASERO_BURN_DEBUG_RECORD_LEN];
+};
+
+typedef struct _BraseroBurnDebugRing BraseroBurnDebugRing;
+struct _BraseroBurnDebugRing {
+	/* Only written by the thread owning the ring */
+	volatile gint head;
+
+	/* Only written by the flusher thread */
+	volatile gint tail;
+	guint limit;
+
+	volatile gint dropped;
+	volatile gint finished;
+	guint id;
+
+	BraseroBurnDebugRecord records [BRASERO_BURN_DEBUG_RING_LEN];
+};
+
+typedef struct _BraseroBurnDebugPending BraseroBurnDebugPending;
+struct _BraseroBurnDebugPending {
+	guint thread;
+	BraseroBurnDebugRecord record;
+};
+
+/* Protects the list of rings and the tails of the rings */
+G_LOCK_DEFINE_STATIC (rings_lock);
+
+/* Held while writing so that flushes don't mix their records */
+G_LOCK_DEFINE_STATIC (output_lock);
+
+static GSList *rings = NULL;
+static guint rings_num = 0;
+static GPrivate *ring_key = NULL;
+
+static GThread *flusher = NULL;
+static volatile gint flusher_stop = 0;
+static volatile gint stopped = 0;
+
+static FILE *trace_file = NULL;
+
 void
 brasero_burn_library_set_debug (gboolean value)
 {
 	debug = value;
 }
 
+static gboolean
+brasero_burn_debug_is_enabled (void)
+{
+	static gint trace_env = -1;
+
+	if (debug || trace_path)
+		return TRUE;
+
+	if (trace_env < 0) {
+		const gchar *path;
+
+		path = g_getenv ("BRASERO_BURN_TRACE");
+		trace_env = (path && path [0]);
+	}
+
+	return trace_env;
+}
+
+static void
+brasero_burn_debug_ring_release (gpointer data)
+{
+	BraseroBurnDebugRing *ring = data;
+
+	/* The thread is exiting; the ring will be freed once empty */
+	g_atomic_int_set (&ring->finished, 1);
+}
+
+static void
+brasero_burn_debug_write_trace (guint thread_id,
+				BraseroBurnDebugRecord *record,
+				const gchar *text)
+{
+	guint64 time;
+	guint32 thread;
+	guint16 type;
+	guint16 len;
+	gsize location_len;
+	gsize text_len;
+
+	location_len = strlen (record->location) + 1;
+	text_len = MIN (strlen (text), G_MAXUINT16 - location_len);
+
+	time = GUINT64_TO_LE ((guint64) record->time);
+	thread = GUINT32_TO_LE (thread_id);
+	type = GUINT16_TO_LE (record->type);
+	len = GUINT16_TO_LE (location_len + text_len);
+
+	if (fwrite (&time, sizeof (time), 1, trace_file) != 1
+	||  fwrite (&thread, sizeof (thread), 1, trace_file) != 1
+	||  fwrite (&type, sizeof (type), 1, trace_file) != 1
+	||  fwrite (&len, sizeof (len), 1, trace_file) != 1
+	||  fwrite (record->location, 1, location_len, trace_file) != location_len
+	||  fwrite (text, 1, text_len, trace_file) != text_len) {
+		g_warning ("Trace data couldn't be written");
+		fclose (trace_file);
+		trace_file = NULL;
+	}
+}
+
+static void
+brasero_burn_debug_write_record (guint thread_id,
+				 BraseroBurnDebugRecord *record)
+{
+	const gchar *text;
+
+	text = record->long_text? record->long_text:record->text;
+
+	if (debug) {
+		switch (record->type) {
+		case BRASERO_BURN_TRACE_STAGE_BEGIN:
+			printf ("BraseroBurn: (at %s) Stage started: %s\n", record->location, text);
+			break;
+		case BRASERO_BURN_TRACE_STAGE_END:
+			printf ("BraseroBurn: (at %s) Stage finished: %s\n", record->location, text);
+			break;
+		case BRASERO_BURN_TRACE_ERROR:
+			printf ("BraseroBurn: (at %s) Error: %s\n", record->location, text);
+			break;
+		default:
+			printf ("BraseroBurn: (at %s) %s\n", record->location, text);
+			break;
+		}
+	}
+
+	if (trace_file)
+		brasero_burn_debug_write_trace (thread_id, record, text);
+
+	if (record->long_text) {
+		g_free (record->long_text);
+		record->long_text = NULL;
+	}
+}
+
+static void
+brasero_burn_debug_flush (void)
+{
+	BraseroBurnDebugPending *pending = NULL;
+	GSList *dropped_list = NULL;
+	guint pending_num = 0;
+	guint pending_len = 0;
+	GSList *iter, *next;
+	guint i;
+
+	G_LOCK (output_lock);
+	G_LOCK (rings_lock);
+
+	/* Only consider what was pushed until now so as not to be kept
+	 * busy by a thread logging continuously */
+	for (iter = rings; iter; iter = iter->next) {
+		BraseroBurnDebugRing *ring = iter->data;
+		ring->limit = g_atomic_int_get (&ring->head);
+		pending_len += ring->limit - (guint) ring->tail;
+	}
+
+	/* The records are copied so that they are written once the lock is
+	 * released; otherwise a thread creating its ring would wait for the
+	 * output. */
+	if (pending_len)
+		pending = g_new (BraseroBurnDebugPending, pending_len);
+
+	/* Merge all the rings in the order of the timestamps */
+	while (1) {
+		BraseroBurnDebugRecord *oldest = NULL;
+		BraseroBurnDebugRing *oldest_ring = NULL;
+
+		for (iter = rings; iter; iter = iter->next) {
+			BraseroBurnDebugRecord *record;
+			BraseroBurnDebugRing *ring;
+
+			ring = iter->data;
+			if ((guint) ring->tail == ring->limit)
+				continue;
+
+			record = ring->records + ((guint) ring->tail & (BRASERO_BURN_DEBUG_RING_LEN - 1));
+			if (!oldest || record->time < oldest->time) {
+				oldest = record;
+				oldest_ring = ring;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		/* long_text now belongs to the copy */
+		pending [pending_num].thread = oldest_ring->id;
+		pending [pending_num].record = *oldest;
+		oldest->long_text = NULL;
+		pending_num ++;
+
+		/* This gives the slot back to the thread owning the ring */
+		g_atomic_int_set (&oldest_ring->tail, (gint) ((guint) oldest_ring->tail + 1));
+	}
+
+	for (iter = rings; iter; iter = next) {
+		BraseroBurnDebugRing *ring;
+		gint dropped;
+
+		ring = iter->data;
+		next = iter->next;
+
+		dropped = g_atomic_int_get (&ring->dropped);
+		if (dropped) {
+			g_atomic_int_exchange_and_add (&ring->dropped, - dropped);
+			if (debug)
+				dropped_list = g_slist_prepend (dropped_list,
+								g_strdup_printf ("BraseroBurn: %i debug statements were dropped (thread %u)\n",
+										 dropped,
+										 ring->id));
+		}
+
+		if (g_atomic_int_get (&ring->finished)
+		&&  g_atomic_int_get (&ring->head) == ring->tail) {
+			rings = g_slist_delete_link (rings, iter);
+			g_free (ring);
+		}
+	}
+
+	G_UNLOCK (rings_lock);
+
+	for (i = 0; i < pending_num; i ++)
+		brasero_burn_debug_write_record (pending [i].thread, &pending [i].record);
+
+	g_free (pending);
+
+	dropped_list = g_slist_reverse (dropped_list);
+	for (iter = dropped_list; iter; iter = iter->next)
+		fputs (iter->data, stdout);
+
+	g_slist_foreach (dropped_list, (GFunc) g_free, NULL);
+	g_slist_free (dropped_list);
+
+	if (debug)
+		fflush (stdout);
+
+	if (trace_file)
+		fflush (trace_file);
+
+	G_UNLOCK (output_lock);
+}
+
+static void
+brasero_burn_debug_exit (void)
+{
+	brasero_burn_debug_flush ();
+}
+
+static gpointer
+brasero_burn_debug_flusher (gpointer data)
+{
+	while (!g_atomic_int_get (&flusher_stop)) {
+		g_usleep (BRASERO_BURN_DEBUG_FLUSH_INTERVAL);
+		brasero_burn_debug_flush ();
+	}
+
+	/* Empty what was left */
+	brasero_burn_debug_flush ();
+	return NULL;
+}
+
+static void
+brasero_burn_debug_open_trace (void)
+{
+	const gchar *path;
+	guint32 version;
+
+	path = trace_path? trace_path:g_getenv ("BRASERO_BURN_TRACE");
+	if (!path || !path [0])
+		return;
+
+	trace_file = fopen (path, "wb");
+	if (!trace_file) {
+		g_warning ("Trace file %s couldn't be opened: %s", path, g_strerror (errno));
+		return;
+	}
+
+	version = GUINT32_TO_LE (BRASERO_BURN_TRACE_VERSION);
+	if (fwrite (BRASERO_BURN_TRACE_MAGIC, 1, 8, trace_file) != 8
+	||  fwrite (&version, sizeof (version), 1, trace_file) != 1) {
+		g_warning ("Trace file %s couldn't be written", path);
+		fclose (trace_file);
+		trace_file = NULL;
+	}
+}
+
+static BraseroBurnDebugRing *
+brasero_burn_debug_get_ring (void)
+{
+	BraseroBurnDebugRing *ring;
+
+	/* Threads may not be initialized yet; in this case messages are
+	 * written synchronously */
+	if (!g_thread_supported ())
+		return NULL;
+
+	/* Nobody would empty the ring any more */
+	if (g_atomic_int_get (&stopped))
+		return NULL;
+
+	if (ring_key) {
+		ring = g_private_get (ring_key);
+		if (ring)
+			return ring;
+	}
+
+	G_LOCK (rings_lock);
+
+	if (stopped) {
+		G_UNLOCK (rings_lock);
+		return NULL;
+	}
+
+	if (!ring_key)
+		ring_key = g_private_new (brasero_burn_debug_ring_release);
+
+	if (!flusher) {
+		brasero_burn_debug_open_trace ();
+		flusher = g_thread_create (brasero_burn_debug_flusher,
+					   NULL,
+					   TRUE,
+					   NULL);
+		if (!flusher) {
+			G_UNLOCK (rings_lock);
+			return NULL;
+		}
+
+		/* Hosts don't always call brasero_burn_debug_shutdown () */
+		atexit (brasero_burn_debug_exit);
+	}
+
+	ring = g_new0 (BraseroBurnDebugRing, 1);
+	ring->id = rings_num ++;
+	rings = g_slist_prepend (rings, ring);
+
+	G_UNLOCK (rings_lock);
+
+	g_private_set (ring_key, ring);
+	return ring;
+}
+
+static void
+brasero_burn_debug_push (BraseroBurnTraceType type,
+			 const gchar *location,
+			 const gchar *format,
+			 va_list arg_list)
+{
+	BraseroBurnDebugRecord *record;
+	BraseroBurnDebugRing *ring;
+	va_list arg_copy;
+	guint retries;
+	guint head;
+	gint len;
+
+	ring = brasero_burn_debug_get_ring ();
+	if (!ring) {
+		if (debug) {
+			gchar *message;
+
+			message = g_strdup_vprintf (format, arg_list);
+			printf ("BraseroBurn: (at %s) %s\n", location, message);
+			g_free (message);
+		}
+		return;
+	}
+
+	/* Wait for the flusher if the ring is full but never block for long.
+	 * Errors are never dropped: the ring is emptied right away. */
+	head = ring->head;
+	for (retries = 0; head - (guint) g_atomic_int_get (&ring->tail) >= BRASERO_BURN_DEBUG_RING_LEN; retries ++) {
+		if (type == BRASERO_BURN_TRACE_ERROR) {
+			brasero_burn_debug_flush ();
+			continue;
+		}
+
+		if (retries >= BRASERO_BURN_DEBUG_FULL_RETRIES) {
+			g_atomic_int_inc (&ring->dropped);
+			return;
+		}
+
+		g_usleep (BRASERO_BURN_DEBUG_FLUSH_INTERVAL / 10);
+	}
+
+	record = ring->records + (head & (BRASERO_BURN_DEBUG_RING_LEN - 1));
+	record->time = g_get_monotonic_time ();
+	record->type = type;
+	record->location = location;
+
+	/* Arguments can't outlive this call so they are formatted now; the
+	 * rest (prefix, location, output) is left to the flusher. */
+	G_VA_COPY (arg_copy, arg_list);
+	len = g_vsnprintf (record->text, sizeof (record->text), format, arg_list);
+	if (len >= (gint) sizeof (record->text))
+		record->long_text = g_strdup_vprintf (format, arg_copy);
+	else
+		record->long_text = NULL;
+	va_end (arg_copy);
+
+	/* Publish the record */
+	g_atomic_int_set (&ring->head, (gint) (head + 1));
+
+	/* An error may well be followed by a crash */
+	if (type == BRASERO_BURN_TRACE_ERROR)
+		brasero_burn_debug_flush ();
+}
+
+/**
+ * brasero_burn_debug_shutdown:
+ *
+ * Writes all pending debug statements and stops the flusher thread.
+ **/
+void
+brasero_burn_debug_shutdown (void)
+{
+	GThread *thread;
+
+	G_LOCK (rings_lock);
+	g_atomic_int_set (&stopped, 1);
+	thread = flusher;
+	flusher = NULL;
+	G_UNLOCK (rings_lock);
+
+	if (!thread)
+		return;
+
+	g_atomic_int_set (&flusher_stop, 1);
+	g_thread_join (thread);
+
+	G_LOCK (output_lock);
+	if (trace_file) {
+		fclose (trace_file);
+		trace_file = NULL;
+	}
+	G_UNLOCK (output_lock);
+}
+
 /**
  * brasero_burn_library_get_option_group:
  *
@@ -88,7 +562,9 @@ brasero_burn_library_get_option_group (void)
 void
 brasero_burn_debug_setup_module (GModule *handle)
 {
-	if (debug)
+	/* Locations of the statements are only read by the flusher thread
+	 * so the module must not be unloaded */
+	if (brasero_burn_debug_is_enabled ())
 		g_module_make_resident (handle);
 }
 
@@ -98,20 +574,16 @@ brasero_burn_debug_message (const gchar *location,
 			    ...)
 {
 	va_list arg_list;
-	gchar *format_real;
 
-	if (!debug)
+	if (!brasero_burn_debug_is_enabled ())
 		return;
 
-	format_real = g_strdup_printf ("BraseroBurn: (at %s) %s\n",
-				       location,
-				       format);
-
 	va_start (arg_list, format);
-	vprintf (format_real, arg_list);
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_MESSAGE,
+				 location,
+				 format,
+				 arg_list);
 	va_end (arg_list);
-
-	g_free (format_real);
 }
 
 void
@@ -119,17 +591,64 @@ brasero_burn_debug_messagev (const gchar *location,
 			     const gchar *format,
 			     va_list arg_list)
 {
-	gchar *format_real;
+	if (!brasero_burn_debug_is_enabled ())
+		return;
+
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_MESSAGE,
+				 location,
+				 format,
+				 arg_list);
+}
+
+void
+brasero_burn_debug_error (const gchar *location,
+			  const gchar *format,
+			  ...)
+{
+	va_list arg_list;
 
-	if (!debug)
+	if (!brasero_burn_debug_is_enabled ())
 		return;
 
-	format_real = g_strdup_printf ("BraseroBurn: (at %s) %s\n",
-				       location,
-				       format);
+	va_start (arg_list, format);
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_ERROR,
+				 location,
+				 format,
+				 arg_list);
+	va_end (arg_list);
+}
 
-	vprintf (format_real, arg_list);
-	g_free (format_real);
+void
+brasero_burn_debug_errorv (const gchar *location,
+			   const gchar *format,
+			   va_list arg_list)
+{
+	if (!brasero_burn_debug_is_enabled ())
+		return;
+
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_ERROR,
+				 location,
+				 format,
+				 arg_list);
+}
+
+void
+brasero_burn_debug_stage (BraseroBurnTraceType type,
+			  const gchar *location,
+			  const gchar *format,
+			  ...)
+{
+	va_list arg_list;
+
+	if (!brasero_burn_debug_is_enabled ())
+		return;
+
+	va_start (arg_list, format);
+	brasero_burn_debug_push (type,
+				 location,
+				 format,
+				 arg_list);
+	va_end (arg_list);
 }
 
 static void
@@ -176,18 +695,20 @@ brasero_burn_debug_flags_type_message (BraseroBurnFlag flags,
 	gchar *format_real;
 	va_list arg_list;
 
-	if (!debug)
+	if (!brasero_burn_debug_is_enabled ())
 		return;
 
 	brasero_debug_burn_flags_to_string (buffer, flags);
 
-	format_real = g_strdup_printf ("BraseroBurn: (at %s) %s %s\n",
-				       location,
+	format_real = g_strdup_printf ("%s %s",
 				       format,
 				       buffer);
 
 	va_start (arg_list, format);
-	vprintf (format_real, arg_list);
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_MESSAGE,
+				 location,
+				 format_real,
+				 arg_list);
 	va_end (arg_list);
 
 	g_free (format_real);
@@ -279,7 +800,7 @@ brasero_burn_debug_track_type_struct_message (BraseroTrackType *type,
 	gchar *format_real;
 	va_list arg_list;
 
-	if (!debug)
+	if (!brasero_burn_debug_is_enabled ())
 		return;
 
 	if (brasero_track_type_get_has_data (type)) {
@@ -319,13 +840,15 @@ brasero_burn_debug_track_type_struct_message (BraseroTrackType *type,
 	else
 		strcpy (buffer, "Undefined");
 
-	format_real = g_strdup_printf ("BraseroBurn: (at %s) %s %s\n",
-				       location,
+	format_real = g_strdup_printf ("%s %s",
 				       format,
 				       buffer);
 
 	va_start (arg_list, format);
-	vprintf (format_real, arg_list);
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_MESSAGE,
+				 location,
+				 format_real,
+				 arg_list);
 	va_end (arg_list);
 
 	g_free (format_real);
@@ -343,7 +866,7 @@ brasero_burn_debug_track_type_message (BraseroTrackDataType type,
 	gchar *format_real;
 	va_list arg_list;
 
-	if (!debug)
+	if (!brasero_burn_debug_is_enabled ())
 		return;
 
 	switch (type) {
@@ -386,13 +909,15 @@ brasero_burn_debug_track_type_message (BraseroTrackDataType type,
 		break;
 	}
 
-	format_real = g_strdup_printf ("BraseroBurn: (at %s) %s %s\n",
-				       location,
+	format_real = g_strdup_printf ("%s %s",
 				       format,
 				       buffer);
 
 	va_start (arg_list, format);
-	vprintf (format_real, arg_list);
+	brasero_burn_debug_push (BRASERO_BURN_TRACE_MESSAGE,
+				 location,
+				 format_real,
+				 arg_list);
 	va_end (arg_list);
 
 	g_free (format_real);
@@ -42,6 +42,45 @@
 
 G_BEGIN_DECLS
 
+/**
+ * Debug statements can be filtered at compile time (see the configure
+ * option --with-debug-log-level):
+ * - none removes all of them, including those of the jobs (BRASERO_JOB_LOG)
+ *   which also go to the session log
+ * - debug keeps them all (default)
+ */
+#define BRASERO_BURN_LOG_LEVEL_NONE		0
+#define BRASERO_BURN_LOG_LEVEL_DEBUG		1
+
+#ifndef BRASERO_BURN_LOG_LEVEL
+#define BRASERO_BURN_LOG_LEVEL			BRASERO_BURN_LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * Types of records in a binary trace (see --brasero-burn-trace option or
+ * BRASERO_BURN_TRACE environment variable).
+ * A trace file starts with the 8 bytes "BRSTRACE" followed by the version
+ * of the format (32 bits). Then each record is made of:
+ * - the time in microseconds of a monotonic clock (64 bits)
+ * - the number of the thread that emitted the record (32 bits)
+ * - its type (16 bits, one of the values below)
+ * - the length of its data (16 bits)
+ * - the data: the location in the code (NUL terminated) followed by the
+ *   message or the name of the stage (not NUL terminated).
+ * All integers are little endian. Matching the STAGE_BEGIN and STAGE_END
+ * records with the same name and thread gives a timeline of the stages
+ * a burning session went through. ERROR records are messages that were
+ * written out as soon as they were emitted.
+ */
+typedef enum {
+	BRASERO_BURN_TRACE_MESSAGE		= 0,
+	BRASERO_BURN_TRACE_STAGE_BEGIN		= 1,
+	BRASERO_BURN_TRACE_STAGE_END		= 2,
+	BRASERO_BURN_TRACE_ERROR		= 3
+} BraseroBurnTraceType;
+
+#if BRASERO_BURN_LOG_LEVEL >= BRASERO_BURN_LOG_LEVEL_DEBUG
+
 #define BRASERO_BURN_LOG(format, ...)						\
 		brasero_burn_debug_message (G_STRLOC,				\
 					    format,				\
@@ -52,6 +91,11 @@ G_BEGIN_DECLS
 					     format,		\
 					     args_list);
 
+#define BRASERO_BURN_LOG_ERROR(format, ...)					\
+		brasero_burn_debug_error (G_STRLOC,				\
+					  format,				\
+					  ##__VA_ARGS__);
+
 #define BRASERO_BURN_LOG_DISC_TYPE(media_MACRO, format, ...)	\
 		BRASERO_BURN_LOG_WITH_FULL_TYPE (BRASERO_TRACK_TYPE_DISC,	\
 						 media_MACRO,	\
@@ -87,6 +131,33 @@ G_BEGIN_DECLS
 						       format,					\
 						       ##__VA_ARGS__);
 
+#define BRASERO_BURN_LOG_STAGE_BEGIN(format, ...)				\
+		brasero_burn_debug_stage (BRASERO_BURN_TRACE_STAGE_BEGIN,	\
+					  G_STRLOC,				\
+					  format,				\
+					  ##__VA_ARGS__);
+
+#define BRASERO_BURN_LOG_STAGE_END(format, ...)				\
+		brasero_burn_debug_stage (BRASERO_BURN_TRACE_STAGE_END,		\
+					  G_STRLOC,				\
+					  format,				\
+					  ##__VA_ARGS__);
+
+#else
+
+#define BRASERO_BURN_LOG(format, ...)
+#define BRASERO_BURN_LOGV(format, args_list)
+#define BRASERO_BURN_LOG_ERROR(format, ...)
+#define BRASERO_BURN_LOG_DISC_TYPE(media_MACRO, format, ...)
+#define BRASERO_BURN_LOG_FLAGS(flags_MACRO, format, ...)
+#define BRASERO_BURN_LOG_TYPE(type_MACRO, format, ...)
+#define BRASERO_BURN_LOG_WITH_TYPE(type_MACRO, flags_MACRO, format, ...)
+#define BRASERO_BURN_LOG_WITH_FULL_TYPE(type_MACRO, subtype_MACRO, flags_MACRO, format, ...)
+#define BRASERO_BURN_LOG_STAGE_BEGIN(format, ...)
+#define BRASERO_BURN_LOG_STAGE_END(format, ...)
+
+#endif
+
 void
 brasero_burn_library_set_debug (gboolean value);
 
@@ -121,6 +192,25 @@ brasero_burn_debug_messagev (const gchar *location,
 			     const gchar *format,
 			     va_list args);
 
+void
+brasero_burn_debug_error (const gchar *location,
+			  const gchar *format,
+			  ...);
+
+void
+brasero_burn_debug_errorv (const gchar *location,
+			   const gchar *format,
+			   va_list args);
+
+void
+brasero_burn_debug_stage (BraseroBurnTraceType type,
+			  const gchar *location,
+			  const gchar *format,
+			  ...);
+
+void
+brasero_burn_debug_shutdown (void);
+
 G_END_DECLS
 
 #endif /* _BURN_DEBUG_H */
@@ -0,0 +1,461 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+
+#include "brasero-error.h"
+
+#include "burn-debug.h"
+#include "burn-fanout.h"
+
+/* An image is read once into a ring of chunks and each chunk is written to
+ * every output (a pipe feeding a recorder). A chunk can only be refilled
+ * once all the outputs that were alive when it was filled have written it;
+ * that count acts as a reference count on the chunk. This way the slowest
+ * drive throttles the reader while the others can still run ahead by up to
+ * the size of the ring. An output whose reader went away (drive error or
+ * cancellation) drops its references and no longer holds anyone back. */
+
+typedef struct _BraseroFanoutChunk BraseroFanoutChunk;
+struct _BraseroFanoutChunk {
+	guchar *data;
+	gsize size;
+
+	/* outputs that still have to write this chunk */
+	guint pending;
+};
+
+typedef struct _BraseroFanoutOutput BraseroFanoutOutput;
+struct _BraseroFanoutOutput {
+	BraseroFanout *fanout;
+
+	/* write end of the pipe; the read end is given to the recorder */
+	int fd;
+
+	/* number of the next chunk to write */
+	guint64 position;
+
+	guint dead:1;
+};
+
+struct _BraseroFanout {
+	gint ref;
+
+	GMutex *lock;
+	GCond *cond;
+
+	int fd;
+	gint read_errno;
+
+	BraseroFanoutChunk chunks [BRASERO_FANOUT_CHUNKS];
+
+	/* number of chunks read so far */
+	guint64 produced;
+
+	GSList *outputs;
+	guint alive;
+
+	guint started:1;
+	guint eof:1;
+	guint cancel:1;
+};
+
+BraseroFanout *
+brasero_fanout_new (const gchar *path,
+		    GError **error)
+{
+	BraseroFanout *fanout;
+	int fd;
+	gint i;
+
+	fd = open (path, O_RDONLY);
+	if (fd < 0) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("File \"%s\" could not be opened (%s)"),
+			     path,
+			     g_strerror (errsv));
+		return NULL;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	fanout = g_new0 (BraseroFanout, 1);
+	fanout->ref = 1;
+	fanout->fd = fd;
+	fanout->lock = g_mutex_new ();
+	fanout->cond = g_cond_new ();
+
+	for (i = 0; i < BRASERO_FANOUT_CHUNKS; i ++)
+		fanout->chunks [i].data = g_malloc (BRASERO_FANOUT_CHUNK_SIZE);
+
+	return fanout;
+}
+
+BraseroFanout *
+brasero_fanout_ref (BraseroFanout *fanout)
+{
+	g_return_val_if_fail (fanout != NULL, NULL);
+
+	g_atomic_int_inc (&fanout->ref);
+	return fanout;
+}
+
+static void
+brasero_fanout_output_free (BraseroFanoutOutput *output)
+{
+	if (output->fd >= 0)
+		close (output->fd);
+
+	g_free (output);
+}
+
+void
+brasero_fanout_unref (BraseroFanout *fanout)
+{
+	gint i;
+
+	g_return_if_fail (fanout != NULL);
+
+	if (!g_atomic_int_dec_and_test (&fanout->ref))
+		return;
+
+	g_slist_foreach (fanout->outputs,
+			 (GFunc) brasero_fanout_output_free,
+			 NULL);
+	g_slist_free (fanout->outputs);
+
+	for (i = 0; i < BRASERO_FANOUT_CHUNKS; i ++)
+		g_free (fanout->chunks [i].data);
+
+	if (fanout->fd >= 0)
+		close (fanout->fd);
+
+	g_cond_free (fanout->cond);
+	g_mutex_free (fanout->lock);
+	g_free (fanout);
+}
+
+/**
+ * Returns the read end of a new pipe that will receive the whole image.
+ * The caller owns it. Must be called before brasero_fanout_start ().
+ */
+
+int
+brasero_fanout_add_output (BraseroFanout *fanout,
+			   GError **error)
+{
+	BraseroFanoutOutput *output;
+	int fd [2];
+
+	g_return_val_if_fail (fanout != NULL, -1);
+	g_return_val_if_fail (!fanout->started, -1);
+
+	if (pipe (fd)) {
+		int errsv = errno;
+
+		BRASERO_BURN_LOG ("A pipe couldn't be created");
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("An internal error occurred (%s)"),
+			     g_strerror (errsv));
+		return -1;
+	}
+
+	output = g_new0 (BraseroFanoutOutput, 1);
+	output->fanout = fanout;
+	output->fd = fd [1];
+
+	fanout->outputs = g_slist_append (fanout->outputs, output);
+	fanout->alive ++;
+
+	return fd [0];
+}
+
+/* Must be called with the lock held */
+static void
+brasero_fanout_output_release (BraseroFanoutOutput *output)
+{
+	BraseroFanout *fanout = output->fanout;
+	guint64 i;
+
+	/* Give back the references on all the chunks still to be written */
+	for (i = output->position; i < fanout->produced; i ++)
+		fanout->chunks [i % BRASERO_FANOUT_CHUNKS].pending --;
+
+	output->position = fanout->produced;
+	output->dead = TRUE;
+	fanout->alive --;
+
+	g_cond_broadcast (fanout->cond);
+}
+
+static gboolean
+brasero_fanout_write (int fd,
+		      const guchar *buffer,
+		      gsize size)
+{
+	while (size > 0) {
+		gssize written;
+
+		written = write (fd, buffer, size);
+		if (written < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+
+			return FALSE;
+		}
+
+		buffer += written;
+		size -= written;
+	}
+
+	return TRUE;
+}
+
+static gpointer
+brasero_fanout_output_thread (gpointer data)
+{
+	BraseroFanoutOutput *output = data;
+	BraseroFanout *fanout = output->fanout;
+	sigset_t set;
+
+	/* A recorder that stops reading closes its end of the pipe. Make sure
+	 * that only gives us EPIPE and doesn't kill the whole process. */
+	sigemptyset (&set);
+	sigaddset (&set, SIGPIPE);
+	pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+	g_mutex_lock (fanout->lock);
+	while (1) {
+		BraseroFanoutChunk *chunk;
+		gboolean success;
+
+		while (output->position == fanout->produced
+		&&    !fanout->eof
+		&&    !fanout->cancel)
+			g_cond_wait (fanout->cond, fanout->lock);
+
+		if (fanout->cancel)
+			break;
+
+		if (output->position == fanout->produced)
+			break;
+
+		/* The chunk can't be refilled while we hold a reference */
+		chunk = fanout->chunks + (output->position % BRASERO_FANOUT_CHUNKS);
+		g_mutex_unlock (fanout->lock);
+
+		success = brasero_fanout_write (output->fd, chunk->data, chunk->size);
+
+		g_mutex_lock (fanout->lock);
+		if (!success) {
+			BRASERO_BURN_LOG ("Output of image stopped (%s)", g_strerror (errno));
+			break;
+		}
+
+		output->position ++;
+		chunk->pending --;
+		if (!chunk->pending)
+			g_cond_broadcast (fanout->cond);
+	}
+
+	brasero_fanout_output_release (output);
+
+	/* Closing our end tells the recorder there is nothing more to come */
+	close (output->fd);
+	output->fd = -1;
+
+	g_mutex_unlock (fanout->lock);
+
+	brasero_fanout_unref (fanout);
+	return NULL;
+}
+
+static gpointer
+brasero_fanout_read_thread (gpointer data)
+{
+	BraseroFanout *fanout = data;
+
+	g_mutex_lock (fanout->lock);
+	while (1) {
+		BraseroFanoutChunk *chunk;
+		gsize size = 0;
+		gint errsv = 0;
+
+		chunk = fanout->chunks + (fanout->produced % BRASERO_FANOUT_CHUNKS);
+		while (chunk->pending
+		&&     fanout->alive
+		&&    !fanout->cancel)
+			g_cond_wait (fanout->cond, fanout->lock);
+
+		if (fanout->cancel || !fanout->alive)
+			break;
+
+		/* Nobody references this chunk so it can be filled unlocked */
+		g_mutex_unlock (fanout->lock);
+
+		while (size < BRASERO_FANOUT_CHUNK_SIZE) {
+			gssize bytes;
+
+			bytes = read (fanout->fd,
+				      chunk->data + size,
+				      BRASERO_FANOUT_CHUNK_SIZE - size);
+			if (bytes < 0) {
+				if (errno == EINTR)
+					continue;
+
+				errsv = errno;
+				break;
+			}
+
+			if (!bytes)
+				break;
+
+			size += bytes;
+		}
+
+		g_mutex_lock (fanout->lock);
+		fanout->read_errno = errsv;
+		if (size) {
+			chunk->size = size;
+			chunk->pending = fanout->alive;
+			fanout->produced ++;
+			g_cond_broadcast (fanout->cond);
+		}
+
+		if (size < BRASERO_FANOUT_CHUNK_SIZE)
+			break;
+	}
+
+	if (fanout->read_errno)
+		BRASERO_BURN_LOG ("Image could not be read (%s)", g_strerror (fanout->read_errno));
+
+	/* A read error ends the stream early; recorders will complain about
+	 * the missing data and brasero_fanout_get_error () tells why. */
+	fanout->eof = TRUE;
+	g_cond_broadcast (fanout->cond);
+	g_mutex_unlock (fanout->lock);
+
+	brasero_fanout_unref (fanout);
+	return NULL;
+}
+
+gboolean
+brasero_fanout_start (BraseroFanout *fanout,
+		      GError **error)
+{
+	GSList *iter;
+
+	g_return_val_if_fail (fanout != NULL, FALSE);
+	g_return_val_if_fail (!fanout->started, FALSE);
+
+	fanout->started = TRUE;
+
+	/* Each thread holds a reference and drops it when it is done */
+	for (iter = fanout->outputs; iter; iter = iter->next) {
+		BraseroFanoutOutput *output = iter->data;
+
+		brasero_fanout_ref (fanout);
+		if (!g_thread_create (brasero_fanout_output_thread,
+				      output,
+				      FALSE,
+				      error)) {
+			brasero_fanout_unref (fanout);
+			brasero_fanout_cancel (fanout);
+			return FALSE;
+		}
+	}
+
+	brasero_fanout_ref (fanout);
+	if (!g_thread_create (brasero_fanout_read_thread,
+			      fanout,
+			      FALSE,
+			      error)) {
+		brasero_fanout_unref (fanout);
+		brasero_fanout_cancel (fanout);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+brasero_fanout_cancel (BraseroFanout *fanout)
+{
+	g_return_if_fail (fanout != NULL);
+
+	g_mutex_lock (fanout->lock);
+	fanout->cancel = TRUE;
+	g_cond_broadcast (fanout->cond);
+	g_mutex_unlock (fanout->lock);
+}
+
+gboolean
+brasero_fanout_get_error (BraseroFanout *fanout,
+			  GError **error)
+{
+	gint errsv;
+
+	g_return_val_if_fail (fanout != NULL, FALSE);
+
+	g_mutex_lock (fanout->lock);
+	errsv = fanout->read_errno;
+	g_mutex_unlock (fanout->lock);
+
+	if (!errsv)
+		return FALSE;
+
+	g_set_error (error,
+		     BRASERO_BURN_ERROR,
+		     BRASERO_BURN_ERROR_GENERAL,
+		     _("Data could not be read (%s)"),
+		     g_strerror (errsv));
+	return TRUE;
+}
@@ -0,0 +1,72 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BURN_FANOUT_H
+#define _BURN_FANOUT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The ring holds BRASERO_FANOUT_CHUNKS * BRASERO_FANOUT_CHUNK_SIZE bytes.
+ * That is how far the fastest output may get ahead of the slowest one. */
+#define BRASERO_FANOUT_CHUNK_SIZE	(256 * 1024)
+#define BRASERO_FANOUT_CHUNKS		64
+
+typedef struct _BraseroFanout BraseroFanout;
+
+BraseroFanout *
+brasero_fanout_new (const gchar *path,
+		    GError **error);
+
+BraseroFanout *
+brasero_fanout_ref (BraseroFanout *fanout);
+
+void
+brasero_fanout_unref (BraseroFanout *fanout);
+
+int
+brasero_fanout_add_output (BraseroFanout *fanout,
+			   GError **error);
+
+gboolean
+brasero_fanout_start (BraseroFanout *fanout,
+		      GError **error);
+
+void
+brasero_fanout_cancel (BraseroFanout *fanout);
+
+gboolean
+brasero_fanout_get_error (BraseroFanout *fanout,
+			  GError **error);
+
+G_END_DECLS
+
+#endif /* _BURN_FANOUT_H */
@@ -42,6 +42,8 @@
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 
+#include <gio/gio.h>
+
 #include "burn-basics.h"
 #include "burn-debug.h"
 #include "burn-image-format.h"
@@ -75,7 +77,7 @@ brasero_image_format_read_path (const gchar *ptr,
 		/* there is no starting '"' seek last space */
 		start = ptr;
 		end = ptr;
-		while (!isspace (*end)) end ++;
+		while (*end && !isspace (*end)) end ++;
 
 		ptr = end;
 		if (isspace (*end))
@@ -88,139 +90,6 @@ brasero_image_format_read_path (const gchar *ptr,
 	return ptr;
 }
 
-static gchar *
-brasero_image_format_get_cue_file_complement (const gchar *path)
-{
-	FILE *file;
-	gchar *ptr;
-	gchar *complement = NULL;
-	/* a path can't be over MAXPATHLEN then buffer doesn't need to be over
-	 * this value + 4 + white space + commas */
-	gchar buffer [MAXPATHLEN+8+3];
-
-	file = fopen (path, "r");
-	if (!file) {
-		if (g_str_has_suffix (path, ".cue"))
-			return g_strdup_printf ("%.*sbin",
-						(int) strlen (path) - 3,
-						path);
-
-		return g_strdup_printf ("%s.bin", path);
-	}
-
-	while (fgets (buffer, sizeof (buffer), file)) {
-		ptr = strstr (buffer, "FILE");
-		if (ptr) {
-			ptr += 4;
-			if (brasero_image_format_read_path (ptr, &complement))
-				break;
-		}
-	}
-	fclose (file);
-
-	/* check if the path is relative, if so then add the root path */
-	if (complement && !g_path_is_absolute (complement)) {
-		gchar *directory;
-		gchar *tmp;
-
-		directory = g_path_get_dirname (path);
-
-		tmp = complement;
-		complement = g_build_path (G_DIR_SEPARATOR_S,
-					   directory,
-					   complement,
-					   NULL);
-		g_free (tmp);
-	}
-
-	return complement;
-}
-
-static gchar *
-brasero_image_format_get_toc_file_complement (const gchar *path)
-{
-	FILE *file;
-	gchar *ptr;
-	gchar *complement = NULL;
-	/* a path can't be over MAXPATHLEN then buffer doesn't need to be over
-	 * this value + keyword size + white space + commas */
-	gchar buffer [MAXPATHLEN+8+3];
-
-	/* NOTE: the problem here is that cdrdao files can have references to 
-	 * multiple files. Which is great but not for us ... */
-	file = fopen (path, "r");
-	if (!file) {
-		if (g_str_has_suffix (path, ".cue"))
-			return g_strdup_printf ("%.*sbin",
-						(int) strlen (path) - 3,
-						path);
-
-		return g_strdup_printf ("%s.bin", path);
-	}
-
-	while (fgets (buffer, sizeof (buffer), file)) {
-		ptr = strstr (buffer, "DATAFILE");
-		if (ptr) {
-			ptr += 8;
-			if (brasero_image_format_read_path (ptr, &complement))
-				break;
-		}
-
-		ptr = strstr (buffer, "FILE");
-		if (ptr) {
-			ptr += 4;
-			if (brasero_image_format_read_path (ptr, &complement))
-				break;
-		}
-	}
-	fclose (file);
-
-	/* check if the path is relative, if so then add the root path */
-	if (complement && !g_path_is_absolute (complement)) {
-		gchar *directory;
-		gchar *tmp;
-
-		directory = g_path_get_dirname (path);
-
-		tmp = complement;
-		complement = g_build_path (G_DIR_SEPARATOR_S,
-					   directory,
-					   complement,
-					   NULL);
-		g_free (tmp);
-	}
-
-	return complement;
-}
-
-/* FIXME this function is flawed at the moment. A cue file or toc file can 
- * hold different paths */
-gchar *
-brasero_image_format_get_complement (BraseroImageFormat format,
-				     const gchar *path)
-{
-	gchar *retval = NULL;
-
-	if (format == BRASERO_IMAGE_FORMAT_CLONE) {
-		/* These are set rules no need to parse:
-		 * the toc file has to end with .toc suffix */
-		if (g_str_has_suffix (path, ".toc"))
-			retval = g_strndup (path, strlen (path) - 4);
-	}
-	else if (format == BRASERO_IMAGE_FORMAT_CUE) {
-		/* need to parse */
-		retval = brasero_image_format_get_cue_file_complement (path);
-	}
-	else if (format == BRASERO_IMAGE_FORMAT_CDRDAO) {
-		/* need to parse */
-		retval = brasero_image_format_get_toc_file_complement (path);
-	}
-	else
-		retval = NULL;
-
-	return retval;
-}
-
 static gchar *
 brasero_image_format_get_MSF_address (const gchar *ptr,
 				      gint64 *block)
@@ -229,7 +98,7 @@ brasero_image_format_get_MSF_address (const gchar *ptr,
 	gint64 address = 0;
 
 	address = strtoll (ptr, &next, 10); 
-	if (isspace (*next)) {
+	if (isspace (*next) || *next == '\0') {
 		*block = address;
 		return next;
 	}
@@ -260,252 +129,587 @@ brasero_image_format_get_MSF_address (const gchar *ptr,
 	return next;	
 }
 
-static gboolean
-brasero_image_format_get_DATAFILE_info (const gchar *ptr,
-					GFile *parent,
-					gint64 *size_file,
-					GError **error)
-{
-	gchar *path = NULL;
-	GFileInfo *info;
-	GFile *file;
-
-	/* get the path. NOTE: no need to check if it's relative since that's
-	 * just to skip it. */
-	ptr = brasero_image_format_read_path (ptr, &path);
-	if (!ptr)
-		return FALSE;
+/**
+ * Cue and toc sheets are parsed once into a BraseroImageSheet. Sheets are
+ * kept in a cache (by URI) as long as someone holds a reference to them and
+ * the sheet file was not modified (mtime and size) since it was parsed.
+ * The sizes of the files they refer to are queried on demand and kept along
+ * with their mtime; they are checked again whenever the sheet is looked up.
+ */
 
-	/* skip white spaces */
-	while (isspace (*ptr)) ptr++;
+G_LOCK_DEFINE_STATIC (sheets_lock);
+static GHashTable *sheets = NULL;
 
-	if (ptr [0] == '\0'
-	|| (ptr [0] == '/' && ptr [1] == '/'))
-		goto stat_end;
+static BraseroImageFormat
+brasero_image_sheet_identify_line (const gchar *line)
+{
+	/* Keywords for cdrdao cuesheets */
+	if (strstr (line, "CD_ROM_XA")
+	||  strstr (line, "CD_ROM")
+	||  strstr (line, "CD_DA")
+	||  strstr (line, "CD_TEXT"))
+		return BRASERO_IMAGE_FORMAT_CDRDAO;
+
+	if (strstr (line, "TRACK")) {
+		/* NOTE: there is also "AUDIO" but it's common to both */
+
+		/* CDRDAO */
+		if (strstr (line, "MODE1")
+		||  strstr (line, "MODE1_RAW")
+		||  strstr (line, "MODE2_FORM1")
+		||  strstr (line, "MODE2_FORM2")
+		||  strstr (line, "MODE_2_RAW")
+		||  strstr (line, "MODE2_FORM_MIX")
+		||  strstr (line, "MODE2")) {
+			/* Careful: "MODE1/2048" is a .cue mode */
+			if (!strstr (line, "/"))
+				return BRASERO_IMAGE_FORMAT_CDRDAO;
+		}
 
-	if (!brasero_image_format_get_MSF_address (ptr, size_file)) {
-		g_free (path);
-		return FALSE;
+		/* .CUE file */
+		if (strstr (line, "CDG")
+		||  strstr (line, "MODE1/2048")
+		||  strstr (line, "MODE1/2352")
+		||  strstr (line, "MODE2/2336")
+		||  strstr (line, "MODE2/2352")
+		||  strstr (line, "CDI/2336")
+		||  strstr (line, "CDI/2352"))
+			return BRASERO_IMAGE_FORMAT_CUE;
+	}
+	else if (strstr (line, "FILE")) {
+		if (strstr (line, "MOTOROLA")
+		||  strstr (line, "BINARY")
+		||  strstr (line, "AIFF")
+		||  strstr (line, "WAVE")
+		||  strstr (line, "MP3"))
+			return BRASERO_IMAGE_FORMAT_CUE;
 	}
 
-	g_free (path);
-	return TRUE;
+	return BRASERO_IMAGE_FORMAT_NONE;
+}
 
-stat_end:
+static GFile *
+brasero_image_sheet_resolve (GFile *sheet_file,
+			     const gchar *path)
+{
+	GFile *parent;
+	GFile *file;
 
 	/* check if the path is relative, if so then add the root path */
-	if (path && !g_path_is_absolute (path))
+	if (!g_path_is_absolute (path)) {
+		parent = g_file_get_parent (sheet_file);
 		file = g_file_resolve_relative_path (parent, path);
-	else if (path) {
+		g_object_unref (parent);
+	}
+	else {
 		gchar *img_uri;
 		gchar *scheme;
 
-		scheme = g_file_get_uri_scheme (parent);
+		scheme = g_file_get_uri_scheme (sheet_file);
 		img_uri = g_strconcat (scheme, "://", path, NULL);
 		g_free (scheme);
 
 		file = g_file_new_for_commandline_arg (img_uri);
 		g_free (img_uri);
 	}
-	else
-		return FALSE;
 
-	g_free (path);
+	return file;
+}
 
-	/* NOTE: follow symlink if any */
-	info = g_file_query_info (file,
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
-				  G_FILE_QUERY_INFO_NONE,
-				  NULL,
-				  error);
-	g_object_unref (file);
-	if (!info)
-		return FALSE;
+static void
+brasero_image_sheet_parse_toc_address (BraseroImageSheetFile *entry,
+				       const gchar *ptr)
+{
+	gchar *tmp;
 
-	if (size_file)
-		*size_file = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2352);
+	/* Only relevant for cdrdao sheets:
+	 * DATAFILE path [length]
+	 * FILE/AUDIOFILE path [#offset] start [length]
+	 * When there is no length the rest of the file is used. */
+	entry->length = -1;
 
-	g_object_unref (info);
+	/* skip white spaces */
+	while (isspace (*ptr)) ptr++;
 
-	return TRUE;
+	if (!entry->is_datafile) {
+		/* skip a possible #.... (offset in bytes) */
+		tmp = g_utf8_strchr (ptr, -1, '#');
+		if (tmp) {
+			tmp ++;
+			while (isdigit (*tmp)) tmp ++;
+			while (isspace (*tmp)) tmp++;
+			ptr = tmp;
+		}
+
+		/* get the start */
+		ptr = brasero_image_format_get_MSF_address (ptr, &entry->start);
+		if (!ptr)
+			return;
+
+		/* skip white spaces */
+		while (isspace (*ptr)) ptr++;
+	}
+
+	if (ptr [0] == '\0'
+	|| (ptr [0] == '/' && ptr [1] == '/')) {
+		entry->toc_valid = TRUE;
+		return;
+	}
+
+	/* get the size */
+	if (brasero_image_format_get_MSF_address (ptr, &entry->length))
+		entry->toc_valid = TRUE;
 }
 
-static gboolean
-brasero_image_format_get_FILE_info (const gchar *ptr,
-				    GFile *parent,
-				    gint64 *size_img,
-				    GError **error)
+static gint64
+brasero_image_sheet_parse_gap (const gchar *ptr)
 {
-	gchar *path = NULL;
-	gint64 start = 0;
-	GFileInfo *info;
-	GFile *file = NULL;
-	gchar *tmp;
+	gint64 sectors = 0;
 
-	/* get the path and skip it */
-	ptr = brasero_image_format_read_path (ptr, &path);
-	if (!ptr)
-		return FALSE;
+	if (!isspace (*ptr))
+		return 0;
 
-	/* skip white spaces */
-	while (isspace (*ptr)) ptr++;
+	if (!brasero_image_format_get_MSF_address (ptr, &sectors))
+		return 0;
+
+	return sectors;
+}
+
+static void
+brasero_image_sheet_parse_line (BraseroImageSheet *sheet,
+				GFile *sheet_file,
+				const gchar *line)
+{
+	BraseroImageSheetTrack *track;
+	const gchar *ptr;
+	gsize len;
+
+	if (sheet->format == BRASERO_IMAGE_FORMAT_NONE)
+		sheet->format = brasero_image_sheet_identify_line (line);
+
+	/* The first word is the keyword */
+	ptr = line;
+	while (isspace (*ptr)) ptr ++;
+
+	len = 0;
+	while (ptr [len] && (isalnum (ptr [len]) || ptr [len] == '_')) len ++;
+
+	track = sheet->tracks? sheet->tracks->data:NULL;
+
+	if ((len == 4 && !strncmp (ptr, "FILE", 4))
+	||  (len == 8 && !strncmp (ptr, "DATAFILE", 8))
+	||  (len == 9 && !strncmp (ptr, "AUDIOFILE", 9))) {
+		BraseroImageSheetFile *entry;
+		const gchar *next;
+		gchar *path = NULL;
+
+		entry = g_new0 (BraseroImageSheetFile, 1);
+		entry->size = -1;
+		entry->is_datafile = (len == 8);
+
+		next = brasero_image_format_read_path (ptr + len, &path);
+		if (!next || !path) {
+			/* The sheet can't be used to get a size */
+			sheet->broken = TRUE;
+			g_free (path);
+			g_free (entry);
+			return;
+		}
+
+		entry->path = path;
+		entry->file = brasero_image_sheet_resolve (sheet_file, path);
 
-	/* skip a possible #.... (offset in bytes) */
-	tmp = g_utf8_strchr (ptr, -1, '#');
-	if (tmp) {
-		tmp ++;
-		while (isdigit (*tmp)) tmp ++;
-		while (isspace (*tmp)) tmp++;
-		ptr = tmp;
+		entry->type = g_strstrip (g_strdup (next));
+		brasero_image_sheet_parse_toc_address (entry, next);
+
+		sheet->files = g_slist_prepend (sheet->files, entry);
+	}
+	else if (len == 5 && !strncmp (ptr, "TRACK", 5)) {
+		gchar *next;
+
+		track = g_new0 (BraseroImageSheetTrack, 1);
+		track->number = strtol (ptr + len, &next, 10);
+		track->mode = g_strstrip (g_strdup (next));
+		track->file = sheet->files? sheet->files->data:NULL;
+		sheet->tracks = g_slist_prepend (sheet->tracks, track);
 	}
+	else if (len == 5 && !strncmp (ptr, "INDEX", 5)) {
+		BraseroImageSheetIndex *index;
+		gchar *next;
+
+		if (!track)
+			return;
+
+		index = g_new0 (BraseroImageSheetIndex, 1);
+		index->number = strtol (ptr + len, &next, 10);
+		while (isspace (*next)) next ++;
+		brasero_image_format_get_MSF_address (next, &index->address);
+		track->indexes = g_slist_append (track->indexes, index);
+	}
+	else if (len == 6 && !strncmp (ptr, "PREGAP", 6)) {
+		gint64 sectors;
 
-	/* get the start */
-	ptr = brasero_image_format_get_MSF_address (ptr, &start);
-	if (!ptr) {
-		g_free (path);
-		return FALSE;
+		sectors = brasero_image_sheet_parse_gap (ptr + len);
+		sheet->pregap += sectors;
+		if (track)
+			track->pregap += sectors;
 	}
+	else if (len == 7 && !strncmp (ptr, "POSTGAP", 7)) {
+		gint64 sectors;
 
-	/* skip white spaces */
-	while (isspace (*ptr)) ptr++;
+		sectors = brasero_image_sheet_parse_gap (ptr + len);
+		sheet->postgap += sectors;
+		if (track)
+			track->postgap += sectors;
+	}
+	else if (len == 7 && !strncmp (ptr, "SILENCE", 7))
+		sheet->silence += brasero_image_sheet_parse_gap (ptr + len);
+	else if (len == 4 && !strncmp (ptr, "ZERO", 4))
+		sheet->zero += brasero_image_sheet_parse_gap (ptr + len);
+}
 
-	if (ptr [0] == '\0'
-	|| (ptr [0] == '/' && ptr [1] == '/'))
-		goto stat_end;
+static void
+brasero_image_sheet_free (BraseroImageSheet *sheet)
+{
+	GSList *iter;
 
-	/* get the size */
-	if (!brasero_image_format_get_MSF_address (ptr, size_img)) {
-		g_free (path);
-		return FALSE;
+	for (iter = sheet->tracks; iter; iter = iter->next) {
+		BraseroImageSheetTrack *track = iter->data;
+
+		g_slist_foreach (track->indexes, (GFunc) g_free, NULL);
+		g_slist_free (track->indexes);
+		g_free (track->mode);
+		g_free (track);
 	}
+	g_slist_free (sheet->tracks);
 
-	g_free (path);
-	return TRUE;
+	for (iter = sheet->files; iter; iter = iter->next) {
+		BraseroImageSheetFile *entry = iter->data;
 
-stat_end:
+		g_object_unref (entry->file);
+		g_free (entry->path);
+		g_free (entry->type);
+		g_free (entry);
+	}
+	g_slist_free (sheet->files);
 
-	/* check if the path is relative, if so then add the root path */
-	if (path && !g_path_is_absolute (path))
-		file = g_file_resolve_relative_path (parent, path);
-	else if (path) {
-		gchar *img_uri;
-		gchar *scheme;
+	g_free (sheet->uri);
+	g_free (sheet);
+}
 
-		scheme = g_file_get_uri_scheme (parent);
-		img_uri = g_strconcat (scheme, "://", path, NULL);
-		g_free (scheme);
+static BraseroImageSheet *
+brasero_image_sheet_parse (GFile *file,
+			   GCancellable *cancel,
+			   GError **error)
+{
+	gchar *line;
+	BraseroImageSheet *sheet;
+	GFileInputStream *input;
+	GDataInputStream *stream;
 
-		file = g_file_new_for_commandline_arg (img_uri);
-		g_free (img_uri);
+	input = g_file_read (file, cancel, error);
+	if (!input)
+		return NULL;
+
+	stream = g_data_input_stream_new (G_INPUT_STREAM (input));
+	g_object_unref (input);
+
+	sheet = g_new0 (BraseroImageSheet, 1);
+	sheet->ref = 1;
+	sheet->uri = g_file_get_uri (file);
+	sheet->format = BRASERO_IMAGE_FORMAT_NONE;
+
+	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
+		brasero_image_sheet_parse_line (sheet, file, line);
+		g_free (line);
 	}
-	else
-		return FALSE;
 
-	g_free (path);
+	g_object_unref (stream);
+
+	if (error && *error) {
+		brasero_image_sheet_free (sheet);
+		return NULL;
+	}
+
+	sheet->files = g_slist_reverse (sheet->files);
+	sheet->tracks = g_slist_reverse (sheet->tracks);
+
+	BRASERO_BURN_LOG ("Parsed sheet %s (%i files, %i tracks)",
+			  sheet->uri,
+			  g_slist_length (sheet->files),
+			  g_slist_length (sheet->tracks));
+	return sheet;
+}
+
+static gboolean
+brasero_image_sheet_file_query (BraseroImageSheetFile *entry,
+				gint64 *size,
+				guint64 *mtime,
+				guint32 *mtime_usec,
+				GCancellable *cancel,
+				GError **error)
+{
+	GFileInfo *info;
 
 	/* NOTE: follow symlink if any */
-	info = g_file_query_info (file,
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	info = g_file_query_info (entry->file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
 				  G_FILE_QUERY_INFO_NONE,
-				  NULL,
+				  cancel,
 				  error);
-	g_object_unref (file);
 	if (!info)
 		return FALSE;
 
-	if (size_img)
-		*size_img = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2352) - start;
-
+	*size = g_file_info_get_size (info);
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	*mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
 	g_object_unref (info);
 
 	return TRUE;
 }
 
-gboolean
-brasero_image_format_get_cdrdao_size (gchar *uri,
-				      guint64 *sectors,
-				      guint64 *size_img,
-				      GCancellable *cancel,
-				      GError **error)
+/* Forget the sizes of the data files that changed since they were queried
+ * so they are queried again when needed. */
+
+static void
+brasero_image_sheet_revalidate (BraseroImageSheet *sheet,
+				GCancellable *cancel)
 {
+	GSList *iter;
+
+	for (iter = sheet->files; iter; iter = iter->next) {
+		BraseroImageSheetFile *entry = iter->data;
+		guint64 mtime = 0;
+		guint32 mtime_usec = 0;
+		gint64 size = -1;
+		gboolean valid;
+
+		G_LOCK (sheets_lock);
+		valid = (entry->size >= 0);
+		G_UNLOCK (sheets_lock);
+
+		if (!valid)
+			continue;
+
+		if (!brasero_image_sheet_file_query (entry, &size, &mtime, &mtime_usec, cancel, NULL))
+			size = -1;
+
+		G_LOCK (sheets_lock);
+		if (size != entry->size
+		||  mtime != entry->mtime
+		||  mtime_usec != entry->mtime_usec) {
+			BRASERO_BURN_LOG ("Data file %s changed", entry->path);
+			entry->size = -1;
+		}
+		G_UNLOCK (sheets_lock);
+	}
+}
+
+/**
+ * Returns the parsed sheet for uri (a new reference). It is only parsed if
+ * it isn't cached or if it changed since it was.
+ */
+
+BraseroImageSheet *
+brasero_image_sheet_get (const gchar *uri,
+			 GCancellable *cancel,
+			 GError **error)
+{
+	BraseroImageSheet *sheet;
+	GFileInfo *info;
+	guint64 mtime;
+	guint32 mtime_usec;
+	goffset size;
 	GFile *file;
-	gchar *line;
-	GFile *parent;
-	gint64 cue_size = 0;
-	GFileInputStream *input;
-	GDataInputStream *stream;
 
 	file = g_file_new_for_uri (uri);
-	input = g_file_read (file, cancel, error);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE,
+				  cancel,
+				  error);
+	if (!info) {
+		g_object_unref (file);
+		return NULL;
+	}
+
+	size = g_file_info_get_size (info);
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref (info);
+
+	G_LOCK (sheets_lock);
+	sheet = sheets? g_hash_table_lookup (sheets, uri):NULL;
+	if (sheet
+	&&  sheet->mtime == mtime
+	&&  sheet->mtime_usec == mtime_usec
+	&&  sheet->sheet_size == size) {
+		sheet->ref ++;
+		G_UNLOCK (sheets_lock);
 
-	if (!input) {
 		g_object_unref (file);
+
+		brasero_image_sheet_revalidate (sheet, cancel);
+		return sheet;
+	}
+	G_UNLOCK (sheets_lock);
+
+	sheet = brasero_image_sheet_parse (file, cancel, error);
+	g_object_unref (file);
+
+	if (!sheet)
+		return NULL;
+
+	sheet->mtime = mtime;
+	sheet->mtime_usec = mtime_usec;
+	sheet->sheet_size = size;
+
+	G_LOCK (sheets_lock);
+	if (!sheets)
+		sheets = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* The previous one (if any) is outdated; it remains valid for the
+	 * ones holding a reference but is no longer in the cache. Replace
+	 * the key too since it belongs to the previous sheet and is freed
+	 * with it. */
+	g_hash_table_replace (sheets, sheet->uri, sheet);
+	G_UNLOCK (sheets_lock);
+
+	return sheet;
+}
+
+BraseroImageSheet *
+brasero_image_sheet_ref (BraseroImageSheet *sheet)
+{
+	G_LOCK (sheets_lock);
+	sheet->ref ++;
+	G_UNLOCK (sheets_lock);
+
+	return sheet;
+}
+
+void
+brasero_image_sheet_unref (BraseroImageSheet *sheet)
+{
+	G_LOCK (sheets_lock);
+	sheet->ref --;
+	if (sheet->ref > 0) {
+		G_UNLOCK (sheets_lock);
+		return;
+	}
+
+	if (sheets && g_hash_table_lookup (sheets, sheet->uri) == sheet)
+		g_hash_table_remove (sheets, sheet->uri);
+	G_UNLOCK (sheets_lock);
+
+	brasero_image_sheet_free (sheet);
+}
+
+BraseroImageFormat
+brasero_image_sheet_get_format (BraseroImageSheet *sheet)
+{
+	return sheet->format;
+}
+
+static gboolean
+brasero_image_sheet_file_get_size (BraseroImageSheetFile *entry,
+				   GCancellable *cancel,
+				   GError **error)
+{
+	guint32 mtime_usec;
+	gboolean cached;
+	guint64 mtime;
+	gint64 size;
+
+	G_LOCK (sheets_lock);
+	cached = (entry->size >= 0);
+	G_UNLOCK (sheets_lock);
+
+	if (cached)
+		return TRUE;
+
+	if (!brasero_image_sheet_file_query (entry, &size, &mtime, &mtime_usec, cancel, error))
+		return FALSE;
+
+	G_LOCK (sheets_lock);
+	entry->size = size;
+	entry->mtime = mtime;
+	entry->mtime_usec = mtime_usec;
+	G_UNLOCK (sheets_lock);
+
+	return TRUE;
+}
+
+/**
+ * .cue can use various data files but have to use them ALL. So we don't need
+ * to care about a start/size address. We just add the size of every file.
+ */
+
+gboolean
+brasero_image_sheet_get_cue_size (BraseroImageSheet *sheet,
+				  guint64 *blocks,
+				  guint64 *size_img,
+				  GCancellable *cancel,
+				  GError **error)
+{
+	gint64 cue_size = 0;
+	GSList *iter;
+
+	if (sheet->broken)
 		return FALSE;
+
+	for (iter = sheet->files; iter; iter = iter->next) {
+		BraseroImageSheetFile *entry = iter->data;
+
+		if (!brasero_image_sheet_file_get_size (entry, cancel, error))
+			return FALSE;
+
+		cue_size += entry->size;
 	}
 
-	stream = g_data_input_stream_new (G_INPUT_STREAM (input));
-	g_object_unref (input);
+	cue_size += (sheet->pregap + sheet->postgap) * 2352;
 
-	parent = g_file_get_parent (file);
-	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		gchar *ptr;
+	if (size_img)
+		*size_img = cue_size;
+	if (blocks)
+		*blocks = BRASERO_BYTES_TO_SECTORS (cue_size, 2352);
 
-		if ((ptr = strstr (line, "DATAFILE"))) {
-			gint64 size_file;
+	return TRUE;
+}
 
-			ptr += 8;
-			if (brasero_image_format_get_DATAFILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "FILE"))) {
-			gint64 size_file;
-
-			ptr += 4;
-			/* first number is the position, the second the size,
-			 * number after '#' is the offset (in bytes). */
-			if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "AUDIOFILE"))) {
-			gint64 size_file;
-
-			ptr += 4;
-			/* first number is the position, the second the size,
-			 * number after '#' is the offset (in bytes). */
-			if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "SILENCE"))) {
-			gint64 size_silence;
+gboolean
+brasero_image_sheet_get_cdrdao_size (BraseroImageSheet *sheet,
+				     guint64 *sectors,
+				     guint64 *size_img,
+				     GCancellable *cancel,
+				     GError **error)
+{
+	gint64 cue_size = 0;
+	GSList *iter;
 
-			ptr += 7;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_silence))
-				cue_size += size_silence;
-		}
-		else if ((ptr = strstr (line, "PREGAP"))) {
-			gint64 size_pregap;
+	for (iter = sheet->files; iter; iter = iter->next) {
+		BraseroImageSheetFile *entry = iter->data;
 
-			ptr += 6;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_pregap))
-				cue_size += size_pregap;
-		}
-		else if ((ptr = strstr (line, "ZERO"))) {
-			gint64 size_zero;
+		if (!entry->toc_valid)
+			continue;
 
-			ptr += 4;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_zero))
-				cue_size += size_zero;
+		if (entry->length >= 0) {
+			cue_size += entry->length;
+			continue;
 		}
 
-		g_free (line);
+		/* No length: the file is used up to its end */
+		if (!brasero_image_sheet_file_get_size (entry, cancel, error))
+			return FALSE;
+
+		cue_size += BRASERO_BYTES_TO_SECTORS (entry->size, 2352) - entry->start;
 	}
-	g_object_unref (parent);
 
-	g_object_unref (stream);
-	g_object_unref (file);
+	cue_size += sheet->silence + sheet->pregap + sheet->zero;
 
 	if (sectors)
 		*sectors = cue_size;
@@ -517,252 +721,158 @@ brasero_image_format_get_cdrdao_size (gchar *uri,
 }
 
 gboolean
-brasero_image_format_cue_bin_byte_swap (gchar *uri,
-					GCancellable *cancel,
-					GError **error)
+brasero_image_sheet_need_byte_swap (BraseroImageSheet *sheet)
 {
-	GFile *file;
-	gchar *line;
-	GFileInputStream *input;
-	GDataInputStream *stream;
-	gboolean is_audio = FALSE;
 	gboolean is_binary = FALSE;
+	gboolean is_audio = FALSE;
+	GSList *iter;
 
-	file = g_file_new_for_uri (uri);
-	input = g_file_read (file, cancel, error);
+	for (iter = sheet->files; iter && !is_binary; iter = iter->next) {
+		BraseroImageSheetFile *entry = iter->data;
 
-	if (!input) {
-		g_object_unref (file);
-		return FALSE;
+		if (!entry->is_datafile && strstr (entry->type, "BINARY"))
+			is_binary = TRUE;
 	}
 
-	stream = g_data_input_stream_new (G_INPUT_STREAM (input));
-	g_object_unref (input);
+	for (iter = sheet->tracks; iter && !is_audio; iter = iter->next) {
+		BraseroImageSheetTrack *track = iter->data;
 
-	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		const gchar *ptr;
-		
-		if ((ptr = strstr (line, "FILE"))) {
-			if (strstr (ptr, "BINARY"))
-				is_binary = TRUE;
-		}
-		else if ((ptr = strstr (line, "TRACK"))) {
-			if (strstr (ptr, "AUDIO"))
-				is_audio = TRUE;
-		}
-		g_free (line);
+		if (strstr (track->mode, "AUDIO"))
+			is_audio = TRUE;
 	}
 
-	g_object_unref (stream);
-	g_object_unref (file);
-
 	return is_binary && is_audio;
 }
 
-/**
- * .cue can use various data files but have to use them ALL. So we don't need
- * to care about a start/size address. We just go through the whole file and
- * stat every time we catch a FILE keyword.
- */
+/* FIXME: a cue file or toc file can hold different paths; this returns the
+ * first one */
+gchar *
+brasero_image_sheet_get_complement (BraseroImageSheet *sheet)
+{
+	BraseroImageSheetFile *entry;
 
-gboolean
-brasero_image_format_get_cue_size (gchar *uri,
-				   guint64 *blocks,
-				   guint64 *size_img,
-				   GCancellable *cancel,
-				   GError **error)
+	if (!sheet->files)
+		return NULL;
+
+	entry = sheet->files->data;
+	return g_file_get_path (entry->file);
+}
+
+/* FIXME this function is flawed at the moment. A cue file or toc file can 
+ * hold different paths */
+gchar *
+brasero_image_format_get_complement (BraseroImageFormat format,
+				     const gchar *path)
 {
-	GFile *file;
-	gchar *line;
-	gint64 cue_size = 0;
-	GFileInputStream *input;
-	GDataInputStream *stream;
+	gchar *retval = NULL;
 
-	file = g_file_new_for_uri (uri);
-	input = g_file_read (file, cancel, error);
+	if (format == BRASERO_IMAGE_FORMAT_CLONE) {
+		/* These are set rules no need to parse:
+		 * the toc file has to end with .toc suffix */
+		if (g_str_has_suffix (path, ".toc"))
+			retval = g_strndup (path, strlen (path) - 4);
+	}
+	else if (format == BRASERO_IMAGE_FORMAT_CUE
+	     ||  format == BRASERO_IMAGE_FORMAT_CDRDAO) {
+		BraseroImageSheet *sheet;
+		GFile *file;
+		gchar *uri;
 
-	if (!input) {
+		/* need to parse */
+		file = g_file_new_for_path (path);
+		uri = g_file_get_uri (file);
 		g_object_unref (file);
-		return FALSE;
-	}
 
-	stream = g_data_input_stream_new (G_INPUT_STREAM (input));
-	g_object_unref (input);
+		sheet = brasero_image_sheet_get (uri, NULL, NULL);
+		g_free (uri);
 
-	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		const gchar *ptr;
-
-		if ((ptr = strstr (line, "FILE"))) {
-			GFileInfo *info;
-			gchar *file_path;
-			GFile *file_img = NULL;
-
-			ptr += 4;
-
-			/* get the path (NOTE: if ptr is NULL file_path as well) */
-			ptr = brasero_image_format_read_path (ptr, &file_path);
-			if (!ptr) {
-				g_object_unref (stream);
-				g_object_unref (file);
-				g_free (line);
-				return FALSE;
-			}
-
-			/* check if the path is relative, if so then add the root path */
-			if (file_path && !g_path_is_absolute (file_path)) {
-				GFile *parent;
-
-				parent = g_file_get_parent (file);
-				file_img = g_file_resolve_relative_path (parent, file_path);
-				g_object_unref (parent);
-			}
-			else if (file_path) {
-				gchar *img_uri;
-				gchar *scheme;
-
-				scheme = g_file_get_uri_scheme (file);
-				img_uri = g_strconcat (scheme, "://", file_path, NULL);
-				g_free (scheme);
-
-				file_img = g_file_new_for_commandline_arg (img_uri);
-				g_free (img_uri);
-			}
-
-			g_free (file_path);
-
-			/* NOTE: follow symlink if any */
-			info = g_file_query_info (file_img,
-						  G_FILE_ATTRIBUTE_STANDARD_SIZE,
-						  G_FILE_QUERY_INFO_NONE,
-						  NULL,
-						  error);
-			g_object_unref (file_img);
-
-			if (!info) {
-				g_free (line);
-				g_object_unref (file);
-				g_object_unref (stream);
-				return FALSE;
-			}
-
-			cue_size += g_file_info_get_size (info);
-			g_object_unref (info);
-		}
-		else if ((ptr = strstr (line, "PREGAP"))) {
-			ptr += 6;
-			if (isspace (*ptr)) {
-				gint64 size_pregap;
-
-				ptr ++;
-				ptr = brasero_image_format_get_MSF_address (ptr, &size_pregap);
-				if (ptr)
-					cue_size += size_pregap * 2352;
-			}
-		}
-		else if ((ptr = strstr (line, "POSTGAP"))) {
-			ptr += 7;
-			if (isspace (*ptr)) {
-				gint64 size_postgap;
-
-				ptr ++;
-				ptr = brasero_image_format_get_MSF_address (ptr, &size_postgap);
-				if (ptr)
-					cue_size += size_postgap * 2352;
-			}
+		if (!sheet) {
+			if (g_str_has_suffix (path, ".cue"))
+				return g_strdup_printf ("%.*sbin",
+							(int) strlen (path) - 3,
+							path);
+
+			return g_strdup_printf ("%s.bin", path);
 		}
 
-		g_free (line);
+		retval = brasero_image_sheet_get_complement (sheet);
+		brasero_image_sheet_unref (sheet);
 	}
+	else
+		retval = NULL;
 
-	g_object_unref (stream);
-	g_object_unref (file);
+	return retval;
+}
 
-	if (size_img)
-		*size_img = cue_size;
-	if (blocks)
-		*blocks = BRASERO_BYTES_TO_SECTORS (cue_size, 2352);
+gboolean
+brasero_image_format_get_cdrdao_size (gchar *uri,
+				      guint64 *sectors,
+				      guint64 *size_img,
+				      GCancellable *cancel,
+				      GError **error)
+{
+	BraseroImageSheet *sheet;
+	gboolean result;
 
-	return TRUE;
+	sheet = brasero_image_sheet_get (uri, cancel, error);
+	if (!sheet)
+		return FALSE;
+
+	result = brasero_image_sheet_get_cdrdao_size (sheet, sectors, size_img, cancel, error);
+	brasero_image_sheet_unref (sheet);
+	return result;
 }
 
-BraseroImageFormat
-brasero_image_format_identify_cuesheet (const gchar *uri,
+gboolean
+brasero_image_format_cue_bin_byte_swap (gchar *uri,
 					GCancellable *cancel,
 					GError **error)
 {
-	GFile *file;
-	gchar *line;
-	GFileInputStream *input;
-	GDataInputStream *stream;
-	BraseroImageFormat format;
+	BraseroImageSheet *sheet;
+	gboolean result;
 
-	file = g_file_new_for_uri (uri);
-	input = g_file_read (file, cancel, error);
-	if (!input) {
-		g_object_unref (file);
+	sheet = brasero_image_sheet_get (uri, cancel, error);
+	if (!sheet)
 		return FALSE;
-	}
 
-	stream = g_data_input_stream_new (G_INPUT_STREAM (input));
-	g_object_unref (input);
+	result = brasero_image_sheet_need_byte_swap (sheet);
+	brasero_image_sheet_unref (sheet);
+	return result;
+}
 
-	format = BRASERO_IMAGE_FORMAT_NONE;
-	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		/* Keywords for cdrdao cuesheets */
-		if (strstr (line, "CD_ROM_XA")
-		||  strstr (line, "CD_ROM")
-		||  strstr (line, "CD_DA")
-		||  strstr (line, "CD_TEXT")) {
-			format = BRASERO_IMAGE_FORMAT_CDRDAO;
-			g_free (line);
-			break;
-		}
-		else if (strstr (line, "TRACK")) {
-			/* NOTE: there is also "AUDIO" but it's common to both */
-
-			/* CDRDAO */
-			if (strstr (line, "MODE1")
-			||  strstr (line, "MODE1_RAW")
-			||  strstr (line, "MODE2_FORM1")
-			||  strstr (line, "MODE2_FORM2")
-			||  strstr (line, "MODE_2_RAW")
-			||  strstr (line, "MODE2_FORM_MIX")
-			||  strstr (line, "MODE2")) {
-				format = BRASERO_IMAGE_FORMAT_CDRDAO;
-				g_free (line);
-				break;
-			}
-
-			/* .CUE file */
-			else if (strstr (line, "CDG")
-			     ||  strstr (line, "MODE1/2048")
-			     ||  strstr (line, "MODE1/2352")
-			     ||  strstr (line, "MODE2/2336")
-			     ||  strstr (line, "MODE2/2352")
-			     ||  strstr (line, "CDI/2336")
-			     ||  strstr (line, "CDI/2352")) {
-				format = BRASERO_IMAGE_FORMAT_CUE;
-				g_free (line);
-				break;
-			}
-		}
-		else if (strstr (line, "FILE")) {
-			if (strstr (line, "MOTOROLA")
-			||  strstr (line, "BINARY")
-			||  strstr (line, "AIFF")
-			||  strstr (line, "WAVE")
-			||  strstr (line, "MP3")) {
-				format = BRASERO_IMAGE_FORMAT_CUE;
-				g_free (line);
-				break;
-			}
-		}
-		g_free (line);
-		line = NULL;
-	}
+gboolean
+brasero_image_format_get_cue_size (gchar *uri,
+				   guint64 *blocks,
+				   guint64 *size_img,
+				   GCancellable *cancel,
+				   GError **error)
+{
+	BraseroImageSheet *sheet;
+	gboolean result;
 
-	g_object_unref (stream);
-	g_object_unref (file);
+	sheet = brasero_image_sheet_get (uri, cancel, error);
+	if (!sheet)
+		return FALSE;
+
+	result = brasero_image_sheet_get_cue_size (sheet, blocks, size_img, cancel, error);
+	brasero_image_sheet_unref (sheet);
+	return result;
+}
+
+BraseroImageFormat
+brasero_image_format_identify_cuesheet (const gchar *uri,
+					GCancellable *cancel,
+					GError **error)
+{
+	BraseroImageSheet *sheet;
+	BraseroImageFormat format;
+
+	sheet = brasero_image_sheet_get (uri, cancel, error);
+	if (!sheet)
+		return BRASERO_IMAGE_FORMAT_NONE;
+
+	format = brasero_image_sheet_get_format (sheet);
+	brasero_image_sheet_unref (sheet);
 
 	BRASERO_BURN_LOG_WITH_FULL_TYPE (BRASERO_TRACK_TYPE_IMAGE,
 					 format,
@@ -32,11 +32,102 @@
 #define _BURN_IMAGES_FORMAT_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "burn-basics.h"
 
 G_BEGIN_DECLS
 
+typedef struct _BraseroImageSheetFile BraseroImageSheetFile;
+struct _BraseroImageSheetFile {
+	gchar *path;		/* as written in the sheet */
+	GFile *file;		/* resolved against the sheet location */
+	gchar *type;		/* the rest of the line (BINARY, WAVE, ...) */
+
+	gint64 start;		/* sectors (cdrdao only) */
+	gint64 length;		/* sectors, -1 up to the end (cdrdao only) */
+	gint64 size;		/* bytes, -1 until it was queried */
+	guint64 mtime;		/* when size was queried, to revalidate it */
+	guint32 mtime_usec;
+
+	guint is_datafile:1;
+	guint toc_valid:1;
+};
+
+typedef struct _BraseroImageSheetIndex BraseroImageSheetIndex;
+struct _BraseroImageSheetIndex {
+	gint number;
+	gint64 address;
+};
+
+typedef struct _BraseroImageSheetTrack BraseroImageSheetTrack;
+struct _BraseroImageSheetTrack {
+	gint number;
+	gchar *mode;
+
+	gint64 pregap;
+	gint64 postgap;
+
+	GSList *indexes;
+	BraseroImageSheetFile *file;
+};
+
+typedef struct _BraseroImageSheet BraseroImageSheet;
+struct _BraseroImageSheet {
+	gint ref;
+
+	BraseroImageFormat format;
+
+	/* Used to validate the cached copy */
+	gchar *uri;
+	guint64 mtime;
+	guint32 mtime_usec;
+	goffset sheet_size;
+
+	GSList *files;
+	GSList *tracks;
+
+	/* sectors */
+	gint64 pregap;
+	gint64 postgap;
+	gint64 silence;
+	gint64 zero;
+
+	guint broken:1;
+};
+
+BraseroImageSheet *
+brasero_image_sheet_get (const gchar *uri,
+			 GCancellable *cancel,
+			 GError **error);
+
+BraseroImageSheet *
+brasero_image_sheet_ref (BraseroImageSheet *sheet);
+
+void
+brasero_image_sheet_unref (BraseroImageSheet *sheet);
+
+BraseroImageFormat
+brasero_image_sheet_get_format (BraseroImageSheet *sheet);
+
+gboolean
+brasero_image_sheet_get_cue_size (BraseroImageSheet *sheet,
+				  guint64 *blocks,
+				  guint64 *size_img,
+				  GCancellable *cancel,
+				  GError **error);
+gboolean
+brasero_image_sheet_get_cdrdao_size (BraseroImageSheet *sheet,
+				     guint64 *sectors,
+				     guint64 *size_img,
+				     GCancellable *cancel,
+				     GError **error);
+gboolean
+brasero_image_sheet_need_byte_swap (BraseroImageSheet *sheet);
+
+gchar *
+brasero_image_sheet_get_complement (BraseroImageSheet *sheet);
+
 BraseroImageFormat
 brasero_image_format_identify_cuesheet (const gchar *path,
 					GCancellable *cancel,
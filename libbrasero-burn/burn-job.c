@@ -63,6 +63,9 @@
 typedef struct _BraseroJobOutput {
 	gchar *image;
 	gchar *toc;
+
+	/* Not a path the user chose */
+	guint tmp:1;
 } BraseroJobOutput;
 
 typedef struct _BraseroJobInput {
@@ -640,6 +643,7 @@ brasero_job_set_output_file (BraseroJob *self,
 				priv->output = g_new0 (BraseroJobOutput, 1);
 				priv->output->image = image;
 				priv->output->toc = toc;
+				priv->output->tmp = brasero_burn_session_is_output_tmp (session);
 				return BRASERO_BURN_OK;
 			}
 		}
@@ -675,6 +679,9 @@ brasero_job_set_output_file (BraseroJob *self,
 	priv->output = g_new0 (BraseroJobOutput, 1);
 	priv->output->image = image;
 	priv->output->toc = toc;
+	priv->output->tmp = (priv->type.type != BRASERO_TRACK_TYPE_IMAGE
+			  || !is_last
+			  || brasero_burn_session_is_output_tmp (session));
 
 	if (brasero_burn_session_get_flags (session) & BRASERO_BURN_FLAG_CHECK_SIZE)
 		return brasero_job_check_output_volume_space (self, error);
@@ -777,6 +784,20 @@ brasero_job_item_start (BraseroTaskItem *item,
 		priv->input->in = fd [0];
 		priv->input->out = fd [1];
 	}
+	else if (brasero_job_is_last_active (self)
+	     &&  brasero_task_ctx_get_action (priv->ctx) != BRASERO_TASK_ACTION_NONE) {
+		int fd;
+
+		/* A lone recorder may be fed through a pipe set up by the
+		 * caller (see brasero_burn_record_fanout ()). Not in fake mode
+		 * though, nothing would be read. */
+		fd = brasero_task_ctx_steal_input_fd (priv->ctx);
+		if (fd >= 0) {
+			BRASERO_JOB_LOG (self, "reading from external input");
+			priv->input = g_new0 (BraseroJobInput, 1);
+			priv->input->in = fd;
+		}
+	}
 
 	klass = BRASERO_JOB_GET_CLASS (self);
 	if (!klass->start) {
@@ -784,6 +805,8 @@ brasero_job_item_start (BraseroTaskItem *item,
 		BRASERO_JOB_NOT_SUPPORTED (self);
 	}
 
+	BRASERO_BURN_LOG_STAGE_BEGIN ("%s", G_OBJECT_TYPE_NAME (self));
+
 	result = klass->start (self, error);
 	if (result == BRASERO_BURN_NOT_RUNNING) {
 		/* this means that the task is already completed. This 
@@ -917,6 +940,7 @@ brasero_job_item_stop (BraseroTaskItem *item,
 		priv->ctx = NULL;
 	}
 
+	BRASERO_BURN_LOG_STAGE_END ("%s", G_OBJECT_TYPE_NAME (self));
 	return result;
 }
 
@@ -1166,12 +1190,12 @@ brasero_job_error (BraseroJob *self, GError *error)
 
 	g_value_unset (instance_and_params);
 
-	BRASERO_JOB_LOG (self,
-			 "asked to stop because of an error\n"
-			 "\terror\t\t= %i\n"
-			 "\tmessage\t= \"%s\"",
-			 error ? error->code:0,
-			 error ? error->message:"no message");
+	BRASERO_JOB_LOG_ERROR (self,
+			       "asked to stop because of an error\n"
+			       "\terror\t\t= %i\n"
+			       "\tmessage\t= \"%s\"",
+			       error ? error->code:0,
+			       error ? error->message:"no message");
 
 	return brasero_task_ctx_error (priv->ctx, g_value_get_int (&return_value), error);
 }
@@ -1347,6 +1371,25 @@ brasero_job_get_image_output (BraseroJob *self,
 	return BRASERO_BURN_OK;
 }
 
+/**
+ * Whether the output was created for the session (it is then removed with
+ * the other temporary files) or is a path the user chose.
+ */
+
+gboolean
+brasero_job_is_output_tmp (BraseroJob *self)
+{
+	BraseroJobPrivate *priv;
+
+	BRASERO_JOB_DEBUG (self);
+
+	priv = BRASERO_JOB_PRIVATE (self);
+	if (!priv->output)
+		return FALSE;
+
+	return priv->output->tmp;
+}
+
 BraseroBurnResult
 brasero_job_get_audio_output (BraseroJob *self,
 			      gchar **path)
@@ -1931,6 +1974,24 @@ brasero_job_set_output_size_for_current_track (BraseroJob *self,
 								   bytes);
 }
 
+/**
+ * Each job class gets its own channel in the telemetry of the task
+ */
+
+static BraseroTelemetryChannel *
+brasero_job_get_telemetry_channel (BraseroJob *self)
+{
+	BraseroJobPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_JOB (self), NULL);
+
+	priv = BRASERO_JOB_PRIVATE (self);
+	if (!priv->ctx)
+		return NULL;
+
+	return brasero_task_ctx_get_telemetry_channel (priv->ctx, G_OBJECT_TYPE_NAME (self));
+}
+
 BraseroBurnResult
 brasero_job_set_written_track (BraseroJob *self,
 			       goffset written)
@@ -1951,6 +2012,7 @@ BraseroBurnResult
 brasero_job_set_written_session (BraseroJob *self,
 				 goffset written)
 {
+	BraseroTelemetryChannel *channel;
 	BraseroJobPrivate *priv;
 
 	/* Turn this off as otherwise it floods bug reports */
@@ -1960,9 +2022,62 @@ brasero_job_set_written_session (BraseroJob *self,
 	if (priv->next)
 		return BRASERO_BURN_NOT_RUNNING;
 
+	channel = brasero_job_get_telemetry_channel (self);
+	if (channel)
+		brasero_telemetry_channel_set_written (channel, written);
+
 	return brasero_task_ctx_set_written_session (priv->ctx, written);
 }
 
+BraseroBurnResult
+brasero_job_add_io_bytes (BraseroJob *self,
+			  guint64 bytes_in,
+			  guint64 bytes_out)
+{
+	BraseroTelemetryChannel *channel;
+
+	/* Called for every block; don't log */
+	channel = brasero_job_get_telemetry_channel (self);
+	if (!channel)
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	brasero_telemetry_channel_add_io (channel, bytes_in, bytes_out);
+	return BRASERO_BURN_OK;
+}
+
+BraseroBurnResult
+brasero_job_add_stall_time (BraseroJob *self,
+			    BraseroJobStall stall,
+			    gint64 usec)
+{
+	BraseroTelemetryChannel *channel;
+
+	channel = brasero_job_get_telemetry_channel (self);
+	if (!channel)
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	brasero_telemetry_channel_add_stall (channel,
+					     stall == BRASERO_JOB_STALL_INPUT ?
+					     BRASERO_TELEMETRY_STALL_INPUT:
+					     BRASERO_TELEMETRY_STALL_OUTPUT,
+					     usec);
+	return BRASERO_BURN_OK;
+}
+
+BraseroBurnResult
+brasero_job_set_buffer_fill (BraseroJob *self,
+			     gint percent)
+{
+	BraseroTelemetryChannel *channel;
+
+	channel = brasero_job_get_telemetry_channel (self);
+	if (!channel)
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	brasero_telemetry_channel_set_buffer_fill (channel, percent);
+	return BRASERO_BURN_OK;
+}
+
 BraseroBurnResult
 brasero_job_set_use_average_rate (BraseroJob *self, gboolean value)
 {
@@ -2018,6 +2133,31 @@ brasero_job_log_message (BraseroJob *self,
 	va_end (arg_list);
 }
 
+void
+brasero_job_log_error (BraseroJob *self,
+		       const gchar *location,
+		       const gchar *format,
+		       ...)
+{
+	va_list arg_list;
+	BraseroJobPrivate *priv;
+	BraseroBurnSession *session;
+
+	g_return_if_fail (BRASERO_IS_JOB (self));
+	g_return_if_fail (format != NULL);
+
+	priv = BRASERO_JOB_PRIVATE (self);
+	session = brasero_task_ctx_get_session (priv->ctx);
+
+	va_start (arg_list, format);
+	brasero_burn_session_logv (session, format, arg_list);
+	va_end (arg_list);
+
+	va_start (arg_list, format);
+	brasero_burn_debug_errorv (location, format, arg_list);
+	va_end (arg_list);
+}
+
 /**
  * Object creation stuff
  */
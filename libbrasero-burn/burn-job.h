@@ -35,6 +35,7 @@
 #include <glib-object.h>
 
 #include "brasero-track.h"
+#include "burn-debug.h"
 
 G_BEGIN_DECLS
 
@@ -197,6 +198,8 @@ BraseroBurnResult
 brasero_job_get_image_output (BraseroJob *job,
 			      gchar **image,
 			      gchar **toc);
+gboolean
+brasero_job_is_output_tmp (BraseroJob *job);
 BraseroBurnResult
 brasero_job_get_audio_output (BraseroJob *job,
 			      gchar **output);
@@ -288,6 +291,28 @@ brasero_job_set_output_size_for_current_track (BraseroJob *job,
 					       goffset sectors,
 					       goffset bytes);
 
+/**
+ * Throughput and latency telemetry: every job of a chain may use these, not
+ * only the last one. Stalls are in microseconds, buffer fill in percent.
+ */
+
+typedef enum {
+	BRASERO_JOB_STALL_INPUT,
+	BRASERO_JOB_STALL_OUTPUT
+} BraseroJobStall;
+
+BraseroBurnResult
+brasero_job_add_io_bytes (BraseroJob *job,
+			  guint64 bytes_in,
+			  guint64 bytes_out);
+BraseroBurnResult
+brasero_job_add_stall_time (BraseroJob *job,
+			    BraseroJobStall stall,
+			    gint64 usec);
+BraseroBurnResult
+brasero_job_set_buffer_fill (BraseroJob *job,
+			     gint percent);
+
 /**
  * Used to tell it's (or not) dangerous to interrupt this job
  */
@@ -313,6 +338,14 @@ brasero_job_log_message (BraseroJob *job,
 			 const gchar *format,
 			 ...);
 
+void
+brasero_job_log_error (BraseroJob *job,
+		       const gchar *location,
+		       const gchar *format,
+		       ...);
+
+#if BRASERO_BURN_LOG_LEVEL >= BRASERO_BURN_LOG_LEVEL_DEBUG
+
 #define BRASERO_JOB_LOG(job, message, ...) 			\
 {								\
 	gchar *format;						\
@@ -325,6 +358,18 @@ brasero_job_log_message (BraseroJob *job,
 				 ##__VA_ARGS__);		\
 	g_free (format);					\
 }
+#define BRASERO_JOB_LOG_ERROR(job, message, ...) 		\
+{								\
+	gchar *format;						\
+	format = g_strdup_printf ("%s %s",			\
+				  G_OBJECT_TYPE_NAME (job),	\
+				  message);			\
+	brasero_job_log_error (BRASERO_JOB (job),		\
+			       G_STRLOC,			\
+			       format,				\
+			       ##__VA_ARGS__);			\
+	g_free (format);					\
+}
 #define BRASERO_JOB_LOG_ARG(job, message, ...)			\
 {								\
 	gchar *format;						\
@@ -337,6 +382,14 @@ brasero_job_log_message (BraseroJob *job,
 	g_free (format);					\
 }
 
+#else
+
+#define BRASERO_JOB_LOG(job, message, ...)
+#define BRASERO_JOB_LOG_ERROR(job, message, ...)
+#define BRASERO_JOB_LOG_ARG(job, message, ...)
+
+#endif
+
 #define BRASERO_JOB_NOT_SUPPORTED(job) 					\
 	{								\
 		BRASERO_JOB_LOG (job, "unsupported operation");		\
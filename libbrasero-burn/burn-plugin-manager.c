@@ -66,6 +66,8 @@ struct _BraseroPluginManagerPrivate {
 	GSettings *settings;
 };
 
+#define BRASERO_PLUGIN_MANAGER_CHECK_THREADS	4
+
 #define BRASERO_PLUGIN_MANAGER_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_PLUGIN_MANAGER, BraseroPluginManagerPrivate))
 
 G_DEFINE_TYPE (BraseroPluginManager, brasero_plugin_manager, G_TYPE_OBJECT);
@@ -354,15 +356,78 @@ brasero_plugin_manager_init (BraseroPluginManager *self)
 
 #endif
 
+static void
+brasero_plugin_manager_check_plugin_thread (gpointer data,
+                                            gpointer user_data)
+{
+	brasero_plugin_check_plugin_ready (BRASERO_PLUGIN (data));
+}
+
+static void
+brasero_plugin_manager_check_plugins (BraseroPluginManager *self)
+{
+	BraseroPluginManagerPrivate *priv;
+	GThreadPool *pool;
+	GSList *iter;
+
+	priv = BRASERO_PLUGIN_MANAGER_PRIVATE (self);
+
+	/* Plugins that didn't say their checks are thread safe are checked
+	 * first, one by one, from this thread so that nothing else runs at
+	 * the same time. */
+	for (iter = priv->plugins; iter; iter = iter->next) {
+		BraseroPlugin *plugin;
+
+		plugin = iter->data;
+		if (brasero_plugin_get_gtype (plugin) == G_TYPE_NONE)
+			continue;
+
+		if (!brasero_plugin_get_check_thread_safe (plugin))
+			brasero_plugin_check_plugin_ready (plugin);
+	}
+
+	/* Most checks consist in looking for programs and running them to get
+	 * their version so they are run concurrently. */
+	pool = g_thread_pool_new (brasero_plugin_manager_check_plugin_thread,
+				  NULL,
+				  BRASERO_PLUGIN_MANAGER_CHECK_THREADS,
+				  TRUE,
+				  NULL);
+
+	for (iter = priv->plugins; iter; iter = iter->next) {
+		BraseroPlugin *plugin;
+
+		plugin = iter->data;
+		if (brasero_plugin_get_gtype (plugin) == G_TYPE_NONE)
+			continue;
+
+		if (!brasero_plugin_get_check_thread_safe (plugin))
+			continue;
+
+		if (pool)
+			g_thread_pool_push (pool, plugin, NULL);
+		else
+			brasero_plugin_check_plugin_ready (plugin);
+	}
+
+	/* Wait for all checks to be over */
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	brasero_plugin_save_app_cache ();
+}
+
 static void
 brasero_plugin_manager_init (BraseroPluginManager *self)
 {
 	GDir *directory;
 	const gchar *name;
 	GError *error = NULL;
+	gint64 start, loaded, checked;
 	BraseroPluginManagerPrivate *priv;
 
 	priv = BRASERO_PLUGIN_MANAGER_PRIVATE (self);
+	start = g_get_monotonic_time ();
 
 	priv->settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
 	g_signal_connect (priv->settings,
@@ -438,7 +503,17 @@ brasero_plugin_manager_init (BraseroPluginManager *self)
 	}
 	g_dir_close (directory);
 
+	loaded = g_get_monotonic_time ();
+	brasero_plugin_manager_check_plugins (self);
+	checked = g_get_monotonic_time ();
+
 	brasero_plugin_manager_set_plugins_state (self);
+
+	BRASERO_BURN_LOG ("Plugins: %i loaded in %.1f ms, checked in %.1f ms, set up in %.1f ms",
+			  g_slist_length (priv->plugins),
+			  (loaded - start) / 1000.0,
+			  (checked - loaded) / 1000.0,
+			  (g_get_monotonic_time () - checked) / 1000.0);
 }
 
 static void
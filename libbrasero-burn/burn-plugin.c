@@ -33,9 +33,12 @@
 #endif
 
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
 #include <glib/gi18n-lib.h>
 
@@ -122,6 +125,7 @@ struct _BraseroPluginPrivate
 	BraseroPluginProcessFlag process_flags;
 
 	guint compulsory:1;
+	guint check_thread_safe:1;
 };
 
 static const gchar *default_icon = "gtk-cdrom";
@@ -146,6 +150,25 @@ enum
 static GTypeModuleClass* parent_class = NULL;
 static guint plugin_signals [LAST_SIGNAL] = { 0 };
 
+/* Incremented whenever a change could alter the result of
+ * brasero_plugin_get_active () for any plugin. */
+static gint plugin_state_serial = 0;
+
+/**
+ * brasero_plugin_get_state_serial:
+ *
+ * Returns a number that changes every time a plugin is (de)activated, has its
+ * priority changed or its errors updated. That allows caching results that
+ * depend on the state of plugins.
+ *
+ * Return value: a #guint
+ **/
+guint
+brasero_plugin_get_state_serial (void)
+{
+	return g_atomic_int_get (&plugin_state_serial);
+}
+
 static void
 brasero_plugin_error_free (BraseroPluginError *error)
 {
@@ -170,6 +193,7 @@ brasero_plugin_add_error (BraseroPlugin *plugin,
 	error->type = type;
 
 	priv->errors = g_slist_prepend (priv->errors, error);
+	g_atomic_int_inc (&plugin_state_serial);
 }
 
 void
@@ -188,6 +212,137 @@ brasero_plugin_test_gstreamer_plugin (BraseroPlugin *plugin,
 		gst_object_unref (element);
 }
 
+/**
+ * The output of the programs run to get their version is cached on disk so
+ * that they don't need to be spawned again on each start. An entry is valid
+ * as long as the path, modification time and inode of the program are the
+ * same.
+ */
+
+#define BRASERO_APP_CACHE_MTIME		"mtime"
+#define BRASERO_APP_CACHE_INODE		"inode"
+#define BRASERO_APP_CACHE_OUTPUT	"output"
+#define BRASERO_APP_CACHE_ERROR		"error"
+
+G_LOCK_DEFINE_STATIC (app_cache);
+static GKeyFile *app_cache = NULL;
+static gboolean app_cache_dirty = FALSE;
+static guint app_cache_hits = 0;
+static guint app_cache_spawns = 0;
+
+static gchar *
+brasero_plugin_app_cache_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "app-versions",
+				 NULL);
+}
+
+static void
+brasero_plugin_app_cache_load (void)
+{
+	gchar *path;
+
+	if (app_cache)
+		return;
+
+	app_cache = g_key_file_new ();
+
+	path = brasero_plugin_app_cache_get_path ();
+	g_key_file_load_from_file (app_cache, path, G_KEY_FILE_NONE, NULL);
+	g_free (path);
+}
+
+static gboolean
+brasero_plugin_app_cache_lookup (const gchar *group,
+                                 struct stat *info,
+                                 gchar **standard_output,
+                                 gchar **standard_error)
+{
+	gboolean result = FALSE;
+
+	G_LOCK (app_cache);
+
+	brasero_plugin_app_cache_load ();
+
+	if (g_key_file_has_group (app_cache, group)
+	&&  g_key_file_get_int64 (app_cache, group, BRASERO_APP_CACHE_MTIME, NULL) == (gint64) info->st_mtime
+	&&  g_key_file_get_uint64 (app_cache, group, BRASERO_APP_CACHE_INODE, NULL) == (guint64) info->st_ino) {
+		*standard_output = g_key_file_get_string (app_cache, group, BRASERO_APP_CACHE_OUTPUT, NULL);
+		*standard_error = g_key_file_get_string (app_cache, group, BRASERO_APP_CACHE_ERROR, NULL);
+		app_cache_hits ++;
+		result = TRUE;
+	}
+
+	G_UNLOCK (app_cache);
+
+	return result;
+}
+
+static void
+brasero_plugin_app_cache_store (const gchar *group,
+                                struct stat *info,
+                                const gchar *standard_output,
+                                const gchar *standard_error)
+{
+	G_LOCK (app_cache);
+
+	brasero_plugin_app_cache_load ();
+
+	g_key_file_remove_group (app_cache, group, NULL);
+	g_key_file_set_int64 (app_cache, group, BRASERO_APP_CACHE_MTIME, info->st_mtime);
+	g_key_file_set_uint64 (app_cache, group, BRASERO_APP_CACHE_INODE, info->st_ino);
+	g_key_file_set_string (app_cache, group, BRASERO_APP_CACHE_OUTPUT, standard_output ? standard_output:"");
+	g_key_file_set_string (app_cache, group, BRASERO_APP_CACHE_ERROR, standard_error ? standard_error:"");
+	app_cache_dirty = TRUE;
+	app_cache_spawns ++;
+
+	G_UNLOCK (app_cache);
+}
+
+/**
+ * brasero_plugin_save_app_cache:
+ *
+ * Writes the versions of the programs found while checking plugins to disk
+ * if there were any changes.
+ **/
+void
+brasero_plugin_save_app_cache (void)
+{
+	G_LOCK (app_cache);
+
+	BRASERO_BURN_LOG ("Program versions: %u cached, %u spawned",
+			  app_cache_hits,
+			  app_cache_spawns);
+
+	if (app_cache && app_cache_dirty) {
+		GError *error = NULL;
+		gchar *directory;
+		gchar *data;
+		gchar *path;
+		gsize size;
+
+		path = brasero_plugin_app_cache_get_path ();
+		directory = g_path_get_dirname (path);
+		g_mkdir_with_parents (directory, 0700);
+		g_free (directory);
+
+		data = g_key_file_to_data (app_cache, &size, NULL);
+		if (!g_file_set_contents (path, data, size, &error)) {
+			BRASERO_BURN_LOG ("Program versions could not be saved: %s", error->message);
+			g_error_free (error);
+		}
+		else
+			app_cache_dirty = FALSE;
+
+		g_free (data);
+		g_free (path);
+	}
+
+	G_UNLOCK (app_cache);
+}
+
 void
 brasero_plugin_test_app (BraseroPlugin *plugin,
                          const gchar *name,
@@ -198,9 +353,11 @@ brasero_plugin_test_app (BraseroPlugin *plugin,
 	gchar *standard_output = NULL;
 	gchar *standard_error = NULL;
 	guint major, minor, sub;
+	struct stat info;
 	gchar *prog_path;
 	GPtrArray *argv;
 	gboolean res;
+	gchar *group;
 	int i;
 
 	/* First see if this plugin can be used, i.e. if cdrecord is in
@@ -248,6 +405,15 @@ brasero_plugin_test_app (BraseroPlugin *plugin,
 		return;
 	}
 
+	/* See if we already know the version of this very program */
+	group = g_strconcat (prog_path, " ", version_arg, NULL);
+	if (g_stat (prog_path, &info) == 0
+	&&  brasero_plugin_app_cache_lookup (group, &info, &standard_output, &standard_error)) {
+		g_free (group);
+		g_free (prog_path);
+		goto check_version;
+	}
+
 	/* Check version */
 	argv = g_ptr_array_new ();
 	g_ptr_array_add (argv, prog_path);
@@ -266,15 +432,24 @@ brasero_plugin_test_app (BraseroPlugin *plugin,
 	                    NULL);
 
 	g_ptr_array_free (argv, TRUE);
-	g_free (prog_path);
 
 	if (!res) {
+		g_free (group);
+		g_free (prog_path);
 		brasero_plugin_add_error (plugin,
 		                          BRASERO_PLUGIN_ERROR_WRONG_APP_VERSION,
 		                          name);
 		return;
 	}
 
+	if (g_stat (prog_path, &info) == 0)
+		brasero_plugin_app_cache_store (group, &info, standard_output, standard_error);
+
+	g_free (group);
+	g_free (prog_path);
+
+check_version:
+
 	for (i = 0; i < 3 && version [i] >= 0; i++);
 
 	if ((standard_output && sscanf (standard_output, version_format, &major, &minor, &sub) == i)
@@ -314,6 +489,25 @@ brasero_plugin_get_compulsory (BraseroPlugin *self)
 	return priv->compulsory;
 }
 
+void
+brasero_plugin_set_check_thread_safe (BraseroPlugin *self,
+				      gboolean thread_safe)
+{
+	BraseroPluginPrivate *priv;
+
+	priv = BRASERO_PLUGIN_PRIVATE (self);
+	priv->check_thread_safe = thread_safe;
+}
+
+gboolean
+brasero_plugin_get_check_thread_safe (BraseroPlugin *self)
+{
+	BraseroPluginPrivate *priv;
+
+	priv = BRASERO_PLUGIN_PRIVATE (self);
+	return priv->check_thread_safe;
+}
+
 void
 brasero_plugin_set_active (BraseroPlugin *self, gboolean active)
 {
@@ -325,6 +519,7 @@ brasero_plugin_set_active (BraseroPlugin *self, gboolean active)
 
 	was_active = brasero_plugin_get_active (self, FALSE);
 	priv->active = active;
+	g_atomic_int_inc (&plugin_state_serial);
 
 	now_active = brasero_plugin_get_active (self, FALSE);
 	if (was_active == now_active)
@@ -1185,6 +1380,7 @@ brasero_plugin_priority_changed (GSettings *settings,
 
 	/* At the moment it can only be the priority key */
 	priv->priority = g_settings_get_int (settings, BRASERO_PROPS_PRIORITY_KEY);
+	g_atomic_int_inc (&plugin_state_serial);
 
 	is_active = brasero_plugin_get_active (self, FALSE);
 
@@ -1211,6 +1407,7 @@ void
 brasero_plugin_check_plugin_ready (BraseroPlugin *plugin)
 {
 	GModule *handle;
+	gint64 start;
 	BraseroPluginPrivate *priv;
 	BraseroPluginCheckConfig function = NULL;
 
@@ -1223,6 +1420,9 @@ brasero_plugin_check_plugin_ready (BraseroPlugin *plugin)
 		priv->errors = NULL;
 	}
 
+	/* Also covers the caps links registered before the plugin is checked */
+	g_atomic_int_inc (&plugin_state_serial);
+
 	handle = g_module_open (priv->path, 0);
 	if (!handle) {
 		brasero_plugin_add_error (plugin, BRASERO_PLUGIN_ERROR_MODULE, g_module_error ());
@@ -1236,7 +1436,11 @@ brasero_plugin_check_plugin_ready (BraseroPlugin *plugin)
 		return;
 	}
 
+	start = g_get_monotonic_time ();
 	function (BRASERO_PLUGIN (plugin));
+	BRASERO_BURN_LOG ("Module %s checked in %.1f ms",
+			  priv->name,
+			  (g_get_monotonic_time () - start) / 1000.0);
 	g_module_close (handle);
 }
 
@@ -1292,8 +1496,9 @@ brasero_plugin_init_real (BraseroPlugin *object)
 	                  G_CALLBACK (brasero_plugin_priority_changed),
 	                  object);
 
-	/* Check if it can operate */
-	brasero_plugin_check_plugin_ready (object);
+	/* Whether it can operate is checked later by the plugin manager with
+	 * brasero_plugin_check_plugin_ready () so that all plugins are checked
+	 * at the same time. */
 
 	g_module_close (handle);
 }
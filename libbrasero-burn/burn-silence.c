@@ -0,0 +1,229 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#ifdef HAVE_SPLICE
+#  ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#  endif
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+#include <gio/gio.h>
+
+#include "brasero-error.h"
+#include "burn-silence.h"
+
+/* NOTE: this is not const so that it ends up in .bss and not in the binary */
+static guchar silence [BRASERO_SILENCE_BLOCK_SIZE];
+
+/**
+ * Returns the number of bytes needed to complete the last sector.
+ */
+
+gint64
+brasero_silence_get_padding (gint64 bytes,
+			     gint64 sector_size)
+{
+	if (sector_size <= 0)
+		return 0;
+
+	return (bytes % sector_size) ? sector_size - (bytes % sector_size) : 0;
+}
+
+/**
+ * Waits (without a timeout) for fd to become writable again or for the
+ * operation to be cancelled. Returns FALSE if it was cancelled.
+ */
+
+static gboolean
+brasero_silence_wait_writable (int fd,
+			       GCancellable *cancel)
+{
+	GPollFD fds [2];
+	gint num = 1;
+
+	fds [0].fd = fd;
+	fds [0].events = G_IO_OUT|G_IO_ERR|G_IO_HUP;
+	fds [0].revents = 0;
+
+	if (cancel && g_cancellable_make_pollfd (cancel, &fds [1]))
+		num = 2;
+
+	while (g_poll (fds, num, -1) == -1 && errno == EINTR);
+
+	if (num == 2)
+		g_cancellable_release_fd (cancel);
+
+	return !g_cancellable_is_cancelled (cancel);
+}
+
+#ifdef HAVE_SPLICE
+
+/**
+ * When the output is a pipe, the kernel can fill it with zeros straight from
+ * /dev/zero. Returns the number of bytes written; the caller writes the rest
+ * (if any) in case it is not supported.
+ */
+
+static gint64
+brasero_silence_splice (int fd,
+			gint64 bytes,
+			GCancellable *cancel)
+{
+	gint64 written = 0;
+	struct stat info;
+	int zero;
+
+	if (fstat (fd, &info) == -1 || !S_ISFIFO (info.st_mode))
+		return 0;
+
+	zero = open ("/dev/zero", O_RDONLY);
+	if (zero == -1)
+		return 0;
+
+	while (written < bytes) {
+		ssize_t res;
+
+		if (g_cancellable_is_cancelled (cancel))
+			break;
+
+		res = splice (zero,
+			      NULL,
+			      fd,
+			      NULL,
+			      MIN (bytes - written, BRASERO_SILENCE_BLOCK_SIZE),
+			      SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+		if (res > 0) {
+			written += res;
+			continue;
+		}
+
+		if (res == -1 && errno == EINTR)
+			continue;
+
+		if (res == -1 && errno == EAGAIN) {
+			if (!brasero_silence_wait_writable (fd, cancel))
+				break;
+
+			continue;
+		}
+
+		/* Not supported (EINVAL) or a real error that the
+		 * write () path will report */
+		break;
+	}
+
+	close (zero);
+	return written;
+}
+
+#endif
+
+/**
+ * Writes bytes of silence to fd. This is blocking and meant to be called from
+ * a thread; when fd is non blocking, it waits for it to be writable instead
+ * of polling it.
+ */
+
+BraseroBurnResult
+brasero_silence_write (int fd,
+		       gint64 bytes,
+		       GCancellable *cancel,
+		       GError **error)
+{
+#ifdef HAVE_SPLICE
+	bytes -= brasero_silence_splice (fd, bytes, cancel);
+#endif
+
+	while (bytes > 0) {
+		ssize_t written;
+
+		if (g_cancellable_is_cancelled (cancel))
+			return BRASERO_BURN_CANCEL;
+
+		written = write (fd, silence, MIN (bytes, (gint64) sizeof (silence)));
+		if (written > 0) {
+			bytes -= written;
+			continue;
+		}
+
+		if (written == -1 && errno == EINTR)
+			continue;
+
+		if (written == -1 && errno == EAGAIN) {
+			if (!brasero_silence_wait_writable (fd, cancel))
+				return BRASERO_BURN_CANCEL;
+
+			continue;
+		}
+
+		if (written <= 0) {
+			int errsv = errno;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     /* Translators: %s is the string error from errno */
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			return BRASERO_BURN_ERR;
+		}
+	}
+
+	if (g_cancellable_is_cancelled (cancel))
+		return BRASERO_BURN_CANCEL;
+
+	return BRASERO_BURN_OK;
+}
+
+BraseroBurnResult
+brasero_silence_write_sectors (int fd,
+			       gint64 sectors,
+			       gint64 sector_size,
+			       GCancellable *cancel,
+			       GError **error)
+{
+	return brasero_silence_write (fd,
+				      sectors * sector_size,
+				      cancel,
+				      error);
+}
@@ -0,0 +1,68 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+#ifndef _BURN_SILENCE_H
+#define _BURN_SILENCE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "brasero-enums.h"
+
+G_BEGIN_DECLS
+
+/**
+ * Size of the buffer of silence (zeros) written at once. It is a multiple of
+ * both the size of an audio sector (2352) and of a data sector (2048) since
+ * 301056 is their least common multiple.
+ */
+#define BRASERO_SILENCE_BLOCK_SIZE		(301056 * 4)
+
+gint64
+brasero_silence_get_padding (gint64 bytes,
+			     gint64 sector_size);
+
+BraseroBurnResult
+brasero_silence_write (int fd,
+		       gint64 bytes,
+		       GCancellable *cancel,
+		       GError **error);
+
+BraseroBurnResult
+brasero_silence_write_sectors (int fd,
+			       gint64 sectors,
+			       gint64 sector_size,
+			       GCancellable *cancel,
+			       GError **error);
+
+G_END_DECLS
+
+#endif /* _BURN_SILENCE_H */
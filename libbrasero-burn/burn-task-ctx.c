@@ -33,6 +33,7 @@
 #endif
 
 #include <math.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -43,6 +44,7 @@
 #include "brasero-session-helper.h"
 #include "burn-debug.h"
 #include "burn-task-ctx.h"
+#include "burn-telemetry.h"
 
 typedef struct _BraseroTaskCtxPrivate BraseroTaskCtxPrivate;
 struct _BraseroTaskCtxPrivate
@@ -83,6 +85,12 @@ struct _BraseroTaskCtxPrivate
 	/* used for rates that certain jobs are able to report */
 	guint64 rate;
 
+	/* per job throughput samples (shared with BraseroBurn) */
+	BraseroTelemetry *telemetry;
+
+	/* pipe feeding the first job instead of the tracks (fan-out) */
+	int input_fd;
+
 	/* the current action */
 	BraseroBurnAction current_action;
 	gchar *action_string;
@@ -541,6 +549,9 @@ brasero_task_ctx_report_progress (BraseroTaskCtx *self)
 		}
 	}
 
+	if (priv->telemetry)
+		brasero_telemetry_sample (priv->telemetry);
+
 	if (priv->progress_changed) {
 		priv->progress_changed = 0;
 		g_signal_emit (self,
@@ -555,6 +566,71 @@ brasero_task_ctx_report_progress (BraseroTaskCtx *self)
 	}
 }
 
+void
+brasero_task_ctx_set_telemetry (BraseroTaskCtx *self,
+				BraseroTelemetry *telemetry)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_if_fail (BRASERO_IS_TASK_CTX (self));
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	if (telemetry)
+		brasero_telemetry_ref (telemetry);
+
+	if (priv->telemetry)
+		brasero_telemetry_unref (priv->telemetry);
+
+	priv->telemetry = telemetry;
+}
+
+BraseroTelemetryChannel *
+brasero_task_ctx_get_telemetry_channel (BraseroTaskCtx *self,
+					const gchar *name)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_TASK_CTX (self), NULL);
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+	if (!priv->telemetry)
+		return NULL;
+
+	return brasero_telemetry_get_channel (priv->telemetry, name);
+}
+
+void
+brasero_task_ctx_set_input_fd (BraseroTaskCtx *self,
+			       int fd)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_if_fail (BRASERO_IS_TASK_CTX (self));
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	if (priv->input_fd >= 0)
+		close (priv->input_fd);
+
+	priv->input_fd = fd;
+}
+
+int
+brasero_task_ctx_steal_input_fd (BraseroTaskCtx *self)
+{
+	BraseroTaskCtxPrivate *priv;
+	int fd;
+
+	g_return_val_if_fail (BRASERO_IS_TASK_CTX (self), -1);
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	fd = priv->input_fd;
+	priv->input_fd = -1;
+	return fd;
+}
+
 BraseroBurnResult
 brasero_task_ctx_set_rate (BraseroTaskCtx *self,
 			   gint64 rate)
@@ -748,6 +824,11 @@ brasero_task_ctx_set_current_action (BraseroTaskCtx *self,
 		priv->update_action_string = 1;
 	}
 	else {
+		if (priv->current_action != BRASERO_BURN_ACTION_NONE)
+			BRASERO_BURN_LOG_STAGE_END ("%s", brasero_burn_action_to_string (priv->current_action));
+		if (action != BRASERO_BURN_ACTION_NONE)
+			BRASERO_BURN_LOG_STAGE_BEGIN ("%s", brasero_burn_action_to_string (action));
+
 		g_mutex_lock (priv->lock);
 
 		priv->current_action = action;
@@ -1051,6 +1132,7 @@ brasero_task_ctx_init (BraseroTaskCtx *object)
 
 	priv = BRASERO_TASK_CTX_PRIVATE (object);
 	priv->lock = g_mutex_new ();
+	priv->input_fd = -1;
 }
 
 static void
@@ -1086,6 +1168,16 @@ brasero_task_ctx_finalize (GObject *object)
 		priv->session = NULL;
 	}
 
+	if (priv->telemetry) {
+		brasero_telemetry_unref (priv->telemetry);
+		priv->telemetry = NULL;
+	}
+
+	if (priv->input_fd >= 0) {
+		close (priv->input_fd);
+		priv->input_fd = -1;
+	}
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
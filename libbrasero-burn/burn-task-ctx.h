@@ -35,6 +35,7 @@
 
 #include "burn-basics.h"
 #include "brasero-session.h"
+#include "burn-telemetry.h"
 
 G_BEGIN_DECLS
 
@@ -144,6 +145,31 @@ brasero_task_ctx_report_progress (BraseroTaskCtx *ctx);
 void
 brasero_task_ctx_stop_progress (BraseroTaskCtx *ctx);
 
+/**
+ * Throughput and latency samples; the telemetry object is owned by the caller
+ * (BraseroBurn) and outlives the tasks
+ */
+
+void
+brasero_task_ctx_set_telemetry (BraseroTaskCtx *ctx,
+				BraseroTelemetry *telemetry);
+
+BraseroTelemetryChannel *
+brasero_task_ctx_get_telemetry_channel (BraseroTaskCtx *ctx,
+					const gchar *name);
+
+/**
+ * The first job reads from @fd instead of the tracks of the session. The
+ * task owns @fd; the first job to start takes it over.
+ */
+
+void
+brasero_task_ctx_set_input_fd (BraseroTaskCtx *ctx,
+			       int fd);
+
+int
+brasero_task_ctx_steal_input_fd (BraseroTaskCtx *ctx);
+
 /**
  * task progress report for jobs
  */
@@ -51,6 +51,7 @@
 static void brasero_task_class_init (BraseroTaskClass *klass);
 static void brasero_task_init (BraseroTask *sp);
 static void brasero_task_finalize (GObject *object);
+static gboolean brasero_task_done_cb (gpointer data);
 
 typedef struct _BraseroTaskPrivate BraseroTaskPrivate;
 
@@ -61,6 +62,12 @@ struct _BraseroTaskPrivate {
 	/* used to poll for progress (every 0.5 sec) */
 	gint clock_id;
 
+	/* set when the task runs without a loop of its own */
+	BraseroTaskDoneFunc done_func;
+	gpointer done_data;
+	guint done_id;
+	guint async:1;
+
 	BraseroTaskItem *leader;
 	BraseroTaskItem *first;
 
@@ -359,6 +366,13 @@ brasero_task_stop (BraseroTask *task,
 
 	if (priv->loop && g_main_loop_is_running (priv->loop))
 		g_main_loop_quit (priv->loop);
+	else if (priv->async) {
+		/* The callback may well destroy the task or start another
+		 * one so don't call it from within a job */
+		priv->async = FALSE;
+		if (!priv->done_id)
+			priv->done_id = g_idle_add (brasero_task_done_cb, task);
+	}
 	else
 		BRASERO_BURN_LOG ("task was asked to stop (%i/%i) during ::init or ::start",
 				  result, retval);
@@ -381,7 +395,7 @@ brasero_task_is_running (BraseroTask *task)
 	BraseroTaskPrivate *priv;
 
 	priv = BRASERO_TASK_PRIVATE (task);
-	return (priv->loop && g_main_loop_is_running (priv->loop));
+	return priv->async || (priv->loop && g_main_loop_is_running (priv->loop));
 }
 
 static void
@@ -420,9 +434,8 @@ brasero_task_finished (BraseroTaskCtx *ctx,
 	brasero_task_stop (self, retval, error);
 }
 
-static BraseroBurnResult
-brasero_task_run_loop (BraseroTask *self,
-		       GError **error)
+static void
+brasero_task_begin (BraseroTask *self)
 {
 	BraseroTaskPrivate *priv;
 
@@ -433,18 +446,15 @@ brasero_task_run_loop (BraseroTask *self,
 	priv->clock_id = g_timeout_add (500,
 					brasero_task_clock_tick,
 					self);
+}
 
-	priv->loop = g_main_loop_new (NULL, FALSE);
-
-	BRASERO_BURN_LOG ("entering loop");
-
-	GDK_THREADS_LEAVE ();  
-	g_main_loop_run (priv->loop);
-	GDK_THREADS_ENTER ();
+static BraseroBurnResult
+brasero_task_end (BraseroTask *self,
+		  GError **error)
+{
+	BraseroTaskPrivate *priv;
 
-	BRASERO_BURN_LOG ("got out of loop");
-	g_main_loop_unref (priv->loop);
-	priv->loop = NULL;
+	priv = BRASERO_TASK_PRIVATE (self);
 
 	if (priv->error) {
 		g_propagate_error (error, priv->error);
@@ -467,6 +477,68 @@ brasero_task_run_loop (BraseroTask *self,
 	return priv->retval;	
 }
 
+static BraseroBurnResult
+brasero_task_run_loop (BraseroTask *self,
+		       GError **error)
+{
+	BraseroTaskPrivate *priv;
+
+	priv = BRASERO_TASK_PRIVATE (self);
+
+	brasero_task_begin (self);
+
+	/* Without a loop, the task returns at once and the result is given
+	 * to the callback once it is stopped (see brasero_task_stop ()) */
+	if (priv->done_func) {
+		BRASERO_BURN_LOG ("running without loop");
+		priv->async = TRUE;
+		return BRASERO_BURN_RUNNING;
+	}
+
+	priv->loop = g_main_loop_new (NULL, FALSE);
+
+	BRASERO_BURN_LOG ("entering loop");
+
+	GDK_THREADS_LEAVE ();  
+	g_main_loop_run (priv->loop);
+	GDK_THREADS_ENTER ();
+
+	BRASERO_BURN_LOG ("got out of loop");
+	g_main_loop_unref (priv->loop);
+	priv->loop = NULL;
+
+	return brasero_task_end (self, error);
+}
+
+static gboolean
+brasero_task_done_cb (gpointer data)
+{
+	BraseroTask *self = BRASERO_TASK (data);
+	BraseroTaskDoneFunc done_func;
+	BraseroTaskPrivate *priv;
+	BraseroBurnResult result;
+	GError *error = NULL;
+	gpointer done_data;
+
+	priv = BRASERO_TASK_PRIVATE (self);
+	priv->done_id = 0;
+
+	result = brasero_task_end (self, &error);
+
+	done_func = priv->done_func;
+	done_data = priv->done_data;
+	priv->done_func = NULL;
+	priv->done_data = NULL;
+
+	BRASERO_BURN_LOG ("task finished without loop (%i)", result);
+
+	g_object_ref (self);
+	done_func (self, result, error, done_data);
+	g_object_unref (self);
+
+	return FALSE;
+}
+
 static BraseroBurnResult
 brasero_task_set_track_output_size_default (BraseroTask *self,
 					    GError **error)
@@ -635,7 +707,7 @@ brasero_task_start (BraseroTask *self,
 		result = brasero_task_start_items (self, error);
 	}
 
-	if (result != BRASERO_BURN_OK)
+	if (result != BRASERO_BURN_OK && result != BRASERO_BURN_RUNNING)
 		brasero_task_send_stop_signal (self, result, NULL);
 
 	return result;
@@ -682,6 +754,39 @@ brasero_task_run (BraseroTask *self,
 	return brasero_task_start (self, FALSE, error);
 }
 
+/**
+ * Same as above except that it doesn't run a loop of its own. If it returns
+ * BRASERO_BURN_RUNNING the task was started and @func will be called from
+ * the main loop once it stops; @func then owns the error. Any other result
+ * is the one of the task and @func won't be called.
+ */
+
+BraseroBurnResult
+brasero_task_run_async (BraseroTask *self,
+			BraseroTaskDoneFunc func,
+			gpointer user_data,
+			GError **error)
+{
+	BraseroTaskPrivate *priv;
+	BraseroBurnResult result;
+
+	g_return_val_if_fail (BRASERO_IS_TASK (self), BRASERO_BURN_ERR);
+	g_return_val_if_fail (func != NULL, BRASERO_BURN_ERR);
+
+	priv = BRASERO_TASK_PRIVATE (self);
+
+	priv->done_func = func;
+	priv->done_data = user_data;
+
+	result = brasero_task_start (self, FALSE, error);
+	if (result != BRASERO_BURN_RUNNING) {
+		priv->done_func = NULL;
+		priv->done_data = NULL;
+	}
+
+	return result;
+}
+
 static void
 brasero_task_class_init (BraseroTaskClass *klass)
 {
@@ -709,6 +814,11 @@ brasero_task_finalize (GObject *object)
 	cobj = BRASERO_TASK (object);
 	priv = BRASERO_TASK_PRIVATE (cobj);
 
+	if (priv->done_id) {
+		g_source_remove (priv->done_id);
+		priv->done_id = 0;
+	}
+
 	if (priv->leader) {
 		g_object_unref (priv->leader);
 		priv->leader = NULL;
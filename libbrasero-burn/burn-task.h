@@ -73,6 +73,17 @@ BraseroBurnResult
 brasero_task_run (BraseroTask *task,
 		  GError **error);
 
+typedef void (*BraseroTaskDoneFunc) (BraseroTask *task,
+				     BraseroBurnResult result,
+				     GError *error,
+				     gpointer user_data);
+
+BraseroBurnResult
+brasero_task_run_async (BraseroTask *task,
+			BraseroTaskDoneFunc func,
+			gpointer user_data,
+			GError **error);
+
 BraseroBurnResult
 brasero_task_check (BraseroTask *task,
 		    GError **error);
@@ -0,0 +1,291 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "burn-telemetry.h"
+
+typedef struct _BraseroTelemetrySample BraseroTelemetrySample;
+struct _BraseroTelemetrySample {
+	gint64 time;		/* microseconds since the telemetry was created */
+	guint64 bytes_in;
+	guint64 bytes_out;
+	gint64 stall_in;	/* cumulative microseconds spent waiting */
+	gint64 stall_out;
+	gint buffer_fill;	/* percent, -1 when not reported */
+};
+
+struct _BraseroTelemetryChannel {
+	gchar *name;
+
+	/* Running totals; protected by the telemetry lock */
+	BraseroTelemetrySample current;
+
+	BraseroTelemetrySample samples [BRASERO_TELEMETRY_SAMPLES];
+	guint first;
+	guint num;
+
+	BraseroTelemetry *telemetry;
+};
+
+struct _BraseroTelemetry {
+	gint ref;
+
+	GMutex *lock;
+	gint64 start;
+
+	/* Kept in the order jobs were started */
+	GSList *channels;
+};
+
+BraseroTelemetry *
+brasero_telemetry_new (void)
+{
+	BraseroTelemetry *telemetry;
+
+	telemetry = g_new0 (BraseroTelemetry, 1);
+	telemetry->ref = 1;
+	telemetry->lock = g_mutex_new ();
+	telemetry->start = g_get_monotonic_time ();
+	return telemetry;
+}
+
+BraseroTelemetry *
+brasero_telemetry_ref (BraseroTelemetry *telemetry)
+{
+	g_return_val_if_fail (telemetry != NULL, NULL);
+
+	g_atomic_int_inc (&telemetry->ref);
+	return telemetry;
+}
+
+static void
+brasero_telemetry_channel_free (BraseroTelemetryChannel *channel)
+{
+	g_free (channel->name);
+	g_free (channel);
+}
+
+void
+brasero_telemetry_unref (BraseroTelemetry *telemetry)
+{
+	g_return_if_fail (telemetry != NULL);
+
+	if (!g_atomic_int_dec_and_test (&telemetry->ref))
+		return;
+
+	g_slist_foreach (telemetry->channels,
+			 (GFunc) brasero_telemetry_channel_free,
+			 NULL);
+	g_slist_free (telemetry->channels);
+	g_mutex_free (telemetry->lock);
+	g_free (telemetry);
+}
+
+/**
+ * Returns the channel named @name, creating it the first time. The channel
+ * lives as long as @telemetry so jobs may keep a pointer to it.
+ */
+
+BraseroTelemetryChannel *
+brasero_telemetry_get_channel (BraseroTelemetry *telemetry,
+			       const gchar *name)
+{
+	BraseroTelemetryChannel *channel;
+	GSList *iter;
+
+	g_return_val_if_fail (telemetry != NULL, NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	g_mutex_lock (telemetry->lock);
+	for (iter = telemetry->channels; iter; iter = iter->next) {
+		channel = iter->data;
+		if (!strcmp (channel->name, name)) {
+			g_mutex_unlock (telemetry->lock);
+			return channel;
+		}
+	}
+
+	channel = g_new0 (BraseroTelemetryChannel, 1);
+	channel->name = g_strdup (name);
+	channel->current.buffer_fill = -1;
+	channel->telemetry = telemetry;
+	telemetry->channels = g_slist_append (telemetry->channels, channel);
+	g_mutex_unlock (telemetry->lock);
+
+	return channel;
+}
+
+void
+brasero_telemetry_channel_add_io (BraseroTelemetryChannel *channel,
+				  guint64 bytes_in,
+				  guint64 bytes_out)
+{
+	g_return_if_fail (channel != NULL);
+
+	g_mutex_lock (channel->telemetry->lock);
+	channel->current.bytes_in += bytes_in;
+	channel->current.bytes_out += bytes_out;
+	g_mutex_unlock (channel->telemetry->lock);
+}
+
+/**
+ * Used when a backend only reports how much it wrote overall (which is the
+ * case for most of the external programs)
+ */
+
+void
+brasero_telemetry_channel_set_written (BraseroTelemetryChannel *channel,
+				       guint64 bytes)
+{
+	g_return_if_fail (channel != NULL);
+
+	g_mutex_lock (channel->telemetry->lock);
+	if (bytes > channel->current.bytes_out)
+		channel->current.bytes_out = bytes;
+	g_mutex_unlock (channel->telemetry->lock);
+}
+
+void
+brasero_telemetry_channel_add_stall (BraseroTelemetryChannel *channel,
+				     BraseroTelemetryStall stall,
+				     gint64 usec)
+{
+	g_return_if_fail (channel != NULL);
+
+	if (usec <= 0)
+		return;
+
+	g_mutex_lock (channel->telemetry->lock);
+	if (stall == BRASERO_TELEMETRY_STALL_INPUT)
+		channel->current.stall_in += usec;
+	else
+		channel->current.stall_out += usec;
+	g_mutex_unlock (channel->telemetry->lock);
+}
+
+void
+brasero_telemetry_channel_set_buffer_fill (BraseroTelemetryChannel *channel,
+					   gint percent)
+{
+	g_return_if_fail (channel != NULL);
+
+	g_mutex_lock (channel->telemetry->lock);
+	channel->current.buffer_fill = CLAMP (percent, 0, 100);
+	g_mutex_unlock (channel->telemetry->lock);
+}
+
+/**
+ * Takes a snapshot of the running totals of every channel. Once a ring is
+ * full the oldest sample is overwritten.
+ */
+
+void
+brasero_telemetry_sample (BraseroTelemetry *telemetry)
+{
+	gint64 now;
+	GSList *iter;
+
+	g_return_if_fail (telemetry != NULL);
+
+	now = g_get_monotonic_time () - telemetry->start;
+
+	g_mutex_lock (telemetry->lock);
+	for (iter = telemetry->channels; iter; iter = iter->next) {
+		BraseroTelemetryChannel *channel;
+		guint index;
+
+		channel = iter->data;
+		channel->current.time = now;
+
+		index = (channel->first + channel->num) % BRASERO_TELEMETRY_SAMPLES;
+		channel->samples [index] = channel->current;
+
+		if (channel->num < BRASERO_TELEMETRY_SAMPLES)
+			channel->num ++;
+		else
+			channel->first = (channel->first + 1) % BRASERO_TELEMETRY_SAMPLES;
+	}
+	g_mutex_unlock (telemetry->lock);
+}
+
+/**
+ * Returns a floating GVariant of type BRASERO_TELEMETRY_VARIANT_TYPE: for
+ * each channel its name and its samples from the oldest to the newest as
+ * (time, bytes in, bytes out, input stall, output stall, buffer fill).
+ */
+
+GVariant *
+brasero_telemetry_to_variant (BraseroTelemetry *telemetry)
+{
+	GVariantBuilder builder;
+	GSList *iter;
+
+	g_return_val_if_fail (telemetry != NULL, NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (BRASERO_TELEMETRY_VARIANT_TYPE));
+
+	g_mutex_lock (telemetry->lock);
+	for (iter = telemetry->channels; iter; iter = iter->next) {
+		BraseroTelemetryChannel *channel;
+		guint i;
+
+		channel = iter->data;
+
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("(sa(xttxxi))"));
+		g_variant_builder_add (&builder, "s", channel->name);
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(xttxxi)"));
+
+		for (i = 0; i < channel->num; i ++) {
+			BraseroTelemetrySample *sample;
+
+			sample = channel->samples + ((channel->first + i) % BRASERO_TELEMETRY_SAMPLES);
+			g_variant_builder_add (&builder, "(xttxxi)",
+					       sample->time,
+					       sample->bytes_in,
+					       sample->bytes_out,
+					       sample->stall_in,
+					       sample->stall_out,
+					       sample->buffer_fill);
+		}
+
+		g_variant_builder_close (&builder);
+		g_variant_builder_close (&builder);
+	}
+	g_mutex_unlock (telemetry->lock);
+
+	return g_variant_builder_end (&builder);
+}
@@ -0,0 +1,91 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BURN_TELEMETRY_H
+#define _BURN_TELEMETRY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Samples kept for each job (at 2 samples a second this is 5 minutes) */
+#define BRASERO_TELEMETRY_SAMPLES	600
+
+/* Signature of the GVariant returned by brasero_telemetry_to_variant () */
+#define BRASERO_TELEMETRY_VARIANT_TYPE	"a(sa(xttxxi))"
+
+typedef enum {
+	BRASERO_TELEMETRY_STALL_INPUT,
+	BRASERO_TELEMETRY_STALL_OUTPUT
+} BraseroTelemetryStall;
+
+typedef struct _BraseroTelemetry BraseroTelemetry;
+typedef struct _BraseroTelemetryChannel BraseroTelemetryChannel;
+
+BraseroTelemetry *
+brasero_telemetry_new (void);
+
+BraseroTelemetry *
+brasero_telemetry_ref (BraseroTelemetry *telemetry);
+
+void
+brasero_telemetry_unref (BraseroTelemetry *telemetry);
+
+BraseroTelemetryChannel *
+brasero_telemetry_get_channel (BraseroTelemetry *telemetry,
+			       const gchar *name);
+
+void
+brasero_telemetry_sample (BraseroTelemetry *telemetry);
+
+GVariant *
+brasero_telemetry_to_variant (BraseroTelemetry *telemetry);
+
+void
+brasero_telemetry_channel_add_io (BraseroTelemetryChannel *channel,
+				  guint64 bytes_in,
+				  guint64 bytes_out);
+
+void
+brasero_telemetry_channel_set_written (BraseroTelemetryChannel *channel,
+				       guint64 bytes);
+
+void
+brasero_telemetry_channel_add_stall (BraseroTelemetryChannel *channel,
+				     BraseroTelemetryStall stall,
+				     gint64 usec);
+
+void
+brasero_telemetry_channel_set_buffer_fill (BraseroTelemetryChannel *channel,
+					   gint percent);
+
+G_END_DECLS
+
+#endif /* _BURN_TELEMETRY_H */
@@ -1094,3 +1094,71 @@ brasero_iso9660_get_directory_contents (BraseroVolSrc *vol,
 
 	return children;
 }
+
+gboolean
+brasero_iso9660_get_directories_contents (BraseroVolSrc *vol,
+					  const gchar *vol_desc,
+					  const gint *addresses,
+					  guint num,
+					  GList **contents,
+					  GError **error)
+{
+	BraseroIsoDirRec *record = NULL;
+	BraseroIsoPrimary *primary;
+	BraseroIsoDirRec *root;
+	GError *first_error = NULL;
+	BraseroIsoCtx ctx;
+	gint root_address;
+	guint i;
+
+	/* Same as above but the volume descriptor is read and the use of RR is
+	 * checked only once for the whole set of directories. The caller is
+	 * expected to sort addresses so that the reads go forward. */
+	primary = (BraseroIsoPrimary *) vol_desc;
+	root = primary->root_rec;
+	root_address = brasero_iso9660_get_733_val (root->address);
+
+	brasero_iso9660_ctx_init (&ctx, vol);
+	brasero_iso9660_get_first_directory_record (&ctx,
+						    &record,
+						    root_address);
+	brasero_iso9660_check_SUSP_RR_use (&ctx, record);
+
+	for (i = 0; i < num; i ++) {
+		BraseroIsoResult result;
+
+		BRASERO_MEDIA_LOG ("Loading directory at %i", addresses [i]);
+
+		result = brasero_iso9660_get_first_directory_record (&ctx,
+								     &record,
+								     addresses [i] > 0? addresses [i]:root_address);
+		if (result == BRASERO_ISO_OK)
+			contents [i] = brasero_iso9660_load_directory_records (&ctx,
+									       NULL,
+									       record,
+									       FALSE);
+		else
+			contents [i] = NULL;
+
+		/* A damaged directory should not prevent the others from
+		 * being loaded; only keep the first error around */
+		if (ctx.error) {
+			if (!first_error)
+				first_error = ctx.error;
+			else
+				g_error_free (ctx.error);
+
+			ctx.error = NULL;
+		}
+	}
+
+	if (ctx.spare_record)
+		g_free (ctx.spare_record);
+
+	if (first_error) {
+		g_propagate_error (error, first_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -80,6 +80,17 @@ brasero_iso9660_get_directory_contents (BraseroVolSrc *vol,
 					gint address,
 					GError **error);
 
+/**
+ * Addresses should be sorted; contents must hold num lists
+ */
+gboolean
+brasero_iso9660_get_directories_contents (BraseroVolSrc *vol,
+					  const gchar *vol_desc,
+					  const gint *addresses,
+					  guint num,
+					  GList **contents,
+					  GError **error);
+
 BraseroVolFile *
 brasero_iso9660_get_file (BraseroVolSrc *src,
 			  const gchar *path,
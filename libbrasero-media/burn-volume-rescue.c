@@ -0,0 +1,761 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * Rescue mode for damaged discs, modelled after what data recovery tools do.
+ * The area to read is described by a map of ranges of sectors that are:
+ * - UNTRIED: never read yet
+ * - SKIPPED: in a damaged area; passed over during the first pass
+ * - GOOD: read and written to the image
+ * - BAD: could not be read, even alone and at low speed
+ * Reading happens in three passes:
+ * 1. all untried sectors are read with large transfers at full speed. When a
+ *    read fails the transfer and the following sectors are skipped, the
+ *    number of skipped sectors doubling as long as reads fail. That gets all
+ *    the easily readable data first without the drive wasting time retrying.
+ * 2. the drive is slowed down and skipped areas are read with small
+ *    transfers, failing transfers being read again one sector at a time.
+ * 3. bad sectors are retried one at a time a few more times.
+ * The map is saved regularly so that an interrupted rescue resumes where it
+ * stopped, without reading good data again. The image is written in place
+ * (with pwrite) so it must be a regular file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "brasero-media.h"
+#include "brasero-media-private.h"
+#include "burn-iso9660.h"
+#include "burn-volume-source.h"
+#include "burn-volume-rescue.h"
+
+#include "scsi-mmc2.h"
+
+typedef enum {
+	BRASERO_VOL_RESCUE_UNTRIED,
+	BRASERO_VOL_RESCUE_SKIPPED,
+	BRASERO_VOL_RESCUE_GOOD,
+	BRASERO_VOL_RESCUE_BAD
+} BraseroVolRescueState;
+
+typedef struct _BraseroVolRescueRange BraseroVolRescueRange;
+struct _BraseroVolRescueRange {
+	guint64 start;
+	guint64 end;
+	BraseroVolRescueState state;
+};
+
+struct _BraseroVolRescue {
+	BraseroVolSrc *src;
+	BraseroDeviceHandle *handle;
+
+	guint64 start;
+	guint64 blocks;
+
+	/* Sorted ranges covering [start, start + blocks) */
+	GList *ranges;
+
+	/* Checksum of the volume descriptor identifying the disc in maps */
+	gchar *disc_id;
+
+	gint slow_speed;
+	guint slowed:1;
+
+	/* Used while running */
+	int fd;
+	const gchar *map_path;
+	gint64 last_save;
+	GCancellable *cancel;
+	BraseroVolRescueProgress progress;
+	gpointer user_data;
+	gchar *buffer;
+};
+
+/* Transfer sizes for the first and second passes */
+#define BRASERO_VOL_RESCUE_FAST_BLOCKS		256
+#define BRASERO_VOL_RESCUE_SLOW_BLOCKS		16
+
+/* Maximum number of sectors skipped at once in a damaged area */
+#define BRASERO_VOL_RESCUE_MAX_SKIP		4096
+
+/* Number of times bad sectors are retried during the last pass */
+#define BRASERO_VOL_RESCUE_RETRIES		2
+
+/* The volume descriptor comes after the system area */
+#define BRASERO_VOL_RESCUE_DESC_BLOCK		16
+
+/* The map is saved at least every 30 seconds */
+#define BRASERO_VOL_RESCUE_SAVE_DELAY		(30 * G_USEC_PER_SEC)
+
+#define BRASERO_VOL_RESCUE_GROUP		"Rescue"
+
+BraseroVolRescue *
+brasero_volume_rescue_new (BraseroVolSrc *src,
+			   BraseroDeviceHandle *handle,
+			   guint64 start,
+			   guint64 blocks)
+{
+	BraseroVolRescueRange *range;
+	BraseroVolRescue *rescue;
+
+	g_return_val_if_fail (src != NULL, NULL);
+	g_return_val_if_fail (blocks > 0, NULL);
+
+	rescue = g_new0 (BraseroVolRescue, 1);
+	rescue->src = src;
+	rescue->handle = handle;
+	rescue->start = start;
+	rescue->blocks = blocks;
+	rescue->fd = -1;
+	brasero_volume_source_ref (src);
+
+	range = g_new0 (BraseroVolRescueRange, 1);
+	range->start = start;
+	range->end = start + blocks;
+	range->state = BRASERO_VOL_RESCUE_UNTRIED;
+	rescue->ranges = g_list_prepend (NULL, range);
+
+	return rescue;
+}
+
+void
+brasero_volume_rescue_free (BraseroVolRescue *rescue)
+{
+	g_list_foreach (rescue->ranges, (GFunc) g_free, NULL);
+	g_list_free (rescue->ranges);
+
+	g_free (rescue->disc_id);
+	brasero_volume_source_close (rescue->src);
+	g_free (rescue);
+}
+
+/**
+ * Speed (in kB/s) used for the second and third passes. 0 (the default) means
+ * the drive speed is left untouched.
+ */
+
+void
+brasero_volume_rescue_set_slow_speed (BraseroVolRescue *rescue,
+				      gint speed)
+{
+	rescue->slow_speed = speed;
+}
+
+void
+brasero_volume_rescue_get_status (BraseroVolRescue *rescue,
+				  guint64 *good_ret,
+				  guint64 *bad_ret)
+{
+	guint64 good = 0;
+	guint64 bad = 0;
+	GList *iter;
+
+	for (iter = rescue->ranges; iter; iter = iter->next) {
+		BraseroVolRescueRange *range = iter->data;
+
+		if (range->state == BRASERO_VOL_RESCUE_GOOD)
+			good += range->end - range->start;
+		else if (range->state == BRASERO_VOL_RESCUE_BAD)
+			bad += range->end - range->start;
+	}
+
+	if (good_ret)
+		*good_ret = good;
+	if (bad_ret)
+		*bad_ret = bad;
+}
+
+static void
+brasero_volume_rescue_mark (BraseroVolRescue *rescue,
+			    guint64 start,
+			    guint64 end,
+			    BraseroVolRescueState state)
+{
+	BraseroVolRescueRange *range;
+	GList *iter, *next;
+
+	range = g_new0 (BraseroVolRescueRange, 1);
+	range->start = start;
+	range->end = end;
+	range->state = state;
+
+	/* Cut out [start, end) of the existing ranges */
+	for (iter = rescue->ranges; iter; iter = next) {
+		BraseroVolRescueRange *current = iter->data;
+
+		next = iter->next;
+		if (current->end <= start)
+			continue;
+
+		if (current->start >= end) {
+			next = iter;
+			break;
+		}
+
+		if (current->start < start && current->end > end) {
+			BraseroVolRescueRange *tail;
+
+			/* Split it in two around the new one */
+			tail = g_new0 (BraseroVolRescueRange, 1);
+			tail->start = end;
+			tail->end = current->end;
+			tail->state = current->state;
+			current->end = start;
+
+			rescue->ranges = g_list_insert_before (rescue->ranges, next, tail);
+			next = g_list_find (rescue->ranges, tail);
+			break;
+		}
+
+		if (current->start < start) {
+			current->end = start;
+			continue;
+		}
+
+		if (current->end > end) {
+			current->start = end;
+			next = iter;
+			break;
+		}
+
+		/* Entirely covered */
+		g_free (current);
+		rescue->ranges = g_list_delete_link (rescue->ranges, iter);
+	}
+
+	rescue->ranges = g_list_insert_before (rescue->ranges, next, range);
+
+	/* Merge with the neighbours in the same state */
+	iter = g_list_find (rescue->ranges, range);
+	if (iter->prev) {
+		BraseroVolRescueRange *prev = iter->prev->data;
+
+		if (prev->state == state && prev->end == range->start) {
+			prev->end = range->end;
+			rescue->ranges = g_list_delete_link (rescue->ranges, iter);
+			g_free (range);
+
+			range = prev;
+			iter = g_list_find (rescue->ranges, range);
+		}
+	}
+
+	if (iter->next) {
+		BraseroVolRescueRange *following = iter->next->data;
+
+		if (following->state == state && following->start == range->end) {
+			range->end = following->end;
+			rescue->ranges = g_list_delete_link (rescue->ranges, iter->next);
+			g_free (following);
+		}
+	}
+}
+
+/**
+ * The volume descriptor holds the volume id, the size and the creation and
+ * modification dates so its checksum tells two discs apart even when their
+ * areas have the same size. Returns NULL if it can't be read.
+ */
+
+static const gchar *
+brasero_volume_rescue_get_disc_id (BraseroVolRescue *rescue)
+{
+	gchar buffer [ISO9660_BLOCK_SIZE];
+
+	if (rescue->disc_id)
+		return rescue->disc_id;
+
+	if (rescue->blocks <= BRASERO_VOL_RESCUE_DESC_BLOCK)
+		return NULL;
+
+	if (BRASERO_VOL_SRC_SEEK (rescue->src, rescue->start + BRASERO_VOL_RESCUE_DESC_BLOCK, SEEK_SET, NULL) == -1
+	||  !BRASERO_VOL_SRC_READ (rescue->src, buffer, 1, NULL)) {
+		BRASERO_MEDIA_LOG ("Volume descriptor could not be read");
+		return NULL;
+	}
+
+	rescue->disc_id = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+						       (guchar *) buffer,
+						       sizeof (buffer));
+	return rescue->disc_id;
+}
+
+/**
+ * The map is a key file holding the area it describes and the disc it was
+ * made for (to make sure it matches what is being read) and a list of start,
+ * end and state for each range. A map for a disc whose volume descriptor
+ * can't be read is never trusted.
+ */
+
+gboolean
+brasero_volume_rescue_load_map (BraseroVolRescue *rescue,
+				const gchar *path)
+{
+	const gchar *disc_id;
+	GKeyFile *keyfile;
+	gchar *map_id;
+	gint *ranges;
+	gsize num = 0;
+	gsize i;
+
+	keyfile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (keyfile);
+		return FALSE;
+	}
+
+	if (g_key_file_get_int64 (keyfile, BRASERO_VOL_RESCUE_GROUP, "Start", NULL) != rescue->start
+	||  g_key_file_get_int64 (keyfile, BRASERO_VOL_RESCUE_GROUP, "Blocks", NULL) != rescue->blocks) {
+		BRASERO_MEDIA_LOG ("Rescue map does not match the area to read");
+		g_key_file_free (keyfile);
+		return FALSE;
+	}
+
+	disc_id = brasero_volume_rescue_get_disc_id (rescue);
+	map_id = g_key_file_get_string (keyfile, BRASERO_VOL_RESCUE_GROUP, "Disc", NULL);
+	if (!disc_id || !map_id || strcmp (disc_id, map_id)) {
+		BRASERO_MEDIA_LOG ("Rescue map was not made for this disc");
+		g_key_file_free (keyfile);
+		g_free (map_id);
+		return FALSE;
+	}
+	g_free (map_id);
+
+	ranges = g_key_file_get_integer_list (keyfile,
+					      BRASERO_VOL_RESCUE_GROUP,
+					      "Ranges",
+					      &num,
+					      NULL);
+	g_key_file_free (keyfile);
+
+	if (!ranges || !num || num % 3) {
+		BRASERO_MEDIA_LOG ("Invalid rescue map");
+		g_free (ranges);
+		return FALSE;
+	}
+
+	for (i = 0; i < num; i += 3) {
+		/* Only trust ranges within the area */
+		if ((gint64) ranges [i] < (gint64) rescue->start
+		||  (gint64) ranges [i + 1] > (gint64) (rescue->start + rescue->blocks)
+		||  ranges [i] >= ranges [i + 1]
+		||  ranges [i + 2] < BRASERO_VOL_RESCUE_UNTRIED
+		||  ranges [i + 2] > BRASERO_VOL_RESCUE_BAD)
+			continue;
+
+		brasero_volume_rescue_mark (rescue,
+					    ranges [i],
+					    ranges [i + 1],
+					    ranges [i + 2]);
+	}
+	g_free (ranges);
+
+	BRASERO_MEDIA_LOG ("Rescue map loaded (%i ranges)", g_list_length (rescue->ranges));
+	return TRUE;
+}
+
+gboolean
+brasero_volume_rescue_save_map (BraseroVolRescue *rescue,
+				const gchar *path,
+				GError **error)
+{
+	const gchar *disc_id;
+	GKeyFile *keyfile;
+	gboolean result;
+	gint *ranges;
+	gchar *data;
+	GList *iter;
+	gsize size;
+	gint i = 0;
+
+	ranges = g_new0 (gint, g_list_length (rescue->ranges) * 3 + 1);
+	for (iter = rescue->ranges; iter; iter = iter->next) {
+		BraseroVolRescueRange *range = iter->data;
+
+		ranges [i ++] = range->start;
+		ranges [i ++] = range->end;
+		ranges [i ++] = range->state;
+	}
+
+	keyfile = g_key_file_new ();
+	g_key_file_set_int64 (keyfile, BRASERO_VOL_RESCUE_GROUP, "Start", rescue->start);
+	g_key_file_set_int64 (keyfile, BRASERO_VOL_RESCUE_GROUP, "Blocks", rescue->blocks);
+
+	disc_id = brasero_volume_rescue_get_disc_id (rescue);
+	if (disc_id)
+		g_key_file_set_string (keyfile, BRASERO_VOL_RESCUE_GROUP, "Disc", disc_id);
+	g_key_file_set_integer_list (keyfile, BRASERO_VOL_RESCUE_GROUP, "Ranges", ranges, i);
+	g_free (ranges);
+
+	data = g_key_file_to_data (keyfile, &size, NULL);
+	g_key_file_free (keyfile);
+
+	result = g_file_set_contents (path, data, size, error);
+	g_free (data);
+
+	return result;
+}
+
+static void
+brasero_volume_rescue_set_speed (BraseroVolRescue *rescue,
+				 gboolean slow)
+{
+	BraseroScsiResult result;
+
+	if (!rescue->handle || !rescue->slow_speed)
+		return;
+
+	if ((slow != FALSE) == rescue->slowed)
+		return;
+
+	result = brasero_mmc2_set_cd_speed (rescue->handle,
+					    slow ? rescue->slow_speed : BRASERO_SCSI_SPEED_MAX,
+					    BRASERO_SCSI_SPEED_MAX,
+					    NULL);
+	if (result != BRASERO_SCSI_OK) {
+		BRASERO_MEDIA_LOG ("Speed could not be set");
+		return;
+	}
+
+	rescue->slowed = (slow != FALSE);
+}
+
+static gboolean
+brasero_volume_rescue_update (BraseroVolRescue *rescue,
+			      guint64 start,
+			      guint64 end,
+			      BraseroVolRescueState state,
+			      GError **error)
+{
+	brasero_volume_rescue_mark (rescue, start, end, state);
+
+	if (rescue->progress) {
+		guint64 good, bad;
+
+		brasero_volume_rescue_get_status (rescue, &good, &bad);
+		rescue->progress (rescue, good, bad, rescue->user_data);
+	}
+
+	if (rescue->map_path
+	&&  g_get_monotonic_time () - rescue->last_save > BRASERO_VOL_RESCUE_SAVE_DELAY) {
+		rescue->last_save = g_get_monotonic_time ();
+		if (!brasero_volume_rescue_save_map (rescue, rescue->map_path, error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns -1 on a write error, 0 on a read error, 1 on success */
+static gint
+brasero_volume_rescue_read (BraseroVolRescue *rescue,
+			    guint64 start,
+			    guint count,
+			    GError **error)
+{
+	gsize bytes = count * ISO9660_BLOCK_SIZE;
+	gsize written = 0;
+	off_t offset;
+
+	BRASERO_VOL_SRC_SEEK (rescue->src, start, SEEK_SET, NULL);
+	if (!BRASERO_VOL_SRC_READ (rescue->src, rescue->buffer, count, NULL))
+		return 0;
+
+	offset = (off_t) (start - rescue->start) * ISO9660_BLOCK_SIZE;
+	while (written < bytes) {
+		ssize_t res;
+
+		res = pwrite (rescue->fd,
+			      rescue->buffer + written,
+			      bytes - written,
+			      offset + written);
+		if (res > 0) {
+			written += res;
+			continue;
+		}
+
+		if (res < 0 && errno == EINTR)
+			continue;
+
+		g_set_error (error,
+			     BRASERO_MEDIA_ERROR,
+			     BRASERO_MEDIA_ERROR_GENERAL,
+			     "%s",
+			     g_strerror (errno));
+		return -1;
+	}
+
+	return 1;
+}
+
+static BraseroVolRescueRange *
+brasero_volume_rescue_find (BraseroVolRescue *rescue,
+			    BraseroVolRescueState state,
+			    guint64 position)
+{
+	GList *iter;
+
+	for (iter = rescue->ranges; iter; iter = iter->next) {
+		BraseroVolRescueRange *range = iter->data;
+
+		if (range->state == state && range->end > position)
+			return range;
+	}
+
+	return NULL;
+}
+
+/* Pass 1: large reads skipping ahead on errors */
+static gboolean
+brasero_volume_rescue_copy (BraseroVolRescue *rescue,
+			    GError **error)
+{
+	BraseroVolRescueRange *range;
+	guint64 position = 0;
+	guint64 skip = 0;
+
+	while ((range = brasero_volume_rescue_find (rescue, BRASERO_VOL_RESCUE_UNTRIED, position))) {
+		guint64 end;
+		guint count;
+		gint res;
+
+		if (g_cancellable_is_cancelled (rescue->cancel))
+			return TRUE;
+
+		position = MAX (position, range->start);
+		end = range->end;
+
+		count = MIN (BRASERO_VOL_RESCUE_FAST_BLOCKS, end - position);
+		res = brasero_volume_rescue_read (rescue, position, count, error);
+		if (res < 0)
+			return FALSE;
+
+		if (res > 0) {
+			if (!brasero_volume_rescue_update (rescue, position, position + count, BRASERO_VOL_RESCUE_GOOD, error))
+				return FALSE;
+
+			position += count;
+			skip = 0;
+			continue;
+		}
+
+		/* Skip the transfer and even more sectors if the previous
+		 * transfer failed as well */
+		count = MIN (count + skip, end - position);
+		BRASERO_MEDIA_LOG ("Skipping %u sectors from %" G_GUINT64_FORMAT, count, position);
+
+		if (!brasero_volume_rescue_update (rescue, position, position + count, BRASERO_VOL_RESCUE_SKIPPED, error))
+			return FALSE;
+
+		position += count;
+		skip = skip ? MIN (skip * 2, BRASERO_VOL_RESCUE_MAX_SKIP) : BRASERO_VOL_RESCUE_FAST_BLOCKS;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_volume_rescue_scrape_sectors (BraseroVolRescue *rescue,
+				      guint64 start,
+				      guint count,
+				      GError **error)
+{
+	guint i;
+
+	for (i = 0; i < count; i ++) {
+		gint res;
+
+		if (g_cancellable_is_cancelled (rescue->cancel))
+			return TRUE;
+
+		res = brasero_volume_rescue_read (rescue, start + i, 1, error);
+		if (res < 0)
+			return FALSE;
+
+		if (!brasero_volume_rescue_update (rescue,
+						   start + i,
+						   start + i + 1,
+						   res ? BRASERO_VOL_RESCUE_GOOD : BRASERO_VOL_RESCUE_BAD,
+						   error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Passes 2 and 3: small reads at low speed, then sector by sector. */
+static gboolean
+brasero_volume_rescue_scrape (BraseroVolRescue *rescue,
+			      BraseroVolRescueState state,
+			      guint transfer,
+			      GError **error)
+{
+	BraseroVolRescueRange *range;
+	guint64 position = 0;
+
+	while ((range = brasero_volume_rescue_find (rescue, state, position))) {
+		guint64 end;
+		guint count;
+		gint res;
+
+		if (g_cancellable_is_cancelled (rescue->cancel))
+			return TRUE;
+
+		position = MAX (position, range->start);
+		end = range->end;
+
+		count = MIN (transfer, end - position);
+		res = brasero_volume_rescue_read (rescue, position, count, error);
+		if (res < 0)
+			return FALSE;
+
+		if (res > 0) {
+			if (!brasero_volume_rescue_update (rescue, position, position + count, BRASERO_VOL_RESCUE_GOOD, error))
+				return FALSE;
+
+			position += count;
+			continue;
+		}
+
+		if (count > 1) {
+			/* Read them again one by one */
+			if (!brasero_volume_rescue_scrape_sectors (rescue, position, count, error))
+				return FALSE;
+		}
+		else if (!brasero_volume_rescue_update (rescue, position, position + 1, BRASERO_VOL_RESCUE_BAD, error))
+			return FALSE;
+
+		position += count;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reads the area into fd (an image of blocks * 2048 bytes). When map_path is
+ * not NULL the map is saved there regularly and when leaving. Returns TRUE if
+ * all passes were made (even if some sectors are still bad) or if cancel was
+ * triggered; check the status to know whether the image is complete.
+ */
+
+gboolean
+brasero_volume_rescue_run (BraseroVolRescue *rescue,
+			   int fd,
+			   const gchar *map_path,
+			   GCancellable *cancel,
+			   BraseroVolRescueProgress progress,
+			   gpointer user_data,
+			   GError **error)
+{
+	gboolean result;
+	gint retry;
+
+	rescue->fd = fd;
+	rescue->map_path = map_path;
+	rescue->cancel = cancel;
+	rescue->progress = progress;
+	rescue->user_data = user_data;
+	rescue->last_save = g_get_monotonic_time ();
+	rescue->buffer = g_malloc (BRASERO_VOL_RESCUE_FAST_BLOCKS * ISO9660_BLOCK_SIZE);
+
+	/* Make sure sectors never read end up as zeros in the image */
+	if (ftruncate (fd, (off_t) rescue->blocks * ISO9660_BLOCK_SIZE) == -1)
+		BRASERO_MEDIA_LOG ("Image could not be resized (%s)", g_strerror (errno));
+
+	BRASERO_MEDIA_LOG ("Rescue: copying readable areas");
+	result = brasero_volume_rescue_copy (rescue, error);
+
+	if (result) {
+		BRASERO_MEDIA_LOG ("Rescue: reading skipped areas");
+		brasero_volume_rescue_set_speed (rescue, TRUE);
+		result = brasero_volume_rescue_scrape (rescue,
+						       BRASERO_VOL_RESCUE_SKIPPED,
+						       BRASERO_VOL_RESCUE_SLOW_BLOCKS,
+						       error);
+	}
+
+	for (retry = 0; result && retry < BRASERO_VOL_RESCUE_RETRIES; retry ++) {
+		guint64 bad = 0;
+
+		brasero_volume_rescue_get_status (rescue, NULL, &bad);
+		if (!bad)
+			break;
+
+		BRASERO_MEDIA_LOG ("Rescue: retrying %" G_GUINT64_FORMAT " bad sectors", bad);
+
+		/* Turn bad sectors into skipped ones to retry them */
+		while (TRUE) {
+			BraseroVolRescueRange *range;
+
+			range = brasero_volume_rescue_find (rescue, BRASERO_VOL_RESCUE_BAD, 0);
+			if (!range)
+				break;
+
+			brasero_volume_rescue_mark (rescue, range->start, range->end, BRASERO_VOL_RESCUE_SKIPPED);
+		}
+
+		result = brasero_volume_rescue_scrape (rescue,
+						       BRASERO_VOL_RESCUE_SKIPPED,
+						       1,
+						       error);
+	}
+
+	brasero_volume_rescue_set_speed (rescue, FALSE);
+
+	if (map_path) {
+		GError *save_error = NULL;
+
+		if (!brasero_volume_rescue_save_map (rescue, map_path, &save_error)) {
+			BRASERO_MEDIA_LOG ("Rescue map could not be saved (%s)", save_error->message);
+			g_error_free (save_error);
+		}
+	}
+
+	g_free (rescue->buffer);
+	rescue->buffer = NULL;
+	rescue->fd = -1;
+	rescue->map_path = NULL;
+	rescue->cancel = NULL;
+	rescue->progress = NULL;
+	rescue->user_data = NULL;
+
+	return result;
+}
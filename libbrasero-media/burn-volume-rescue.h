@@ -0,0 +1,86 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BURN_VOLUME_RESCUE_H
+#define _BURN_VOLUME_RESCUE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "burn-volume-source.h"
+
+G_BEGIN_DECLS
+
+typedef struct _BraseroVolRescue BraseroVolRescue;
+
+typedef void (*BraseroVolRescueProgress)	(BraseroVolRescue *rescue,
+						 guint64 good,
+						 guint64 bad,
+						 gpointer user_data);
+
+BraseroVolRescue *
+brasero_volume_rescue_new (BraseroVolSrc *src,
+			   BraseroDeviceHandle *handle,
+			   guint64 start,
+			   guint64 blocks);
+
+void
+brasero_volume_rescue_free (BraseroVolRescue *rescue);
+
+void
+brasero_volume_rescue_set_slow_speed (BraseroVolRescue *rescue,
+				      gint speed);
+
+gboolean
+brasero_volume_rescue_load_map (BraseroVolRescue *rescue,
+				const gchar *path);
+
+gboolean
+brasero_volume_rescue_save_map (BraseroVolRescue *rescue,
+				const gchar *path,
+				GError **error);
+
+gboolean
+brasero_volume_rescue_run (BraseroVolRescue *rescue,
+			   int fd,
+			   const gchar *map_path,
+			   GCancellable *cancel,
+			   BraseroVolRescueProgress progress,
+			   gpointer user_data,
+			   GError **error);
+
+void
+brasero_volume_rescue_get_status (BraseroVolRescue *rescue,
+				  guint64 *good,
+				  guint64 *bad);
+
+G_END_DECLS
+
+#endif /* _BURN_VOLUME_RESCUE_H */
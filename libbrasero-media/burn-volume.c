@@ -211,6 +211,42 @@ brasero_volume_load_directory_contents (BraseroVolSrc *vol,
 						       error);
 }
 
+gboolean
+brasero_volume_load_directories_contents (BraseroVolSrc *vol,
+					  gint64 session_block,
+					  const gint64 *blocks,
+					  guint num,
+					  GList **contents,
+					  GError **error)
+{
+	gchar buffer [ISO9660_BLOCK_SIZE];
+	gint *addresses;
+	gboolean result;
+	guint i;
+
+	if (BRASERO_VOL_SRC_SEEK (vol, session_block, SEEK_SET, error) == -1)
+		return FALSE;
+
+	if (!brasero_volume_get_primary_from_file (vol, buffer, error))
+		return FALSE;
+
+	if (!brasero_iso9660_is_primary_descriptor (buffer, error))
+		return FALSE;
+
+	addresses = g_new (gint, num);
+	for (i = 0; i < num; i ++)
+		addresses [i] = blocks [i];
+
+	result = brasero_iso9660_get_directories_contents (vol,
+							   buffer,
+							   addresses,
+							   num,
+							   contents,
+							   error);
+	g_free (addresses);
+	return result;
+}
+
 BraseroVolFile *
 brasero_volume_get_file (BraseroVolSrc *vol,
 			 const gchar *path,
@@ -109,6 +109,14 @@ brasero_volume_load_directory_contents (BraseroVolSrc *vol,
 					gint64 block,
 					GError **error);
 
+gboolean
+brasero_volume_load_directories_contents (BraseroVolSrc *vol,
+					  gint64 session_block,
+					  const gint64 *blocks,
+					  guint num,
+					  GList **contents,
+					  GError **error);
+
 
 #define BRASERO_VOLUME_FILE_NAME(file)			((file)->rr_name?(file)->rr_name:(file)->name)
 #define BRASERO_VOLUME_FILE_SIZE(file)			((file)->isdir?0:(file)->specific.file.size_bytes)
@@ -0,0 +1,562 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * This is not a real transport. It emulates a read-only DVD drive holding a
+ * closed, single session disc whose contents are those of a regular file
+ * (typically an ISO image) so that the burn pipeline can be exercised (and
+ * benchmarked) without any hardware: the device path given to
+ * libbrasero-media is simply the path of the file. It is never part of
+ * libbrasero-media; it is only linked into the benchmark (built with
+ * --enable-benchmark) whose definitions of the functions below take the place
+ * of those of the real SCSI interface at run time.
+ *
+ * Responses are built with the same structures the command helpers use to
+ * parse them and are truncated to the allocation length as a real drive
+ * would do. Unknown commands fail with INVALID COMMAND.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "brasero-media-private.h"
+
+#include "scsi-command.h"
+#include "scsi-utils.h"
+#include "scsi-error.h"
+#include "scsi-opcodes.h"
+#include "scsi-inquiry.h"
+#include "scsi-get-configuration.h"
+#include "scsi-mode-pages.h"
+#include "scsi-status-page.h"
+#include "scsi-read-disc-info.h"
+#include "scsi-read-toc-pma-atip.h"
+#include "scsi-read-track-information.h"
+#include "scsi-read-capacity.h"
+#include "scsi-q-subchannel.h"
+
+struct _BraseroDeviceHandle {
+	int fd;
+
+	/* size of the emulated disc in 2048 bytes blocks */
+	guint32 blocks;
+};
+
+struct _BraseroScsiCmd {
+	uchar cmd [BRASERO_SCSI_CMD_MAX_LEN];
+	BraseroDeviceHandle *handle;
+
+	const BraseroScsiCmdInfo *info;
+};
+typedef struct _BraseroScsiCmd BraseroScsiCmd;
+
+#define BRASERO_SCSI_CMD_OPCODE_OFF			0
+#define BRASERO_SCSI_CMD_SET_OPCODE(command)		(command->cmd [BRASERO_SCSI_CMD_OPCODE_OFF] = command->info->opcode)
+
+#define BRASERO_FAKE_BLOCK_SIZE		2048
+
+/* 16x DVD in kB/s */
+#define BRASERO_FAKE_READ_SPEED		22160
+
+#define BRASERO_FAKE_VENDOR		"Brasero"
+#define BRASERO_FAKE_MODEL		"File backed drive"
+
+/* Offsets in the CDBs as defined in SPC/MMC */
+#define CDB_ALLOC_LEN(cdb)		BRASERO_GET_16 ((cdb) + 7)
+#define CDB_LBA(cdb)			BRASERO_GET_32 ((cdb) + 2)
+
+static BraseroScsiResult
+brasero_fake_reply (gpointer reply,
+		    int reply_size,
+		    gpointer buffer,
+		    int size)
+{
+	/* Like a real drive, never write more than the allocation length */
+	memset (buffer, 0, size);
+	memcpy (buffer, reply, MIN (reply_size, size));
+	return BRASERO_SCSI_OK;
+}
+
+static BraseroScsiResult
+brasero_fake_error (BraseroScsiErrCode code,
+		    BraseroScsiErrCode *error)
+{
+	BRASERO_SCSI_SET_ERRCODE (error, code);
+	return BRASERO_SCSI_FAILURE;
+}
+
+static BraseroScsiResult
+brasero_fake_inquiry (BraseroScsiCmd *cmd,
+		      gpointer buffer,
+		      int size)
+{
+	BraseroScsiInquiry inquiry;
+
+	memset (&inquiry, 0, sizeof (inquiry));
+
+	/* MMC device */
+	inquiry.type = 0x05;
+	inquiry.rmb = 1;
+	inquiry.response_format = 2;
+	inquiry.add_len = sizeof (inquiry) - 5;
+	memset (inquiry.vendor, ' ', sizeof (inquiry.vendor));
+	memcpy (inquiry.vendor, BRASERO_FAKE_VENDOR, strlen (BRASERO_FAKE_VENDOR));
+	memset (inquiry.name, ' ', sizeof (inquiry.name));
+	memcpy (inquiry.name, BRASERO_FAKE_MODEL, strlen (BRASERO_FAKE_MODEL));
+	memcpy (inquiry.revision, "1.0 ", sizeof (inquiry.revision));
+
+	return brasero_fake_reply (&inquiry, sizeof (inquiry), buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_get_configuration (BraseroScsiCmd *cmd,
+				gpointer buffer,
+				int size)
+{
+	uchar reply [sizeof (BraseroScsiGetConfigHdr) +
+		     sizeof (BraseroScsiFeatureDesc) +
+		     2 * sizeof (BraseroScsiProfileDesc)];
+	BraseroScsiProfileDesc *profiles;
+	BraseroScsiGetConfigHdr *hdr;
+	int reply_size;
+
+	memset (reply, 0, sizeof (reply));
+	hdr = (BraseroScsiGetConfigHdr *) reply;
+	BRASERO_SET_16 (hdr->current_profile, BRASERO_SCSI_PROF_DVD_ROM);
+
+	/* We only describe the list of profiles; for any other feature there
+	 * is no descriptor which callers treat as "not supported". */
+	reply_size = sizeof (BraseroScsiGetConfigHdr);
+	if (BRASERO_GET_16 (cmd->cmd + 2) == BRASERO_SCSI_FEAT_PROFILES) {
+		BRASERO_SET_16 (hdr->desc->code, BRASERO_SCSI_FEAT_PROFILES);
+		hdr->desc->current = 1;
+		hdr->desc->persistent = 1;
+		hdr->desc->add_len = 2 * sizeof (BraseroScsiProfileDesc);
+
+		profiles = (BraseroScsiProfileDesc *) hdr->desc->data;
+		BRASERO_SET_16 (profiles [0].number, BRASERO_SCSI_PROF_DVD_ROM);
+		profiles [0].currentp = 1;
+		BRASERO_SET_16 (profiles [1].number, BRASERO_SCSI_PROF_CDROM);
+
+		reply_size = sizeof (reply);
+	}
+
+	BRASERO_SET_32 (hdr->len, reply_size - sizeof (hdr->len));
+	return brasero_fake_reply (reply, reply_size, buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_mode_sense (BraseroScsiCmd *cmd,
+			 gpointer buffer,
+			 int size,
+			 BraseroScsiErrCode *error)
+{
+	uchar reply [sizeof (BraseroScsiModeHdr) + sizeof (BraseroScsiStatusPage)];
+	BraseroScsiStatusPage *page;
+	BraseroScsiModeHdr *hdr;
+
+	if ((cmd->cmd [2] & 0x3F) != BRASERO_SPC_PAGE_STATUS)
+		return brasero_fake_error (BRASERO_SCSI_INVALID_FIELD, error);
+
+	memset (reply, 0, sizeof (reply));
+	hdr = (BraseroScsiModeHdr *) reply;
+	BRASERO_SET_16 (hdr->len, sizeof (reply) - sizeof (hdr->len));
+
+	page = (BraseroScsiStatusPage *) (reply + sizeof (BraseroScsiModeHdr));
+	page->code = BRASERO_SPC_PAGE_STATUS;
+	page->len = sizeof (BraseroScsiStatusPage) - 2;
+	page->rd_DVDROM = 1;
+	page->lock = 1;
+	page->eject = 1;
+	BRASERO_SET_16 (page->rd_max_speed, BRASERO_FAKE_READ_SPEED);
+	BRASERO_SET_16 (page->rd_current_speed, BRASERO_FAKE_READ_SPEED);
+
+	return brasero_fake_reply (reply, sizeof (reply), buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_read_disc_information (BraseroScsiCmd *cmd,
+				    gpointer buffer,
+				    int size)
+{
+	BraseroScsiDiscInfoStd info;
+
+	memset (&info, 0, sizeof (info));
+	BRASERO_SET_16 (info.len, sizeof (info) - sizeof (info.len));
+	info.status = BRASERO_SCSI_DISC_FINALIZED;
+	info.last_session_state = BRASERO_SCSI_SESSION_COMPLETE;
+	info.first_track_num = 1;
+	info.sessions_num_low = 1;
+	info.first_track_nb_lastses_low = 1;
+	info.last_track_nb_lastses_low = 1;
+	info.unrestricted_use = 1;
+
+	return brasero_fake_reply (&info, sizeof (info), buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_read_toc (BraseroScsiCmd *cmd,
+		       gpointer buffer,
+		       int size,
+		       BraseroScsiErrCode *error)
+{
+	uchar reply [sizeof (BraseroScsiFormattedTocData) + 2 * sizeof (BraseroScsiTocDesc)];
+	BraseroScsiFormattedTocData *toc;
+	BraseroDeviceHandle *handle;
+
+	/* Only the formatted TOC: there is no ATIP/PMA on a pressed disc */
+	if ((cmd->cmd [2] & 0x0F) != 0)
+		return brasero_fake_error (BRASERO_SCSI_INVALID_FIELD, error);
+
+	handle = cmd->handle;
+
+	memset (reply, 0, sizeof (reply));
+	toc = (BraseroScsiFormattedTocData *) reply;
+	BRASERO_SET_16 (toc->hdr->len, sizeof (reply) - sizeof (toc->hdr->len));
+	toc->hdr->first_track_session = 1;
+	toc->hdr->last_track_session = 1;
+
+	toc->desc [0].adr = 1;
+	toc->desc [0].control = BRASERO_SCSI_TRACK_DATA;
+	toc->desc [0].track_num = 1;
+	BRASERO_SET_32 (toc->desc [0].track_start, 0);
+
+	toc->desc [1].adr = 1;
+	toc->desc [1].control = BRASERO_SCSI_TRACK_DATA;
+	toc->desc [1].track_num = BRASERO_SCSI_TRACK_LEADOUT_START;
+	BRASERO_SET_32 (toc->desc [1].track_start, handle->blocks);
+
+	return brasero_fake_reply (reply, sizeof (reply), buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_read_track_information (BraseroScsiCmd *cmd,
+				     gpointer buffer,
+				     int size,
+				     BraseroScsiErrCode *error)
+{
+	BraseroDeviceHandle *handle;
+	BraseroScsiTrackInfo info;
+	guint32 number;
+
+	handle = cmd->handle;
+	number = CDB_LBA (cmd->cmd);
+
+	/* Addressed by track number or by LBA; either way there is only one
+	 * track, the invisible/leadout track doesn't exist on closed discs */
+	if ((cmd->cmd [1] & 0x03) == 0x01 && number != 1)
+		return brasero_fake_error (BRASERO_SCSI_INVALID_FIELD, error);
+	else if ((cmd->cmd [1] & 0x03) == 0x00 && number >= handle->blocks)
+		return brasero_fake_error (BRASERO_SCSI_OUTRANGE_ADDRESS, error);
+
+	memset (&info, 0, sizeof (info));
+	BRASERO_SET_16 (info.len, 34);
+	info.track_num_low = 1;
+	info.session_num_low = 1;
+	info.track_mode = BRASERO_SCSI_TRACK_DATA;
+	info.data_mode = 1;
+	info.last_recorded_blk_valid = 1;
+	BRASERO_SET_32 (info.start_lba, 0);
+	BRASERO_SET_32 (info.track_size, handle->blocks);
+	BRASERO_SET_32 (info.last_recorded_blk, handle->blocks - 1);
+
+	return brasero_fake_reply (&info, 36, buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_read_capacity (BraseroScsiCmd *cmd,
+			    gpointer buffer,
+			    int size)
+{
+	BraseroScsiReadCapacityData data;
+
+	BRASERO_SET_32 (data.lba, cmd->handle->blocks - 1);
+	BRASERO_SET_32 (data.block_size, BRASERO_FAKE_BLOCK_SIZE);
+
+	return brasero_fake_reply (&data, sizeof (data), buffer, size);
+}
+
+static BraseroScsiResult
+brasero_fake_read_blocks (BraseroDeviceHandle *handle,
+			  guint32 start,
+			  guint32 num,
+			  uchar *buffer,
+			  int block_size,
+			  int offset,
+			  BraseroScsiErrCode *error)
+{
+	guint32 i;
+
+	if (start + num > handle->blocks)
+		return brasero_fake_error (BRASERO_SCSI_OUTRANGE_ADDRESS, error);
+
+	for (i = 0; i < num; i ++) {
+		ssize_t bytes;
+		uchar *data;
+
+		data = buffer + i * block_size + offset;
+		bytes = pread (handle->fd,
+			       data,
+			       BRASERO_FAKE_BLOCK_SIZE,
+			       (off_t) (start + i) * BRASERO_FAKE_BLOCK_SIZE);
+		if (bytes < 0)
+			return brasero_fake_error (BRASERO_SCSI_ERRNO, error);
+
+		/* The last block of the file may be incomplete */
+		if (bytes < BRASERO_FAKE_BLOCK_SIZE)
+			memset (data + bytes, 0, BRASERO_FAKE_BLOCK_SIZE - bytes);
+	}
+
+	return BRASERO_SCSI_OK;
+}
+
+static BraseroScsiResult
+brasero_fake_read10 (BraseroScsiCmd *cmd,
+		     gpointer buffer,
+		     int size,
+		     BraseroScsiErrCode *error)
+{
+	guint32 num;
+
+	num = BRASERO_GET_16 (cmd->cmd + 7);
+	if (num * BRASERO_FAKE_BLOCK_SIZE > size)
+		return brasero_fake_error (BRASERO_SCSI_SIZE_MISMATCH, error);
+
+	/* No need to go through the whole loop for big reads */
+	if (num > 1 && CDB_LBA (cmd->cmd) + num <= cmd->handle->blocks) {
+		ssize_t bytes;
+
+		bytes = pread (cmd->handle->fd,
+			       buffer,
+			       num * BRASERO_FAKE_BLOCK_SIZE,
+			       (off_t) CDB_LBA (cmd->cmd) * BRASERO_FAKE_BLOCK_SIZE);
+		if (bytes < 0)
+			return brasero_fake_error (BRASERO_SCSI_ERRNO, error);
+
+		if (bytes < num * BRASERO_FAKE_BLOCK_SIZE)
+			memset ((uchar *) buffer + bytes, 0, num * BRASERO_FAKE_BLOCK_SIZE - bytes);
+
+		return BRASERO_SCSI_OK;
+	}
+
+	return brasero_fake_read_blocks (cmd->handle,
+					 CDB_LBA (cmd->cmd),
+					 num,
+					 buffer,
+					 BRASERO_FAKE_BLOCK_SIZE,
+					 0,
+					 error);
+}
+
+static BraseroScsiResult
+brasero_fake_read_cd (BraseroScsiCmd *cmd,
+		      gpointer buffer,
+		      int size,
+		      BraseroScsiErrCode *error)
+{
+	int block_size = 0;
+	int offset = 0;
+	guint32 num;
+	uchar flags;
+
+	num = BRASERO_GET_24 (cmd->cmd + 6);
+	flags = cmd->cmd [9];
+
+	/* Mode 1 layout: SYNC (12) HEADER (4) USER DATA (2048) EDC/ECC (288).
+	 * Only user data is emulated, the rest is zeroed. */
+	if (flags & 0x80)
+		block_size += 12;
+	if (flags & 0x60)
+		block_size += 4;
+
+	offset = block_size;
+
+	if (flags & 0x10)
+		block_size += BRASERO_FAKE_BLOCK_SIZE;
+	if (flags & 0x08)
+		block_size += 288;
+
+	if (!(flags & 0x10))
+		return brasero_fake_error (BRASERO_SCSI_INVALID_FIELD, error);
+
+	if (num * block_size > size)
+		return brasero_fake_error (BRASERO_SCSI_SIZE_MISMATCH, error);
+
+	memset (buffer, 0, num * block_size);
+	return brasero_fake_read_blocks (cmd->handle,
+					 CDB_LBA (cmd->cmd),
+					 num,
+					 buffer,
+					 block_size,
+					 offset,
+					 error);
+}
+
+BraseroScsiResult
+brasero_scsi_command_issue_sync (gpointer command,
+				 gpointer buffer,
+				 int size,
+				 BraseroScsiErrCode *error)
+{
+	BraseroScsiCmd *cmd;
+
+	g_return_val_if_fail (command != NULL, BRASERO_SCSI_FAILURE);
+
+	cmd = command;
+	switch (cmd->cmd [BRASERO_SCSI_CMD_OPCODE_OFF]) {
+	case BRASERO_TEST_UNIT_READY_OPCODE:
+	case BRASERO_PREVENT_ALLOW_MEDIUM_REMOVAL_OPCODE:
+	case BRASERO_SET_CD_SPEED_OPCODE:
+		return BRASERO_SCSI_OK;
+
+	case BRASERO_INQUIRY_OPCODE:
+		return brasero_fake_inquiry (cmd, buffer, size);
+
+	case BRASERO_GET_CONFIGURATION_OPCODE:
+		return brasero_fake_get_configuration (cmd, buffer, size);
+
+	case BRASERO_MODE_SENSE_OPCODE:
+		return brasero_fake_mode_sense (cmd, buffer, size, error);
+
+	case BRASERO_READ_DISC_INFORMATION_OPCODE:
+		return brasero_fake_read_disc_information (cmd, buffer, size);
+
+	case BRASERO_READ_TOC_PMA_ATIP_OPCODE:
+		return brasero_fake_read_toc (cmd, buffer, size, error);
+
+	case BRASERO_READ_TRACK_INFORMATION_OPCODE:
+		return brasero_fake_read_track_information (cmd, buffer, size, error);
+
+	case BRASERO_READ_CAPACITY_OPCODE:
+		return brasero_fake_read_capacity (cmd, buffer, size);
+
+	case BRASERO_READ10_OPCODE:
+		return brasero_fake_read10 (cmd, buffer, size, error);
+
+	case BRASERO_READ_CD_OPCODE:
+		return brasero_fake_read_cd (cmd, buffer, size, error);
+
+	default:
+		break;
+	}
+
+	BRASERO_MEDIA_LOG ("Unsupported command 0x%02x", cmd->cmd [BRASERO_SCSI_CMD_OPCODE_OFF]);
+	return brasero_fake_error (BRASERO_SCSI_INVALID_COMMAND, error);
+}
+
+gpointer
+brasero_scsi_command_new (const BraseroScsiCmdInfo *info,
+			  BraseroDeviceHandle *handle) 
+{
+	BraseroScsiCmd *cmd;
+
+	g_return_val_if_fail (handle != NULL, NULL);
+
+	/* allocate the command */
+	cmd = g_new0 (BraseroScsiCmd, 1);
+	cmd->info = info;
+	cmd->handle = handle;
+
+	BRASERO_SCSI_CMD_SET_OPCODE (cmd);
+	return cmd;
+}
+
+BraseroScsiResult
+brasero_scsi_command_free (gpointer cmd)
+{
+	g_free (cmd);
+	return BRASERO_SCSI_OK;
+}
+
+/**
+ * This is to open a device
+ */
+
+BraseroDeviceHandle *
+brasero_device_handle_open (const gchar *path,
+			    gboolean exclusive,
+			    BraseroScsiErrCode *code)
+{
+	BraseroDeviceHandle *handle;
+	struct stat info;
+	int fd;
+
+	BRASERO_MEDIA_LOG ("Getting handle");
+	fd = open (path, O_RDONLY);
+	if (fd < 0) {
+		BRASERO_MEDIA_LOG ("No handle: %s", strerror (errno));
+		if (code)
+			*code = BRASERO_SCSI_ERRNO;
+
+		return NULL;
+	}
+
+	/* Only regular files can back a fake drive */
+	if (fstat (fd, &info) || !S_ISREG (info.st_mode) || !info.st_size) {
+		BRASERO_MEDIA_LOG ("Not a regular file");
+		close (fd);
+
+		if (code)
+			*code = BRASERO_SCSI_ERRNO;
+
+		return NULL;
+	}
+
+	handle = g_new (BraseroDeviceHandle, 1);
+	handle->fd = fd;
+	handle->blocks = (info.st_size + BRASERO_FAKE_BLOCK_SIZE - 1) / BRASERO_FAKE_BLOCK_SIZE;
+
+	BRASERO_MEDIA_LOG ("Handle ready (%u blocks)", handle->blocks);
+	return handle;
+}
+
+void
+brasero_device_handle_close (BraseroDeviceHandle *handle)
+{
+	close (handle->fd);
+	g_free (handle);
+}
+
+char *
+brasero_device_get_bus_target_lun (const gchar *device)
+{
+	return strdup (device);
+}
@@ -73,6 +73,14 @@ brasero_mmc2_read_format_capacities (BraseroDeviceHandle *handle,
 				     BraseroScsiFormatCapacitiesHdr **data,
 				     int *size,
 				     BraseroScsiErrCode *error);
+
+#define BRASERO_SCSI_SPEED_MAX		0xFFFF
+
+BraseroScsiResult
+brasero_mmc2_set_cd_speed (BraseroDeviceHandle *handle,
+			   int read_speed,
+			   int write_speed,
+			   BraseroScsiErrCode *error);
 G_END_DECLS
 
 #endif /* _SCSI_MMC2_H */
@@ -103,6 +103,9 @@ struct _BraseroIOPrivate
 	guint progress_id;
 	GSList *progress;
 
+	/* Threads reading the first bytes of files for their content type */
+	BraseroAsyncTaskManager *sniffer;
+
 	BraseroIOGetParentWinCb win_callback;
 	gpointer win_user_data;
 };
@@ -1341,6 +1344,174 @@ brasero_io_get_file_info (const gchar *uri,
 	g_object_unref (self);
 }
 
+/**
+ * Used to find out the content type of files whose name was not enough.
+ * These jobs have their own threads so that reading the first bytes of
+ * many files never delays the loading of directories.
+ */
+
+#define BRASERO_IO_SNIFF_LEN	4096
+
+struct _BraseroIOSniffData {
+	BraseroIOJob job;
+	GSList *uris;
+};
+typedef struct _BraseroIOSniffData BraseroIOSniffData;
+
+static BraseroAsyncTaskManager *
+brasero_io_get_sniffer (BraseroIO *self)
+{
+	BraseroIOPrivate *priv;
+
+	priv = BRASERO_IO_PRIVATE (self);
+
+	g_mutex_lock (priv->lock);
+	if (!priv->sniffer)
+		priv->sniffer = g_object_new (BRASERO_TYPE_ASYNC_TASK_MANAGER, NULL);
+	g_mutex_unlock (priv->lock);
+
+	return priv->sniffer;
+}
+
+static void
+brasero_io_sniff_destroy (BraseroAsyncTaskManager *manager,
+			  gboolean cancelled,
+			  gpointer callback_data)
+{
+	BraseroIOSniffData *data = callback_data;
+
+	g_slist_foreach (data->uris, (GFunc) g_free, NULL);
+	g_slist_free (data->uris);
+
+	brasero_io_job_free (cancelled, BRASERO_IO_JOB (data));
+}
+
+static BraseroAsyncTaskResult
+brasero_io_sniff_thread (BraseroAsyncTaskManager *manager,
+			 GCancellable *cancel,
+			 gpointer callback_data)
+{
+	guchar buffer [BRASERO_IO_SNIFF_LEN];
+	BraseroIOSniffData *data = callback_data;
+	GFileInputStream *stream = NULL;
+	GFileInfo *info;
+	gsize read = 0;
+	gchar *name;
+	gchar *mime;
+	GFile *file;
+	gchar *uri;
+
+	if (!data->uris)
+		return BRASERO_ASYNC_TASK_FINISHED;
+
+	uri = data->uris->data;
+	data->uris = g_slist_remove (data->uris, uri);
+
+	file = g_file_new_for_uri (uri);
+
+	/* Make sure not to block on a FIFO or a device */
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_TYPE,
+				  G_FILE_QUERY_INFO_NONE,
+				  cancel,
+				  NULL);
+	if (info) {
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
+			stream = g_file_read (file, cancel, NULL);
+		g_object_unref (info);
+	}
+
+	if (stream) {
+		if (!g_input_stream_read_all (G_INPUT_STREAM (stream),
+					      buffer,
+					      sizeof (buffer),
+					      &read,
+					      cancel,
+					      NULL))
+			read = 0;
+
+		g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+		g_object_unref (stream);
+	}
+
+	/* Even if the file could not be read return the best guess; whether
+	 * it is readable is checked elsewhere. */
+	name = g_file_get_basename (file);
+	mime = g_content_type_guess (name,
+				     read ? buffer:NULL,
+				     read,
+				     NULL);
+	g_free (name);
+	g_object_unref (file);
+
+	info = g_file_info_new ();
+	g_file_info_set_content_type (info, mime);
+	g_free (mime);
+
+	brasero_io_return_result (data->job.base,
+				  uri,
+				  info,
+				  NULL,
+				  data->job.callback_data);
+	g_free (uri);
+
+	if (g_cancellable_is_cancelled (cancel) || !data->uris)
+		return BRASERO_ASYNC_TASK_FINISHED;
+
+	return BRASERO_ASYNC_TASK_RESCHEDULE;
+}
+
+static const BraseroAsyncTaskType sniff_type = {
+	brasero_io_sniff_thread,
+	brasero_io_sniff_destroy
+};
+
+/**
+ * Returns for each of @uris (all children of @parent_uri) a GFileInfo with
+ * only the content type set, as found from the name and the first bytes.
+ * The whole batch is one job whose priority (BRASERO_IO_INFO_URGENT or
+ * BRASERO_IO_INFO_IDLE) can be raised later with brasero_io_find_urgent ().
+ */
+
+void
+brasero_io_sniff_content_types (const gchar *parent_uri,
+				GSList *uris,
+				const BraseroIOJobBase *base,
+				BraseroIOFlags options,
+				gpointer user_data)
+{
+	BraseroIOSniffData *data;
+	BraseroAsyncTaskManager *sniffer;
+	BraseroIO *self = brasero_io_get_default ();
+	BraseroIOResultCallbackData *callback_data = NULL;
+
+	if (user_data) {
+		callback_data = g_new0 (BraseroIOResultCallbackData, 1);
+		callback_data->callback_data = user_data;
+	}
+
+	data = g_new0 (BraseroIOSniffData, 1);
+
+	for (; uris; uris = uris->next)
+		data->uris = g_slist_prepend (data->uris, g_strdup (uris->data));
+	data->uris = g_slist_reverse (data->uris);
+
+	brasero_io_set_job (BRASERO_IO_JOB (data),
+			    base,
+			    parent_uri,
+			    options,
+			    callback_data);
+
+	sniffer = brasero_io_get_sniffer (self);
+	brasero_async_task_manager_queue (sniffer,
+					  (options & BRASERO_IO_INFO_URGENT) ? BRASERO_ASYNC_URGENT:
+					  (options & BRASERO_IO_INFO_IDLE) ? BRASERO_ASYNC_IDLE:
+					  BRASERO_ASYNC_NORMAL,
+					  &sniff_type,
+					  data);
+	g_object_unref (self);
+}
+
 /**
  * Used to parse playlists
  */
@@ -1889,9 +2060,30 @@ brasero_io_get_file_count (GSList *uris,
 struct _BraseroIOContentsData {
 	BraseroIOJob job;
 	GSList *children;
+
+	BraseroIOSnapshot *snapshot;
 };
 typedef struct _BraseroIOContentsData BraseroIOContentsData;
 
+void
+brasero_io_snapshot_free (BraseroIOSnapshot *snapshot)
+{
+	GSList *iter;
+
+	if (!snapshot)
+		return;
+
+	for (iter = snapshot->entries; iter; iter = iter->next) {
+		BraseroIOSnapshotEntry *entry;
+
+		entry = iter->data;
+		g_free (entry->name);
+		g_free (entry);
+	}
+	g_slist_free (snapshot->entries);
+	g_free (snapshot);
+}
+
 static void
 brasero_io_load_directory_destroy (BraseroAsyncTaskManager *manager,
 				   gboolean cancelled,
@@ -1902,6 +2094,8 @@ brasero_io_load_directory_destroy (BraseroAsyncTaskManager *manager,
 	g_slist_foreach (data->children, (GFunc) g_object_unref, NULL);
 	g_slist_free (data->children);
 
+	brasero_io_snapshot_free (data->snapshot);
+
 	brasero_io_job_free (cancelled, BRASERO_IO_JOB (data));
 }
 
@@ -1970,6 +2164,180 @@ brasero_io_load_directory_playlist (BraseroIO *self,
 
 #endif
 
+/**
+ * Rewriting a file in place doesn't change the modification time of its
+ * directory. So the files of an unchanged directory are checked one by one
+ * (directories are checked when they are explored): their new size and
+ * modification time replace those of the snapshot. Returns FALSE if one of
+ * them was replaced (another inode) or removed.
+ */
+
+static gboolean
+brasero_io_snapshot_check_entries (BraseroIOSnapshot *snapshot,
+				   GFile *file,
+				   GCancellable *cancel)
+{
+	GSList *iter;
+
+	for (iter = snapshot->entries; iter; iter = iter->next) {
+		BraseroIOSnapshotEntry *entry;
+		GFileInfo *info;
+		GFile *child;
+		guint64 mtime;
+
+		if (g_cancellable_is_cancelled (cancel))
+			return FALSE;
+
+		entry = iter->data;
+		if (entry->is_directory)
+			continue;
+
+		child = g_file_get_child (file, entry->name);
+		info = g_file_query_info (child,
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+					  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+					  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+					  G_FILE_ATTRIBUTE_UNIX_INODE,
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  cancel,
+					  NULL);
+		g_object_unref (child);
+
+		if (!info)
+			return FALSE;
+
+		if (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE) != entry->inode) {
+			g_object_unref (info);
+			return FALSE;
+		}
+
+		mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+			g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+		if (mtime != entry->mtime) {
+			entry->size = g_file_info_get_size (info);
+			entry->mtime = mtime;
+		}
+
+		g_object_unref (info);
+	}
+
+	return TRUE;
+}
+
+/**
+ * The state of the directory (modification time and inode) is returned
+ * first with BRASERO_IO_SNAPSHOT_DIRECTORY set so that the results that
+ * follow can be recorded along with it.
+ * If it matches the snapshot given for the job and none of its files was
+ * replaced, the children are returned from the snapshot and the directory
+ * is not enumerated.
+ */
+
+static gboolean
+brasero_io_load_directory_from_snapshot (BraseroIO *self,
+					 GCancellable *cancel,
+					 BraseroIOContentsData *data,
+					 GFile *file)
+{
+	BraseroIOSnapshot *snapshot;
+	gchar *directory_uri;
+	gboolean unchanged;
+	GFileInfo *info;
+	guint64 inode;
+	guint64 mtime;
+	GSList *iter;
+
+	/* It only applies to the directory of the job */
+	snapshot = data->snapshot;
+	data->snapshot = NULL;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+				  G_FILE_ATTRIBUTE_UNIX_INODE,
+				  (data->job.options & BRASERO_IO_INFO_FOLLOW_SYMLINK)?G_FILE_QUERY_INFO_NONE:G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+				  cancel,
+				  NULL);
+
+	/* The enumeration will report the error if any. Some backends don't
+	 * have inodes; nothing can be recorded for them. */
+	if (!info
+	||  !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+	||  !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE)) {
+		if (info)
+			g_object_unref (info);
+
+		brasero_io_snapshot_free (snapshot);
+		return FALSE;
+	}
+
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+
+	/* Adding, removing or renaming a child updates the modification time
+	 * of its parent directory */
+	unchanged = FALSE;
+	g_file_info_set_attribute_boolean (info, BRASERO_IO_SNAPSHOT_DIRECTORY, TRUE);
+	if (snapshot) {
+		unchanged = (snapshot->mtime == mtime
+			 &&  snapshot->inode == inode
+			 &&  brasero_io_snapshot_check_entries (snapshot, file, cancel));
+		g_file_info_set_attribute_boolean (info, BRASERO_IO_SNAPSHOT_UNCHANGED, unchanged);
+	}
+
+	directory_uri = g_file_get_uri (file);
+	brasero_io_return_result (data->job.base,
+				  directory_uri,
+				  info,
+				  NULL,
+				  data->job.callback_data);
+	g_free (directory_uri);
+
+	if (!unchanged) {
+		brasero_io_snapshot_free (snapshot);
+		return FALSE;
+	}
+
+	for (iter = snapshot->entries; iter; iter = iter->next) {
+		BraseroIOSnapshotEntry *entry;
+		gchar *child_uri;
+		GFile *child;
+
+		if (g_cancellable_is_cancelled (cancel))
+			break;
+
+		entry = iter->data;
+
+		info = g_file_info_new ();
+		g_file_info_set_name (info, entry->name);
+		g_file_info_set_size (info, entry->size);
+		g_file_info_set_is_symlink (info, FALSE);
+		g_file_info_set_file_type (info, entry->is_directory? G_FILE_TYPE_DIRECTORY:G_FILE_TYPE_REGULAR);
+		g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, entry->mtime / G_USEC_PER_SEC);
+		g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, entry->mtime % G_USEC_PER_SEC);
+		g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE, entry->inode);
+
+		/* Only readable children are in snapshots */
+		if (data->job.options & BRASERO_IO_INFO_PERM)
+			g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ, TRUE);
+
+		child = g_file_get_child (file, entry->name);
+		child_uri = g_file_get_uri (child);
+		g_object_unref (child);
+
+		brasero_io_return_result (data->job.base,
+					  child_uri,
+					  info,
+					  NULL,
+					  data->job.callback_data);
+		g_free (child_uri);
+	}
+
+	brasero_io_snapshot_free (snapshot);
+	return TRUE;
+}
+
 static BraseroAsyncTaskResult
 brasero_io_load_directory_thread (BraseroAsyncTaskManager *manager,
 				  GCancellable *cancel,
@@ -1998,6 +2366,11 @@ brasero_io_load_directory_thread (BraseroAsyncTaskManager *manager,
 	if (data->job.options & BRASERO_IO_INFO_ICON)
 		strcat (attributes, "," G_FILE_ATTRIBUTE_STANDARD_ICON);
 
+	if (data->job.options & BRASERO_IO_INFO_SNAPSHOT)
+		strcat (attributes, "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+				    "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+				    "," G_FILE_ATTRIBUTE_UNIX_INODE);
+
 	if (data->children) {
 		file = data->children->data;
 		data->children = g_slist_remove (data->children, file);
@@ -2005,6 +2378,16 @@ brasero_io_load_directory_thread (BraseroAsyncTaskManager *manager,
 	else
 		file = g_file_new_for_uri (data->job.uri);
 
+	if ((data->job.options & BRASERO_IO_INFO_SNAPSHOT)
+	&&   brasero_io_load_directory_from_snapshot (BRASERO_IO (manager), cancel, data, file)) {
+		g_object_unref (file);
+
+		if (data->children)
+			return BRASERO_ASYNC_TASK_RESCHEDULE;
+
+		return BRASERO_ASYNC_TASK_FINISHED;
+	}
+
 	enumerator = g_file_enumerate_children (file,
 						attributes,
 						(data->job.options & BRASERO_IO_INFO_FOLLOW_SYMLINK)?G_FILE_QUERY_INFO_NONE:G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,	/* follow symlinks by default*/
@@ -2159,6 +2542,27 @@ brasero_io_load_directory (const gchar *uri,
 			   const BraseroIOJobBase *base,
 			   BraseroIOFlags options,
 			   gpointer user_data)
+{
+	brasero_io_load_directory_snapshot (uri,
+					    base,
+					    options,
+					    NULL,
+					    user_data);
+}
+
+/**
+ * Same as brasero_io_load_directory (); @snapshot (which is then owned by
+ * the job) is used instead of enumerating the directory if the directory
+ * did not change since it was recorded. Only the attributes that are in
+ * a snapshot are returned for the children in this case.
+ */
+
+void
+brasero_io_load_directory_snapshot (const gchar *uri,
+				    const BraseroIOJobBase *base,
+				    BraseroIOFlags options,
+				    BraseroIOSnapshot *snapshot,
+				    gpointer user_data)
 {
 	BraseroIOContentsData *data;
 	BraseroIO *self = brasero_io_get_default ();
@@ -2170,6 +2574,7 @@ brasero_io_load_directory (const gchar *uri,
 	}
 
 	data = g_new0 (BraseroIOContentsData, 1);
+	data->snapshot = snapshot;
 	brasero_io_set_job (BRASERO_IO_JOB (data),
 			    base,
 			    uri,
@@ -2233,6 +2638,15 @@ brasero_io_cancel_by_base (BraseroIOJobBase *base)
 							  brasero_io_cancel_tasks_by_base_cb,
 							  base);
 
+	if (priv->sniffer) {
+		brasero_async_task_manager_foreach_unprocessed_remove (priv->sniffer,
+								       brasero_io_cancel_tasks_by_base_cb,
+								       base);
+		brasero_async_task_manager_foreach_active_remove (priv->sniffer,
+								  brasero_io_cancel_tasks_by_base_cb,
+								  base);
+	}
+
 	/* do it afterwards in case some results slipped through */
 	for (iter = priv->results; iter; iter = next) {
 		BraseroIOJobResult *result;
@@ -2264,7 +2678,7 @@ brasero_io_compare_unprocessed_task (BraseroAsyncTaskManager *manager,
 	BraseroIOJob *job = task;
 	BraseroIOJobCompareData *data = callback_data;
 
-	if (job->base == data->base)
+	if (job->base != data->base)
 		return FALSE;
 
 	if (!job->callback_data)
@@ -2280,6 +2694,9 @@ brasero_io_find_urgent (const BraseroIOJobBase *base,
 {
 	BraseroIOJobCompareData callback_data;
 	BraseroIO *self = brasero_io_get_default ();
+	BraseroIOPrivate *priv;
+
+	priv = BRASERO_IO_PRIVATE (self);
 
 	callback_data.func = callback;
 	callback_data.base = base;
@@ -2288,6 +2705,10 @@ brasero_io_find_urgent (const BraseroIOJobBase *base,
 	brasero_async_task_manager_find_urgent_task (BRASERO_ASYNC_TASK_MANAGER (self),
 						     brasero_io_compare_unprocessed_task,
 						     &callback_data);
+	if (priv->sniffer)
+		brasero_async_task_manager_find_urgent_task (priv->sniffer,
+							     brasero_io_compare_unprocessed_task,
+							     &callback_data);
 	g_object_unref (self);
 						     
 }
@@ -2413,6 +2834,17 @@ brasero_io_finalize (GObject *object)
 							  brasero_io_free_async_queue,
 							  NULL);
 
+	if (priv->sniffer) {
+		brasero_async_task_manager_foreach_unprocessed_remove (priv->sniffer,
+								       brasero_io_free_async_queue,
+								       NULL);
+		brasero_async_task_manager_foreach_active_remove (priv->sniffer,
+								  brasero_io_free_async_queue,
+								  NULL);
+		g_object_unref (priv->sniffer);
+		priv->sniffer = NULL;
+	}
+
 	g_slist_foreach (priv->metadatas, (GFunc) g_object_unref, NULL);
 	g_slist_free (priv->metadatas);
 	priv->metadatas = NULL;
@@ -2519,6 +2951,15 @@ brasero_io_shutdown (void)
 							  brasero_io_cancel,
 							  NULL);
 
+	if (priv->sniffer) {
+		brasero_async_task_manager_foreach_unprocessed_remove (priv->sniffer,
+								       brasero_io_cancel,
+								       NULL);
+		brasero_async_task_manager_foreach_active_remove (priv->sniffer,
+								  brasero_io_cancel,
+								  NULL);
+	}
+
 	/* do it afterwards in case some results slipped through */
 	for (iter = priv->results; iter; iter = next) {
 		BraseroIOJobResult *result;
@@ -52,7 +52,9 @@ typedef enum {
 	BRASERO_IO_INFO_FOLLOW_SYMLINK		= 1 << 7,
 
 	BRASERO_IO_INFO_URGENT			= 1 << 9,
-	BRASERO_IO_INFO_IDLE			= 1 << 10
+	BRASERO_IO_INFO_IDLE			= 1 << 10,
+
+	BRASERO_IO_INFO_SNAPSHOT		= 1 << 11
 } BraseroIOFlags;
 
 
@@ -92,8 +94,32 @@ typedef enum {
 
 #define BRASERO_IO_DIR_CONTENTS_ADDR	"image::directory::address"
 
+#define BRASERO_IO_SNAPSHOT_DIRECTORY	"snapshot::directory"
+#define BRASERO_IO_SNAPSHOT_UNCHANGED	"snapshot::unchanged"
+
 typedef struct _BraseroIOJobProgress BraseroIOJobProgress;
 
+/**
+ * State of a directory and of its children when it was explored. Times are
+ * in microseconds.
+ */
+
+struct _BraseroIOSnapshotEntry {
+	gchar *name;
+	guint64 size;
+	guint64 mtime;
+	guint64 inode;
+	guint is_directory:1;
+};
+typedef struct _BraseroIOSnapshotEntry BraseroIOSnapshotEntry;
+
+struct _BraseroIOSnapshot {
+	guint64 mtime;
+	guint64 inode;
+	GSList *entries;
+};
+typedef struct _BraseroIOSnapshot BraseroIOSnapshot;
+
 typedef void		(*BraseroIOResultCallback)	(GObject *object,
 							 GError *error,
 							 const gchar *uri,
@@ -217,11 +243,25 @@ brasero_io_load_directory (const gchar *uri,
 			   BraseroIOFlags options,
 			   gpointer callback_data);
 void
+brasero_io_load_directory_snapshot (const gchar *uri,
+				    const BraseroIOJobBase *base,
+				    BraseroIOFlags options,
+				    BraseroIOSnapshot *snapshot,
+				    gpointer callback_data);
+void
+brasero_io_snapshot_free (BraseroIOSnapshot *snapshot);
+void
 brasero_io_get_file_info (const gchar *uri,
 			  const BraseroIOJobBase *base,
 			  BraseroIOFlags options,
 			  gpointer callback_data);
 void
+brasero_io_sniff_content_types (const gchar *parent_uri,
+				GSList *uris,
+				const BraseroIOJobBase *base,
+				BraseroIOFlags options,
+				gpointer callback_data);
+void
 brasero_io_get_file_count (GSList *uris,
 			   const BraseroIOJobBase *base,
 			   BraseroIOFlags options,
@@ -48,8 +48,20 @@
 
 #include "brasero-misc.h"
 #include "brasero-metadata.h"
-
-#define BRASERO_METADATA_SILENCE_INTERVAL		100000000LL
+#include "brasero-silence-detector.h"
+
+/* Below that level (dB), sound is considered as silence. Silences are searched
+ * in windows of BRASERO_METADATA_SILENCE_WINDOW ms and must be at least
+ * BRASERO_METADATA_SILENCE_MIN ms long. */
+#define BRASERO_METADATA_SILENCE_THRESHOLD		-50.0
+#define BRASERO_METADATA_SILENCE_WINDOW			10
+#define BRASERO_METADATA_SILENCE_MIN			100
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define BRASERO_METADATA_SILENCE_CAPS			"audio/x-raw, format=(string)F32LE, layout=(string)interleaved"
+#else
+#define BRASERO_METADATA_SILENCE_CAPS			"audio/x-raw, format=(string)F32BE, layout=(string)interleaved"
+#endif
 #define BRASERO_METADATA_INITIAL_STATE			GST_STATE_PAUSED
 
 struct BraseroMetadataPrivate {
@@ -57,7 +69,7 @@ struct BraseroMetadataPrivate {
 	GstElement *source;
 	GstElement *decode;
 	GstElement *convert;
-	GstElement *level;
+	GstElement *filter;
 	GstElement *sink;
 
 	GstElement *pipeline_mp3;
@@ -71,7 +83,7 @@ struct BraseroMetadataPrivate {
 	guint watch;
 	guint watch_mp3;
 
-	BraseroMetadataSilence *silence;
+	BraseroSilenceDetector *detector;
 
 	BraseroMetadataFlag flags;
 	BraseroMetadataInfo *info;
@@ -90,7 +102,6 @@ struct BraseroMetadataPrivate {
 
 	guint started:1;
 	guint moved_forward:1;
-	guint prev_level_mes:1;
 	guint video_linked:1;
 	guint audio_linked:1;
 	guint snapshot_started:1;
@@ -262,8 +273,9 @@ brasero_metadata_info_copy (BraseroMetadataInfo *dest,
 		copy->start = silence->start;
 		copy->end = silence->end;
 
-		dest->silences = g_slist_append (dest->silences, copy);
+		dest->silences = g_slist_prepend (dest->silences, copy);
 	}
+	dest->silences = g_slist_reverse (dest->silences);
 }
 
 static void
@@ -336,9 +348,9 @@ brasero_metadata_destroy_pipeline (BraseroMetadata *self)
 	gst_object_unref (GST_OBJECT (priv->pipeline));
 	priv->pipeline = NULL;
 
-	if (priv->level) {
-		gst_object_unref (GST_OBJECT (priv->level));
-		priv->level = NULL;
+	if (priv->filter) {
+		gst_object_unref (GST_OBJECT (priv->filter));
+		priv->filter = NULL;
 	}
 
 	if (priv->sink) {
@@ -989,55 +1001,6 @@ brasero_metadata_process_element_messages (BraseroMetadata *self,
 	&&   gst_is_missing_plugin_message (msg)) {
 		priv->missing_plugins = g_slist_prepend (priv->missing_plugins, gst_message_ref (msg));
 	}
-	else if (gst_message_has_name (msg, "level")
-	&&   gst_structure_has_field (s, "peak")) {
-		const GValue *value;
-		const GValue *list;
-		gdouble peak;
-
-		/* FIXME: this might still be changed to GValueArray before 1.0 release */
-		list = gst_structure_get_value (s, "peak");
-		value = gst_value_list_get_value (list, 0);
-		peak = g_value_get_double (value);
-
-		/* detection of silence */
-		if (peak < -50.0) {
-			gint64 pos = -1;
-
-			/* was there a silence last time we check ?
-			 * NOTE: if that's the first signal we receive
-			 * then consider that silence started from 0 */
-			gst_element_query_position (priv->pipeline, GST_FORMAT_TIME, &pos);
-			if (pos == -1) {
-				BRASERO_UTILS_LOG ("impossible to retrieve position");
-				return TRUE;
-			}
-
-			if (!priv->silence) {
-				priv->silence = g_new0 (BraseroMetadataSilence, 1);
-				if (priv->prev_level_mes) {
-					priv->silence->start = pos;
-					priv->silence->end = pos;
-				}
-				else {
-					priv->silence->start = 0;
-					priv->silence->end = pos;
-				}
-			}				
-			else
-				priv->silence->end = pos;
-
-			BRASERO_UTILS_LOG ("silence detected at %lli", pos);
-		}
-		else if (priv->silence) {
-			BRASERO_UTILS_LOG ("silence finished");
-
-			priv->info->silences = g_slist_append (priv->info->silences,
-							       priv->silence);
-			priv->silence = NULL;
-		}
-		priv->prev_level_mes = 1;
-	}
 
 	return TRUE;
 }
@@ -1081,10 +1044,10 @@ brasero_metadata_success (BraseroMetadata *self)
 	/* check if that's a seekable one */
 	brasero_metadata_is_seekable (self);
 
-	if (priv->silence) {
-		priv->silence->end = priv->info->len;
-		priv->info->silences = g_slist_append (priv->info->silences, priv->silence);
-		priv->silence = NULL;
+	if (priv->detector) {
+		priv->info->silences = brasero_silence_detector_finish (priv->detector, priv->info->len);
+		brasero_silence_detector_free (priv->detector);
+		priv->detector = NULL;
 	}
 
 	/* before leaving, check if we need a snapshot */
@@ -1340,6 +1303,57 @@ brasero_metadata_bus_messages (GstBus *bus,
 	return TRUE;
 }
 
+static GstPadProbeReturn
+brasero_metadata_silence_probe (GstPad *pad,
+				GstPadProbeInfo *info,
+				gpointer user_data)
+{
+	BraseroMetadata *self = BRASERO_METADATA (user_data);
+	BraseroMetadataPrivate *priv;
+	GstMapInfo map;
+	GstBuffer *buffer;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	if (!priv->detector) {
+		GstStructure *structure;
+		gint channels = 0;
+		gint rate = 0;
+		GstCaps *caps;
+
+		caps = gst_pad_get_current_caps (pad);
+		if (!caps)
+			return GST_PAD_PROBE_OK;
+
+		structure = gst_caps_get_structure (caps, 0);
+		gst_structure_get_int (structure, "rate", &rate);
+		gst_structure_get_int (structure, "channels", &channels);
+		gst_caps_unref (caps);
+
+		if (rate <= 0 || channels <= 0) {
+			BRASERO_UTILS_LOG ("Wrong audio format for silence detection");
+			return GST_PAD_PROBE_OK;
+		}
+
+		priv->detector = brasero_silence_detector_new (rate,
+							       channels,
+							       BRASERO_METADATA_SILENCE_THRESHOLD,
+							       BRASERO_METADATA_SILENCE_WINDOW,
+							       BRASERO_METADATA_SILENCE_MIN);
+	}
+
+	buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+	if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+		return GST_PAD_PROBE_OK;
+
+	brasero_silence_detector_process (priv->detector,
+					  (const gfloat *) map.data,
+					  map.size / sizeof (gfloat));
+	gst_buffer_unmap (buffer, &map);
+
+	return GST_PAD_PROBE_OK;
+}
+
 static gboolean
 brasero_metadata_create_audio_pipeline (BraseroMetadata *self)
 {
@@ -1352,41 +1366,46 @@ brasero_metadata_create_audio_pipeline (BraseroMetadata *self)
 
 	/* set up the pipeline according to flags */
 	if (priv->flags & BRASERO_METADATA_FLAG_SILENCES) {
-		priv->prev_level_mes = 0;
+		GstPad *filter_pad;
 
 		/* Add a reference to these objects as we want to keep them
 		 * around after the bin they've been added to is destroyed
 		 * NOTE: now we destroy the pipeline every time which means
 		 * that it doesn't really matter. */
-		if (!priv->level) {
-			priv->level = gst_element_factory_make ("level", NULL);
-			if (!priv->level) {
+		if (!priv->filter) {
+			GstCaps *caps;
+
+			priv->filter = gst_element_factory_make ("capsfilter", NULL);
+			if (!priv->filter) {
 				priv->error = g_error_new (BRASERO_UTILS_ERROR,
 							   BRASERO_UTILS_ERROR_GENERAL,
 							   _("%s element could not be created"),
-							   "\"Level\"");
+							   "\"Capsfilter\"");
 				gst_object_unref (priv->audio);
 				priv->audio = NULL;
 				return FALSE;
 			}
-			g_object_set (priv->level,
-				      "message", TRUE,
-				      "interval", (guint64) BRASERO_METADATA_SILENCE_INTERVAL,
+
+			/* Silences are found directly in decoded samples */
+			caps = gst_caps_from_string (BRASERO_METADATA_SILENCE_CAPS);
+			g_object_set (priv->filter,
+				      "caps", caps,
 				      NULL);
+			gst_caps_unref (caps);
 		}
 
 		gst_object_ref (priv->convert);
-		gst_object_ref (priv->level);
+		gst_object_ref (priv->filter);
 		gst_object_ref (priv->sink);
 
 		gst_bin_add_many (GST_BIN (priv->audio),
 				  priv->convert,
-				  priv->level,
+				  priv->filter,
 				  priv->sink,
 				  NULL);
 
 		if (!gst_element_link_many (priv->convert,
-		                            priv->level,
+		                            priv->filter,
 		                            priv->sink,
 		                            NULL)) {
 			BRASERO_UTILS_LOG ("Impossible to link elements");
@@ -1395,6 +1414,14 @@ brasero_metadata_create_audio_pipeline (BraseroMetadata *self)
 			return FALSE;
 		}
 
+		filter_pad = gst_element_get_static_pad (priv->filter, "src");
+		gst_pad_add_probe (filter_pad,
+				   GST_PAD_PROBE_TYPE_BUFFER,
+				   brasero_metadata_silence_probe,
+				   self,
+				   NULL);
+		gst_object_unref (filter_pad);
+
 		audio_pad = gst_element_get_static_pad (priv->convert, "sink");
 	}
 	else if (priv->flags & BRASERO_METADATA_FLAG_THUMBNAIL) {
@@ -1786,11 +1813,6 @@ brasero_metadata_set_new_uri (BraseroMetadata *self,
 	brasero_metadata_info_free (priv->info);
 	priv->info = NULL;
 
-	if (priv->silence) {
-		g_free (priv->silence);
-		priv->silence = NULL;
-	}
-
 	priv->info = g_new0 (BraseroMetadataInfo, 1);
 	priv->info->uri = g_strdup (uri);
 
@@ -1815,6 +1837,12 @@ brasero_metadata_set_new_uri (BraseroMetadata *self,
 	else if (!brasero_metadata_create_pipeline (self))
 		return FALSE;
 
+	/* Now that nothing is streaming anymore */
+	if (priv->detector) {
+		brasero_silence_detector_free (priv->detector);
+		priv->detector = NULL;
+	}
+
 	if (!gst_uri_is_valid (uri))
 		return FALSE;
 
@@ -2056,9 +2084,9 @@ brasero_metadata_finalize (GObject *object)
 
 	brasero_metadata_destroy_pipeline (BRASERO_METADATA (object));
 
-	if (priv->silence) {
-		g_free (priv->silence);
-		priv->silence = NULL;
+	if (priv->detector) {
+		brasero_silence_detector_free (priv->detector);
+		priv->detector = NULL;
 	}
 
 	if (priv->error) {
@@ -0,0 +1,279 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-misc
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-misc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-misc authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-misc. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-misc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+
+#include <glib.h>
+
+#include "brasero-metadata.h"
+#include "brasero-silence-detector.h"
+
+/**
+ * Finds silences in interleaved float PCM. Samples are looked at in windows
+ * of a few milliseconds: a window is silent when its peak stays below the
+ * threshold. The boundaries of a silence are then refined to the exact frame
+ * where sound stops and starts again by looking at the loud windows around it.
+ */
+
+struct _BraseroSilenceDetector {
+	gint rate;
+	gint channels;
+	gfloat threshold;
+
+	guint64 window;
+	guint64 min_duration;
+
+	/* Position (in frames) of the start of the current window */
+	guint64 position;
+
+	/* Current window */
+	guint64 window_frames;
+	gint64 window_first_loud;
+	gint64 window_last_loud;
+
+	/* Frame following the last loud one */
+	guint64 sound_end;
+	gint64 silence_start;
+
+	/* In reverse order */
+	GSList *silences;
+};
+
+BraseroSilenceDetector *
+brasero_silence_detector_new (gint rate,
+			      gint channels,
+			      gdouble threshold,
+			      guint window,
+			      guint min_duration)
+{
+	BraseroSilenceDetector *detector;
+
+	g_return_val_if_fail (rate > 0, NULL);
+	g_return_val_if_fail (channels > 0, NULL);
+
+	detector = g_new0 (BraseroSilenceDetector, 1);
+	detector->rate = rate;
+	detector->channels = channels;
+
+	/* threshold is in dB and window/min_duration in ms */
+	detector->threshold = pow (10.0, threshold / 20.0);
+	detector->window = MAX (1, (guint64) rate * window / 1000);
+	detector->min_duration = (guint64) rate * min_duration / 1000;
+
+	detector->window_first_loud = -1;
+	detector->window_last_loud = -1;
+	detector->silence_start = -1;
+	return detector;
+}
+
+/* Written with independent accumulators so that the compiler can turn it into
+ * SIMD code. */
+static gfloat
+brasero_silence_detector_peak (const gfloat *samples,
+			       gsize num)
+{
+	gfloat peak [8] = { 0.0, };
+	gfloat retval;
+	gsize i, j;
+
+	for (i = 0; i + 8 <= num; i += 8) {
+		for (j = 0; j < 8; j ++) {
+			gfloat value;
+
+			value = fabsf (samples [i + j]);
+			peak [j] = value > peak [j] ? value:peak [j];
+		}
+	}
+
+	retval = 0.0;
+	for (j = 0; j < 8; j ++)
+		retval = MAX (retval, peak [j]);
+
+	for (; i < num; i ++)
+		retval = MAX (retval, fabsf (samples [i]));
+
+	return retval;
+}
+
+static gboolean
+brasero_silence_detector_frame_is_loud (BraseroSilenceDetector *detector,
+					const gfloat *frame)
+{
+	gint i;
+
+	for (i = 0; i < detector->channels; i ++) {
+		if (fabsf (frame [i]) >= detector->threshold)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gint64
+brasero_silence_detector_frames_to_time (BraseroSilenceDetector *detector,
+					 guint64 frames)
+{
+	/* Avoid overflows with long files */
+	return (frames / detector->rate) * G_GINT64_CONSTANT (1000000000) +
+	       (frames % detector->rate) * G_GINT64_CONSTANT (1000000000) / detector->rate;
+}
+
+static void
+brasero_silence_detector_add (BraseroSilenceDetector *detector,
+			      guint64 start,
+			      guint64 end,
+			      gint64 end_time)
+{
+	BraseroMetadataSilence *silence;
+
+	/* Silences at the start and the end of a track are always kept */
+	if (start && end_time < 0 && end - start < detector->min_duration)
+		return;
+
+	silence = g_new0 (BraseroMetadataSilence, 1);
+	silence->start = brasero_silence_detector_frames_to_time (detector, start);
+	silence->end = end_time >= 0 ? end_time:brasero_silence_detector_frames_to_time (detector, end);
+	detector->silences = g_slist_prepend (detector->silences, silence);
+}
+
+static void
+brasero_silence_detector_end_window (BraseroSilenceDetector *detector)
+{
+	if (detector->window_first_loud < 0) {
+		/* Silent window */
+		if (detector->silence_start < 0)
+			detector->silence_start = detector->sound_end;
+	}
+	else {
+		if (detector->silence_start >= 0) {
+			brasero_silence_detector_add (detector,
+						      detector->silence_start,
+						      detector->window_first_loud,
+						      -1);
+			detector->silence_start = -1;
+		}
+
+		detector->sound_end = detector->window_last_loud + 1;
+	}
+
+	detector->position += detector->window_frames;
+	detector->window_frames = 0;
+	detector->window_first_loud = -1;
+	detector->window_last_loud = -1;
+}
+
+void
+brasero_silence_detector_process (BraseroSilenceDetector *detector,
+				  const gfloat *samples,
+				  gsize num)
+{
+	gsize frames;
+
+	/* Samples are interleaved */
+	frames = num / detector->channels;
+	while (frames) {
+		guint64 chunk;
+		guint64 start;
+
+		chunk = MIN (frames, detector->window - detector->window_frames);
+		start = detector->position + detector->window_frames;
+
+		if (brasero_silence_detector_peak (samples, chunk * detector->channels) >= detector->threshold) {
+			gint64 i;
+
+			/* Find where sound starts and ends in this chunk; that
+			 * usually stops at the first frames tested */
+			if (detector->window_first_loud < 0) {
+				for (i = 0; i < (gint64) chunk; i ++) {
+					if (brasero_silence_detector_frame_is_loud (detector, samples + i * detector->channels)) {
+						detector->window_first_loud = start + i;
+						break;
+					}
+				}
+			}
+
+			for (i = chunk - 1; i >= 0; i --) {
+				if (brasero_silence_detector_frame_is_loud (detector, samples + i * detector->channels)) {
+					detector->window_last_loud = start + i;
+					break;
+				}
+			}
+		}
+
+		detector->window_frames += chunk;
+		samples += chunk * detector->channels;
+		frames -= chunk;
+
+		if (detector->window_frames == detector->window)
+			brasero_silence_detector_end_window (detector);
+	}
+}
+
+/**
+ * brasero_silence_detector_finish:
+ * @detector: a #BraseroSilenceDetector
+ * @length: the length of the stream in nanoseconds or -1
+ *
+ * Returns the silences found (as #BraseroMetadataSilence) in order. A silence
+ * at the end of the stream ends at @length when it is known.
+ */
+GSList *
+brasero_silence_detector_finish (BraseroSilenceDetector *detector,
+				 gint64 length)
+{
+	GSList *silences;
+
+	if (detector->window_frames)
+		brasero_silence_detector_end_window (detector);
+
+	if (detector->silence_start >= 0) {
+		brasero_silence_detector_add (detector,
+					      detector->silence_start,
+					      detector->position,
+					      length > 0 ? length:-1);
+		detector->silence_start = -1;
+	}
+
+	silences = g_slist_reverse (detector->silences);
+	detector->silences = NULL;
+	return silences;
+}
+
+void
+brasero_silence_detector_free (BraseroSilenceDetector *detector)
+{
+	g_slist_foreach (detector->silences, (GFunc) g_free, NULL);
+	g_slist_free (detector->silences);
+	g_free (detector);
+}
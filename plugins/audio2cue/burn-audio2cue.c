@@ -32,9 +32,17 @@
 #  include <config.h>
 #endif
 
+/* Needed for splice (), fallocate () and O_DIRECT */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 
 #include <glib.h>
@@ -42,9 +50,11 @@
 #include <glib/gi18n-lib.h>
 #include <glib/gstdio.h>
 #include <gmodule.h>
+#include <gio/gio.h>
 
 #include "brasero-plugin-registration.h"
 #include "burn-job.h"
+#include "burn-silence.h"
 #include "brasero-tags.h"
 #include "brasero-track-image.h"
 
@@ -58,17 +68,32 @@
 
 BRASERO_PLUGIN_BOILERPLATE (BraseroAudio2Cue, brasero_audio2cue, BRASERO_TYPE_JOB, BraseroJob);
 
+#define BRASERO_SCHEMA_CONFIG		"org.gnome.brasero.config"
+#define BRASERO_KEY_DIRECT_IO		"audio2cue-direct-io"
+
+/* Alignment required by O_DIRECT (the largest logical block size) */
+#define BRASERO_AUDIO2CUE_ALIGNMENT	4096
+
+/* Least common multiple of 2352 and 4096 so that every full buffer ends on
+ * a sector boundary and can be written with O_DIRECT */
+#define BRASERO_AUDIO2CUE_BUFFER_SIZE	(602112 * 2)
+
 struct _BraseroAudio2CuePrivate {
 	goffset total;
 	goffset bytes;
 
+	guchar *buffer;
+
 	GThread *thread;
 	GMutex *mutex;
 	GCond *cond;
 	GError *error;
 	gint thread_id;
 
-	guint cancel:1;
+	GCancellable *cancel;
+
+	guint direct_io:1;
+	guint direct:1;
 	guint success:1;
 };
 typedef struct _BraseroAudio2CuePrivate BraseroAudio2CuePrivate;
@@ -87,9 +112,9 @@ brasero_audio2cue_stop_real (BraseroAudio2Cue *self)
 
 	g_mutex_lock (priv->mutex);
 	if (priv->thread) {
-		priv->cancel = 1;
+		g_cancellable_cancel (priv->cancel);
 		g_cond_wait (priv->cond, priv->mutex);
-		priv->cancel = 0;
+		g_cancellable_reset (priv->cancel);
 	}
 	g_mutex_unlock (priv->mutex);
 
@@ -157,6 +182,36 @@ brasero_audio2cue_create_finished (gpointer user_data)
 	return FALSE;
 }
 
+/**
+ * Waits for fd to be readable or writable. Returns FALSE if it was cancelled.
+ */
+
+static gboolean
+brasero_audio2cue_wait (BraseroAudio2Cue *self,
+			int fd,
+			GIOCondition condition)
+{
+	BraseroAudio2CuePrivate *priv;
+	GPollFD fds [2];
+	gint num = 1;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
+
+	fds [0].fd = fd;
+	fds [0].events = condition|G_IO_ERR|G_IO_HUP;
+	fds [0].revents = 0;
+
+	if (g_cancellable_make_pollfd (priv->cancel, &fds [1]))
+		num = 2;
+
+	while (g_poll (fds, num, -1) == -1 && errno == EINTR);
+
+	if (num == 2)
+		g_cancellable_release_fd (priv->cancel);
+
+	return !g_cancellable_is_cancelled (priv->cancel);
+}
+
 static gint
 brasero_audio2cue_read (BraseroAudio2Cue *self,
 			int fd,
@@ -170,42 +225,91 @@ brasero_audio2cue_read (BraseroAudio2Cue *self,
 
 	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
 
-	while (1) {
+	while (total < bytes) {
+		if (g_cancellable_is_cancelled (priv->cancel))
+			return -2;
+
 		read_bytes = read (fd, buffer + total, (bytes - total));
 
 		/* maybe that's the end of the stream ... */
 		if (!read_bytes)
 			return total;
 
-		if (priv->cancel)
-			return -2;
-
-		/* ... or an error =( */
-		if (read_bytes == -1) {
-			if (errno != EAGAIN && errno != EINTR) {
-                                int errsv = errno;
-
-				g_set_error (error,
-					     BRASERO_BURN_ERROR,
-					     BRASERO_BURN_ERROR_GENERAL,
-					     _("Data could not be read (%s)"),
-					     g_strerror (errsv));
-				return -1;
-			}
-		}
-		else {
+		if (read_bytes > 0) {
 			total += read_bytes;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+
+		/* ... or there is nothing to read yet ... */
+		if (errno == EAGAIN) {
+			if (!brasero_audio2cue_wait (self, fd, G_IO_IN))
+				return -2;
 
-			if (total == bytes)
-				return total;
+			continue;
 		}
 
-		g_usleep (500);
+		/* ... or an error =( */
+		{
+			int errsv = errno;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be read (%s)"),
+				     g_strerror (errsv));
+			return -1;
+		}
 	}
 
 	return total;
 }
 
+static void
+brasero_audio2cue_disable_direct (BraseroAudio2Cue *self,
+				  int fd)
+{
+	BraseroAudio2CuePrivate *priv;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
+	if (!priv->direct)
+		return;
+
+#ifdef O_DIRECT
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) & ~O_DIRECT);
+#endif
+
+	priv->direct = FALSE;
+	BRASERO_JOB_LOG (self, "Switching to buffered writes at offset %" G_GOFFSET_FORMAT, priv->bytes);
+}
+
+/**
+ * O_DIRECT requires the buffer, the size and the offset to be aligned. As
+ * soon as one of them is not (which happens for the end of the image) the
+ * output goes back to buffered writes.
+ */
+
+static void
+brasero_audio2cue_check_direct (BraseroAudio2Cue *self,
+				int fd,
+				goffset offset,
+				guchar *buffer,
+				gint bytes)
+{
+	BraseroAudio2CuePrivate *priv;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
+	if (!priv->direct)
+		return;
+
+	if ((offset % BRASERO_AUDIO2CUE_ALIGNMENT)
+	||  (bytes % BRASERO_AUDIO2CUE_ALIGNMENT)
+	||  (GPOINTER_TO_SIZE (buffer) % BRASERO_AUDIO2CUE_ALIGNMENT))
+		brasero_audio2cue_disable_direct (self, fd);
+}
+
 static BraseroBurnResult
 brasero_audio2cue_write (BraseroAudio2Cue *self,
 			 int fd,
@@ -223,38 +327,128 @@ brasero_audio2cue_write (BraseroAudio2Cue *self,
 	while (bytes_remaining) {
 		gint written;
 
+		if (g_cancellable_is_cancelled (priv->cancel))
+			return BRASERO_BURN_CANCEL;
+
+		brasero_audio2cue_check_direct (self,
+						fd,
+						priv->bytes + bytes_written,
+						buffer + bytes_written,
+						bytes_remaining);
+
 		written = write (fd,
 				 buffer + bytes_written,
 				 bytes_remaining);
 
-		if (priv->cancel)
+		if (written > 0) {
+			bytes_remaining -= written;
+			bytes_written += written;
+			continue;
+		}
+
+		if (written == -1 && errno == EINTR)
+			continue;
+
+		if (written == -1 && errno == EAGAIN) {
+			if (!brasero_audio2cue_wait (self, fd, G_IO_OUT))
+				return BRASERO_BURN_CANCEL;
+
+			continue;
+		}
+
+		{
+			int errsv = errno;
+
+			/* unrecoverable error */
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			return BRASERO_BURN_ERR;
+		}
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+#ifdef HAVE_SPLICE
+
+/**
+ * When the data comes from a pipe, the kernel can move it straight to the
+ * .bin file without copying it to user space.
+ */
+
+static BraseroBurnResult
+brasero_audio2cue_splice_bin (BraseroAudio2Cue *self,
+			      int fd_in,
+			      int fd_out)
+{
+	BraseroAudio2CuePrivate *priv;
+	gboolean started = FALSE;
+	struct stat info;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
+
+	if (fstat (fd_in, &info) == -1 || !S_ISFIFO (info.st_mode))
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	/* Pages moved from the pipe can't honour O_DIRECT constraints */
+	brasero_audio2cue_disable_direct (self, fd_out);
+
+	while (1) {
+		ssize_t res;
+
+		if (g_cancellable_is_cancelled (priv->cancel))
 			return BRASERO_BURN_CANCEL;
 
-		if (written != bytes_remaining) {
-			if (errno != EINTR && errno != EAGAIN) {
-                                int errsv = errno;
-
-				/* unrecoverable error */
-				g_set_error (error,
-					     BRASERO_BURN_ERROR,
-					     BRASERO_BURN_ERROR_GENERAL,
-					     _("Data could not be written (%s)"),
-					     g_strerror (errsv));
-				return BRASERO_BURN_ERR;
-			}
+		res = splice (fd_in,
+			      NULL,
+			      fd_out,
+			      NULL,
+			      BRASERO_AUDIO2CUE_BUFFER_SIZE,
+			      SPLICE_F_MOVE|SPLICE_F_MORE|SPLICE_F_NONBLOCK);
+
+		if (res > 0) {
+			started = TRUE;
+			priv->bytes += res;
+			continue;
 		}
 
-		g_usleep (500);
+		/* End of stream */
+		if (!res)
+			return BRASERO_BURN_OK;
 
-		if (written > 0) {
-			bytes_remaining -= written;
-			bytes_written += written;
+		if (errno == EINTR)
+			continue;
+
+		if (errno == EAGAIN) {
+			if (!brasero_audio2cue_wait (self, fd_in, G_IO_IN))
+				return BRASERO_BURN_CANCEL;
+
+			continue;
+		}
+
+		if (!started && (errno == EINVAL || errno == ENOSYS))
+			return BRASERO_BURN_NOT_SUPPORTED;
+
+		{
+			int errsv = errno;
+
+			g_set_error (&priv->error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			return BRASERO_BURN_ERR;
 		}
 	}
 
 	return BRASERO_BURN_OK;
 }
 
+#endif
+
 static BraseroBurnResult
 brasero_audio2cue_write_bin (BraseroAudio2Cue *self,
 			     int fd_in,
@@ -264,36 +458,39 @@ brasero_audio2cue_write_bin (BraseroAudio2Cue *self,
 
 	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
 
+#ifdef HAVE_SPLICE
+	{
+		BraseroBurnResult result;
+
+		result = brasero_audio2cue_splice_bin (self, fd_in, fd_out);
+		if (result != BRASERO_BURN_NOT_SUPPORTED)
+			return result;
+	}
+#endif
+
 	while (1) {
 		gint read_bytes;
-		guchar buffer [2352 * 10];
 		BraseroBurnResult result;
 
 		read_bytes = brasero_audio2cue_read (self,
 		                                     fd_in,
-		                                     buffer,
-		                                     sizeof (buffer),
+		                                     priv->buffer,
+		                                     BRASERO_AUDIO2CUE_BUFFER_SIZE,
 		                                     &priv->error);
 
 		/* This is a simple cancellation */
 		if (read_bytes == -2)
 			return BRASERO_BURN_CANCEL;
 
-		if (read_bytes == -1) {
-			int err_saved = errno;
-
-			priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
-							   BRASERO_BURN_ERROR_GENERAL,
-							   strerror (err_saved));
+		if (read_bytes == -1)
 			return BRASERO_BURN_ERR;
-		}
 
 		if (!read_bytes)
 			break;
 
 		result = brasero_audio2cue_write (self,
 		                                  fd_out,
-		                                  buffer,
+		                                  priv->buffer,
 		                                  read_bytes,
 		                                  &priv->error);
 		if (result != BRASERO_BURN_OK)
@@ -305,6 +502,52 @@ brasero_audio2cue_write_bin (BraseroAudio2Cue *self,
 	return BRASERO_BURN_OK;
 }
 
+/**
+ * Opens the .bin file, possibly with O_DIRECT so that writing a whole CD
+ * image does not flush the page cache, and reserves its space at once.
+ */
+
+static int
+brasero_audio2cue_open_bin (BraseroAudio2Cue *self,
+			    const gchar *image)
+{
+	BraseroAudio2CuePrivate *priv;
+	int fd_out = -1;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (self);
+	priv->direct = FALSE;
+
+#ifdef O_DIRECT
+	if (priv->direct_io) {
+		fd_out = open (image,
+			       O_WRONLY|O_CREAT|O_DIRECT,
+			       S_IWUSR|S_IRUSR);
+
+		/* Some file systems (tmpfs) don't support O_DIRECT */
+		if (fd_out >= 0)
+			priv->direct = TRUE;
+		else
+			BRASERO_JOB_LOG (self, "O_DIRECT not supported (%s)", g_strerror (errno));
+	}
+#endif
+
+	if (fd_out < 0)
+		fd_out = open (image,
+			       O_WRONLY|O_CREAT,
+			       S_IWUSR|S_IRUSR);
+
+	if (fd_out < 0)
+		return fd_out;
+
+#ifdef HAVE_FALLOCATE
+	/* NOTE: the file is truncated to its real size once written */
+	if (priv->total > 0 && fallocate (fd_out, 0, 0, priv->total) == -1)
+		BRASERO_JOB_LOG (self, "Space could not be reserved (%s)", g_strerror (errno));
+#endif
+
+	return fd_out;
+}
+
 static gchar *
 brasero_audio2cue_len_to_string (guint64 len)
 {
@@ -343,6 +586,7 @@ brasero_audio2cue_create_thread (gpointer data)
 
 	priv = BRASERO_AUDIO2CUE_PRIVATE (data);
 	priv->success = FALSE;
+	priv->bytes = 0;
 
 	/* Get all audio data as input and write .bin */
 	brasero_job_get_image_output (data,
@@ -351,10 +595,7 @@ brasero_audio2cue_create_thread (gpointer data)
 	if (!toc || !image)
 		goto end;
 
-	fd_out = open (image,
-	               O_WRONLY|O_CREAT,
-	               S_IWUSR|S_IRUSR);
-
+	fd_out = brasero_audio2cue_open_bin (data, image);
 	if (fd_out < 0) {
 		int err_saved = errno;
 		priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
@@ -363,6 +604,16 @@ brasero_audio2cue_create_thread (gpointer data)
 		goto end;
 	}
 
+	if (posix_memalign ((void **) &priv->buffer,
+			    BRASERO_AUDIO2CUE_ALIGNMENT,
+			    BRASERO_AUDIO2CUE_BUFFER_SIZE)) {
+		priv->buffer = NULL;
+		priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+						   BRASERO_BURN_ERROR_GENERAL,
+						   strerror (ENOMEM));
+		goto end;
+	}
+
 	brasero_job_set_current_action (data,
 					BRASERO_BURN_ACTION_CREATING_IMAGE,
 					NULL,
@@ -374,6 +625,8 @@ brasero_audio2cue_create_thread (gpointer data)
 		for (; tracks; tracks = tracks->next) {
 			BraseroTrackStream *track;
 			gchar *song_path;
+			goffset padding;
+			goffset start;
 
 			track = tracks->data;
 			song_path = brasero_track_stream_get_source (track, FALSE);
@@ -391,6 +644,7 @@ brasero_audio2cue_create_thread (gpointer data)
 				goto end;
 			}
 
+			start = priv->bytes;
 			result = brasero_audio2cue_write_bin (data, fd_in, fd_out);
 
 			close (fd_in);
@@ -398,11 +652,38 @@ brasero_audio2cue_create_thread (gpointer data)
 
 			if (result != BRASERO_BURN_OK)
 				goto end;
+
+			/* Each song must start on a sector boundary for the
+			 * indexes in the cue file to be right */
+			padding = brasero_silence_get_padding (priv->bytes - start, 2352);
+			if (padding) {
+				BRASERO_JOB_LOG (data, "Padding %" G_GOFFSET_FORMAT " bytes", padding);
+				brasero_audio2cue_disable_direct (data, fd_out);
+				result = brasero_silence_write (fd_out,
+								padding,
+								priv->cancel,
+								&priv->error);
+				if (result != BRASERO_BURN_OK)
+					goto end;
+
+				priv->bytes += padding;
+			}
 		}
 	}
 	else {
 		BRASERO_JOB_LOG (data, "Writing data from fd");
-		brasero_audio2cue_write_bin (data, fd_in, fd_out);
+		result = brasero_audio2cue_write_bin (data, fd_in, fd_out);
+		if (result != BRASERO_BURN_OK)
+			goto end;
+	}
+
+	/* Remove the space reserved but not used */
+	if (ftruncate (fd_out, priv->bytes) == -1) {
+		int err_saved = errno;
+		priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+						   BRASERO_BURN_ERROR_GENERAL,
+						   strerror (err_saved));
+		goto end;
 	}
 
 	close (fd_out);
@@ -620,8 +901,13 @@ end:
 	if (image)
 		g_free (image);
 
+	if (priv->buffer) {
+		free (priv->buffer);
+		priv->buffer = NULL;
+	}
+
 	/* Get out of the thread */
-	if (!priv->cancel)
+	if (!g_cancellable_is_cancelled (priv->cancel))
 		priv->thread_id = g_idle_add (brasero_audio2cue_create_finished, data);
 
 	g_mutex_lock (priv->mutex);
@@ -699,21 +985,38 @@ brasero_audio2cue_init (BraseroAudio2Cue *obj)
 {
 	BraseroAudio2CuePrivate *priv;
 
+	GSettings *settings;
+
 	priv = BRASERO_AUDIO2CUE_PRIVATE (obj);
 	priv->mutex = g_mutex_new ();
 	priv->cond = g_cond_new ();
+	priv->cancel = g_cancellable_new ();
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	priv->direct_io = g_settings_get_boolean (settings, BRASERO_KEY_DIRECT_IO);
+	g_object_unref (settings);
 }
 
 static void
 brasero_audio2cue_finalize (GObject *object)
 {
+	BraseroAudio2CuePrivate *priv;
+
+	priv = BRASERO_AUDIO2CUE_PRIVATE (object);
+
 	brasero_audio2cue_stop_real (BRASERO_AUDIO2CUE (object));
+
+	g_object_unref (priv->cancel);
+	g_mutex_free (priv->mutex);
+	g_cond_free (priv->cond);
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
 brasero_audio2cue_export_caps (BraseroPlugin *plugin)
 {
+	BraseroPluginConfOption *direct_io;
 	GSList *output;
 	GSList *input;
 
@@ -735,4 +1038,10 @@ brasero_audio2cue_export_caps (BraseroPlugin *plugin)
 	brasero_plugin_link_caps (plugin, output, input);
 	g_slist_free (output);
 	g_slist_free (input);
+
+	/* add some configure options */
+	direct_io = brasero_plugin_conf_option_new (BRASERO_KEY_DIRECT_IO,
+						    _("Write images without going through the system cache"),
+						    BRASERO_PLUGIN_OPTION_BOOL);
+	brasero_plugin_add_conf_option (plugin, direct_io);
 }
@@ -697,6 +697,7 @@ brasero_cdrdao_export_caps (BraseroPlugin *plugin)
 			       _("Copies, burns and blanks CDs"),
 			       "Philippe Rouquier",
 			       0);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* that's for cdrdao images: CDs only as input */
 	input = brasero_caps_disc_new (BRASERO_MEDIUM_CD|
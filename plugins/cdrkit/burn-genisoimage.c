@@ -527,6 +527,7 @@ brasero_genisoimage_export_caps (BraseroPlugin *plugin)
 			       _("Creates disc images from a file selection"),
 			       "Philippe Rouquier",
 			       1);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	brasero_plugin_set_flags (plugin,
 				  BRASERO_MEDIUM_CDR|
@@ -450,6 +450,7 @@ brasero_readom_export_caps (BraseroPlugin *plugin)
 			       _("Copies any disc to a disc image"),
 			       "Philippe Rouquier",
 			       1);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* that's for clone mode only The only one to copy audio */
 	output = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_FILE,
@@ -315,6 +315,7 @@ brasero_wodim_stdout_read (BraseroProcess *process, const gchar *line)
 	    sscanf (line, "Track %2u:    %d of %d MB written (fifo  %d%%) [buf  %d%%] |%*s  %*s|   %d.%dx.",
 	            &track, &mb_written, &mb_total, &fifo, &buf, &speed_1, &speed_2) == 7) {
 		brasero_wodim_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_fill (BRASERO_JOB (wodim), buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		brasero_wodim_compute (wodim,
 				       mb_written,
@@ -329,6 +330,7 @@ brasero_wodim_stdout_read (BraseroProcess *process, const gchar *line)
 			 &track, &mb_written, &fifo, &buf, &speed_1, &speed_2) == 6) {
 		/* this line is printed when wodim writes on the fly */
 		brasero_wodim_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_fill (BRASERO_JOB (wodim), buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		if (brasero_job_get_fd_in (BRASERO_JOB (wodim), NULL) == BRASERO_BURN_OK) {
 			goffset bytes = 0;
@@ -1269,6 +1271,7 @@ brasero_wodim_export_caps (BraseroPlugin *plugin)
 			       _("Burns, blanks and formats CDs and DVDs"),
 			       "Philippe Rouquier",
 			       0);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* for recording */
 	input = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_PIPE|
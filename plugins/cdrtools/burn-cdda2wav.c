@@ -411,6 +411,7 @@ brasero_cdda2wav_export_caps (BraseroPlugin *plugin)
 			       _("Copy tracks from an audio CD with all associated information"),
 			       "Philippe Rouquier",
 			       1);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	output = brasero_caps_audio_new (BRASERO_PLUGIN_IO_ACCEPT_FILE /*|BRASERO_PLUGIN_IO_ACCEPT_PIPE*/, /* Keep on the fly on hold until it gets proper testing */
 					 BRASERO_AUDIO_FORMAT_RAW|
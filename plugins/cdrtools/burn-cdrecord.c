@@ -305,6 +305,7 @@ brasero_cdrecord_stdout_read (BraseroProcess *process, const gchar *line)
 	            &track, &mb_written, &mb_total, &fifo, &buf, &speed_1, &speed_2) == 7) {
 
 		brasero_cdrecord_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_fill (BRASERO_JOB (cdrecord), buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		brasero_cdrecord_compute (cdrecord,
 					  mb_written,
@@ -319,6 +320,7 @@ brasero_cdrecord_stdout_read (BraseroProcess *process, const gchar *line)
 			 &track, &mb_written, &fifo, &buf, &speed_1, &speed_2) == 6) {
 
 				 brasero_cdrecord_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_fill (BRASERO_JOB (cdrecord), buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		if (brasero_job_get_fd_in (BRASERO_JOB (cdrecord), NULL) == BRASERO_BURN_OK) {
 			goffset bytes = 0;
@@ -1203,6 +1205,7 @@ brasero_cdrecord_export_caps (BraseroPlugin *plugin)
 			       _("Burns, blanks and formats CDs, DVDs and BDs"),
 			       "Philippe Rouquier",
 			       1);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* for recording */
 	input = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_PIPE|
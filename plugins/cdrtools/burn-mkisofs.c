@@ -531,6 +531,7 @@ brasero_mkisofs_export_caps (BraseroPlugin *plugin)
 			       _("Creates disc images from a file selection"),
 			       "Philippe Rouquier",
 			       2);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	brasero_plugin_set_flags (plugin,
 				  BRASERO_MEDIUM_CDR|
@@ -460,6 +460,7 @@ brasero_readcd_export_caps (BraseroPlugin *plugin)
 			       _("Copies any disc to a disc image"),
 			       "Philippe Rouquier",
 			       0);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* that's for clone mode only The only one to copy audio */
 	output = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_FILE,
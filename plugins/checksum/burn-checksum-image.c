@@ -55,6 +55,8 @@
 #include "brasero-track-image.h"
 #include "brasero-tags.h"
 
+#include "burn-volume-stream.h"
+
 
 #define BRASERO_TYPE_CHECKSUM_IMAGE		(brasero_checksum_image_get_type ())
 #define BRASERO_CHECKSUM_IMAGE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), BRASERO_TYPE_CHECKSUM_IMAGE, BraseroChecksumImage))
@@ -69,6 +71,9 @@ struct _BraseroChecksumImagePrivate {
 	GChecksum *checksum;
 	BraseroChecksumType checksum_type;
 
+	/* Files of the image and their checksums */
+	BraseroVolStream *stream;
+
 	/* That's for progress reporting */
 	goffset total;
 	goffset bytes;
@@ -188,6 +193,27 @@ brasero_checksum_image_write (BraseroChecksumImage *self,
 	return BRASERO_BURN_OK;
 }
 
+static void
+brasero_checksum_image_report_io (BraseroChecksumImage *self,
+				  guint64 *bytes_in,
+				  guint64 *bytes_out,
+				  gint64 *stall_in,
+				  gint64 *stall_out)
+{
+	brasero_job_add_io_bytes (BRASERO_JOB (self), *bytes_in, *bytes_out);
+	brasero_job_add_stall_time (BRASERO_JOB (self),
+				    BRASERO_JOB_STALL_INPUT,
+				    *stall_in);
+	brasero_job_add_stall_time (BRASERO_JOB (self),
+				    BRASERO_JOB_STALL_OUTPUT,
+				    *stall_out);
+
+	*bytes_in = 0;
+	*bytes_out = 0;
+	*stall_in = 0;
+	*stall_out = 0;
+}
+
 static BraseroBurnResult
 brasero_checksum_image_checksum (BraseroChecksumImage *self,
 				 GChecksumType checksum_type,
@@ -199,44 +225,84 @@ brasero_checksum_image_checksum (BraseroChecksumImage *self,
 	guchar buffer [2048];
 	BraseroBurnResult result;
 	BraseroChecksumImagePrivate *priv;
+	guint64 bytes_in = 0, bytes_out = 0;
+	gint64 stall_in = 0, stall_out = 0;
+	guint blocks = 0;
 
 	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
 
 	priv->checksum = g_checksum_new (checksum_type);
 	result = BRASERO_BURN_OK;
 	while (1) {
+		gint64 start;
+
+		start = g_get_monotonic_time ();
 		read_bytes = brasero_checksum_image_read (self,
 							  fd_in,
 							  buffer,
 							  sizeof (buffer),
 							  error);
-		if (read_bytes == -2)
-			return BRASERO_BURN_CANCEL;
+		stall_in += g_get_monotonic_time () - start;
 
-		if (read_bytes == -1)
-			return BRASERO_BURN_ERR;
+		if (read_bytes == -2) {
+			result = BRASERO_BURN_CANCEL;
+			break;
+		}
+
+		if (read_bytes == -1) {
+			result = BRASERO_BURN_ERR;
+			break;
+		}
 
 		if (!read_bytes)
 			break;
 
+		bytes_in += read_bytes;
+
 		/* it can happen when we're just asked to generate a checksum
 		 * that we don't need to output the received data */
 		if (fd_out > 0) {
+			start = g_get_monotonic_time ();
 			result = brasero_checksum_image_write (self,
 							       fd_out,
 							       buffer,
 							       read_bytes, error);
+			stall_out += g_get_monotonic_time () - start;
+
 			if (result != BRASERO_BURN_OK)
 				break;
+
+			bytes_out += read_bytes;
 		}
 
 		g_checksum_update (priv->checksum,
 				   buffer,
 				   read_bytes);
 
+		if (priv->stream)
+			brasero_volume_stream_update (priv->stream,
+						      buffer,
+						      read_bytes);
+
 		priv->bytes += read_bytes;
+
+		/* Report telemetry every 512 KiB not to take the lock for
+		 * every block */
+		if (++ blocks == 256) {
+			brasero_checksum_image_report_io (self,
+							  &bytes_in,
+							  &bytes_out,
+							  &stall_in,
+							  &stall_out);
+			blocks = 0;
+		}
 	}
 
+	brasero_checksum_image_report_io (self,
+					  &bytes_in,
+					  &bytes_out,
+					  &stall_in,
+					  &stall_out);
 	return result;
 }
 
@@ -400,6 +466,11 @@ brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 		/* That's the only way to get the sector size */
 		priv->total *= bytes / sectors;
 
+		/* If the checksums of the files were recorded when the image
+		 * was created, get them as well to tell which are corrupted */
+		if (brasero_track_tag_lookup_string (track, BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG))
+			priv->stream = brasero_volume_stream_new (checksum_type, start);
+
 		return brasero_checksum_image_checksum_fd_input (self, checksum_type, error);
 	}
 	else {
@@ -428,13 +499,56 @@ brasero_checksum_get_checksum_type (void)
 	return checksum_type;
 }
 
+static void
+brasero_checksum_image_files_sums (BraseroChecksumImage *self,
+				   GChecksumType checksum_type)
+{
+	BraseroChecksumImagePrivate *priv;
+	BraseroTrack *track = NULL;
+	GError *error = NULL;
+	gchar *path = NULL;
+	const gchar *suffix;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	if (checksum_type == G_CHECKSUM_SHA256)
+		suffix = ".sha256";
+	else if (checksum_type == G_CHECKSUM_SHA1)
+		suffix = ".sha1";
+	else
+		suffix = ".md5";
+
+	/* This is not an error if that fails; only files won't be checked */
+	if (brasero_job_get_tmp_file (BRASERO_JOB (self), suffix, &path, &error) != BRASERO_BURN_OK
+	|| !brasero_volume_stream_write_sums (priv->stream, path, &error)) {
+		BRASERO_JOB_LOG (self,
+				 "Checksums of the files could not be saved (%s)",
+				 error? error->message:"unknown error");
+		if (error)
+			g_error_free (error);
+
+		g_free (path);
+		return;
+	}
+
+	BRASERO_JOB_LOG (self, "Checksums of the files saved in %s", path);
+
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	brasero_track_tag_add_string (track,
+				      BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG,
+				      path);
+	g_free (path);
+}
+
 static BraseroBurnResult
 brasero_checksum_image_image_and_checksum (BraseroChecksumImage *self,
 					   GError **error)
 {
+	BraseroBurnFlag flags = BRASERO_BURN_FLAG_NONE;
 	BraseroBurnResult result;
 	GChecksumType checksum_type;
 	BraseroChecksumImagePrivate *priv;
+	goffset start_block = 0;
 
 	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
 
@@ -457,6 +571,15 @@ brasero_checksum_image_image_and_checksum (BraseroChecksumImage *self,
 					FALSE);
 	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
 
+	/* The files are hashed from the blocks of the image that go to the
+	 * recorder as well, so that they are not read a second time. */
+	brasero_job_get_flags (BRASERO_JOB (self), &flags);
+	if (flags & (BRASERO_BURN_FLAG_APPEND|BRASERO_BURN_FLAG_MERGE))
+		brasero_job_get_next_writable_address (BRASERO_JOB (self), &start_block);
+
+	if (start_block >= 0)
+		priv->stream = brasero_volume_stream_new (checksum_type, start_block);
+
 	if (brasero_job_get_fd_in (BRASERO_JOB (self), NULL) != BRASERO_BURN_OK) {
 		BraseroTrack *track;
 
@@ -476,6 +599,14 @@ brasero_checksum_image_image_and_checksum (BraseroChecksumImage *self,
 								   checksum_type,
 								   error);
 
+	if (result == BRASERO_BURN_OK && priv->stream)
+		brasero_checksum_image_files_sums (self, checksum_type);
+
+	if (priv->stream) {
+		brasero_volume_stream_free (priv->stream);
+		priv->stream = NULL;
+	}
+
 	return result;
 }
 
@@ -486,6 +617,33 @@ struct _BraseroChecksumImageThreadCtx {
 };
 typedef struct _BraseroChecksumImageThreadCtx BraseroChecksumImageThreadCtx;
 
+static void
+brasero_checksum_image_wrong_files (BraseroChecksumImage *self,
+				    BraseroTrack *track)
+{
+	BraseroChecksumImagePrivate *priv;
+	gchar **wrong_checksums;
+	GValue *value;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	/* Compare the files read from the disc with those that were in the
+	 * image when it was recorded */
+	wrong_checksums = brasero_volume_stream_compare_sums (priv->stream,
+							      brasero_track_tag_lookup_string (track, BRASERO_TRACK_IMAGE_FILES_CHECKSUM_TAG));
+	if (!wrong_checksums)
+		return;
+
+	BRASERO_JOB_LOG (self, "%i corrupted files", g_strv_length (wrong_checksums));
+
+	value = g_new0 (GValue, 1);
+	g_value_init (value, G_TYPE_STRV);
+	g_value_take_boxed (value, wrong_checksums);
+	brasero_track_tag_add (track,
+			       BRASERO_TRACK_MEDIUM_WRONG_CHECKSUM_TAG,
+			       value);
+}
+
 static gboolean
 brasero_checksum_image_end (gpointer data)
 {
@@ -512,6 +670,11 @@ brasero_checksum_image_end (gpointer data)
 		g_checksum_free (priv->checksum);
 		priv->checksum = NULL;
 
+		if (priv->stream) {
+			brasero_volume_stream_free (priv->stream);
+			priv->stream = NULL;
+		}
+
 		brasero_job_error (BRASERO_JOB (self), error);
 		return FALSE;
 	}
@@ -535,6 +698,14 @@ brasero_checksum_image_end (gpointer data)
 	g_checksum_free (priv->checksum);
 	priv->checksum = NULL;
 
+	if (result != BRASERO_BURN_OK && priv->stream)
+		brasero_checksum_image_wrong_files (self, track);
+
+	if (priv->stream) {
+		brasero_volume_stream_free (priv->stream);
+		priv->stream = NULL;
+	}
+
 	if (result != BRASERO_BURN_OK)
 		goto error;
 
@@ -747,6 +918,11 @@ brasero_checksum_image_stop (BraseroJob *job,
 		priv->checksum = NULL;
 	}
 
+	if (priv->stream) {
+		brasero_volume_stream_free (priv->stream);
+		priv->stream = NULL;
+	}
+
 	return BRASERO_BURN_OK;
 }
 
@@ -787,6 +963,11 @@ brasero_checksum_image_finalize (GObject *object)
 		priv->checksum = NULL;
 	}
 
+	if (priv->stream) {
+		brasero_volume_stream_free (priv->stream);
+		priv->stream = NULL;
+	}
+
 	if (priv->mutex) {
 		g_mutex_free (priv->mutex);
 		priv->mutex = NULL;
@@ -0,0 +1,635 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+
+#include "brasero-error.h"
+#include "burn-iso9660.h"
+#include "burn-iso-field.h"
+#include "burn-susp.h"
+#include "burn-volume-stream.h"
+
+/* Offsets of the fields we need in a directory record */
+#define DIR_REC_SIZE			0
+#define DIR_REC_ADDRESS			2
+#define DIR_REC_FILE_SIZE		10
+#define DIR_REC_FLAGS			25
+#define DIR_REC_ID_SIZE			32
+#define DIR_REC_ID			33
+
+#define DIR_REC_FLAG_DIRECTORY		(1 << 1)
+#define DIR_REC_FLAG_MULTI_EXTENT	(1 << 7)
+
+/* Offset of the root directory record in the primary volume descriptor */
+#define PRIMARY_ROOT_REC		156
+#define PRIMARY_BLOCK			16
+
+struct _BraseroVolStreamFile {
+	gchar *path;
+
+	guint64 size;
+	guint64 done;
+
+	GChecksum *checksum;
+	gchar *sum;
+
+	guint missed:1;
+};
+typedef struct _BraseroVolStreamFile BraseroVolStreamFile;
+
+struct _BraseroVolStreamExtent {
+	BraseroVolStreamFile *file;
+
+	/* bytes still to come */
+	guint32 size;
+};
+typedef struct _BraseroVolStreamExtent BraseroVolStreamExtent;
+
+struct _BraseroVolStreamDir {
+	gchar *path;
+	guint32 size;
+	GByteArray *records;
+};
+typedef struct _BraseroVolStreamDir BraseroVolStreamDir;
+
+struct _BraseroVolStream {
+	GChecksumType type;
+	gint64 start_block;
+
+	/* Blocks can be split over several reads */
+	guchar buffer [ISO9660_BLOCK_SIZE];
+	guint buffer_len;
+
+	/* Number of blocks seen so far */
+	gint64 blocks;
+
+	guchar susp_skip;
+
+	/* Directories and file extents (GSList) waiting for their first block
+	 * indexed by address */
+	GHashTable *directories;
+	GHashTable *extents;
+
+	/* Directory whose records are being collected */
+	BraseroVolStreamDir *directory;
+
+	/* File extents whose blocks are going through */
+	GSList *active;
+
+	/* All files, last found first */
+	GSList *files;
+
+	/* Last file if its record said it had more extents */
+	BraseroVolStreamFile *multi;
+
+	guint disabled:1;
+};
+
+static void
+brasero_volume_stream_dir_free (BraseroVolStreamDir *directory)
+{
+	g_byte_array_free (directory->records, TRUE);
+	g_free (directory->path);
+	g_free (directory);
+}
+
+static void
+brasero_volume_stream_extents_free (GSList *extents)
+{
+	g_slist_foreach (extents, (GFunc) g_free, NULL);
+	g_slist_free (extents);
+}
+
+static void
+brasero_volume_stream_file_free (BraseroVolStreamFile *file)
+{
+	if (file->checksum)
+		g_checksum_free (file->checksum);
+
+	g_free (file->sum);
+	g_free (file->path);
+	g_free (file);
+}
+
+static void
+brasero_volume_stream_file_finished (BraseroVolStream *stream,
+				     BraseroVolStreamFile *file)
+{
+	if (!file->checksum)
+		file->checksum = g_checksum_new (stream->type);
+
+	file->sum = g_strdup (g_checksum_get_string (file->checksum));
+	g_checksum_free (file->checksum);
+	file->checksum = NULL;
+}
+
+static void
+brasero_volume_stream_add_directory (BraseroVolStream *stream,
+				     const gchar *path,
+				     guint32 address,
+				     guint32 size)
+{
+	BraseroVolStreamDir *directory;
+
+	/* Directories that were already streamed are lost; so are their
+	 * files. Same thing if it was found already (loop). */
+	if (address < stream->start_block + stream->blocks
+	||  g_hash_table_lookup (stream->directories, GUINT_TO_POINTER (address)))
+		return;
+
+	directory = g_new0 (BraseroVolStreamDir, 1);
+	directory->path = g_strdup (path);
+	directory->size = size;
+	directory->records = g_byte_array_sized_new (size);
+
+	g_hash_table_insert (stream->directories,
+			     GUINT_TO_POINTER (address),
+			     directory);
+}
+
+static void
+brasero_volume_stream_add_file (BraseroVolStream *stream,
+				gchar *path,
+				guint32 address,
+				guint32 size,
+				gboolean more_extents)
+{
+	BraseroVolStreamExtent *extent;
+	BraseroVolStreamFile *file;
+	GSList *extents;
+
+	/* Files bigger than 4 GiB have one record per extent which always
+	 * follow each other */
+	if (stream->multi && !strcmp (stream->multi->path, path)) {
+		file = stream->multi;
+		g_free (path);
+	}
+	else {
+		file = g_new0 (BraseroVolStreamFile, 1);
+		file->path = path;
+		stream->files = g_slist_prepend (stream->files, file);
+	}
+
+	stream->multi = more_extents? file:NULL;
+	file->size += size;
+
+	if (size) {
+		if (address < stream->start_block + stream->blocks) {
+			/* Its data went through before we knew about it */
+			file->missed = TRUE;
+			return;
+		}
+
+		extent = g_new0 (BraseroVolStreamExtent, 1);
+		extent->file = file;
+		extent->size = size;
+
+		/* Several files may share the same extent */
+		extents = g_hash_table_lookup (stream->extents, GUINT_TO_POINTER (address));
+		if (extents) {
+			g_hash_table_steal (stream->extents, GUINT_TO_POINTER (address));
+			extents = g_slist_append (extents, extent);
+		}
+		else
+			extents = g_slist_prepend (NULL, extent);
+
+		g_hash_table_insert (stream->extents,
+				     GUINT_TO_POINTER (address),
+				     extents);
+	}
+	else if (!more_extents && !file->done && !file->size)
+		brasero_volume_stream_file_finished (stream, file);
+}
+
+static gchar *
+brasero_volume_stream_iso_name (const gchar *id,
+				guint id_size)
+{
+	gchar *name;
+	gchar *ptr;
+
+	name = g_strndup (id, id_size);
+
+	/* remove the version and a trailing dot */
+	ptr = strchr (name, ';');
+	if (ptr)
+		*ptr = '\0';
+
+	ptr = name + strlen (name);
+	if (ptr > name && *(ptr - 1) == '.')
+		*(ptr - 1) = '\0';
+
+	return name;
+}
+
+static void
+brasero_volume_stream_record (BraseroVolStream *stream,
+			      BraseroVolStreamDir *directory,
+			      guchar *record)
+{
+	BraseroSuspCtx susp_ctx;
+	guint record_size;
+	guint32 address;
+	guint id_size;
+	guint32 size;
+	gchar *name;
+	gchar *path;
+	guint start;
+
+	record_size = record [DIR_REC_SIZE];
+	id_size = record [DIR_REC_ID_SIZE];
+	if (DIR_REC_ID + id_size > record_size)
+		return;
+
+	/* Rock Ridge name and relocation */
+	memset (&susp_ctx, 0, sizeof (BraseroSuspCtx));
+
+	start = DIR_REC_ID + id_size;
+	if (start & 1)
+		start ++;
+
+	start += stream->susp_skip;
+	if (start < record_size)
+		brasero_susp_read (&susp_ctx,
+				   (gchar *) record + start,
+				   record_size - start);
+
+	/* Deep directories that were relocated are not followed */
+	if (susp_ctx.has_RE || susp_ctx.CL_address) {
+		brasero_susp_ctx_clean (&susp_ctx);
+		return;
+	}
+
+	if (susp_ctx.rr_name)
+		name = g_strdup (susp_ctx.rr_name);
+	else
+		name = brasero_volume_stream_iso_name ((gchar *) record + DIR_REC_ID, id_size);
+
+	brasero_susp_ctx_clean (&susp_ctx);
+
+	path = g_strconcat (directory->path, G_DIR_SEPARATOR_S, name, NULL);
+	g_free (name);
+
+	address = brasero_iso9660_get_733_val (record + DIR_REC_ADDRESS);
+	size = brasero_iso9660_get_733_val (record + DIR_REC_FILE_SIZE);
+
+	if (record [DIR_REC_FLAGS] & DIR_REC_FLAG_DIRECTORY) {
+		stream->multi = NULL;
+		brasero_volume_stream_add_directory (stream, path, address, size);
+		g_free (path);
+	}
+	else
+		brasero_volume_stream_add_file (stream,
+						path,
+						address,
+						size,
+						(record [DIR_REC_FLAGS] & DIR_REC_FLAG_MULTI_EXTENT) != 0);
+}
+
+static void
+brasero_volume_stream_directory (BraseroVolStream *stream,
+				 BraseroVolStreamDir *directory)
+{
+	guint offset = 0;
+	guint num = 0;
+
+	stream->multi = NULL;
+	while (offset < directory->records->len) {
+		guchar *record;
+		guint record_size;
+
+		record = directory->records->data + offset;
+		record_size = record [DIR_REC_SIZE];
+
+		/* Records never span two blocks; so go to the next one */
+		if (!record_size) {
+			offset = (offset / ISO9660_BLOCK_SIZE + 1) * ISO9660_BLOCK_SIZE;
+			continue;
+		}
+
+		if (record_size <= DIR_REC_ID
+		||  offset + record_size > directory->records->len)
+			break;
+
+		num ++;
+		offset += record_size;
+
+		/* Skip "." and ".." but "." of root tells whether the system
+		 * use area of the records starts after a few bytes */
+		if (num == 1 && !directory->path [0]) {
+			BraseroSuspCtx susp_ctx;
+			guint start;
+
+			memset (&susp_ctx, 0, sizeof (BraseroSuspCtx));
+			start = DIR_REC_ID + record [DIR_REC_ID_SIZE];
+			if (start & 1)
+				start ++;
+
+			if (start < record_size) {
+				brasero_susp_read (&susp_ctx,
+						   (gchar *) record + start,
+						   record_size - start);
+				stream->susp_skip = susp_ctx.skip;
+			}
+			brasero_susp_ctx_clean (&susp_ctx);
+		}
+
+		if (num <= 2)
+			continue;
+
+		brasero_volume_stream_record (stream, directory, record);
+	}
+}
+
+static void
+brasero_volume_stream_primary (BraseroVolStream *stream,
+			       guchar *block)
+{
+	guchar *root;
+
+	if (block [0] != 1 || memcmp (block + 1, "CD001", 5)) {
+		/* Not an ISO9660 image, nothing to follow */
+		stream->disabled = TRUE;
+		return;
+	}
+
+	root = block + PRIMARY_ROOT_REC;
+	brasero_volume_stream_add_directory (stream,
+					     "",
+					     brasero_iso9660_get_733_val (root + DIR_REC_ADDRESS),
+					     brasero_iso9660_get_733_val (root + DIR_REC_FILE_SIZE));
+}
+
+static void
+brasero_volume_stream_block (BraseroVolStream *stream,
+			     guchar *block)
+{
+	GSList *extents;
+	guint32 address;
+	GSList *iter;
+	GSList *next;
+
+	address = stream->start_block + stream->blocks;
+	stream->blocks ++;
+
+	if (stream->blocks == PRIMARY_BLOCK + 1) {
+		brasero_volume_stream_primary (stream, block);
+		return;
+	}
+
+	/* Directory records come (usually all) before the files' data */
+	if (!stream->directory) {
+		stream->directory = g_hash_table_lookup (stream->directories, GUINT_TO_POINTER (address));
+		if (stream->directory)
+			g_hash_table_steal (stream->directories, GUINT_TO_POINTER (address));
+	}
+
+	if (stream->directory) {
+		g_byte_array_append (stream->directory->records, block, ISO9660_BLOCK_SIZE);
+		if (stream->directory->records->len >= stream->directory->size) {
+			brasero_volume_stream_directory (stream, stream->directory);
+			brasero_volume_stream_dir_free (stream->directory);
+			stream->directory = NULL;
+		}
+		return;
+	}
+
+	extents = g_hash_table_lookup (stream->extents, GUINT_TO_POINTER (address));
+	if (extents) {
+		g_hash_table_steal (stream->extents, GUINT_TO_POINTER (address));
+		stream->active = g_slist_concat (stream->active, extents);
+	}
+
+	for (iter = stream->active; iter; iter = next) {
+		BraseroVolStreamExtent *extent;
+		BraseroVolStreamFile *file;
+		guint len;
+
+		next = iter->next;
+		extent = iter->data;
+		file = extent->file;
+
+		len = MIN (extent->size, ISO9660_BLOCK_SIZE);
+		if (!file->checksum)
+			file->checksum = g_checksum_new (stream->type);
+
+		g_checksum_update (file->checksum, block, len);
+		file->done += len;
+		extent->size -= len;
+
+		if (extent->size)
+			continue;
+
+		stream->active = g_slist_delete_link (stream->active, iter);
+		g_free (extent);
+
+		if (file->done == file->size)
+			brasero_volume_stream_file_finished (stream, file);
+	}
+}
+
+void
+brasero_volume_stream_update (BraseroVolStream *stream,
+			      const guchar *buffer,
+			      gsize bytes)
+{
+	while (bytes && !stream->disabled) {
+		guint len;
+
+		len = MIN (ISO9660_BLOCK_SIZE - stream->buffer_len, bytes);
+		memcpy (stream->buffer + stream->buffer_len, buffer, len);
+		stream->buffer_len += len;
+
+		buffer += len;
+		bytes -= len;
+
+		if (stream->buffer_len < ISO9660_BLOCK_SIZE)
+			break;
+
+		brasero_volume_stream_block (stream, stream->buffer);
+		stream->buffer_len = 0;
+	}
+}
+
+gboolean
+brasero_volume_stream_write_sums (BraseroVolStream *stream,
+				  const gchar *path,
+				  GError **error)
+{
+	GSList *iter;
+	FILE *file;
+
+	file = fopen (path, "w");
+	if (!file) {
+                int errsv = errno;
+
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("File \"%s\" could not be opened (%s)"),
+			     path,
+			     g_strerror (errsv));
+		return FALSE;
+	}
+
+	/* NOTE: like md5sum files, paths are relative to the root */
+	stream->files = g_slist_reverse (stream->files);
+	for (iter = stream->files; iter; iter = iter->next) {
+		BraseroVolStreamFile *stream_file;
+
+		stream_file = iter->data;
+		if (stream_file->missed || !stream_file->sum)
+			continue;
+
+		if (fprintf (file, "%s  %s\n", stream_file->sum, stream_file->path + 1) < 0) {
+	                int errsv = errno;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+
+			fclose (file);
+			stream->files = g_slist_reverse (stream->files);
+			return FALSE;
+		}
+	}
+	stream->files = g_slist_reverse (stream->files);
+
+	fclose (file);
+	return TRUE;
+}
+
+gchar **
+brasero_volume_stream_compare_sums (BraseroVolStream *stream,
+				    const gchar *path)
+{
+	GPtrArray *wrong_sums;
+	GHashTable *sums;
+	gchar *contents;
+	gchar **lines;
+	GSList *iter;
+	guint i;
+
+	if (!g_file_get_contents (path, &contents, NULL, NULL))
+		return NULL;
+
+	lines = g_strsplit (contents, "\n", -1);
+	g_free (contents);
+
+	/* Paths keep their leading "/" here */
+	sums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; lines [i]; i ++) {
+		gchar *separator;
+
+		separator = strstr (lines [i], "  ");
+		if (!separator)
+			continue;
+
+		*separator = '\0';
+		g_hash_table_insert (sums,
+				     g_strconcat (G_DIR_SEPARATOR_S, separator + 2, NULL),
+				     lines [i]);
+	}
+
+	wrong_sums = g_ptr_array_new ();
+	for (iter = stream->files; iter; iter = iter->next) {
+		BraseroVolStreamFile *file;
+		const gchar *sum;
+
+		file = iter->data;
+		if (file->missed || !file->sum)
+			continue;
+
+		sum = g_hash_table_lookup (sums, file->path);
+		if (sum && strcmp (sum, file->sum))
+			g_ptr_array_add (wrong_sums, g_strdup (file->path));
+	}
+
+	g_hash_table_destroy (sums);
+	g_strfreev (lines);
+
+	if (!wrong_sums->len) {
+		g_ptr_array_free (wrong_sums, TRUE);
+		return NULL;
+	}
+
+	g_ptr_array_add (wrong_sums, NULL);
+	return (gchar **) g_ptr_array_free (wrong_sums, FALSE);
+}
+
+BraseroVolStream *
+brasero_volume_stream_new (GChecksumType type,
+			   gint64 start_block)
+{
+	BraseroVolStream *stream;
+
+	stream = g_new0 (BraseroVolStream, 1);
+	stream->type = type;
+	stream->start_block = start_block;
+
+	stream->directories = g_hash_table_new_full (g_direct_hash,
+						     g_direct_equal,
+						     NULL,
+						     (GDestroyNotify) brasero_volume_stream_dir_free);
+	stream->extents = g_hash_table_new_full (g_direct_hash,
+						 g_direct_equal,
+						 NULL,
+						 (GDestroyNotify) brasero_volume_stream_extents_free);
+
+	return stream;
+}
+
+void
+brasero_volume_stream_free (BraseroVolStream *stream)
+{
+	g_hash_table_destroy (stream->directories);
+	g_hash_table_destroy (stream->extents);
+
+	if (stream->directory)
+		brasero_volume_stream_dir_free (stream->directory);
+
+	brasero_volume_stream_extents_free (stream->active);
+
+	g_slist_foreach (stream->files, (GFunc) brasero_volume_stream_file_free, NULL);
+	g_slist_free (stream->files);
+
+	g_free (stream);
+}
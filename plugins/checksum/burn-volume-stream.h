@@ -0,0 +1,71 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+ 
+#ifndef _BURN_VOLUME_STREAM_H
+#define _BURN_VOLUME_STREAM_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BraseroVolStream BraseroVolStream;
+
+/**
+ * Follows an ISO9660 image while it is streamed (start_block is the address
+ * of its first block on the medium) and computes the checksum of each file
+ * from the blocks of its extents.
+ */
+
+BraseroVolStream *
+brasero_volume_stream_new (GChecksumType type,
+			   gint64 start_block);
+
+void
+brasero_volume_stream_free (BraseroVolStream *stream);
+
+void
+brasero_volume_stream_update (BraseroVolStream *stream,
+			      const guchar *buffer,
+			      gsize bytes);
+
+gboolean
+brasero_volume_stream_write_sums (BraseroVolStream *stream,
+				  const gchar *path,
+				  GError **error);
+
+gchar **
+brasero_volume_stream_compare_sums (BraseroVolStream *stream,
+				    const gchar *path);
+
+G_END_DECLS
+
+#endif /* _BURN_VOLUME_STREAM_H */
+
+ 
@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -64,6 +65,22 @@
 
 BRASERO_PLUGIN_BOILERPLATE (BraseroDvdcss, brasero_dvdcss, BRASERO_TYPE_JOB, BraseroJob);
 
+/* Statistics for each stage of the copy (times are in microseconds) */
+struct _BraseroDvdcssStage {
+	guint64 bytes;
+	gint64 busy;
+	gint64 wait;
+};
+typedef struct _BraseroDvdcssStage BraseroDvdcssStage;
+
+/* A buffer of the ring shared by the reading and the writing threads. A
+ * buffer with no sectors marks the end of the stream. */
+struct _BraseroDvdcssBuffer {
+	guchar *data;
+	gint sectors;
+};
+typedef struct _BraseroDvdcssBuffer BraseroDvdcssBuffer;
+
 struct _BraseroDvdcssPrivate {
 	GError *error;
 	GThread *thread;
@@ -71,16 +88,52 @@ struct _BraseroDvdcssPrivate {
 	GCond *cond;
 	guint thread_id;
 
+	/* Used by the writing thread */
+	GAsyncQueue *free_buffers;
+	GAsyncQueue *full_buffers;
+	FILE *output_fd;
+	GError *write_error;
+
+	BraseroDvdcssStage reader;
+	BraseroDvdcssStage writer;
+
 	guint cancel:1;
 };
 typedef struct _BraseroDvdcssPrivate BraseroDvdcssPrivate;
 
 #define BRASERO_DVDCSS_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_DVDCSS, BraseroDvdcssPrivate))
 
-#define BRASERO_DVDCSS_I_BLOCKS	16ULL
+/* Each read is 512 KiB and there are 8 of them in flight (4 MiB) */
+#define BRASERO_DVDCSS_I_BLOCKS	256ULL
+#define BRASERO_DVDCSS_BUFFERS	8
 
 static GObjectClass *parent_class = NULL;
 
+/**
+ * Have libdvdcss keep the title keys it cracked alongside our own cache of
+ * scrambled sectors unless the user chose a location. libdvdcss only reads
+ * DVDCSS_CACHE from the environment; changing the environment is not thread
+ * safe so this is done once when the module is registered, from the main
+ * thread before any plugin is checked or any job is started.
+ */
+
+static void
+brasero_dvdcss_set_key_cache (void)
+{
+	gchar *cache_dir;
+
+	if (g_getenv ("DVDCSS_CACHE"))
+		return;
+
+	cache_dir = g_build_filename (g_get_user_cache_dir (),
+				      "brasero",
+				      "dvdcss",
+				      NULL);
+	if (!g_mkdir_with_parents (cache_dir, 0700))
+		g_setenv ("DVDCSS_CACHE", cache_dir, FALSE);
+	g_free (cache_dir);
+}
+
 static gboolean
 brasero_dvdcss_library_init (BraseroPlugin *plugin)
 {
@@ -184,7 +237,8 @@ brasero_dvdcss_thread_finished (gpointer data)
 static BraseroBurnResult
 brasero_dvdcss_write_sector_to_fd (BraseroDvdcss *self,
 				   gpointer buffer,
-				   gint bytes_remaining)
+				   gint bytes_remaining,
+				   GError **error)
 {
 	int fd;
 	gint bytes_written = 0;
@@ -194,6 +248,7 @@ brasero_dvdcss_write_sector_to_fd (BraseroDvdcss *self,
 
 	brasero_job_get_fd_out (BRASERO_JOB (self), &fd);
 	while (bytes_remaining) {
+		struct pollfd fds;
 		gint written;
 
 		written = write (fd,
@@ -201,30 +256,120 @@ brasero_dvdcss_write_sector_to_fd (BraseroDvdcss *self,
 				 bytes_remaining);
 
 		if (priv->cancel)
+			return BRASERO_BURN_CANCEL;
+
+		if (written > 0) {
+			bytes_remaining -= written;
+			bytes_written += written;
+			continue;
+		}
+
+		if (errno != EINTR && errno != EAGAIN) {
+			int errsv = errno;
+
+			/* unrecoverable error */
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			return BRASERO_BURN_ERR;
+		}
+
+		/* Wait for the pipe to be writable again; the timeout is only
+		 * there to check for cancellation */
+		fds.fd = fd;
+		fds.events = POLLOUT;
+		fds.revents = 0;
+		poll (&fds, 1, 100);
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_dvdcss_log_stage (BraseroDvdcss *self,
+			  const gchar *name,
+			  BraseroDvdcssStage *stage,
+			  const gchar *wait)
+{
+	gdouble rate = 0.0;
+
+	if (stage->busy > 0)
+		rate = (gdouble) stage->bytes / (gdouble) stage->busy * 1000000.0 / 1048576.0;
+
+	BRASERO_JOB_LOG (self,
+			 "%s: %" G_GUINT64_FORMAT " bytes in %.2fs (%.2f MiB/s), %.2fs waiting for %s",
+			 name,
+			 stage->bytes,
+			 (gdouble) stage->busy / 1000000.0,
+			 rate,
+			 (gdouble) stage->wait / 1000000.0,
+			 wait);
+}
+
+static gpointer
+brasero_dvdcss_write_thread (gpointer data)
+{
+	BraseroDvdcss *self = data;
+	BraseroDvdcssPrivate *priv;
+
+	priv = BRASERO_DVDCSS_PRIVATE (self);
+
+	while (1) {
+		BraseroDvdcssBuffer *buffer;
+		BraseroBurnResult result;
+		gint64 data_size;
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		buffer = g_async_queue_pop (priv->full_buffers);
+		priv->writer.wait += g_get_monotonic_time () - start;
+
+		if (!buffer->sectors) {
+			g_async_queue_push (priv->free_buffers, buffer);
 			break;
+		}
+
+		/* After an error or a cancellation, buffers are just handed
+		 * back to the reading thread until it stops */
+		if (priv->cancel || priv->write_error) {
+			g_async_queue_push (priv->free_buffers, buffer);
+			continue;
+		}
 
-		if (written != bytes_remaining) {
-			if (errno != EINTR && errno != EAGAIN) {
+		start = g_get_monotonic_time ();
+		data_size = buffer->sectors * DVDCSS_BLOCK_SIZE;
+		if (priv->output_fd) {
+			if (fwrite (buffer->data, 1, data_size, priv->output_fd) != data_size) {
                                 int errsv = errno;
 
-				/* unrecoverable error */
-				priv->error = g_error_new (BRASERO_BURN_ERROR,
-							   BRASERO_BURN_ERROR_GENERAL,
-							   _("Data could not be written (%s)"),
-							   g_strerror (errsv));
-				return BRASERO_BURN_ERR;
+				priv->write_error = g_error_new (BRASERO_BURN_ERROR,
+								 BRASERO_BURN_ERROR_GENERAL,
+								 _("Data could not be written (%s)"),
+								 g_strerror (errsv));
 			}
-
-			g_thread_yield ();
 		}
-
-		if (written > 0) {
-			bytes_remaining -= written;
-			bytes_written += written;
+		else {
+			result = brasero_dvdcss_write_sector_to_fd (self,
+								    buffer->data,
+								    data_size,
+								    &priv->write_error);
+			if (result == BRASERO_BURN_CANCEL)
+				priv->cancel = 1;
 		}
+		priv->writer.busy += g_get_monotonic_time () - start;
+
+		g_async_queue_push (priv->free_buffers, buffer);
+
+		if (priv->write_error || priv->cancel)
+			continue;
+
+		priv->writer.bytes += data_size;
+		brasero_job_set_written_track (BRASERO_JOB (self), priv->writer.bytes);
 	}
 
-	return BRASERO_BURN_OK;
+	return NULL;
 }
 
 struct _BraseroScrambledSectorRange {
@@ -311,11 +456,165 @@ brasero_dvdcss_sort_ranges (gconstpointer a, gconstpointer b, gpointer user_data
 	return range_a->start - range_b->start;
 }
 
+#define BRASERO_DVDCSS_CACHE_GROUP	"Disc"
+
+/**
+ * The map of scrambled sectors of a disc is cached so that copying the same
+ * disc again does not require to walk all its files. A disc is identified by
+ * its volume identifier, its size and a hash of its primary volume
+ * descriptor (which includes creation and modification dates).
+ */
+
+static gchar *
+brasero_dvdcss_cache_get_path (BraseroDvdcss *self,
+			       BraseroVolSrc *vol,
+			       gint64 volume_size)
+{
+	gchar buffer [DVDCSS_BLOCK_SIZE];
+	GError *error = NULL;
+	gchar *checksum;
+	gchar *volume_id;
+	gchar *path;
+	gchar *name;
+
+	/* The primary volume descriptor is right after the system area */
+	if (BRASERO_VOL_SRC_SEEK (vol, 16, SEEK_SET, &error) == -1
+	|| !BRASERO_VOL_SRC_READ (vol, buffer, 1, &error)) {
+		BRASERO_JOB_LOG (self, "Primary volume descriptor could not be read: %s",
+				 error ? error->message : "unknown error");
+		if (error)
+			g_error_free (error);
+		return NULL;
+	}
+
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+						(guchar *) buffer,
+						sizeof (buffer));
+
+	/* Volume identifier is 32 characters long at offset 40 */
+	volume_id = g_strndup (buffer + 40, 32);
+	g_strstrip (volume_id);
+	g_strcanon (volume_id,
+		    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-",
+		    '_');
+
+	name = g_strdup_printf ("%s-%" G_GINT64_FORMAT "-%s.map",
+				volume_id,
+				volume_size,
+				checksum);
+	g_free (volume_id);
+	g_free (checksum);
+
+	path = g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "dvdcss",
+				 name,
+				 NULL);
+	g_free (name);
+
+	return path;
+}
+
+static gboolean
+brasero_dvdcss_cache_load (BraseroDvdcss *self,
+			   const gchar *path,
+			   gint64 volume_size,
+			   GQueue *map)
+{
+	GKeyFile *keyfile;
+	gint *ranges;
+	gsize num = 0;
+	gsize i;
+
+	keyfile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (keyfile);
+		return FALSE;
+	}
+
+	if (!g_key_file_has_key (keyfile, BRASERO_DVDCSS_CACHE_GROUP, "Ranges", NULL)
+	||   g_key_file_get_int64 (keyfile, BRASERO_DVDCSS_CACHE_GROUP, "Size", NULL) != volume_size) {
+		BRASERO_JOB_LOG (self, "Cached map does not match the disc size");
+		g_key_file_free (keyfile);
+		return FALSE;
+	}
+
+	ranges = g_key_file_get_integer_list (keyfile,
+					      BRASERO_DVDCSS_CACHE_GROUP,
+					      "Ranges",
+					      &num,
+					      NULL);
+	g_key_file_free (keyfile);
+
+	/* A disc with no scrambled sectors has an empty list */
+	if (num % 2) {
+		BRASERO_JOB_LOG (self, "Invalid cached map");
+		g_free (ranges);
+		return FALSE;
+	}
+
+	for (i = 0; i < num; i += 2) {
+		BraseroScrambledSectorRange *range;
+
+		range = g_new0 (BraseroScrambledSectorRange, 1);
+		range->start = ranges [i];
+		range->end = ranges [i + 1];
+		g_queue_push_tail (map, range);
+	}
+
+	g_free (ranges);
+	return TRUE;
+}
+
+static void
+brasero_dvdcss_cache_save (BraseroDvdcss *self,
+			   const gchar *path,
+			   gint64 volume_size,
+			   GQueue *map)
+{
+	GError *error = NULL;
+	GKeyFile *keyfile;
+	gchar *directory;
+	gint *ranges;
+	gchar *data;
+	gsize size;
+	GList *iter;
+	gint i = 0;
+
+	directory = g_path_get_dirname (path);
+	g_mkdir_with_parents (directory, 0700);
+	g_free (directory);
+
+	ranges = g_new0 (gint, g_queue_get_length (map) * 2 + 1);
+	for (iter = map->head; iter; iter = iter->next) {
+		BraseroScrambledSectorRange *range = iter->data;
+
+		ranges [i ++] = range->start;
+		ranges [i ++] = range->end;
+	}
+
+	keyfile = g_key_file_new ();
+	g_key_file_set_int64 (keyfile, BRASERO_DVDCSS_CACHE_GROUP, "Size", volume_size);
+	g_key_file_set_integer_list (keyfile, BRASERO_DVDCSS_CACHE_GROUP, "Ranges", ranges, i);
+	g_free (ranges);
+
+	data = g_key_file_to_data (keyfile, &size, NULL);
+	g_key_file_free (keyfile);
+
+	if (!g_file_set_contents (path, data, size, &error)) {
+		BRASERO_JOB_LOG (self, "Map could not be cached: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_free (data);
+}
+
 static gpointer
 brasero_dvdcss_write_image_thread (gpointer data)
 {
-	guchar buf [DVDCSS_BLOCK_SIZE * BRASERO_DVDCSS_I_BLOCKS];
 	BraseroScrambledSectorRange *range = NULL;
+	BraseroDvdcssBuffer *buffer;
+	GThread *writer = NULL;
 	BraseroMedium *medium = NULL;
 	BraseroVolFile *files = NULL;
 	dvdcss_handle *handle = NULL;
@@ -325,10 +624,11 @@ brasero_dvdcss_write_image_thread (gpointer data)
 	BraseroDvdcss *self = data;
 	BraseroTrack *track = NULL;
 	guint64 remaining_sectors;
-	FILE *output_fd = NULL;
 	BraseroVolSrc *vol;
+	gint i;
 	gint64 volume_size;
 	GQueue *map = NULL;
+	gchar *cache_path = NULL;
 
 	brasero_job_set_use_average_rate (BRASERO_JOB (self), TRUE);
 	brasero_job_set_current_action (BRASERO_JOB (self),
@@ -343,17 +643,6 @@ brasero_dvdcss_write_image_thread (gpointer data)
 	brasero_job_get_current_track (BRASERO_JOB (self), &track);
 	drive = brasero_track_disc_get_drive (BRASERO_TRACK_DISC (track));
 
-	vol = brasero_volume_source_open_file (brasero_drive_get_device (drive), &priv->error);
-	files = brasero_volume_get_files (vol,
-					  0,
-					  NULL,
-					  NULL,
-					  NULL,
-					  &priv->error);
-	brasero_volume_source_close (vol);
-	if (!files)
-		goto end;
-
 	medium = brasero_drive_get_medium (drive);
 	brasero_medium_get_data_size (medium, NULL, &volume_size);
 	if (volume_size == -1) {
@@ -363,6 +652,29 @@ brasero_dvdcss_write_image_thread (gpointer data)
 		goto end;
 	}
 
+	vol = brasero_volume_source_open_file (brasero_drive_get_device (drive), &priv->error);
+	if (!vol)
+		goto end;
+
+	/* See if this disc was already copied in which case there is no need
+	 * to look through its files again */
+	map = g_queue_new ();
+	cache_path = brasero_dvdcss_cache_get_path (self, vol, volume_size);
+	if (!cache_path
+	||  !brasero_dvdcss_cache_load (self, cache_path, volume_size, map)) {
+		files = brasero_volume_get_files (vol,
+						  0,
+						  NULL,
+						  NULL,
+						  NULL,
+						  &priv->error);
+		if (!files) {
+			brasero_volume_source_close (vol);
+			goto end;
+		}
+	}
+	brasero_volume_source_close (vol);
+
 	/* create a handle/open DVD */
 	handle = dvdcss_open (brasero_drive_get_device (drive));
 	if (!handle) {
@@ -372,18 +684,24 @@ brasero_dvdcss_write_image_thread (gpointer data)
 		goto end;
 	}
 
-	/* look through the files to get the ranges of encrypted sectors
-	 * and cache the CSS keys while at it. */
-	map = g_queue_new ();
-	if (!brasero_dvdcss_create_scrambled_sectors_map (self, drive, map, handle, files, &priv->error))
-		goto end;
+	if (files) {
+		/* look through the files to get the ranges of encrypted sectors
+		 * and cache the CSS keys while at it. */
+		if (!brasero_dvdcss_create_scrambled_sectors_map (self, drive, map, handle, files, &priv->error))
+			goto end;
 
-	BRASERO_JOB_LOG (self, "DVD map created (keys retrieved)");
+		BRASERO_JOB_LOG (self, "DVD map created (keys retrieved)");
 
-	g_queue_sort (map, brasero_dvdcss_sort_ranges, NULL);
+		g_queue_sort (map, brasero_dvdcss_sort_ranges, NULL);
 
-	brasero_volume_file_free (files);
-	files = NULL;
+		brasero_volume_file_free (files);
+		files = NULL;
+
+		if (cache_path)
+			brasero_dvdcss_cache_save (self, cache_path, volume_size, map);
+	}
+	else
+		BRASERO_JOB_LOG (self, "DVD map loaded from cache (keys retrieved while copying)");
 
 	if (dvdcss_seek (handle, 0, DVDCSS_NOFLAGS) < 0) {
 		BRASERO_JOB_LOG (self, "Error initial seeking");
@@ -408,8 +726,8 @@ brasero_dvdcss_write_image_thread (gpointer data)
 		gchar *output = NULL;
 
 		brasero_job_get_image_output (BRASERO_JOB (self), &output, NULL);
-		output_fd = fopen (output, "w");
-		if (!output_fd) {
+		priv->output_fd = fopen (output, "w");
+		if (!priv->output_fd) {
 			priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
 							   BRASERO_BURN_ERROR_GENERAL,
 							   g_strerror (errno));
@@ -419,11 +737,34 @@ brasero_dvdcss_write_image_thread (gpointer data)
 		g_free (output);
 	}
 
+	/* Reading (and decrypting since libdvdcss does both at once) happens in
+	 * this thread while another one writes. They exchange a ring of buffers
+	 * so that the drive keeps reading while the output is being written. */
+	memset (&priv->reader, 0, sizeof (BraseroDvdcssStage));
+	memset (&priv->writer, 0, sizeof (BraseroDvdcssStage));
+
+	priv->free_buffers = g_async_queue_new ();
+	priv->full_buffers = g_async_queue_new ();
+	for (i = 0; i < BRASERO_DVDCSS_BUFFERS; i ++) {
+		buffer = g_new0 (BraseroDvdcssBuffer, 1);
+		buffer->data = g_malloc (DVDCSS_BLOCK_SIZE * BRASERO_DVDCSS_I_BLOCKS);
+		g_async_queue_push (priv->free_buffers, buffer);
+	}
+
+	writer = g_thread_create (brasero_dvdcss_write_thread,
+				  self,
+				  TRUE,
+				  &priv->error);
+	if (!writer)
+		goto end;
+
 	while (remaining_sectors) {
 		gint flag;
-		guint64 num_blocks, data_size;
+		gint read_blocks;
+		guint64 num_blocks;
+		gint64 start;
 
-		if (priv->cancel)
+		if (priv->cancel || priv->write_error)
 			break;
 
 		num_blocks = BRASERO_DVDCSS_I_BLOCKS;
@@ -472,8 +813,18 @@ brasero_dvdcss_write_image_thread (gpointer data)
 			}
 		}
 
-		num_blocks = dvdcss_read (handle, buf, num_blocks, flag);
-		if (num_blocks < 0) {
+		/* Wait for the writing thread to give back a buffer */
+		start = g_get_monotonic_time ();
+		buffer = g_async_queue_pop (priv->free_buffers);
+		priv->reader.wait += g_get_monotonic_time () - start;
+
+		start = g_get_monotonic_time ();
+		read_blocks = dvdcss_read (handle, buffer->data, num_blocks, flag);
+		priv->reader.busy += g_get_monotonic_time () - start;
+
+		if (read_blocks <= 0) {
+			g_async_queue_push (priv->free_buffers, buffer);
+
 			BRASERO_JOB_LOG (self, "Error reading");
 			priv->error = g_error_new (BRASERO_BURN_ERROR,
 						   BRASERO_BURN_ERROR_GENERAL,
@@ -482,34 +833,51 @@ brasero_dvdcss_write_image_thread (gpointer data)
 			break;
 		}
 
-		data_size = num_blocks * DVDCSS_BLOCK_SIZE;
-		if (output_fd) {
-			if (fwrite (buf, 1, data_size, output_fd) != data_size) {
-                                int errsv = errno;
+		buffer->sectors = read_blocks;
+		g_async_queue_push (priv->full_buffers, buffer);
 
-				priv->error = g_error_new (BRASERO_BURN_ERROR,
-							   BRASERO_BURN_ERROR_GENERAL,
-							   _("Data could not be written (%s)"),
-							   g_strerror (errsv));
-				break;
-			}
-		}
-		else {
-			BraseroBurnResult result;
+		priv->reader.bytes += read_blocks * DVDCSS_BLOCK_SIZE;
+		written_sectors += read_blocks;
+		remaining_sectors -= read_blocks;
+	}
 
-			result = brasero_dvdcss_write_sector_to_fd (self,
-								    buf,
-								    data_size);
-			if (result != BRASERO_BURN_OK)
-				break;
+end:
+
+	if (writer) {
+		/* Tell the writing thread there is nothing left and wait for it
+		 * to have written everything */
+		buffer = g_async_queue_pop (priv->free_buffers);
+		buffer->sectors = 0;
+		g_async_queue_push (priv->full_buffers, buffer);
+		g_thread_join (writer);
+
+		brasero_dvdcss_log_stage (self, "Reading", &priv->reader, "the writer");
+		brasero_dvdcss_log_stage (self, "Writing", &priv->writer, "the reader");
+	}
+
+	if (priv->write_error) {
+		if (!priv->error)
+			priv->error = priv->write_error;
+		else
+			g_error_free (priv->write_error);
+
+		priv->write_error = NULL;
+	}
+
+	if (priv->free_buffers) {
+		while ((buffer = g_async_queue_try_pop (priv->free_buffers))) {
+			g_free (buffer->data);
+			g_free (buffer);
 		}
 
-		written_sectors += num_blocks;
-		remaining_sectors -= num_blocks;
-		brasero_job_set_written_track (BRASERO_JOB (self), written_sectors * DVDCSS_BLOCK_SIZE);
+		g_async_queue_unref (priv->free_buffers);
+		priv->free_buffers = NULL;
 	}
 
-end:
+	if (priv->full_buffers) {
+		g_async_queue_unref (priv->full_buffers);
+		priv->full_buffers = NULL;
+	}
 
 	if (range)
 		g_free (range);
@@ -520,14 +888,19 @@ end:
 	if (files)
 		brasero_volume_file_free (files);
 
-	if (output_fd)
-		fclose (output_fd);
+	if (priv->output_fd) {
+		fclose (priv->output_fd);
+		priv->output_fd = NULL;
+	}
 
 	if (map) {
 		g_queue_foreach (map, (GFunc) g_free, NULL);
 		g_queue_free (map);
 	}
 
+	if (cache_path)
+		g_free (cache_path);
+
 	if (!priv->cancel)
 		priv->thread_id = g_idle_add (brasero_dvdcss_thread_finished, self);
 
@@ -709,6 +1082,8 @@ brasero_dvdcss_export_caps (BraseroPlugin *plugin)
 
 	g_slist_free (input);
 	g_slist_free (output);
+
+	brasero_dvdcss_set_key_cache ();
 }
 
 G_MODULE_EXPORT void
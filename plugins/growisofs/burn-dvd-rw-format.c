@@ -190,6 +190,7 @@ brasero_dvd_rw_format_export_caps (BraseroPlugin *plugin)
 			       _("Blanks and formats rewritable DVDs and BDs"),
 			       "Philippe Rouquier",
 			       4);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	output = brasero_caps_disc_new (media|
 					BRASERO_MEDIUM_BDRE|
@@ -753,6 +753,7 @@ brasero_growisofs_export_caps (BraseroPlugin *plugin)
 			       _("Burns and blanks DVDs and BDs"),
 			       "Philippe Rouquier",
 			       7);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* growisofs can write images to any type of BD/DVD-R as long as it's blank */
 	input = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_PIPE|
@@ -399,6 +399,12 @@ brasero_libburn_common_status (BraseroJob *self,
 
 		cur_sector = progress.sector + ctx->sectors;
 
+		/* buffer_available is the free space in the drive buffer */
+		if (progress.buffer_capacity > 0)
+			brasero_job_set_buffer_fill (self,
+						     (progress.buffer_capacity - progress.buffer_available) * 100 /
+						     progress.buffer_capacity);
+
 		/* With some media libburn writes only 16 blocks then wait
 		 * which disrupt the whole process of time reporting */
 		if (cur_sector > 32) {
@@ -65,6 +65,10 @@
 
 BRASERO_PLUGIN_BOILERPLATE (BraseroLocalTrack, brasero_local_track, BRASERO_TYPE_JOB, BraseroJob);
 
+#define BRASERO_SCHEMA_CONFIG			"org.gnome.brasero.config"
+#define BRASERO_KEY_DOWNLOAD_JOBS		"download-jobs"
+#define BRASERO_KEY_DOWNLOAD_STREAM		"download-stream"
+
 struct _BraseroLocalTrackPrivate {
 	GCancellable *cancel;
 	BraseroXferCtx *xfer_ctx;
@@ -76,6 +80,11 @@ struct _BraseroLocalTrackPrivate {
 
 	GHashTable *nonlocals;
 
+	/* URIs that are read in place through their local path */
+	GHashTable *streamed;
+
+	guint max_jobs;
+
 	guint thread_id;
 	GThread *thread;
 	GMutex *mutex;
@@ -87,6 +96,7 @@ struct _BraseroLocalTrackPrivate {
 	GError *error;
 
 	guint download_checksum:1;
+	guint stream:1;
 };
 typedef struct _BraseroLocalTrackPrivate BraseroLocalTrackPrivate;
 
@@ -527,31 +537,22 @@ brasero_local_track_thread (gpointer data)
 					_("Copying files locally"),
 					TRUE);
 
+	/* All files are queued and then copied max_jobs at a time */
 	for (src = priv->src_list, dest = priv->dest_list;
 	     src && dest;
 	     src = src->next, dest = dest->next) {
 		gchar *name;
-		GFile *src_file;
-		GFile *dest_file;
-		BraseroBurnResult result;
 
-		src_file = src->data;
-		dest_file = dest->data;
-
-		name = g_file_get_basename (src_file);
+		name = g_file_get_basename (src->data);
 		BRASERO_JOB_LOG (self, "Downloading %s", name);
 		g_free (name);
 
-		result = brasero_xfer_start (priv->xfer_ctx,
-					     src_file,
-					     dest_file,
-					     priv->cancel,
-					     &priv->error);
-
-		if (g_cancellable_is_cancelled (priv->cancel))
-			goto end;
+		brasero_xfer_add (priv->xfer_ctx, src->data, dest->data);
+	}
 
-		if (result != BRASERO_BURN_OK)
+	if (priv->src_list) {
+		brasero_xfer_set_max_jobs (priv->xfer_ctx, priv->max_jobs);
+		if (!brasero_xfer_run (priv->xfer_ctx, priv->cancel, &priv->error))
 			goto end;
 	}
 
@@ -641,6 +642,10 @@ _foreach_non_local_cb (const gchar *uri,
 	}
 	g_free (parent);
 
+	/* It will be read in place */
+	if (priv->streamed && g_hash_table_lookup (priv->streamed, uri))
+		return FALSE;
+
 	file = g_file_new_for_uri (uri);
 	priv->src_list = g_slist_append (priv->src_list, file);
 
@@ -676,6 +681,36 @@ brasero_local_track_add_if_non_local (BraseroLocalTrack *self,
 							 NULL,
 							 g_free);
 
+	/* When the remote location has a local path (through the FUSE
+	 * daemon of GVfs) the imager can read it directly instead of
+	 * waiting for a temporary copy. */
+	if (priv->stream && !g_hash_table_lookup (priv->nonlocals, uri)) {
+		GFile *file;
+		gchar *path;
+
+		file = g_file_new_for_uri (uri);
+		path = g_file_get_path (file);
+		g_object_unref (file);
+
+		if (path) {
+			localuri = g_filename_to_uri (path, NULL, NULL);
+			g_free (path);
+		}
+
+		if (localuri) {
+			if (!priv->streamed)
+				priv->streamed = g_hash_table_new_full (g_str_hash,
+									g_str_equal,
+									g_free,
+									NULL);
+
+			BRASERO_JOB_LOG (self, "%s will be read from %s", uri, localuri);
+			g_hash_table_insert (priv->streamed, g_strdup (uri), GINT_TO_POINTER (1));
+			g_hash_table_insert (priv->nonlocals, g_strdup (uri), localuri);
+			return BRASERO_BURN_OK;
+		}
+	}
+
 	/* generate a unique name */
 	result = brasero_job_get_tmp_file (BRASERO_JOB (self),
 					   NULL,
@@ -840,6 +875,11 @@ brasero_local_track_stop (BraseroJob *job,
 		priv->nonlocals = NULL;
 	}
 
+	if (priv->streamed) {
+		g_hash_table_destroy (priv->streamed);
+		priv->streamed = NULL;
+	}
+
 	if (priv->checksum_path) {
 		g_free (priv->checksum_path);
 		priv->checksum_path = NULL;
@@ -891,14 +931,22 @@ static void
 brasero_local_track_init (BraseroLocalTrack *obj)
 {
 	BraseroLocalTrackPrivate *priv = BRASERO_LOCAL_TRACK_PRIVATE (obj);
+	GSettings *settings;
 
 	priv->mutex = g_mutex_new ();
 	priv->cond = g_cond_new ();
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	priv->max_jobs = MAX (g_settings_get_int (settings, BRASERO_KEY_DOWNLOAD_JOBS), 1);
+	priv->stream = g_settings_get_boolean (settings, BRASERO_KEY_DOWNLOAD_STREAM);
+	g_object_unref (settings);
 }
 
 static void
 brasero_local_track_export_caps (BraseroPlugin *plugin)
 {
+	BraseroPluginConfOption *stream;
+	BraseroPluginConfOption *jobs;
 	GSList *caps;
 
 	brasero_plugin_define (plugin,
@@ -949,4 +997,16 @@ brasero_local_track_export_caps (BraseroPlugin *plugin)
 	brasero_plugin_set_process_flags (plugin, BRASERO_PLUGIN_RUN_PREPROCESSING);
 
 	brasero_plugin_set_compulsory (plugin, FALSE);
+
+	/* add some configure options */
+	jobs = brasero_plugin_conf_option_new (BRASERO_KEY_DOWNLOAD_JOBS,
+					       _("Number of files downloaded at the same time:"),
+					       BRASERO_PLUGIN_OPTION_INT);
+	brasero_plugin_conf_option_int_set_range (jobs, 1, 16);
+	brasero_plugin_add_conf_option (plugin, jobs);
+
+	stream = brasero_plugin_conf_option_new (BRASERO_KEY_DOWNLOAD_STREAM,
+						 _("Read remote files in place when they are mounted locally"),
+						 BRASERO_PLUGIN_OPTION_BOOL);
+	brasero_plugin_add_conf_option (plugin, stream);
 }
@@ -0,0 +1,1095 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+/* Copies data discs to a BIN image without any external program. Sectors are
+ * read through libbrasero-media (READ CD or READ10 depending on what the drive
+ * supports) in large transfers by one thread while another writes them to the
+ * image or to the pipe of the next job. When reading fails, the transfer size
+ * is reduced to single out the damaged sectors and the drive is slowed down
+ * before retrying them. Optionally, sectors that still can't be read are zero
+ * filled and the following ones are skipped exponentially so that a damaged
+ * area doesn't take ages to get through. In rescue mode (file output only)
+ * the reading is left to BraseroVolRescue which makes several passes. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <poll.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+#include <gio/gio.h>
+
+#include "brasero-units.h"
+
+#include "burn-job.h"
+#include "brasero-plugin-registration.h"
+#include "brasero-medium.h"
+#include "brasero-drive.h"
+#include "brasero-track-image.h"
+#include "brasero-track-disc.h"
+#include "brasero-tags.h"
+
+#include "scsi-device.h"
+#include "scsi-mmc2.h"
+#include "burn-volume-source.h"
+#include "burn-volume-rescue.h"
+
+
+#define BRASERO_TYPE_SCSI_COPY         (brasero_scsi_copy_get_type ())
+#define BRASERO_SCSI_COPY(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), BRASERO_TYPE_SCSI_COPY, BraseroScsiCopy))
+#define BRASERO_SCSI_COPY_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), BRASERO_TYPE_SCSI_COPY, BraseroScsiCopyClass))
+#define BRASERO_IS_SCSI_COPY(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), BRASERO_TYPE_SCSI_COPY))
+#define BRASERO_IS_SCSI_COPY_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), BRASERO_TYPE_SCSI_COPY))
+#define BRASERO_SCSI_COPY_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), BRASERO_TYPE_SCSI_COPY, BraseroScsiCopyClass))
+
+BRASERO_PLUGIN_BOILERPLATE (BraseroScsiCopy, brasero_scsi_copy, BRASERO_TYPE_JOB, BraseroJob);
+
+#define BRASERO_SCHEMA_CONFIG			"org.gnome.brasero.config"
+#define BRASERO_KEY_SCSI_COPY_SKIP_ERRORS	"scsi-copy-skip-errors"
+#define BRASERO_KEY_SCSI_COPY_RESCUE		"scsi-copy-rescue"
+
+/* Statistics for each stage of the copy (times are in microseconds) */
+struct _BraseroScsiCopyStage {
+	guint64 bytes;
+	gint64 busy;
+	gint64 wait;
+};
+typedef struct _BraseroScsiCopyStage BraseroScsiCopyStage;
+
+/* A buffer of the ring shared by the reading and the writing threads. A
+ * buffer with no sectors marks the end of the stream. */
+struct _BraseroScsiCopyBuffer {
+	guchar *data;
+	gint sectors;
+};
+typedef struct _BraseroScsiCopyBuffer BraseroScsiCopyBuffer;
+
+struct _BraseroScsiCopyPrivate {
+	GError *error;
+	GThread *thread;
+	GMutex *mutex;
+	GCond *cond;
+	guint thread_id;
+
+	/* Used by the writing thread */
+	GAsyncQueue *free_buffers;
+	GAsyncQueue *full_buffers;
+	FILE *output_fd;
+	GError *write_error;
+
+	BraseroScsiCopyStage reader;
+	BraseroScsiCopyStage writer;
+
+	/* Read strategy (only used by the reading thread) */
+	BraseroDeviceHandle *handle;
+	BraseroVolSrc *vol;
+
+	guint transfer;		/* sectors per command */
+	guint skip;		/* sectors given up on after the next error */
+	guint64 clean;		/* sectors read since the last error */
+	guint64 bad;		/* sectors zero filled */
+
+	gint speed;		/* kB/s, 0 when the drive chooses */
+	gint min_speed;		/* 1x for the medium in kB/s */
+
+	GCancellable *cancellable;
+
+	guint skip_errors:1;
+	guint rescue:1;
+	guint no_speed:1;
+	guint cancel:1;
+};
+typedef struct _BraseroScsiCopyPrivate BraseroScsiCopyPrivate;
+
+#define BRASERO_SCSI_COPY_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_SCSI_COPY, BraseroScsiCopyPrivate))
+
+#define BRASERO_SCSI_COPY_BLOCK_SIZE	2048
+
+/* Each buffer is 512 KiB (read with one command unless there are errors) and
+ * there are 8 of them in flight (4 MiB) */
+#define BRASERO_SCSI_COPY_BLOCKS	256
+#define BRASERO_SCSI_COPY_BUFFERS	8
+
+/* Number of times an unreadable sector is read again (each time slower) */
+#define BRASERO_SCSI_COPY_RETRIES	2
+
+/* Maximum number of sectors skipped at once in a damaged area */
+#define BRASERO_SCSI_COPY_MAX_SKIP	4096
+
+/* The drive gets its full speed back after 32 MiB were read without error */
+#define BRASERO_SCSI_COPY_RECOVER	16384
+
+static GObjectClass *parent_class = NULL;
+
+static BraseroBurnResult
+brasero_scsi_copy_get_range (BraseroScsiCopy *self,
+			     goffset *start_sector,
+			     goffset *num_sectors)
+{
+	goffset start = 0;
+	goffset blocks = 0;
+	GValue *value = NULL;
+	BraseroTrack *track = NULL;
+	BraseroDrive *drive;
+	BraseroMedium *medium;
+
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	drive = brasero_track_disc_get_drive (BRASERO_TRACK_DISC (track));
+	medium = brasero_drive_get_medium (drive);
+
+	brasero_track_tag_lookup (track,
+				  BRASERO_TRACK_MEDIUM_ADDRESS_START_TAG,
+				  &value);
+	if (value) {
+		guint64 end;
+
+		/* we were given an address to start */
+		start = g_value_get_uint64 (value);
+
+		/* get the length now */
+		value = NULL;
+		brasero_track_tag_lookup (track,
+					  BRASERO_TRACK_MEDIUM_ADDRESS_END_TAG,
+					  &value);
+
+		end = g_value_get_uint64 (value);
+		blocks = end - start;
+	}
+	/* 0 means all disc, -1 problem */
+	else if (brasero_track_disc_get_track_num (BRASERO_TRACK_DISC (track)) > 0) {
+		brasero_medium_get_track_space (medium,
+						brasero_track_disc_get_track_num (BRASERO_TRACK_DISC (track)),
+						NULL,
+						&blocks);
+		brasero_medium_get_track_address (medium,
+						  brasero_track_disc_get_track_num (BRASERO_TRACK_DISC (track)),
+						  NULL,
+						  &start);
+	}
+	else {
+		/* BIN images only hold the last data track */
+		brasero_medium_get_last_data_track_space (medium,
+							  NULL,
+							  &blocks);
+		brasero_medium_get_last_data_track_address (medium,
+							    NULL,
+							    &start);
+	}
+
+	if (blocks <= 0 || start < 0)
+		return BRASERO_BURN_ERR;
+
+	if (start_sector)
+		*start_sector = start;
+
+	if (num_sectors)
+		*num_sectors = blocks;
+
+	return BRASERO_BURN_OK;
+}
+
+static gboolean
+brasero_scsi_copy_thread_finished (gpointer data)
+{
+	goffset blocks = 0;
+	gchar *image = NULL;
+	BraseroScsiCopy *self = data;
+	BraseroScsiCopyPrivate *priv;
+	BraseroTrackImage *track = NULL;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+	priv->thread_id = 0;
+
+	if (priv->error) {
+		GError *error;
+
+		error = priv->error;
+		priv->error = NULL;
+		brasero_job_error (BRASERO_JOB (self), error);
+		return FALSE;
+	}
+
+	track = brasero_track_image_new ();
+	brasero_job_get_image_output (BRASERO_JOB (self),
+				      &image,
+				      NULL);
+	brasero_track_image_set_source (track,
+					image,
+					NULL,
+					BRASERO_IMAGE_FORMAT_BIN);
+	g_free (image);
+
+	brasero_job_get_session_output_size (BRASERO_JOB (self), &blocks, NULL);
+	brasero_track_image_set_block_num (track, blocks);
+
+	brasero_job_add_track (BRASERO_JOB (self), BRASERO_TRACK (track));
+	g_object_unref (track);
+
+	brasero_job_finished_track (BRASERO_JOB (self));
+
+	return FALSE;
+}
+
+static BraseroBurnResult
+brasero_scsi_copy_write_to_fd (BraseroScsiCopy *self,
+			       gpointer buffer,
+			       gint bytes_remaining,
+			       GError **error)
+{
+	int fd;
+	gint bytes_written = 0;
+	BraseroScsiCopyPrivate *priv;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	brasero_job_get_fd_out (BRASERO_JOB (self), &fd);
+	while (bytes_remaining) {
+		struct pollfd fds;
+		gint written;
+
+		written = write (fd,
+				 ((gchar *) buffer)  + bytes_written,
+				 bytes_remaining);
+
+		if (priv->cancel)
+			return BRASERO_BURN_CANCEL;
+
+		if (written > 0) {
+			bytes_remaining -= written;
+			bytes_written += written;
+			continue;
+		}
+
+		if (errno != EINTR && errno != EAGAIN) {
+			int errsv = errno;
+
+			/* unrecoverable error */
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			return BRASERO_BURN_ERR;
+		}
+
+		/* Wait for the pipe to be writable again; the timeout is only
+		 * there to check for cancellation */
+		fds.fd = fd;
+		fds.events = POLLOUT;
+		fds.revents = 0;
+		poll (&fds, 1, 100);
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_scsi_copy_log_stage (BraseroScsiCopy *self,
+			     const gchar *name,
+			     BraseroScsiCopyStage *stage,
+			     const gchar *wait)
+{
+	gdouble rate = 0.0;
+
+	if (stage->busy > 0)
+		rate = (gdouble) stage->bytes / (gdouble) stage->busy * 1000000.0 / 1048576.0;
+
+	BRASERO_JOB_LOG (self,
+			 "%s: %" G_GUINT64_FORMAT " bytes in %.2fs (%.2f MiB/s), %.2fs waiting for %s",
+			 name,
+			 stage->bytes,
+			 (gdouble) stage->busy / 1000000.0,
+			 rate,
+			 (gdouble) stage->wait / 1000000.0,
+			 wait);
+}
+
+static gpointer
+brasero_scsi_copy_write_thread (gpointer data)
+{
+	BraseroScsiCopy *self = data;
+	BraseroScsiCopyPrivate *priv;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	while (1) {
+		BraseroScsiCopyBuffer *buffer;
+		BraseroBurnResult result;
+		gint64 data_size;
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		buffer = g_async_queue_pop (priv->full_buffers);
+		priv->writer.wait += g_get_monotonic_time () - start;
+
+		if (!buffer->sectors) {
+			g_async_queue_push (priv->free_buffers, buffer);
+			break;
+		}
+
+		/* After an error or a cancellation, buffers are just handed
+		 * back to the reading thread until it stops */
+		if (priv->cancel || priv->write_error) {
+			g_async_queue_push (priv->free_buffers, buffer);
+			continue;
+		}
+
+		start = g_get_monotonic_time ();
+		data_size = buffer->sectors * BRASERO_SCSI_COPY_BLOCK_SIZE;
+		if (priv->output_fd) {
+			if (fwrite (buffer->data, 1, data_size, priv->output_fd) != data_size) {
+				int errsv = errno;
+
+				priv->write_error = g_error_new (BRASERO_BURN_ERROR,
+								 BRASERO_BURN_ERROR_GENERAL,
+								 _("Data could not be written (%s)"),
+								 g_strerror (errsv));
+			}
+		}
+		else {
+			result = brasero_scsi_copy_write_to_fd (self,
+								buffer->data,
+								data_size,
+								&priv->write_error);
+			if (result == BRASERO_BURN_CANCEL)
+				priv->cancel = 1;
+		}
+		priv->writer.busy += g_get_monotonic_time () - start;
+
+		g_async_queue_push (priv->free_buffers, buffer);
+
+		if (priv->write_error || priv->cancel)
+			continue;
+
+		priv->writer.bytes += data_size;
+		brasero_job_set_written_track (BRASERO_JOB (self), priv->writer.bytes);
+	}
+
+	return NULL;
+}
+
+static void
+brasero_scsi_copy_set_speed (BraseroScsiCopy *self,
+			     gint speed)
+{
+	BraseroScsiCopyPrivate *priv;
+	BraseroScsiResult result;
+	BraseroScsiErrCode code;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+	if (priv->no_speed || priv->speed == speed)
+		return;
+
+	result = brasero_mmc2_set_cd_speed (priv->handle,
+					    speed ? speed : BRASERO_SCSI_SPEED_MAX,
+					    BRASERO_SCSI_SPEED_MAX,
+					    &code);
+	if (result != BRASERO_SCSI_OK) {
+		/* Don't try again */
+		BRASERO_JOB_LOG (self, "Speed could not be set (%s)", brasero_scsi_strerror (code));
+		priv->no_speed = 1;
+		return;
+	}
+
+	BRASERO_JOB_LOG (self, "Reading speed set to %i kB/s", speed);
+	priv->speed = speed;
+}
+
+static void
+brasero_scsi_copy_slow_down (BraseroScsiCopy *self)
+{
+	BraseroScsiCopyPrivate *priv;
+	gint speed;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	/* When the drive is still at full speed, start from the measured
+	 * throughput since we don't know which speed it chose */
+	if (priv->speed)
+		speed = priv->speed / 2;
+	else if (priv->reader.busy > 0)
+		speed = priv->reader.bytes * 1000 / priv->reader.busy / 2;
+	else
+		speed = priv->min_speed * 4;
+
+	brasero_scsi_copy_set_speed (self, MAX (speed, priv->min_speed));
+}
+
+static void
+brasero_scsi_copy_read_ok (BraseroScsiCopy *self,
+			   guint sectors)
+{
+	BraseroScsiCopyPrivate *priv;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	priv->skip = 1;
+	priv->clean += sectors;
+
+	/* Once past a damaged area go back to large transfers and full speed
+	 * progressively */
+	if (priv->transfer < BRASERO_SCSI_COPY_BLOCKS
+	&&  priv->clean >= priv->transfer * 4)
+		priv->transfer = MIN (priv->transfer * 2, BRASERO_SCSI_COPY_BLOCKS);
+
+	if (priv->speed && priv->clean >= BRASERO_SCSI_COPY_RECOVER)
+		brasero_scsi_copy_set_speed (self, 0);
+}
+
+static BraseroBurnResult
+brasero_scsi_copy_fill (BraseroScsiCopy *self,
+			guchar *data,
+			goffset position,
+			guint num)
+{
+	BraseroScsiCopyPrivate *priv;
+	guint retries = 0;
+	guint done = 0;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	while (done < num) {
+		GError *error = NULL;
+		gint64 start;
+		gboolean res;
+		guint count;
+
+		if (priv->cancel)
+			return BRASERO_BURN_CANCEL;
+
+		count = MIN (priv->transfer, num - done);
+
+		start = g_get_monotonic_time ();
+		BRASERO_VOL_SRC_SEEK (priv->vol, position + done, SEEK_SET, NULL);
+		res = BRASERO_VOL_SRC_READ (priv->vol,
+					    (gchar *) data + done * BRASERO_SCSI_COPY_BLOCK_SIZE,
+					    count,
+					    &error);
+		priv->reader.busy += g_get_monotonic_time () - start;
+
+		if (res) {
+			priv->reader.bytes += count * BRASERO_SCSI_COPY_BLOCK_SIZE;
+			brasero_scsi_copy_read_ok (self, count);
+
+			done += count;
+			retries = 0;
+			continue;
+		}
+
+		BRASERO_JOB_LOG (self,
+				 "Read error at sector %" G_GINT64_FORMAT " (%u sectors): %s",
+				 position + done,
+				 count,
+				 error ? error->message : "unknown error");
+		priv->clean = 0;
+
+		/* Narrow down on the damaged sectors */
+		if (count > 1) {
+			priv->transfer = count / 2;
+			g_clear_error (&error);
+			continue;
+		}
+
+		/* Only retry at the beginning of a damaged area; once inside
+		 * of it, retries would only waste time */
+		if (priv->skip == 1 && retries < BRASERO_SCSI_COPY_RETRIES) {
+			brasero_scsi_copy_slow_down (self);
+			g_clear_error (&error);
+			retries ++;
+			continue;
+		}
+
+		if (!priv->skip_errors) {
+			priv->error = g_error_new (BRASERO_BURN_ERROR,
+						   BRASERO_BURN_ERROR_GENERAL,
+						   _("The disc could not be read at sector %lli (%s)"),
+						   (long long) (position + done),
+						   error ? error->message : _("An internal error occurred"));
+			g_clear_error (&error);
+			return BRASERO_BURN_ERR;
+		}
+		g_clear_error (&error);
+
+		/* Give up on this sector and skip the following ones since a
+		 * damaged area is rarely limited to one sector. The number of
+		 * skipped sectors doubles as long as reading fails. */
+		count = MIN (priv->skip, num - done);
+		memset (data + done * BRASERO_SCSI_COPY_BLOCK_SIZE,
+			0,
+			count * BRASERO_SCSI_COPY_BLOCK_SIZE);
+
+		BRASERO_JOB_LOG (self,
+				 "Skipping %u sectors from %" G_GINT64_FORMAT,
+				 count,
+				 position + done);
+
+		priv->bad += count;
+		priv->skip = MIN (priv->skip * 2, BRASERO_SCSI_COPY_MAX_SKIP);
+		done += count;
+		retries = 0;
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_scsi_copy_rescue_progress (BraseroVolRescue *rescue,
+				   guint64 good,
+				   guint64 bad,
+				   gpointer user_data)
+{
+	brasero_job_set_written_track (BRASERO_JOB (user_data), good * BRASERO_SCSI_COPY_BLOCK_SIZE);
+}
+
+/**
+ * In rescue mode the image is written in place over several passes and a map
+ * of the sectors already read is kept next to it. If the copy is interrupted
+ * or if some sectors could not be read, the map is kept so that copying the
+ * same disc to the same image again resumes (and only retries bad sectors).
+ * The map records which disc it was made for so another disc of the same
+ * size never resumes over an image it doesn't belong to.
+ * That's only possible when the user chose the path of the image; temporary
+ * images (disc to disc copies) can't be resumed so they get no map.
+ */
+
+static void
+brasero_scsi_copy_rescue (BraseroScsiCopy *self,
+			  goffset start,
+			  goffset blocks)
+{
+	BraseroScsiCopyPrivate *priv;
+	BraseroVolRescue *rescue;
+	gchar *output = NULL;
+	gboolean resume;
+	gchar *map_path = NULL;
+	guint64 bad = 0;
+	struct stat info;
+	int fd;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	brasero_job_get_image_output (BRASERO_JOB (self), &output, NULL);
+	if (!brasero_job_is_output_tmp (BRASERO_JOB (self)))
+		map_path = g_strconcat (output, ".rescue-map", NULL);
+
+	rescue = brasero_volume_rescue_new (priv->vol, priv->handle, start, blocks);
+	brasero_volume_rescue_set_slow_speed (rescue, priv->min_speed * 2);
+
+	/* Only resume if the image is still there */
+	resume = (map_path
+	       &&  !g_stat (output, &info)
+	       &&  info.st_size == (goffset) blocks * BRASERO_SCSI_COPY_BLOCK_SIZE
+	       &&  brasero_volume_rescue_load_map (rescue, map_path));
+	if (!resume) {
+		brasero_volume_rescue_free (rescue);
+		rescue = brasero_volume_rescue_new (priv->vol, priv->handle, start, blocks);
+		brasero_volume_rescue_set_slow_speed (rescue, priv->min_speed * 2);
+	}
+	else
+		BRASERO_JOB_LOG (self, "Resuming rescue from %s", map_path);
+
+	fd = open (output, O_WRONLY|O_CREAT|(resume ? 0 : O_TRUNC), 0644);
+	if (fd == -1) {
+		priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+						   BRASERO_BURN_ERROR_GENERAL,
+						   g_strerror (errno));
+		goto end;
+	}
+
+	brasero_job_set_current_action (BRASERO_JOB (self),
+					BRASERO_BURN_ACTION_DRIVE_COPY,
+					NULL,
+					FALSE);
+	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
+
+	if (!brasero_volume_rescue_run (rescue,
+					fd,
+					map_path,
+					priv->cancellable,
+					brasero_scsi_copy_rescue_progress,
+					self,
+					&priv->error)) {
+		close (fd);
+		goto end;
+	}
+
+	if (close (fd)) {
+		int errsv = errno;
+
+		priv->error = g_error_new (BRASERO_BURN_ERROR,
+					   BRASERO_BURN_ERROR_GENERAL,
+					   _("Data could not be written (%s)"),
+					   g_strerror (errsv));
+		goto end;
+	}
+
+	if (g_cancellable_is_cancelled (priv->cancellable))
+		goto end;
+
+	brasero_volume_rescue_get_status (rescue, NULL, &bad);
+	if (!bad) {
+		if (map_path)
+			g_remove (map_path);
+	}
+	else if (map_path)
+		BRASERO_JOB_LOG (self,
+				 "%" G_GUINT64_FORMAT " unreadable sectors were zero filled (map kept in %s)",
+				 bad,
+				 map_path);
+	else
+		BRASERO_JOB_LOG (self,
+				 "%" G_GUINT64_FORMAT " unreadable sectors were zero filled",
+				 bad);
+
+end:
+	brasero_volume_rescue_free (rescue);
+	g_free (map_path);
+	g_free (output);
+}
+
+static gpointer
+brasero_scsi_copy_read_thread (gpointer data)
+{
+	BraseroScsiCopyBuffer *buffer;
+	BraseroScsiCopy *self = data;
+	BraseroScsiCopyPrivate *priv;
+	BraseroTrack *track = NULL;
+	BraseroScsiErrCode code = 0;
+	BraseroMedium *medium;
+	BraseroDrive *drive;
+	BraseroMedia media;
+	GThread *writer = NULL;
+	goffset position = 0;
+	goffset end = 0;
+	goffset blocks;
+	gint i;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	drive = brasero_track_disc_get_drive (BRASERO_TRACK_DISC (track));
+	medium = brasero_drive_get_medium (drive);
+	media = brasero_medium_get_status (medium);
+
+	if (brasero_scsi_copy_get_range (self, &position, &blocks) != BRASERO_BURN_OK) {
+		priv->error = g_error_new (BRASERO_BURN_ERROR,
+					   BRASERO_BURN_ERROR_GENERAL,
+					   _("The size of the volume could not be retrieved"));
+		goto end;
+	}
+	end = position + blocks;
+
+	BRASERO_JOB_LOG (self,
+			 "Reading from sector %" G_GINT64_FORMAT " to %" G_GINT64_FORMAT,
+			 position,
+			 end);
+
+	priv->handle = brasero_device_handle_open (brasero_drive_get_device (drive), FALSE, &code);
+	if (!priv->handle) {
+		priv->error = g_error_new (BRASERO_BURN_ERROR,
+					   BRASERO_BURN_ERROR_DRIVE_BUSY,
+					   _("The drive is busy"));
+		goto end;
+	}
+
+	priv->vol = brasero_volume_source_open_device_handle (priv->handle, &priv->error);
+	if (!priv->vol)
+		goto end;
+
+	if (media & BRASERO_MEDIUM_BD)
+		priv->min_speed = BD_RATE / 1000;
+	else if (media & BRASERO_MEDIUM_DVD)
+		priv->min_speed = DVD_RATE / 1000;
+	else
+		priv->min_speed = CD_RATE / 1000;
+
+	priv->transfer = BRASERO_SCSI_COPY_BLOCKS;
+	priv->skip = 1;
+	priv->clean = 0;
+	priv->bad = 0;
+	priv->speed = 0;
+	priv->no_speed = 0;
+
+	/* Rescuing needs to write the image in place */
+	if (priv->rescue) {
+		if (brasero_job_get_fd_out (BRASERO_JOB (self), NULL) != BRASERO_BURN_OK) {
+			brasero_scsi_copy_rescue (self, position, blocks);
+			goto end;
+		}
+
+		BRASERO_JOB_LOG (self, "Rescue mode not possible when piping data");
+	}
+
+	if (brasero_job_get_fd_out (BRASERO_JOB (self), NULL) != BRASERO_BURN_OK) {
+		gchar *output = NULL;
+
+		brasero_job_get_image_output (BRASERO_JOB (self), &output, NULL);
+		priv->output_fd = fopen (output, "w");
+		if (!priv->output_fd) {
+			priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+							   BRASERO_BURN_ERROR_GENERAL,
+							   g_strerror (errno));
+			g_free (output);
+			goto end;
+		}
+		g_free (output);
+	}
+
+	brasero_job_set_current_action (BRASERO_JOB (self),
+					BRASERO_BURN_ACTION_DRIVE_COPY,
+					NULL,
+					FALSE);
+	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
+
+	memset (&priv->reader, 0, sizeof (BraseroScsiCopyStage));
+	memset (&priv->writer, 0, sizeof (BraseroScsiCopyStage));
+
+	priv->free_buffers = g_async_queue_new ();
+	priv->full_buffers = g_async_queue_new ();
+	for (i = 0; i < BRASERO_SCSI_COPY_BUFFERS; i ++) {
+		buffer = g_new0 (BraseroScsiCopyBuffer, 1);
+		buffer->data = g_malloc (BRASERO_SCSI_COPY_BLOCK_SIZE * BRASERO_SCSI_COPY_BLOCKS);
+		g_async_queue_push (priv->free_buffers, buffer);
+	}
+
+	writer = g_thread_create (brasero_scsi_copy_write_thread,
+				  self,
+				  TRUE,
+				  &priv->error);
+	if (!writer)
+		goto end;
+
+	while (position < end) {
+		BraseroBurnResult result;
+		gint64 start;
+		guint num;
+
+		if (priv->cancel || priv->write_error)
+			break;
+
+		num = MIN (BRASERO_SCSI_COPY_BLOCKS, end - position);
+
+		/* Wait for the writing thread to give back a buffer */
+		start = g_get_monotonic_time ();
+		buffer = g_async_queue_pop (priv->free_buffers);
+		priv->reader.wait += g_get_monotonic_time () - start;
+
+		result = brasero_scsi_copy_fill (self, buffer->data, position, num);
+		if (result != BRASERO_BURN_OK) {
+			g_async_queue_push (priv->free_buffers, buffer);
+			break;
+		}
+
+		buffer->sectors = num;
+		g_async_queue_push (priv->full_buffers, buffer);
+		position += num;
+	}
+
+end:
+
+	if (writer) {
+		/* Tell the writing thread there is nothing left and wait for it
+		 * to have written everything */
+		buffer = g_async_queue_pop (priv->free_buffers);
+		buffer->sectors = 0;
+		g_async_queue_push (priv->full_buffers, buffer);
+		g_thread_join (writer);
+
+		brasero_scsi_copy_log_stage (self, "Reading", &priv->reader, "the writer");
+		brasero_scsi_copy_log_stage (self, "Writing", &priv->writer, "the reader");
+
+		if (priv->bad)
+			BRASERO_JOB_LOG (self,
+					 "%" G_GUINT64_FORMAT " unreadable sectors were zero filled",
+					 priv->bad);
+	}
+
+	if (priv->write_error) {
+		if (!priv->error)
+			priv->error = priv->write_error;
+		else
+			g_error_free (priv->write_error);
+
+		priv->write_error = NULL;
+	}
+
+	if (priv->free_buffers) {
+		while ((buffer = g_async_queue_try_pop (priv->free_buffers))) {
+			g_free (buffer->data);
+			g_free (buffer);
+		}
+
+		g_async_queue_unref (priv->free_buffers);
+		priv->free_buffers = NULL;
+	}
+
+	if (priv->full_buffers) {
+		g_async_queue_unref (priv->full_buffers);
+		priv->full_buffers = NULL;
+	}
+
+	if (priv->vol) {
+		/* Leave the drive the way it was */
+		brasero_scsi_copy_set_speed (self, 0);
+		brasero_volume_source_close (priv->vol);
+		priv->vol = NULL;
+	}
+
+	if (priv->handle) {
+		brasero_device_handle_close (priv->handle);
+		priv->handle = NULL;
+	}
+
+	if (priv->output_fd) {
+		fclose (priv->output_fd);
+		priv->output_fd = NULL;
+	}
+
+	if (!priv->cancel)
+		priv->thread_id = g_idle_add (brasero_scsi_copy_thread_finished, self);
+
+	/* End thread */
+	g_mutex_lock (priv->mutex);
+	priv->thread = NULL;
+	g_cond_signal (priv->cond);
+	g_mutex_unlock (priv->mutex);
+
+	g_thread_exit (NULL);
+
+	return NULL;
+}
+
+static BraseroBurnResult
+brasero_scsi_copy_start (BraseroJob *job,
+			 GError **error)
+{
+	BraseroScsiCopy *self;
+	BraseroJobAction action;
+	BraseroScsiCopyPrivate *priv;
+	GError *thread_error = NULL;
+
+	self = BRASERO_SCSI_COPY (job);
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	brasero_job_get_action (job, &action);
+	if (action == BRASERO_JOB_ACTION_SIZE) {
+		goffset blocks = 0;
+
+		if (brasero_scsi_copy_get_range (self, NULL, &blocks) != BRASERO_BURN_OK)
+			return BRASERO_BURN_ERR;
+
+		brasero_job_set_output_size_for_current_track (job,
+							       blocks,
+							       blocks * BRASERO_SCSI_COPY_BLOCK_SIZE);
+		return BRASERO_BURN_NOT_RUNNING;
+	}
+
+	if (action != BRASERO_JOB_ACTION_IMAGE)
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	if (priv->thread)
+		return BRASERO_BURN_RUNNING;
+
+	brasero_job_set_use_average_rate (job, TRUE);
+
+	g_mutex_lock (priv->mutex);
+	priv->thread = g_thread_create (brasero_scsi_copy_read_thread,
+					self,
+					FALSE,
+					&thread_error);
+	g_mutex_unlock (priv->mutex);
+
+	/* Reminder: this is not necessarily an error as the thread may have finished */
+	if (thread_error) {
+		g_propagate_error (error, thread_error);
+		return BRASERO_BURN_ERR;
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_scsi_copy_stop_real (BraseroScsiCopy *self)
+{
+	BraseroScsiCopyPrivate *priv;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (self);
+
+	g_mutex_lock (priv->mutex);
+	if (priv->thread) {
+		priv->cancel = 1;
+		g_cancellable_cancel (priv->cancellable);
+		g_cond_wait (priv->cond, priv->mutex);
+		g_cancellable_reset (priv->cancellable);
+		priv->cancel = 0;
+	}
+	g_mutex_unlock (priv->mutex);
+
+	if (priv->thread_id) {
+		g_source_remove (priv->thread_id);
+		priv->thread_id = 0;
+	}
+
+	if (priv->error) {
+		g_error_free (priv->error);
+		priv->error = NULL;
+	}
+}
+
+static BraseroBurnResult
+brasero_scsi_copy_stop (BraseroJob *job,
+			GError **error)
+{
+	brasero_scsi_copy_stop_real (BRASERO_SCSI_COPY (job));
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_scsi_copy_class_init (BraseroScsiCopyClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	BraseroJobClass *job_class = BRASERO_JOB_CLASS (klass);
+
+	g_type_class_add_private (klass, sizeof (BraseroScsiCopyPrivate));
+
+	parent_class = g_type_class_peek_parent (klass);
+	object_class->finalize = brasero_scsi_copy_finalize;
+
+	job_class->start = brasero_scsi_copy_start;
+	job_class->stop = brasero_scsi_copy_stop;
+}
+
+static void
+brasero_scsi_copy_init (BraseroScsiCopy *obj)
+{
+	BraseroScsiCopyPrivate *priv;
+	GSettings *settings;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (obj);
+
+	priv->mutex = g_mutex_new ();
+	priv->cond = g_cond_new ();
+	priv->cancellable = g_cancellable_new ();
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	priv->skip_errors = g_settings_get_boolean (settings, BRASERO_KEY_SCSI_COPY_SKIP_ERRORS);
+	priv->rescue = g_settings_get_boolean (settings, BRASERO_KEY_SCSI_COPY_RESCUE);
+	g_object_unref (settings);
+}
+
+static void
+brasero_scsi_copy_finalize (GObject *object)
+{
+	BraseroScsiCopyPrivate *priv;
+
+	priv = BRASERO_SCSI_COPY_PRIVATE (object);
+
+	brasero_scsi_copy_stop_real (BRASERO_SCSI_COPY (object));
+
+	if (priv->mutex) {
+		g_mutex_free (priv->mutex);
+		priv->mutex = NULL;
+	}
+
+	if (priv->cond) {
+		g_cond_free (priv->cond);
+		priv->cond = NULL;
+	}
+
+	if (priv->cancellable) {
+		g_object_unref (priv->cancellable);
+		priv->cancellable = NULL;
+	}
+
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+brasero_scsi_copy_export_caps (BraseroPlugin *plugin)
+{
+	BraseroPluginConfOption *skip_errors;
+	BraseroPluginConfOption *rescue;
+	GSList *output;
+	GSList *input;
+
+	brasero_plugin_define (plugin,
+			       "scsi-copy",
+			       /* Translators: this is the name of the plugin
+				* which will be translated only when it needs
+				* displaying. */
+			       N_("Native Disc Copy"),
+			       _("Copies data discs to a disc image without any external program"),
+			       "Philippe Rouquier",
+			       2);
+
+	output = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_FILE|
+					 BRASERO_PLUGIN_IO_ACCEPT_PIPE,
+					 BRASERO_IMAGE_FORMAT_BIN);
+
+	input = brasero_caps_disc_new (BRASERO_MEDIUM_CD|
+				       BRASERO_MEDIUM_DVD|
+				       BRASERO_MEDIUM_BD|
+				       BRASERO_MEDIUM_DUAL_L|
+				       BRASERO_MEDIUM_PLUS|
+				       BRASERO_MEDIUM_SEQUENTIAL|
+				       BRASERO_MEDIUM_RESTRICTED|
+				       BRASERO_MEDIUM_ROM|
+				       BRASERO_MEDIUM_WRITABLE|
+				       BRASERO_MEDIUM_REWRITABLE|
+				       BRASERO_MEDIUM_CLOSED|
+				       BRASERO_MEDIUM_APPENDABLE|
+				       BRASERO_MEDIUM_HAS_DATA);
+
+	brasero_plugin_link_caps (plugin, output, input);
+	g_slist_free (output);
+	g_slist_free (input);
+
+	skip_errors = brasero_plugin_conf_option_new (BRASERO_KEY_SCSI_COPY_SKIP_ERRORS,
+						      _("Replace unreadable sectors with zeros instead of stopping"),
+						      BRASERO_PLUGIN_OPTION_BOOL);
+	brasero_plugin_add_conf_option (plugin, skip_errors);
+
+	rescue = brasero_plugin_conf_option_new (BRASERO_KEY_SCSI_COPY_RESCUE,
+						 _("Rescue damaged discs: read good areas first, then retry damaged ones slowly (can be resumed)"),
+						 BRASERO_PLUGIN_OPTION_BOOL);
+	brasero_plugin_add_conf_option (plugin, rescue);
+}
@@ -644,6 +644,7 @@ brasero_normalize_export_caps (BraseroPlugin *plugin)
 			       _("Sets consistent sound levels between tracks"),
 			       "Philippe Rouquier",
 			       0);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	/* Add dts to make sure that when they are mixed with regular songs
 	 * this plugin will be called for the regular tracks */
@@ -0,0 +1,358 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "burn-transcode-cache.h"
+
+#define BRASERO_TRANSCODE_CACHE_SUFFIX		".pcm"
+
+/* Entries are shared with job outputs through hard links: making them read
+ * only ensures nothing writes to a cached song in place. */
+#define BRASERO_TRANSCODE_CACHE_MODE		(S_IRUSR|S_IRGRP|S_IROTH)
+
+struct _BraseroTranscodeCacheEntry {
+	gchar *path;
+	guint64 size;
+	time_t mtime;
+};
+typedef struct _BraseroTranscodeCacheEntry BraseroTranscodeCacheEntry;
+
+struct _BraseroTranscodeCacheCopy {
+	gchar *tmp;
+	gchar *dest;
+	guint64 limit;
+};
+typedef struct _BraseroTranscodeCacheCopy BraseroTranscodeCacheCopy;
+
+static gchar *
+brasero_transcode_cache_get_dir (void)
+{
+	gchar *dir;
+
+	dir = g_build_filename (g_get_user_cache_dir (),
+				"brasero",
+				"transcode",
+				NULL);
+	if (g_mkdir_with_parents (dir, S_IRWXU) == -1) {
+		g_free (dir);
+		return NULL;
+	}
+
+	return dir;
+}
+
+static gchar *
+brasero_transcode_cache_get_path (const gchar *key)
+{
+	gchar *name;
+	gchar *path;
+	gchar *dir;
+
+	dir = brasero_transcode_cache_get_dir ();
+	if (!dir)
+		return NULL;
+
+	name = g_strconcat (key, BRASERO_TRANSCODE_CACHE_SUFFIX, NULL);
+	path = g_build_filename (dir, name, NULL);
+	g_free (name);
+	g_free (dir);
+
+	return path;
+}
+
+gchar *
+brasero_transcode_cache_get_key (const gchar *uri,
+				 gint64 start,
+				 gint64 end,
+				 gdouble gain,
+				 gdouble peak,
+				 const gchar *format)
+{
+	gchar gain_str [G_ASCII_DTOSTR_BUF_SIZE];
+	gchar peak_str [G_ASCII_DTOSTR_BUF_SIZE];
+	GFileInfo *info;
+	GTimeVal mtime;
+	gchar *string;
+	GFile *file;
+	gchar *key;
+
+	/* If the source cannot be identified by its mtime and size then it
+	 * cannot be cached safely */
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE,
+				  NULL,
+				  NULL);
+	g_object_unref (file);
+
+	if (!info)
+		return NULL;
+
+	if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		g_object_unref (info);
+		return NULL;
+	}
+
+	g_file_info_get_modification_time (info, &mtime);
+
+	/* NOTE: doubles are printed the same way whatever the locale */
+	g_ascii_dtostr (gain_str, sizeof (gain_str), gain);
+	g_ascii_dtostr (peak_str, sizeof (peak_str), peak);
+
+	string = g_strdup_printf ("%s\n%li.%li\n%" G_GOFFSET_FORMAT "\n%" G_GINT64_FORMAT "\n%" G_GINT64_FORMAT "\n%s\n%s\n%s",
+				  uri,
+				  mtime.tv_sec,
+				  mtime.tv_usec,
+				  g_file_info_get_size (info),
+				  start,
+				  end,
+				  gain_str,
+				  peak_str,
+				  format);
+	g_object_unref (info);
+
+	key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, string, -1);
+	g_free (string);
+
+	return key;
+}
+
+gchar *
+brasero_transcode_cache_lookup (const gchar *key,
+				guint64 *size)
+{
+	struct stat buffer;
+	gchar *path;
+
+	path = brasero_transcode_cache_get_path (key);
+	if (!path || g_stat (path, &buffer) == -1 || !buffer.st_size) {
+		g_free (path);
+		return NULL;
+	}
+
+	/* An entry that can still be written to may have been modified
+	 * through one of its links (it was stored by an older version). */
+	if (buffer.st_mode & (S_IWUSR|S_IWGRP|S_IWOTH)) {
+		g_remove (path);
+		g_free (path);
+		return NULL;
+	}
+
+	/* Update the mtime so the entry becomes the most recently used one */
+	g_utime (path, NULL);
+
+	if (size)
+		*size = buffer.st_size;
+
+	return path;
+}
+
+static gint
+brasero_transcode_cache_entry_compare (gconstpointer a,
+				       gconstpointer b)
+{
+	const BraseroTranscodeCacheEntry *entry_a = a;
+	const BraseroTranscodeCacheEntry *entry_b = b;
+
+	if (entry_a->mtime < entry_b->mtime)
+		return -1;
+
+	if (entry_a->mtime > entry_b->mtime)
+		return 1;
+
+	return 0;
+}
+
+static void
+brasero_transcode_cache_entry_free (BraseroTranscodeCacheEntry *entry)
+{
+	g_free (entry->path);
+	g_free (entry);
+}
+
+static void
+brasero_transcode_cache_trim (guint64 limit)
+{
+	GSList *entries = NULL;
+	guint64 total = 0;
+	const gchar *name;
+	GSList *iter;
+	GDir *handle;
+	gchar *dir;
+
+	dir = brasero_transcode_cache_get_dir ();
+	if (!dir)
+		return;
+
+	handle = g_dir_open (dir, 0, NULL);
+	if (!handle) {
+		g_free (dir);
+		return;
+	}
+
+	while ((name = g_dir_read_name (handle))) {
+		BraseroTranscodeCacheEntry *entry;
+		struct stat buffer;
+		gchar *path;
+
+		if (!g_str_has_suffix (name, BRASERO_TRANSCODE_CACHE_SUFFIX))
+			continue;
+
+		path = g_build_filename (dir, name, NULL);
+		if (g_stat (path, &buffer) == -1) {
+			g_free (path);
+			continue;
+		}
+
+		entry = g_new0 (BraseroTranscodeCacheEntry, 1);
+		entry->path = path;
+		entry->size = buffer.st_size;
+		entry->mtime = buffer.st_mtime;
+		entries = g_slist_prepend (entries, entry);
+
+		total += entry->size;
+	}
+	g_dir_close (handle);
+	g_free (dir);
+
+	/* Remove the least recently used entries first */
+	entries = g_slist_sort (entries, brasero_transcode_cache_entry_compare);
+	for (iter = entries; iter && total > limit; iter = iter->next) {
+		BraseroTranscodeCacheEntry *entry;
+
+		entry = iter->data;
+		if (g_remove (entry->path) == 0)
+			total -= entry->size;
+	}
+
+	g_slist_foreach (entries, (GFunc) brasero_transcode_cache_entry_free, NULL);
+	g_slist_free (entries);
+}
+
+static void
+brasero_transcode_cache_copy_cb (GObject *object,
+				 GAsyncResult *result,
+				 gpointer user_data)
+{
+	BraseroTranscodeCacheCopy *copy = user_data;
+
+	if (g_file_copy_finish (G_FILE (object), result, NULL)
+	&&  g_chmod (copy->tmp, BRASERO_TRANSCODE_CACHE_MODE) == 0
+	&&  g_rename (copy->tmp, copy->dest) == 0)
+		brasero_transcode_cache_trim (copy->limit);
+	else
+		g_remove (copy->tmp);
+
+	g_free (copy->tmp);
+	g_free (copy->dest);
+	g_free (copy);
+}
+
+gboolean
+brasero_transcode_cache_store (const gchar *key,
+			       const gchar *path,
+			       guint64 limit)
+{
+	BraseroTranscodeCacheCopy *copy;
+	struct stat buffer;
+	GFile *source;
+	GFile *tmp;
+	gchar *dest;
+
+	if (g_stat (path, &buffer) == -1 || !buffer.st_size)
+		return FALSE;
+
+	/* Don't flush the whole cache for a single entry */
+	if (buffer.st_size > limit)
+		return FALSE;
+
+	dest = brasero_transcode_cache_get_path (key);
+	if (!dest)
+		return FALSE;
+
+	/* A hard link is free when the temporary directory and the cache live
+	 * on the same file system. The output is complete at this point so the
+	 * inode they share is made read only. Otherwise copy the file
+	 * asynchronously under a temporary name so a partial entry is never
+	 * looked up. */
+	if (link (path, dest) == 0) {
+		if (g_chmod (dest, BRASERO_TRANSCODE_CACHE_MODE) == -1) {
+			g_remove (dest);
+			g_free (dest);
+			return FALSE;
+		}
+
+		g_free (dest);
+		brasero_transcode_cache_trim (limit);
+		return TRUE;
+	}
+
+	if (errno == EEXIST) {
+		g_free (dest);
+		return TRUE;
+	}
+
+	copy = g_new0 (BraseroTranscodeCacheCopy, 1);
+	copy->dest = dest;
+	copy->tmp = g_strconcat (dest, ".tmp", NULL);
+	copy->limit = limit;
+
+	source = g_file_new_for_path (path);
+	tmp = g_file_new_for_path (copy->tmp);
+	g_file_copy_async (source,
+			   tmp,
+			   G_FILE_COPY_OVERWRITE,
+			   G_PRIORITY_LOW,
+			   NULL,
+			   NULL,
+			   NULL,
+			   brasero_transcode_cache_copy_cb,
+			   copy);
+	g_object_unref (source);
+	g_object_unref (tmp);
+
+	return TRUE;
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+
+#ifndef _BURN_TRANSCODE_CACHE_H_
+#define _BURN_TRANSCODE_CACHE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * On disk cache of decoded (raw PCM) songs. Entries are addressed by a
+ * digest of everything that changes the decoded output: the source uri,
+ * its mtime and size, the boundaries, the gain/peak values and the output
+ * format. Entries are read only since they may share their data with job
+ * outputs. Least recently used entries are removed once the cache grows
+ * beyond its limit.
+ */
+
+gchar *
+brasero_transcode_cache_get_key (const gchar *uri,
+				 gint64 start,
+				 gint64 end,
+				 gdouble gain,
+				 gdouble peak,
+				 const gchar *format);
+
+gchar *
+brasero_transcode_cache_lookup (const gchar *key,
+				guint64 *size);
+
+gboolean
+brasero_transcode_cache_store (const gchar *key,
+			       const gchar *path,
+			       guint64 limit);
+
+G_END_DECLS
+
+#endif /* _BURN_TRANSCODE_CACHE_H_ */
@@ -36,6 +36,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -49,8 +50,13 @@
 #include "brasero-tags.h"
 #include "burn-job.h"
 #include "brasero-plugin-registration.h"
+#include "burn-silence.h"
 #include "burn-normalize.h"
+#include "burn-transcode-cache.h"
 
+#define BRASERO_SCHEMA_CONFIG			"org.gnome.brasero.config"
+#define BRASERO_KEY_TRANSCODE_CACHE		"transcode-cache"
+#define BRASERO_KEY_TRANSCODE_CACHE_SIZE	"transcode-cache-size"
 
 #define BRASERO_TYPE_TRANSCODE         (brasero_transcode_get_type ())
 #define BRASERO_TRANSCODE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), BRASERO_TYPE_TRANSCODE, BraseroTranscode))
@@ -78,10 +84,16 @@ struct BraseroTranscodePrivate {
 	/* element to link decode to */
 	GstElement *link;
 
-	gint pad_size;
+	gint64 pad_size;
 	gint pad_fd;
 	gint pad_id;
 
+	GThread *pad_thread;
+	GMutex *pad_mutex;
+	GCond *pad_cond;
+	GCancellable *pad_cancel;
+	GError *pad_error;
+
 	gint64 size;
 	gint64 pos;
 
@@ -89,8 +101,14 @@ struct BraseroTranscodePrivate {
 	gint64 segment_start;
 	gint64 segment_end;
 
+	/* key of the current song in the cache and path of its cached copy */
+	gchar *cache_key;
+	gchar *cache_path;
+	guint64 cache_limit;
+
 	guint set_active_state:1;
 	guint mp3_size_pipeline:1;
+	guint use_cache:1;
 };
 typedef struct BraseroTranscodePrivate BraseroTranscodePrivate;
 
@@ -187,6 +205,22 @@ brasero_transcode_buffer_handler (GstPad *pad,
 	return GST_PAD_PROBE_OK;
 }
 
+static GstPadProbeReturn
+brasero_transcode_cache_buffer_handler (GstPad *pad,
+					GstPadProbeInfo *info,
+					gpointer user_data)
+{
+	BraseroTranscodePrivate *priv;
+	GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+	/* Cached songs are already cut and padded; only count bytes */
+	priv = BRASERO_TRANSCODE_PRIVATE (user_data);
+	priv->size += gst_buffer_get_size (buffer);
+	priv->pos += gst_buffer_get_size (buffer);
+
+	return GST_PAD_PROBE_OK;
+}
+
 static BraseroBurnResult
 brasero_transcode_set_boundaries (BraseroTranscode *transcode)
 {
@@ -270,6 +304,21 @@ brasero_transcode_create_volume (BraseroTranscode *transcode,
 	return volume;
 }
 
+static gboolean
+brasero_transcode_is_dts_passthrough (BraseroTranscode *transcode,
+				      BraseroTrack *track)
+{
+	GValue *value = NULL;
+
+	brasero_job_tag_lookup (BRASERO_JOB (transcode),
+				BRASERO_SESSION_STREAM_AUDIO_FORMAT,
+				&value);
+	if (!value || (g_value_get_int (value) & BRASERO_AUDIO_FORMAT_DTS) == 0)
+		return FALSE;
+
+	return (brasero_track_stream_get_format (BRASERO_TRACK_STREAM (track)) & BRASERO_AUDIO_FORMAT_DTS) != 0;
+}
+
 static gboolean
 brasero_transcode_create_pipeline_size_mp3 (BraseroTranscode *transcode,
 					    GstElement *pipeline,
@@ -364,12 +413,10 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 				   GError **error)
 {
 	gchar *uri;
-	gboolean keep_dts;
 	GstElement *decode;
 	GstElement *source;
 	GstBus *bus = NULL;
 	GstCaps *filtercaps;
-	GValue *value = NULL;
 	GstElement *pipeline;
 	GstElement *sink = NULL;
 	BraseroJobAction action;
@@ -412,7 +459,10 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 
 	/* source */
 	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
-	uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (track), TRUE);
+	if (priv->cache_path)
+		uri = g_filename_to_uri (priv->cache_path, NULL, NULL);
+	else
+		uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (track), TRUE);
 	source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
 	g_free (uri);
 
@@ -486,17 +536,45 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 		      "sync", FALSE,
 		      NULL);
 
-	brasero_job_tag_lookup (BRASERO_JOB (transcode),
-				BRASERO_SESSION_STREAM_AUDIO_FORMAT,
-				&value);
-	if (value)
-		keep_dts = (g_value_get_int (value) & BRASERO_AUDIO_FORMAT_DTS) != 0;
-	else
-		keep_dts = FALSE;
+	if (priv->cache_path && action == BRASERO_JOB_ACTION_IMAGE) {
+		GstPad *sinkpad;
+
+		BRASERO_JOB_LOG (transcode, "Cached song pipeline");
+
+		/* The cached copy is already decoded, cut and padded so it
+		 * only needs to be read */
+		if (volume)
+			gst_object_unref (volume);
+
+		if (!gst_element_link (source, sink)) {
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+			             _("Impossible to link plugin pads"));
+			goto error;
+		}
+
+		priv->pos = 0;
+		priv->size = 0;
+		sinkpad = gst_element_get_static_pad (sink, "sink");
+		priv->probe = gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+		                                 brasero_transcode_cache_buffer_handler,
+		                                 transcode, NULL);
+		gst_object_unref (sinkpad);
+
+		priv->link = NULL;
+		priv->sink = sink;
+		priv->decode = NULL;
+		priv->source = source;
+		priv->convert = NULL;
+		priv->pipeline = pipeline;
+
+		gst_element_set_state (pipeline, GST_STATE_PLAYING);
+		return TRUE;
+	}
 
-	if (keep_dts
-	&&  action == BRASERO_JOB_ACTION_IMAGE
-	&& (brasero_track_stream_get_format (BRASERO_TRACK_STREAM (track)) & BRASERO_AUDIO_FORMAT_DTS) != 0) {
+	if (action == BRASERO_JOB_ACTION_IMAGE
+	&&  brasero_transcode_is_dts_passthrough (transcode, track)) {
 		GstElement *wavparse;
 		GstPad *sinkpad;
 
@@ -903,6 +981,153 @@ brasero_transcode_has_track_sibling (BraseroTranscode *transcode,
 	return result;
 }
 
+/**
+ * These functions are to deal with the cache of decoded songs
+ */
+
+static gchar *
+brasero_transcode_get_cache_key (BraseroTranscode *transcode)
+{
+	BraseroStreamFormat session_format;
+	BraseroTrackType *output_type;
+	gdouble track_peak = 0.0;
+	gdouble track_gain = 0.0;
+	const gchar *format;
+	BraseroTrack *track;
+	GValue *value;
+	gint64 start;
+	gint64 end;
+	gchar *uri;
+	gchar *key;
+
+	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
+	start = brasero_track_stream_get_start (BRASERO_TRACK_STREAM (track));
+	end = brasero_track_stream_get_end (BRASERO_TRACK_STREAM (track));
+	if (end <= 0)
+		return NULL;
+
+	if (brasero_transcode_is_dts_passthrough (transcode, track))
+		format = "dts";
+	else {
+		output_type = brasero_track_type_new ();
+		brasero_job_get_output_type (BRASERO_JOB (transcode), output_type);
+		session_format = brasero_track_type_get_stream_format (output_type);
+		brasero_track_type_free (output_type);
+
+		if (session_format & BRASERO_AUDIO_FORMAT_RAW_LITTLE_ENDIAN)
+			format = "S16LE,2,44100";
+		else
+			format = "S16BE,2,44100";
+	}
+
+	if (brasero_track_tag_lookup (track, BRASERO_TRACK_PEAK_VALUE, &value) == BRASERO_BURN_OK)
+		track_peak = g_value_get_double (value);
+
+	if (brasero_track_tag_lookup (track, BRASERO_TRACK_GAIN_VALUE, &value) == BRASERO_BURN_OK)
+		track_gain = g_value_get_double (value);
+
+	uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (track), TRUE);
+	key = brasero_transcode_cache_get_key (uri,
+					       start,
+					       end,
+					       track_gain,
+					       track_peak,
+					       format);
+	g_free (uri);
+
+	return key;
+}
+
+static BraseroBurnResult
+brasero_transcode_create_cached_image (BraseroTranscode *transcode,
+				       GError **error)
+{
+	BraseroTranscodePrivate *priv;
+	BraseroTrackStream *dest;
+	BraseroTrack *track;
+	guint64 length = 0;
+	gchar *path_link;
+	gchar *path_dest;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	/* A hard link keeps the data even if the entry is removed from the
+	 * cache before the song is burnt. If that's not possible (different
+	 * file systems) the cached copy will be read through a pipeline.
+	 * The output file already exists (it was created by mkstemp) so link
+	 * to a name in the same directory and move it over the output rather
+	 * than writing to it. Since the entry is read only nothing can modify
+	 * it through the output afterwards either. */
+	brasero_job_get_audio_output (BRASERO_JOB (transcode), &path_dest);
+	path_link = g_strdup_printf ("%s.link", path_dest);
+	g_remove (path_link);
+	if (link (priv->cache_path, path_link) == -1) {
+		BRASERO_JOB_LOG (transcode, "can't link cached song (%s)", g_strerror (errno));
+		g_free (path_link);
+		g_free (path_dest);
+		return BRASERO_BURN_OK;
+	}
+
+	if (g_rename (path_link, path_dest) == -1) {
+		BRASERO_JOB_LOG (transcode, "can't move linked song (%s)", g_strerror (errno));
+		g_remove (path_link);
+		g_free (path_link);
+		g_free (path_dest);
+		return BRASERO_BURN_OK;
+	}
+	g_free (path_link);
+
+	dest = brasero_track_stream_new ();
+	brasero_track_stream_set_source (dest, path_dest);
+	g_free (path_dest);
+
+	brasero_track_stream_set_format (dest, BRASERO_AUDIO_FORMAT_RAW);
+
+	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
+	brasero_track_stream_get_length (BRASERO_TRACK_STREAM (track), &length);
+	brasero_track_stream_set_boundaries (dest, 0, length, 0);
+
+	brasero_track_tag_copy_missing (BRASERO_TRACK (dest), track);
+	brasero_job_add_track (BRASERO_JOB (transcode), BRASERO_TRACK (dest));
+	g_object_unref (dest);
+
+	return BRASERO_BURN_NOT_RUNNING;
+}
+
+static BraseroBurnResult
+brasero_transcode_search_cache (BraseroTranscode *transcode,
+				GError **error)
+{
+	BraseroTranscodePrivate *priv;
+	guint64 size = 0;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	g_free (priv->cache_key);
+	priv->cache_key = NULL;
+
+	g_free (priv->cache_path);
+	priv->cache_path = NULL;
+
+	if (!priv->use_cache)
+		return BRASERO_BURN_OK;
+
+	priv->cache_key = brasero_transcode_get_cache_key (transcode);
+	if (!priv->cache_key)
+		return BRASERO_BURN_OK;
+
+	priv->cache_path = brasero_transcode_cache_lookup (priv->cache_key, &size);
+	BRASERO_JOB_LOG (transcode, "cache %s", priv->cache_path ? "hit" : "miss");
+
+	if (!priv->cache_path)
+		return BRASERO_BURN_OK;
+
+	if (brasero_job_get_fd_out (BRASERO_JOB (transcode), NULL) == BRASERO_BURN_OK)
+		return BRASERO_BURN_OK;
+
+	return brasero_transcode_create_cached_image (transcode, error);
+}
+
 static BraseroBurnResult
 brasero_transcode_start (BraseroJob *job,
 			 GError **error)
@@ -949,6 +1174,11 @@ brasero_transcode_start (BraseroJob *job,
 				return result;
 		}
 
+		/* Look for a decoded copy of the song from a previous burn */
+		result = brasero_transcode_search_cache (transcode, error);
+		if (result != BRASERO_BURN_OK)
+			return result;
+
 		brasero_transcode_set_boundaries (transcode);
 		if (!brasero_transcode_create_pipeline (transcode, error))
 			return BRASERO_BURN_ERR;
@@ -987,73 +1217,63 @@ brasero_transcode_stop_pipeline (BraseroTranscode *transcode)
 	priv->set_active_state = 0;
 }
 
-static BraseroBurnResult
-brasero_transcode_stop (BraseroJob *job,
-			GError **error)
+static void
+brasero_transcode_stop_padding (BraseroTranscode *transcode)
 {
 	BraseroTranscodePrivate *priv;
 
-	priv = BRASERO_TRANSCODE_PRIVATE (job);
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
 
-	priv->mp3_size_pipeline = 0;
+	g_mutex_lock (priv->pad_mutex);
+	if (priv->pad_thread) {
+		g_cancellable_cancel (priv->pad_cancel);
+
+		/* The thread sets pad_thread to NULL before it signals */
+		while (priv->pad_thread)
+			g_cond_wait (priv->pad_cond, priv->pad_mutex);
+	}
+	g_mutex_unlock (priv->pad_mutex);
 
 	if (priv->pad_id) {
 		g_source_remove (priv->pad_id);
 		priv->pad_id = 0;
 	}
 
-	brasero_transcode_stop_pipeline (BRASERO_TRANSCODE (job));
-	return BRASERO_BURN_OK;
-}
+	if (priv->pad_fd != -1) {
+		close (priv->pad_fd);
+		priv->pad_fd = -1;
+	}
 
-/* we must make sure that the track size is a multiple
- * of 2352 to be burnt by cdrecord with on the fly */
+	if (priv->pad_error) {
+		g_error_free (priv->pad_error);
+		priv->pad_error = NULL;
+	}
+}
 
-static gint64
-brasero_transcode_pad_real (BraseroTranscode *transcode,
-			    int fd,
-			    gint64 bytes2write,
-			    GError **error)
+static BraseroBurnResult
+brasero_transcode_stop (BraseroJob *job,
+			GError **error)
 {
-	const int buffer_size = 512;
-	char buffer [buffer_size];
-	gint64 b_written;
-	gint64 size;
+	BraseroTranscodePrivate *priv;
 
-	b_written = 0;
-	bzero (buffer, sizeof (buffer));
-	for (; bytes2write; bytes2write -= b_written) {
-		size = bytes2write > buffer_size ? buffer_size : bytes2write;
-		b_written = write (fd, buffer, (int) size);
+	priv = BRASERO_TRANSCODE_PRIVATE (job);
 
-		BRASERO_JOB_LOG (transcode,
-				 "written %" G_GINT64_FORMAT " bytes for padding",
-				 b_written);
+	priv->mp3_size_pipeline = 0;
 
-		/* we should not handle EINTR and EAGAIN as errors */
-		if (b_written < 0) {
-			if (errno == EINTR || errno == EAGAIN) {
-				BRASERO_JOB_LOG (transcode, "got EINTR / EAGAIN, retrying");
-	
-				/* we'll try later again */
-				return bytes2write;
-			}
-		}
+	brasero_transcode_stop_padding (BRASERO_TRANSCODE (job));
 
-		if (size != b_written) {
-                        int errsv = errno;
+	if (priv->cache_key) {
+		g_free (priv->cache_key);
+		priv->cache_key = NULL;
+	}
 
-			g_set_error (error,
-				     BRASERO_BURN_ERROR,
-				     BRASERO_BURN_ERROR_GENERAL,
-				     /* Translators: %s is the string error from errno */
-				     _("Error while padding file (%s)"),
-				     g_strerror (errsv));
-			return -1;
-		}
+	if (priv->cache_path) {
+		g_free (priv->cache_path);
+		priv->cache_path = NULL;
 	}
 
-	return 0;
+	brasero_transcode_stop_pipeline (BRASERO_TRANSCODE (job));
+	return BRASERO_BURN_OK;
 }
 
 static void
@@ -1063,10 +1283,21 @@ brasero_transcode_push_track (BraseroTranscode *transcode)
 	gchar *output = NULL;
 	BraseroTrack *src = NULL;
 	BraseroTrackStream *track;
+	BraseroTranscodePrivate *priv;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
 
 	brasero_job_get_audio_output (BRASERO_JOB (transcode), &output);
 	brasero_job_get_current_track (BRASERO_JOB (transcode), &src);
 
+	/* The song was decoded and padded to a file: keep a copy for later */
+	if (priv->cache_key
+	&& !priv->cache_path
+	&&  brasero_job_get_fd_out (BRASERO_JOB (transcode), NULL) != BRASERO_BURN_OK) {
+		if (brasero_transcode_cache_store (priv->cache_key, output, priv->cache_limit))
+			BRASERO_JOB_LOG (transcode, "song stored in cache");
+	}
+
 	brasero_track_stream_get_length (BRASERO_TRACK_STREAM (src), &length);
 
 	track = brasero_track_stream_new ();
@@ -1088,44 +1319,63 @@ brasero_transcode_push_track (BraseroTranscode *transcode)
 }
 
 static gboolean
-brasero_transcode_pad_idle (BraseroTranscode *transcode)
+brasero_transcode_pad_finished (gpointer data)
 {
-	gint64 bytes2write;
-	GError *error = NULL;
+	BraseroTranscode *transcode = BRASERO_TRANSCODE (data);
 	BraseroTranscodePrivate *priv;
 
 	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
-	bytes2write = brasero_transcode_pad_real (transcode,
-						  priv->pad_fd,
-						  priv->pad_size,
-						  &error);
+	priv->pad_id = 0;
 
-	if (bytes2write == -1) {
-		priv->pad_id = 0;
+	close (priv->pad_fd);
+	priv->pad_fd = -1;
+
+	if (priv->pad_error) {
+		GError *error;
+
+		error = priv->pad_error;
+		priv->pad_error = NULL;
 		brasero_job_error (BRASERO_JOB (transcode), error);
 		return FALSE;
 	}
 
-	if (bytes2write) {
-		priv->pad_size = bytes2write;
-		return TRUE;
-	}
-
-	/* we are finished with padding */
-	priv->pad_id = 0;
-	close (priv->pad_fd);
-	priv->pad_fd = -1;
-
 	/* set the next song or finish */
 	brasero_transcode_push_track (transcode);
 	return FALSE;
 }
 
+static gpointer
+brasero_transcode_pad_thread (gpointer data)
+{
+	BraseroTranscodePrivate *priv;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (data);
+
+	brasero_silence_write (priv->pad_fd,
+			       priv->pad_size,
+			       priv->pad_cancel,
+			       &priv->pad_error);
+
+	/* Get out of the thread */
+	if (!g_cancellable_is_cancelled (priv->pad_cancel))
+		priv->pad_id = g_idle_add (brasero_transcode_pad_finished, data);
+
+	g_mutex_lock (priv->pad_mutex);
+	priv->pad_thread = NULL;
+	g_cond_signal (priv->pad_cond);
+	g_mutex_unlock (priv->pad_mutex);
+
+	g_thread_exit (NULL);
+
+	return NULL;
+}
+
 static gboolean
 brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 {
 	guint64 length = 0;
 	gint64 bytes2write = 0;
+	GError *thread_error = NULL;
 	BraseroTrack *track = NULL;
 	BraseroTranscodePrivate *priv;
 
@@ -1145,7 +1395,7 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 
 		/* Check bytes boundary for length */
 		b_written = BRASERO_DURATION_TO_BYTES (length);
-		b_written += (b_written % 2352) ? 2352 - (b_written % 2352):0;
+		b_written += brasero_silence_get_padding (b_written, 2352);
 		bytes2write = b_written - priv->pos;
 
 		BRASERO_JOB_LOG (transcode,
@@ -1162,7 +1412,7 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 
 		/* wrote more or the exact amount of bytes. Check bytes boundary */
 		b_written = priv->pos;
-		bytes2write = (b_written % 2352) ? 2352 - (b_written % 2352):0;
+		bytes2write = brasero_silence_get_padding (b_written, 2352);
 		BRASERO_JOB_LOG (transcode,
 				 "wrote %lli bytes (= %lli ns)"
 				 "\n=> padding %lli bytes",
@@ -1174,30 +1424,28 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 	if (!bytes2write)
 		return TRUE;
 
-	bytes2write = brasero_transcode_pad_real (transcode,
-						  fd,
-						  bytes2write,
-						  error);
-	if (bytes2write == -1)
+	/* when writing to a pipe it can happen that its buffer is full because
+	 * cdrecord is not fast enough. So the padding is written from a thread
+	 * that waits for the pipe to become available again. */
+	priv->pad_fd = fd;
+	priv->pad_size = bytes2write;
+	g_cancellable_reset (priv->pad_cancel);
+
+	g_mutex_lock (priv->pad_mutex);
+	priv->pad_thread = g_thread_create (brasero_transcode_pad_thread,
+					    transcode,
+					    FALSE,
+					    &thread_error);
+	g_mutex_unlock (priv->pad_mutex);
+
+	/* Reminder: this is not necessarily an error as the thread may have finished */
+	if (thread_error) {
+		g_propagate_error (error, thread_error);
+		priv->pad_fd = -1;
 		return TRUE;
-
-	if (bytes2write) {
-		BraseroTranscodePrivate *priv;
-
-		priv = BRASERO_TRANSCODE_PRIVATE (transcode);
-		/* when writing to a pipe it can happen that its buffer is full
-		 * because cdrecord is not fast enough. Therefore we couldn't
-		 * write/pad it and we'll have to wait for the pipe to become
-		 * available again */
-		priv->pad_fd = fd;
-		priv->pad_size = bytes2write;
-		priv->pad_id = g_timeout_add (50,
-					     (GSourceFunc) brasero_transcode_pad_idle,
-					      transcode);
-		return FALSE;		
 	}
 
-	return TRUE;
+	return FALSE;
 }
 
 static gboolean
@@ -1705,7 +1953,22 @@ brasero_transcode_class_init (BraseroTranscodeClass *klass)
 
 static void
 brasero_transcode_init (BraseroTranscode *obj)
-{ }
+{
+	GSettings *settings;
+	BraseroTranscodePrivate *priv;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (obj);
+
+	priv->pad_fd = -1;
+	priv->pad_mutex = g_mutex_new ();
+	priv->pad_cond = g_cond_new ();
+	priv->pad_cancel = g_cancellable_new ();
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	priv->use_cache = g_settings_get_boolean (settings, BRASERO_KEY_TRANSCODE_CACHE);
+	priv->cache_limit = (guint64) MAX (g_settings_get_int (settings, BRASERO_KEY_TRANSCODE_CACHE_SIZE), 0) * 1048576;
+	g_object_unref (settings);
+}
 
 static void
 brasero_transcode_finalize (GObject *object)
@@ -1714,19 +1977,27 @@ brasero_transcode_finalize (GObject *object)
 
 	priv = BRASERO_TRANSCODE_PRIVATE (object);
 
-	if (priv->pad_id) {
-		g_source_remove (priv->pad_id);
-		priv->pad_id = 0;
-	}
+	brasero_transcode_stop_padding (BRASERO_TRANSCODE (object));
+
+	g_free (priv->cache_key);
+	priv->cache_key = NULL;
+
+	g_free (priv->cache_path);
+	priv->cache_path = NULL;
 
 	brasero_transcode_stop_pipeline (BRASERO_TRANSCODE (object));
 
+	g_object_unref (priv->pad_cancel);
+	g_mutex_free (priv->pad_mutex);
+	g_cond_free (priv->pad_cond);
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
 brasero_transcode_export_caps (BraseroPlugin *plugin)
 {
+	BraseroPluginConfOption *cache, *cache_size;
 	GSList *input;
 	GSList *output;
 
@@ -1774,4 +2045,16 @@ brasero_transcode_export_caps (BraseroPlugin *plugin)
 	brasero_plugin_link_caps (plugin, output, input);
 	g_slist_free (output);
 	g_slist_free (input);
+
+	/* add some configure options */
+	cache = brasero_plugin_conf_option_new (BRASERO_KEY_TRANSCODE_CACHE,
+						_("Keep decoded songs to speed up later burns"),
+						BRASERO_PLUGIN_OPTION_BOOL);
+	cache_size = brasero_plugin_conf_option_new (BRASERO_KEY_TRANSCODE_CACHE_SIZE,
+						     _("Maximum size of decoded songs kept (in MiB):"),
+						     BRASERO_PLUGIN_OPTION_INT);
+	brasero_plugin_conf_option_int_set_range (cache_size, 64, 65536);
+
+	brasero_plugin_conf_option_bool_add_suboption (cache, cache_size);
+	brasero_plugin_add_conf_option (plugin, cache);
 }
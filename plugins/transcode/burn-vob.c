@@ -1353,6 +1353,7 @@ brasero_vob_export_caps (BraseroPlugin *plugin)
 			       _("Converts any video file into a format suitable for video DVDs"),
 			       "Philippe Rouquier",
 			       0);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	input = brasero_caps_audio_new (BRASERO_PLUGIN_IO_ACCEPT_FILE,
 					BRASERO_AUDIO_FORMAT_UNDEFINED|
@@ -478,6 +478,7 @@ brasero_vcd_imager_export_caps (BraseroPlugin *plugin)
 			       _("Creates disc images suitable for SVCDs"),
 			       "Philippe Rouquier",
 			       1);
+	brasero_plugin_set_check_thread_safe (plugin, TRUE);
 
 	input = brasero_caps_audio_new (BRASERO_PLUGIN_IO_ACCEPT_FILE,
 					BRASERO_AUDIO_FORMAT_MP2|
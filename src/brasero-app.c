@@ -848,7 +848,6 @@ brasero_app_data (BraseroApp *app,
 	BraseroTrackDataCfg *track;
 	BraseroSessionCfg *session;
 	BraseroAppPrivate *priv;
-	int i, num;
 
 	priv = BRASERO_APP_PRIVATE (app);
 
@@ -878,19 +877,8 @@ brasero_app_data (BraseroApp *app,
 	brasero_burn_session_add_track (BRASERO_BURN_SESSION (session), BRASERO_TRACK (track), NULL);
 	g_object_unref (track);
 
-	num = g_strv_length ((gchar **) uris);
-	for (i = 0; i < num; i ++) {
-		GFile *file;
-		gchar *uri;
-
-		file = g_file_new_for_commandline_arg (uris [i]);
-		uri = g_file_get_uri (file);
-		g_object_unref (file);
-
-		/* Ignore the return value */
-		brasero_track_data_cfg_add (track, uri, NULL);
-		g_free (uri);
-	}
+	/* Ignore the return value */
+	brasero_track_data_cfg_add_many (track, (const gchar * const *) uris, NULL, NULL);
 
 	brasero_burn_session_set_burner (BRASERO_BURN_SESSION (session), burner);
 	brasero_app_process_session (app, session, burn);
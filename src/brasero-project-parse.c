@@ -30,6 +30,9 @@
 #  include <config.h>
 #endif
 
+#include <time.h>
+#include <sys/stat.h>
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib/gi18n.h>
@@ -37,6 +40,7 @@
 #include <libxml/xmlerror.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xmlstring.h>
 #include <libxml/uri.h>
 
@@ -55,6 +59,9 @@
 
 #define BRASERO_PROJECT_VERSION "0.2"
 
+/* Number of grafts read before they are handed to the data track */
+#define BRASERO_PROJECT_GRAFTS_BATCH	256
+
 static void
 brasero_project_invalid_project_dialog (const char *reason)
 {
@@ -114,77 +121,355 @@ error:
 	return NULL;
 }
 
+/**
+ * Projects are read with a xmlTextReader so that the whole file never needs to
+ * be held in memory as a tree. Only the subtree of the element being handled
+ * is expanded; the reader releases it once it moves past it.
+ */
+
+static gboolean
+_reader_next_child (xmlTextReaderPtr reader,
+		    gint depth,
+		    gboolean *error)
+{
+	gint res;
+
+	/* Moves to the next element whose parent is at @depth. If we are on the
+	 * previous one, its subtree has already been handled so skip it. */
+	if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT
+	&&  xmlTextReaderDepth (reader) == depth + 1)
+		res = xmlTextReaderNext (reader);
+	else
+		res = xmlTextReaderRead (reader);
+
+	while (res == 1) {
+		gint node_depth;
+		gint type;
+
+		node_depth = xmlTextReaderDepth (reader);
+		type = xmlTextReaderNodeType (reader);
+
+		if (node_depth == depth && type == XML_READER_TYPE_END_ELEMENT)
+			return FALSE;
+
+		if (node_depth == depth + 1 && type == XML_READER_TYPE_ELEMENT)
+			return TRUE;
+
+		res = xmlTextReaderRead (reader);
+	}
+
+	/* The parent was never closed */
+	*error = TRUE;
+	return FALSE;
+}
+
+/**
+ * The state of the directories explored in a data project is kept in a
+ * separate file in the user cache directory, named after the project uri.
+ * Files of projects that were neither loaded nor saved for a while (they
+ * were most likely deleted or moved) are removed whenever one is saved.
+ */
+
+#define SNAPSHOT_CACHE_MAX_AGE		(30 * 24 * 60 * 60)
+
+static gchar *
+_get_snapshot_cache_dir (void)
+{
+	gchar *dir;
+
+	dir = g_build_filename (g_get_user_cache_dir (),
+				"brasero",
+				"snapshots",
+				NULL);
+	if (g_mkdir_with_parents (dir, S_IRWXU) == -1) {
+		g_free (dir);
+		return NULL;
+	}
+
+	return dir;
+}
+
+static gchar *
+_get_snapshot_cache_path (const gchar *project_uri)
+{
+	gchar *checksum;
+	gchar *name;
+	gchar *path;
+	gchar *dir;
+
+	dir = _get_snapshot_cache_dir ();
+	if (!dir)
+		return NULL;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, project_uri, -1);
+	name = g_strdup_printf ("%s.xml", checksum);
+	g_free (checksum);
+
+	path = g_build_filename (dir, name, NULL);
+	g_free (name);
+	g_free (dir);
+
+	return path;
+}
+
+static void
+_prune_snapshot_cache (void)
+{
+	const gchar *name;
+	GDir *handle;
+	gchar *dir;
+	time_t now;
+
+	dir = _get_snapshot_cache_dir ();
+	if (!dir)
+		return;
+
+	handle = g_dir_open (dir, 0, NULL);
+	if (!handle) {
+		g_free (dir);
+		return;
+	}
+
+	now = time (NULL);
+	while ((name = g_dir_read_name (handle))) {
+		struct stat buffer;
+		gchar *path;
+
+		if (!g_str_has_suffix (name, ".xml"))
+			continue;
+
+		path = g_build_filename (dir, name, NULL);
+		if (!g_stat (path, &buffer)
+		&&  now - buffer.st_mtime > SNAPSHOT_CACHE_MAX_AGE)
+			g_remove (path);
+
+		g_free (path);
+	}
+
+	g_dir_close (handle);
+	g_free (dir);
+}
+
+static void
+_load_snapshot_cache (BraseroTrackDataCfg *track,
+		      const gchar *project_uri)
+{
+	xmlTextReaderPtr reader;
+	gchar *path;
+	gint res;
+
+	if (!project_uri)
+		return;
+
+	path = _get_snapshot_cache_path (project_uri);
+	if (!path)
+		return;
+
+	if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+		g_free (path);
+		return;
+	}
+
+	/* Keep it from being pruned while the project is in use */
+	g_utime (path, NULL);
+
+	reader = xmlReaderForFile (path, NULL, 0);
+	g_free (path);
+	if (!reader)
+		return;
+
+	/* An invalid snapshot only means the directory is explored */
+	while ((res = xmlTextReaderRead (reader)) == 1) {
+		xmlChar *snapshot;
+
+		if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT
+		||  xmlStrcmp (xmlTextReaderConstName (reader), (const xmlChar *) "snapshot"))
+			continue;
+
+		snapshot = xmlTextReaderReadString (reader);
+		if (!snapshot)
+			continue;
+
+		brasero_track_data_cfg_add_snapshot (track, (gchar *) snapshot);
+		xmlFree (snapshot);
+	}
+
+	xmlFreeTextReader (reader);
+}
+
+static void
+_save_snapshot_cache (BraseroTrackDataCfg *track,
+		      const gchar *project_uri)
+{
+	xmlTextWriter *writer;
+	GSList *snapshots;
+	GSList *iter;
+	gint success;
+	gchar *path;
+
+	path = _get_snapshot_cache_path (project_uri);
+	if (!path)
+		return;
+
+	snapshots = brasero_track_data_cfg_get_snapshot (track);
+	if (!snapshots) {
+		g_remove (path);
+		g_free (path);
+		return;
+	}
+
+	writer = xmlNewTextWriterFilename (path, 0);
+	if (!writer)
+		goto end;
+
+	success = xmlTextWriterStartDocument (writer, NULL, "UTF-8", NULL);
+	if (success < 0)
+		goto error;
+
+	success = xmlTextWriterStartElement (writer, (xmlChar *) "snapshots");
+	if (success < 0)
+		goto error;
+
+	for (iter = snapshots; iter; iter = iter->next) {
+		success = xmlTextWriterWriteElement (writer, (xmlChar *) "snapshot", (xmlChar *) iter->data);
+		if (success < 0)
+			goto error;
+	}
+
+	success = xmlTextWriterEndElement (writer); /* snapshots */
+	if (success < 0)
+		goto error;
+
+	xmlTextWriterEndDocument (writer);
+	xmlFreeTextWriter (writer);
+	goto end;
+
+error:
+
+	xmlTextWriterEndDocument (writer);
+	xmlFreeTextWriter (writer);
+	g_remove (path);
+
+end:
+
+	g_slist_foreach (snapshots, (GFunc) g_free, NULL);
+	g_slist_free (snapshots);
+	g_free (path);
+
+	_prune_snapshot_cache ();
+}
+
+static gboolean
+_read_data_track_item (xmlDocPtr project,
+		       xmlNodePtr item,
+		       BraseroTrackDataCfg *track,
+		       GSList **grafts,
+		       GSList **excluded)
+{
+	if (!xmlStrcmp (item->name, (const xmlChar *) "graft")) {
+		if (!(*grafts = _read_graft_point (project, item->xmlChildrenNode, *grafts)))
+			return FALSE;
+	}
+	else if (!xmlStrcmp (item->name, (const xmlChar *) "icon")) {
+		xmlChar *icon_path;
+
+		icon_path = xmlNodeListGetString (project,
+						  item->xmlChildrenNode,
+						  1);
+		if (!icon_path)
+			return FALSE;
+
+		brasero_track_data_cfg_set_icon (track, (gchar *) icon_path, NULL);
+		g_free (icon_path);
+	}
+	else if (!xmlStrcmp (item->name, (const xmlChar *) "restored")) {
+		xmlChar *restored;
+
+		restored = xmlNodeListGetString (project,
+						 item->xmlChildrenNode,
+						 1);
+		if (!restored)
+			return FALSE;
+
+		brasero_track_data_cfg_dont_filter_uri (track, (gchar *) restored);
+		g_free (restored);
+	}
+	else if (!xmlStrcmp (item->name, (const xmlChar *) "excluded")) {
+		xmlChar *excluded_uri;
+
+		excluded_uri = xmlNodeListGetString (project,
+						     item->xmlChildrenNode,
+						     1);
+		if (!excluded_uri)
+			return FALSE;
+
+		*excluded = g_slist_prepend (*excluded, xmlURIUnescapeString ((char*) excluded_uri, 0, NULL));
+		g_free (excluded_uri);
+	}
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
 static BraseroTrack *
-_read_data_track (xmlDocPtr project,
-		  xmlNodePtr item)
+_read_data_track (xmlTextReaderPtr reader,
+		  const gchar *project_uri)
 {
 	BraseroTrackDataCfg *track;
-        GSList *grafts= NULL;
-        GSList *excluded = NULL;
+	GSList *grafts= NULL;
+	GSList *excluded = NULL;
+	gboolean error = FALSE;
+	guint num_grafts = 0;
+	gint depth;
 
 	track = brasero_track_data_cfg_new ();
+	_load_snapshot_cache (track, project_uri);
 
-	while (item) {
-		if (!xmlStrcmp (item->name, (const xmlChar *) "graft")) {
-			if (!(grafts = _read_graft_point (project, item->xmlChildrenNode, grafts)))
-				goto error;
-		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "icon")) {
-			xmlChar *icon_path;
-
-			icon_path = xmlNodeListGetString (project,
-							  item->xmlChildrenNode,
-							  1);
-			if (!icon_path)
-				goto error;
-
-			brasero_track_data_cfg_set_icon (track, (gchar *) icon_path, NULL);
-                        g_free (icon_path);
-		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "restored")) {
-			xmlChar *restored;
+	depth = xmlTextReaderDepth (reader);
+	if (!xmlTextReaderIsEmptyElement (reader)) {
+		while (_reader_next_child (reader, depth, &error)) {
+			xmlNodePtr item;
 
-			restored = xmlNodeListGetString (project,
-							 item->xmlChildrenNode,
-							 1);
-			if (!restored)
+			/* Each entry is added to the lists as soon as it is
+			 * read and its node is released afterwards */
+			item = xmlTextReaderExpand (reader);
+			if (!item)
 				goto error;
 
-                        brasero_track_data_cfg_dont_filter_uri (track, (gchar *) restored);
-                        g_free (restored);
-		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "excluded")) {
-			xmlChar *excluded_uri;
-
-			excluded_uri = xmlNodeListGetString (project,
-							     item->xmlChildrenNode,
-							     1);
-			if (!excluded_uri)
+			if (!_read_data_track_item (item->doc, item, track, &grafts, &excluded))
 				goto error;
 
-			excluded = g_slist_prepend (excluded, xmlURIUnescapeString ((char*) excluded_uri, 0, NULL));
-			g_free (excluded_uri);
+			/* The grafts are added to the tree as they are read
+			 * so they are never all held in lists at once. They
+			 * can't be loaded before the excluded URIs are known
+			 * though; these come after them in the file. */
+			if (!xmlStrcmp (item->name, (const xmlChar *) "graft")
+			&&  ++ num_grafts >= BRASERO_PROJECT_GRAFTS_BATCH) {
+				brasero_track_data_cfg_add_grafts (track, g_slist_reverse (grafts));
+				grafts = NULL;
+				num_grafts = 0;
+			}
 		}
-		else if (item->type == XML_ELEMENT_NODE)
-			goto error;
-
-		item = item->next;
 	}
 
-        grafts = g_slist_reverse (grafts);
-        excluded = g_slist_reverse (excluded);
-        brasero_track_data_set_source (BRASERO_TRACK_DATA (track),
-                                                           grafts,
-                                                           excluded);
+	if (error)
+		goto error;
+
+	grafts = g_slist_reverse (grafts);
+	excluded = g_slist_reverse (excluded);
+	brasero_track_data_set_source (BRASERO_TRACK_DATA (track),
+				       grafts,
+				       excluded);
 	return BRASERO_TRACK (track);
 
 error:
 
-        g_slist_foreach (grafts, (GFunc) brasero_graft_point_free, NULL);
-        g_slist_free (grafts);
+	g_slist_foreach (grafts, (GFunc) brasero_graft_point_free, NULL);
+	g_slist_free (grafts);
 
-        g_slist_foreach (excluded, (GFunc) g_free, NULL);
-        g_slist_free (excluded);
+	g_slist_foreach (excluded, (GFunc) g_free, NULL);
+	g_slist_free (excluded);
 
 	g_object_unref (track);
 
@@ -362,62 +647,51 @@ error:
 	return NULL;
 }
 
-static gboolean
-_get_tracks (xmlDocPtr project,
-	     xmlNodePtr track_node,
-	     BraseroBurnSession *session)
+static GSList *
+_get_tracks (xmlTextReaderPtr reader,
+	     const gchar *project_uri)
 {
 	GSList *tracks = NULL;
-	GSList *iter;
+	gboolean error = FALSE;
+	gint depth;
 
-	track_node = track_node->xmlChildrenNode;
+	depth = xmlTextReaderDepth (reader);
+	if (xmlTextReaderIsEmptyElement (reader))
+		return NULL;
 
-	while (track_node) {
+	while (_reader_next_child (reader, depth, &error)) {
+		const xmlChar *name;
 		BraseroTrack *newtrack;
 
-		if (!xmlStrcmp (track_node->name, (const xmlChar *) "audio")) {
-			newtrack = _read_audio_track (project, track_node->xmlChildrenNode, FALSE);
-			if (!newtrack)
-				goto error;
-
-			tracks = g_slist_append (tracks, newtrack);
-		}
-		else if (!xmlStrcmp (track_node->name, (const xmlChar *) "data")) {
-			newtrack = _read_data_track (project, track_node->xmlChildrenNode);
+		name = xmlTextReaderConstName (reader);
+		if (!xmlStrcmp (name, (const xmlChar *) "audio")
+		||  !xmlStrcmp (name, (const xmlChar *) "video")) {
+			xmlNodePtr node;
 
-			if (!newtrack)
+			/* These tracks are small enough to be read at once */
+			node = xmlTextReaderExpand (reader);
+			if (!node)
 				goto error;
 
-			tracks = g_slist_append (tracks, newtrack);
+			newtrack = _read_audio_track (node->doc,
+						      node->xmlChildrenNode,
+						      !xmlStrcmp (name, (const xmlChar *) "video"));
 		}
-		else if (!xmlStrcmp (track_node->name, (const xmlChar *) "video")) {
-			newtrack = _read_audio_track (project, track_node->xmlChildrenNode, TRUE);
-
-			if (!newtrack)
-				goto error;
+		else if (!xmlStrcmp (name, (const xmlChar *) "data"))
+			newtrack = _read_data_track (reader, project_uri);
+		else
+			goto error;
 
-			tracks = g_slist_append (tracks, newtrack);
-		}
-		else if (track_node->type == XML_ELEMENT_NODE)
+		if (!newtrack)
 			goto error;
 
-		track_node = track_node->next;
+		tracks = g_slist_prepend (tracks, newtrack);
 	}
 
-	if (!tracks)
+	if (error || !tracks)
 		goto error;
 
-	for (iter = tracks; iter; iter = iter->next) {
-		BraseroTrack *newtrack;
-
-		newtrack = iter->data;
-		brasero_burn_session_add_track (session, newtrack, NULL);
-		g_object_unref (newtrack);
-	}
-
-	g_slist_free (tracks);
-
-	return TRUE;
+	return g_slist_reverse (tracks);
 
 error :
 
@@ -426,7 +700,21 @@ error :
 		g_slist_free (tracks);
 	}
 
-	return FALSE;
+	return NULL;
+}
+
+static gchar *
+_read_string (xmlTextReaderPtr reader)
+{
+	xmlNodePtr node;
+
+	node = xmlTextReaderExpand (reader);
+	if (!node)
+		return NULL;
+
+	return (gchar *) xmlNodeListGetString (node->doc,
+					       node->xmlChildrenNode,
+					       1);
 }
 
 gboolean
@@ -434,26 +722,32 @@ brasero_project_open_project_xml (const gchar *uri,
 				  BraseroBurnSession *session,
 				  gboolean warn_user)
 {
-	xmlNodePtr track_node = NULL;
+	xmlTextReaderPtr reader;
+	GSList *tracks = NULL;
+	gboolean error = FALSE;
 	gchar *label = NULL;
 	gchar *cover = NULL;
-	xmlDocPtr project;
-	xmlNodePtr item;
-	gboolean retval;
+	gchar *project_uri;
+	GSList *iter;
 	GFile *file;
 	gchar *path;
+	gint res;
 
 	file = g_file_new_for_commandline_arg (uri);
 	path = g_file_get_path (file);
+	project_uri = g_file_get_uri (file);
 	g_object_unref (file);
-	if (!path)
+	if (!path) {
+		g_free (project_uri);
 		return FALSE;
+	}
 
 	/* start parsing xml doc */
-	project = xmlParseFile (path);
+	reader = xmlReaderForFile (path, NULL, 0);
     	g_free (path);
 
-	if (!project) {
+	if (!reader) {
+		g_free (project_uri);
 	    	if (warn_user)
 			brasero_project_invalid_project_dialog (_("The project could not be opened"));
 
@@ -461,60 +755,87 @@ brasero_project_open_project_xml (const gchar *uri,
 	}
 
 	/* parses the "header" */
-	item = xmlDocGetRootElement (project);
-	if (!item) {
-	    	if (warn_user)
-			brasero_project_invalid_project_dialog (_("The file is empty"));
+	while ((res = xmlTextReaderRead (reader)) == 1) {
+		if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT)
+			break;
+	}
+
+	if (res != 1) {
+	    	if (warn_user) {
+			if (res == 0)
+				brasero_project_invalid_project_dialog (_("The file is empty"));
+			else
+				brasero_project_invalid_project_dialog (_("The project could not be opened"));
+		}
 
-		xmlFreeDoc (project);
+		g_free (project_uri);
+		xmlFreeTextReader (reader);
 		return FALSE;
 	}
 
-	if (xmlStrcmp (item->name, (const xmlChar *) "braseroproject")
-	||  item->next)
+	if (xmlStrcmp (xmlTextReaderConstName (reader), (const xmlChar *) "braseroproject")
+	||  xmlTextReaderIsEmptyElement (reader))
 		goto error;
 
-	item = item->children;
-	while (item) {
-		if (!xmlStrcmp (item->name, (const xmlChar *) "version")) {
+	while (_reader_next_child (reader, 0, &error)) {
+		const xmlChar *name;
+
+		name = xmlTextReaderConstName (reader);
+		if (!xmlStrcmp (name, (const xmlChar *) "version")) {
 			/* simply ignore it */
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "label")) {
-			label = (gchar *) xmlNodeListGetString (project,
-								item->xmlChildrenNode,
-								1);
+		else if (!xmlStrcmp (name, (const xmlChar *) "label")) {
+			if (label)
+				g_free (label);
+
+			label = _read_string (reader);
 			if (!(label))
 				goto error;
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "cover")) {
-			xmlChar *escaped;
+		else if (!xmlStrcmp (name, (const xmlChar *) "cover")) {
+			gchar *escaped;
 
-			escaped = xmlNodeListGetString (project,
-							item->xmlChildrenNode,
-							1);
+			escaped = _read_string (reader);
 			if (!escaped)
 				goto error;
 
-			cover = g_uri_unescape_string ((char *) escaped, NULL);
+			if (cover)
+				g_free (cover);
+
+			cover = g_uri_unescape_string (escaped, NULL);
 			g_free (escaped);
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "track")) {
-			if (track_node)
+		else if (!xmlStrcmp (name, (const xmlChar *) "track")) {
+			if (tracks)
 				goto error;
 
-			track_node = item;
+			tracks = _get_tracks (reader, project_uri);
+			if (!tracks)
+				goto error;
 		}
-		else if (item->type == XML_ELEMENT_NODE)
+		else
 			goto error;
-
-		item = item->next;
 	}
 
-	retval = _get_tracks (project, track_node, session);
-	if (!retval)
+	if (error || !tracks)
+		goto error;
+
+	/* Make sure the end of the file is valid as well */
+	while ((res = xmlTextReaderRead (reader)) == 1);
+	if (res < 0)
 		goto error;
 
-	xmlFreeDoc (project);
+	xmlFreeTextReader (reader);
+	g_free (project_uri);
+
+	for (iter = tracks; iter; iter = iter->next) {
+		BraseroTrack *newtrack;
+
+		newtrack = iter->data;
+		brasero_burn_session_add_track (session, newtrack, NULL);
+		g_object_unref (newtrack);
+	}
+	g_slist_free (tracks);
 
         brasero_burn_session_set_label (session, label);
         g_free (label);
@@ -532,16 +853,22 @@ brasero_project_open_project_xml (const gchar *uri,
                 g_free (cover);
         }
 
-        return retval;
+        return TRUE;
 
 error:
 
+	if (tracks) {
+		g_slist_foreach (tracks, (GFunc) g_object_unref, NULL);
+		g_slist_free (tracks);
+	}
+
 	if (cover)
 		g_free (cover);
 	if (label)
 		g_free (label);
 
-	xmlFreeDoc (project);
+	g_free (project_uri);
+	xmlFreeTextReader (reader);
     	if (warn_user)
 		brasero_project_invalid_project_dialog (_("It does not seem to be a valid Brasero project"));
 
@@ -728,7 +1055,8 @@ _save_audio_track_xml (xmlTextWriter *project,
 
 static gboolean
 _save_data_track_xml (xmlTextWriter *project,
-		      BraseroBurnSession *session)
+		      BraseroBurnSession *session,
+		      const gchar *project_uri)
 {
 	gchar *uri;
 	gint success;
@@ -800,6 +1128,11 @@ _save_data_track_xml (xmlTextWriter *project,
 			return FALSE;
 	}
 
+	/* save the state of explored directories so unchanged ones are not
+	 * explored again when the project is opened. It doesn't go in the
+	 * project file itself since older versions would reject it. */
+	_save_snapshot_cache (track, project_uri);
+
 	/* NOTE: we don't write symlinks and unreadable they are useless */
 	return TRUE;
 }
@@ -908,7 +1241,7 @@ brasero_project_save_project_xml (BraseroBurnSession *session,
 			if (success < 0)
 				goto error;
 
-			retval = _save_data_track_xml (project, session);
+			retval = _save_data_track_xml (project, session, uri);
 			if (!retval)
 				goto error;
 